@@ -2,27 +2,47 @@
 
 #include "BaseFilesDownloader.h"
 #include "RuntimeFilesDownloaderDefines.h"
+#include "RuntimeFilesDownloaderProfiling.h"
 #include "Containers/UnrealString.h"
 #include "ImageUtils.h"
 #include "RuntimeChunkDownloader.h"
-#include "Engine/World.h"
+#include "RuntimeDownloadHandle.h"
 #include "Misc/FileHelper.h"
 #include "Misc/Paths.h"
 
-UBaseFilesDownloader::UBaseFilesDownloader()
+bool UBaseFilesDownloader::CancelDownload()
+{
+	return true;
+}
+
+bool UBaseFilesDownloader::PauseDownload()
 {
-	FWorldDelegates::OnWorldCleanup.AddWeakLambda(this, [this](UWorld* World, bool bSessionEnded, bool bCleanupResources)
+	if (RuntimeChunkDownloaderPtr.IsValid())
 	{
-		if (bSessionEnded)
-		{
-			CancelDownload();
-		}
-	});
+		RuntimeChunkDownloaderPtr->PauseDownload();
+		return true;
+	}
+	return false;
 }
 
-bool UBaseFilesDownloader::CancelDownload()
+bool UBaseFilesDownloader::ResumeDownload()
 {
-	return true;
+	if (RuntimeChunkDownloaderPtr.IsValid())
+	{
+		RuntimeChunkDownloaderPtr->ResumeDownload();
+		return true;
+	}
+	return false;
+}
+
+bool UBaseFilesDownloader::IsDownloadPaused() const
+{
+	return RuntimeChunkDownloaderPtr.IsValid() && RuntimeChunkDownloaderPtr->IsPaused();
+}
+
+FRuntimeFilesDownloaderStats UBaseFilesDownloader::GetDownloadStats() const
+{
+	return RuntimeChunkDownloaderPtr.IsValid() ? RuntimeChunkDownloaderPtr->GetStats() : FRuntimeFilesDownloaderStats();
 }
 
 void UBaseFilesDownloader::GetContentSize(const FString& URL, float Timeout, const FOnGetDownloadContentLength& OnComplete)
@@ -35,29 +55,135 @@ void UBaseFilesDownloader::GetContentSize(const FString& URL, float Timeout, con
 
 void UBaseFilesDownloader::GetContentSize(const FString& URL, float Timeout, const FOnGetDownloadContentLengthNative& OnComplete)
 {
-	UBaseFilesDownloader* FileDownloader = NewObject<UBaseFilesDownloader>();
-	FileDownloader->AddToRoot();
-	FileDownloader->RuntimeChunkDownloaderPtr = MakeShared<FRuntimeChunkDownloader>();
-	FileDownloader->RuntimeChunkDownloaderPtr->GetContentSize(URL, Timeout).Next([FileDownloader, OnComplete](int64 ContentSize)
+	// No object is needed to get the content size, the handle keeps the request alive until it is complete
+	FRuntimeDownloadHandle::GetContentSize(URL, Timeout, [OnComplete](int64 ContentSize)
 	{
-		if (FileDownloader)
-		{
-			FileDownloader->RemoveFromRoot();
-		}
 		OnComplete.ExecuteIfBound(ContentSize);
 	});
 }
 
 FString UBaseFilesDownloader::BytesToString(const TArray<uint8>& Bytes)
 {
-	const uint8* BytesData = Bytes.GetData();
-	FString Result;
-	for (int32 Count = Bytes.Num(); Count > 0; --Count)
+	return BytesToString(Bytes.GetData(), Bytes.Num());
+}
+
+FString UBaseFilesDownloader::BytesToString(const TArray64<uint8>& Bytes)
+{
+	return BytesToString(Bytes.GetData(), Bytes.Num());
+}
+
+FString UBaseFilesDownloader::BytesToString(const uint8* Bytes, int64 Size)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UBaseFilesDownloader::BytesToString);
+
+	if (!Bytes || Size <= 0)
+	{
+		return FString();
+	}
+
+	// UTF-16 text is recognized by its byte order mark
+	if (Size >= 2 && ((Bytes[0] == 0xFF && Bytes[1] == 0xFE) || (Bytes[0] == 0xFE && Bytes[1] == 0xFF)))
+	{
+		const bool bBigEndian = Bytes[0] == 0xFE;
+		const int64 CharCount = (Size - 2) / 2;
+		if (CharCount > TNumericLimits<int32>::Max() - 1)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to convert %lld bytes to string: the string would exceed the maximum length"), Size);
+			return FString();
+		}
+
+		if ((Size - 2) % 2 != 0)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("The UTF-16 text of %lld bytes ends with an incomplete character, which is ignored"), Size);
+		}
+
+		auto GetCodeUnit = [Bytes, bBigEndian](int32 CharIndex) -> uint32
+		{
+			const uint8* CharBytes = Bytes + 2 + static_cast<int64>(CharIndex) * 2;
+			return bBigEndian ? (CharBytes[0] << 8) | CharBytes[1] : CharBytes[0] | (CharBytes[1] << 8);
+		};
+
+		// The code units are decoded directly into the string, without an intermediate buffer
+		FString Result;
+		TArray<TCHAR>& ResultChars = Result.GetCharArray();
+		ResultChars.SetNumUninitialized(static_cast<int32>(CharCount) + 1);
+		TCHAR* ResultData = ResultChars.GetData();
+		int32 Length = 0;
+		for (int32 CharIndex = 0; CharIndex < CharCount; ++CharIndex)
+		{
+			const uint32 CodeUnit = GetCodeUnit(CharIndex);
+#if PLATFORM_TCHAR_IS_4_BYTES
+			// Each character holds a whole code point, so surrogate pairs are combined
+			if (CodeUnit >= 0xD800 && CodeUnit < 0xDC00 && CharIndex + 1 < CharCount)
+			{
+				const uint32 NextCodeUnit = GetCodeUnit(CharIndex + 1);
+				if (NextCodeUnit >= 0xDC00 && NextCodeUnit < 0xE000)
+				{
+					ResultData[Length++] = static_cast<TCHAR>(0x10000 + ((CodeUnit - 0xD800) << 10) + (NextCodeUnit - 0xDC00));
+					++CharIndex;
+					continue;
+				}
+			}
+#endif
+			ResultData[Length++] = static_cast<TCHAR>(CodeUnit);
+		}
+		ResultData[Length] = TEXT('\0');
+		if (Length < CharCount)
+		{
+			ResultChars.SetNum(Length + 1);
+		}
+		return Result;
+	}
+
+	// Skip the UTF-8 byte order mark
+	if (Size >= 3 && Bytes[0] == 0xEF && Bytes[1] == 0xBB && Bytes[2] == 0xBF)
 	{
-		Result += static_cast<TCHAR>(*BytesData);
+		Bytes += 3;
+		Size -= 3;
+	}
 
-		++BytesData;
+	if (Size > TNumericLimits<int32>::Max() - 1)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to convert %lld bytes to string: the string would exceed the maximum length"), Size);
+		return FString();
 	}
+
+	// Find the length of the ASCII prefix, checking 8 bytes at a time for any byte with the high bit set
+	constexpr uint64 HighBitsMask = 0x8080808080808080ull;
+	int64 AsciiLength = 0;
+	while (AsciiLength + 8 <= Size)
+	{
+		uint64 Word;
+		FMemory::Memcpy(&Word, Bytes + AsciiLength, sizeof(Word));
+		if ((Word & HighBitsMask) != 0)
+		{
+			break;
+		}
+		AsciiLength += 8;
+	}
+	while (AsciiLength < Size && Bytes[AsciiLength] < 0x80)
+	{
+		++AsciiLength;
+	}
+
+	// The ASCII prefix is widened directly, and only the remainder goes through the UTF-8 decoder, which decodes it directly into the string
+	const ANSICHAR* Remainder = reinterpret_cast<const ANSICHAR*>(Bytes + AsciiLength);
+	const int32 RemainderSize = static_cast<int32>(Size - AsciiLength);
+	const int32 RemainderLength = RemainderSize > 0 ? FUTF8ToTCHAR_Convert::ConvertedLength(Remainder, RemainderSize) : 0;
+
+	FString Result;
+	TArray<TCHAR>& ResultChars = Result.GetCharArray();
+	ResultChars.SetNumUninitialized(static_cast<int32>(AsciiLength) + RemainderLength + 1);
+	TCHAR* ResultData = ResultChars.GetData();
+	for (int64 CharIndex = 0; CharIndex < AsciiLength; ++CharIndex)
+	{
+		ResultData[CharIndex] = static_cast<TCHAR>(Bytes[CharIndex]);
+	}
+	if (RemainderLength > 0)
+	{
+		FUTF8ToTCHAR_Convert::Convert(ResultData + AsciiLength, RemainderLength, Remainder, RemainderSize);
+	}
+	ResultData[AsciiLength + RemainderLength] = TEXT('\0');
 	return Result;
 }
 
@@ -91,8 +217,16 @@ bool UBaseFilesDownloader::IsFileExist(const FString& FilePath)
 	return FPaths::FileExists(FilePath);
 }
 
+FRuntimeDownloadExecutionPolicy UBaseFilesDownloader::GetExecutionPolicy()
+{
+	FRuntimeDownloadExecutionPolicy ExecutionPolicy = FRuntimeDownloadExecutionPolicy::FromSettings();
+	ExecutionPolicy.CallbackExecutor = ERuntimeDownloadExecutor::GameThread;
+	return ExecutionPolicy;
+}
+
 void UBaseFilesDownloader::BroadcastProgress(int64 BytesReceived, int64 ContentLength, float ProgressRatio) const
 {
+	TRACE_CPUPROFILER_EVENT_SCOPE(UBaseFilesDownloader::BroadcastProgress);
 	if (OnDownloadProgress.IsBound())
 	{
 		OnDownloadProgress.Execute(BytesReceived, ContentLength, ProgressRatio);
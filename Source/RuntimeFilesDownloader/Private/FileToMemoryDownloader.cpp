@@ -2,7 +2,9 @@
 
 #include "FileToMemoryDownloader.h"
 #include "RuntimeChunkDownloader.h"
+#include "RuntimeDownloadHandle.h"
 #include "RuntimeFilesDownloaderDefines.h"
+#include "RuntimeFilesDownloaderProfiling.h"
 
 UFileToMemoryDownloader* UFileToMemoryDownloader::DownloadFileToMemoryPerChunk(const FString& URL, float Timeout, const FString& ContentType, int32 MaxChunkSize, const FOnDownloadProgress& OnProgress, const FOnFileToMemoryChunkDownloadComplete& OnChunkComplete, const FOnFileToMemoryAllChunksDownloadComplete& OnAllChunksDownloadComplete)
 {
@@ -11,6 +13,12 @@ UFileToMemoryDownloader* UFileToMemoryDownloader::DownloadFileToMemoryPerChunk(c
 		OnProgress.ExecuteIfBound(BytesReceived, ContentSize, Progress);
 	}), FOnFileToMemoryChunkDownloadCompleteNative::CreateLambda([OnChunkComplete](const TArray64<uint8>& DownloadedContent, UFileToMemoryDownloader* Downloader)
 	{
+		// Blueprints require a copy into a standard byte array, so it is only made if there is someone to receive it
+		if (!OnChunkComplete.IsBound())
+		{
+			return;
+		}
+
 		if (DownloadedContent.Num() > TNumericLimits<int32>::Max())
 		{
 			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("The size of the downloaded content exceeds the maximum limit for an int32 array. Maximum length: %d, Retrieved length: %lld\nA standard byte array can hold a maximum of 2 GB of data. If you need to download more than 2 GB of data into memory, consider using the C++ native equivalent instead of the Blueprint dynamic delegate"), TNumericLimits<int32>::Max(), DownloadedContent.Num());
@@ -35,6 +43,17 @@ UFileToMemoryDownloader* UFileToMemoryDownloader::DownloadFileToMemoryPerChunk(c
 	return Downloader;
 }
 
+UFileToMemoryDownloader* UFileToMemoryDownloader::DownloadFileToMemoryPerChunk(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, const FOnDownloadProgressNative& OnProgress, const FOnFileToMemoryChunkDownloadCompleteSharedNative& OnChunkComplete, const FOnFileToMemoryAllChunksDownloadCompleteNative& OnAllChunksDownloadComplete)
+{
+	UFileToMemoryDownloader* Downloader = NewObject<UFileToMemoryDownloader>(StaticClass());
+	Downloader->AddToRoot();
+	Downloader->OnDownloadProgress = OnProgress;
+	Downloader->OnChunkDownloadCompleteShared = OnChunkComplete;
+	Downloader->OnAllChunksDownloadComplete = OnAllChunksDownloadComplete;
+	Downloader->DownloadFileToMemoryPerChunk(URL, Timeout, ContentType, MaxChunkSize);
+	return Downloader;
+}
+
 UFileToMemoryDownloader* UFileToMemoryDownloader::DownloadFileToMemory(const FString& URL, float Timeout, const FString& ContentType, bool bForceByPayload, const FOnDownloadProgress& OnProgress, const FOnFileToMemoryDownloadComplete& OnComplete)
 {
 	return DownloadFileToMemory(URL, Timeout, ContentType, bForceByPayload, FOnDownloadProgressNative::CreateLambda([OnProgress](int64 BytesReceived, int64 ContentSize, float Progress)
@@ -42,6 +61,12 @@ UFileToMemoryDownloader* UFileToMemoryDownloader::DownloadFileToMemory(const FSt
 		OnProgress.ExecuteIfBound(BytesReceived, ContentSize, Progress);
 	}), FOnFileToMemoryDownloadCompleteNative::CreateLambda([OnComplete](const TArray64<uint8>& DownloadedContent, EDownloadToMemoryResult Result, UFileToMemoryDownloader* Downloader)
 	{
+		// Blueprints require a copy into a standard byte array, so it is only made if there is someone to receive it
+		if (!OnComplete.IsBound())
+		{
+			return;
+		}
+
 		if (DownloadedContent.Num() > TNumericLimits<int32>::Max())
 		{
 			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("The size of the downloaded content exceeds the maximum limit for an int32 array. Maximum length: %d, Retrieved length: %lld\nA standard byte array can hold a maximum of 2 GB of data. If you need to download more than 2 GB of data into memory, consider using the C++ native equivalent instead of the Blueprint dynamic delegate"), TNumericLimits<int32>::Max(), DownloadedContent.Num());
@@ -62,6 +87,16 @@ UFileToMemoryDownloader* UFileToMemoryDownloader::DownloadFileToMemory(const FSt
 	return Downloader;
 }
 
+UFileToMemoryDownloader* UFileToMemoryDownloader::DownloadFileToMemory(const FString& URL, float Timeout, const FString& ContentType, bool bForceByPayload, const FOnDownloadProgressNative& OnProgress, const FOnFileToMemoryDownloadCompleteSharedNative& OnComplete)
+{
+	UFileToMemoryDownloader* Downloader = NewObject<UFileToMemoryDownloader>(StaticClass());
+	Downloader->AddToRoot();
+	Downloader->OnDownloadProgress = OnProgress;
+	Downloader->OnDownloadCompleteShared = OnComplete;
+	Downloader->DownloadFileToMemory(URL, Timeout, ContentType, bForceByPayload);
+	return Downloader;
+}
+
 bool UFileToMemoryDownloader::CancelDownload()
 {
 	if (RuntimeChunkDownloaderPtr.IsValid())
@@ -78,6 +113,7 @@ void UFileToMemoryDownloader::DownloadFileToMemory(const FString& URL, float Tim
 	{
 		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("You have not provided an URL to download the file"));
 		OnDownloadComplete.ExecuteIfBound(TArray64<uint8>(), EDownloadToMemoryResult::InvalidURL, this);
+		OnDownloadCompleteShared.ExecuteIfBound(MakeRuntimeSharedBuffer(TArray64<uint8>()), EDownloadToMemoryResult::InvalidURL, this);
 		RemoveFromRoot();
 		return;
 	}
@@ -88,26 +124,19 @@ void UFileToMemoryDownloader::DownloadFileToMemory(const FString& URL, float Tim
 		Timeout = 0;
 	}
 
-	auto OnProgress = [this](int64 BytesReceived, int64 ContentSize)
+	// The object only wraps the download handle, which moves the data into the shared buffer, so that the consumers can keep it without copying
+	const TSharedRef<FRuntimeDownloadHandle> Handle = FRuntimeDownloadHandle::DownloadToMemory(URL, Timeout, ContentType, bForceByPayload, [this](int64 BytesReceived, int64 ContentSize)
 	{
 		BroadcastProgress(BytesReceived, ContentSize, ContentSize <= 0 ? 0 : static_cast<float>(BytesReceived) / ContentSize);
-	};
-
-	auto OnResult = [this](FRuntimeChunkDownloaderResult&& Result) mutable
+	}, [this](EDownloadToMemoryResult Result, const FRuntimeSharedBuffer& DownloadedContent)
 	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(UFileToMemoryDownloader::BroadcastDownloadComplete);
 		RemoveFromRoot();
-		OnDownloadComplete.ExecuteIfBound(Result.Data, Result.Result, this);
-	};
-
-	RuntimeChunkDownloaderPtr = MakeShared<FRuntimeChunkDownloader>();
-	if (bForceByPayload)
-	{
-		RuntimeChunkDownloaderPtr->DownloadFileByPayload(URL, Timeout, ContentType, OnProgress).Next(OnResult);
-	}
-	else
-	{
-		RuntimeChunkDownloaderPtr->DownloadFile(URL, Timeout, ContentType, TNumericLimits<TArray<uint8>::SizeType>::Max(), OnProgress).Next(OnResult);
-	}
+		OnDownloadCompleteShared.ExecuteIfBound(DownloadedContent, Result, this);
+		OnDownloadComplete.ExecuteIfBound(*DownloadedContent, Result, this);
+	}, GetExecutionPolicy());
+	RuntimeChunkDownloaderPtr = Handle->GetDownloader();
+	RuntimeChunkDownloaderPtr->SetCancelOnSessionEnd(true);
 }
 
 void UFileToMemoryDownloader::DownloadFileToMemoryPerChunk(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize)
@@ -126,15 +155,22 @@ void UFileToMemoryDownloader::DownloadFileToMemoryPerChunk(const FString& URL, f
 		Timeout = 0;
 	}
 
+	const FRuntimeDownloadExecutionPolicy ExecutionPolicy = GetExecutionPolicy();
 	RuntimeChunkDownloaderPtr = MakeShared<FRuntimeChunkDownloader>();
-	RuntimeChunkDownloaderPtr->DownloadFilePerChunk(URL, Timeout, ContentType, MaxChunkSize, FInt64Vector2(), [this](int64 BytesReceived, int64 ContentSize)
+	RuntimeChunkDownloaderPtr->SetExecutionPolicy(ExecutionPolicy);
+	RuntimeChunkDownloaderPtr->SetCancelOnSessionEnd(true);
+	RuntimeChunkDownloaderPtr->DownloadFilePerChunk(URL, Timeout, ContentType, MaxChunkSize, FInt64Vector2(), ExecutionPolicy.WrapProgress([this](int64 BytesReceived, int64 ContentSize)
 	{
 		BroadcastProgress(BytesReceived, ContentSize, ContentSize <= 0 ? 0 : static_cast<float>(BytesReceived) / ContentSize);
-	}, [this](TArray64<uint8> DownloadedContent)
+	}), [this](TArray64<uint8>&& DownloadedContent)
 	{
-		OnChunkDownloadComplete.ExecuteIfBound(DownloadedContent, this);
+		TRACE_CPUPROFILER_EVENT_SCOPE(UFileToMemoryDownloader::BroadcastChunkDownloadComplete);
+		const FRuntimeSharedBuffer DownloadedChunk = MakeRuntimeSharedBuffer(MoveTemp(DownloadedContent));
+		OnChunkDownloadCompleteShared.ExecuteIfBound(DownloadedChunk, this);
+		OnChunkDownloadComplete.ExecuteIfBound(*DownloadedChunk, this);
 	}).Next([this](EDownloadToMemoryResult Result)
 	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(UFileToMemoryDownloader::BroadcastAllChunksDownloadComplete);
 		RemoveFromRoot();
 		OnAllChunksDownloadComplete.ExecuteIfBound(Result, this);
 	});
@@ -4,11 +4,10 @@
 
 #include "FileToMemoryDownloader.h"
 #include "RuntimeChunkDownloader.h"
+#include "RuntimeDeltaDownloader.h"
+#include "RuntimeDownloadHandle.h"
 #include "RuntimeFilesDownloaderDefines.h"
-#include "Misc/Paths.h"
-#include "HAL/FileManager.h"
-#include "HAL/PlatformFileManager.h"
-#include "GenericPlatform/GenericPlatformFile.h"
+#include "RuntimeFilesDownloaderProfiling.h"
 
 UFileToStorageDownloader* UFileToStorageDownloader::DownloadFileToStorage(const FString& URL, const FString& SavePath, float Timeout, const FString& ContentType, bool bForceByPayload, const FOnDownloadProgress& OnProgress, const FOnFileToStorageDownloadComplete& OnComplete)
 {
@@ -31,6 +30,27 @@ UFileToStorageDownloader* UFileToStorageDownloader::DownloadFileToStorage(const
 	return Downloader;
 }
 
+UFileToStorageDownloader* UFileToStorageDownloader::DownloadFileToStorageDelta(const FString& URL, const FString& SignatureURL, const FString& SavePath, float Timeout, const FString& ContentType, const FOnDownloadProgress& OnProgress, const FOnFileToStorageDownloadComplete& OnComplete)
+{
+	return DownloadFileToStorageDelta(URL, SignatureURL, SavePath, Timeout, ContentType, FOnDownloadProgressNative::CreateLambda([OnProgress](int64 BytesReceived, int64 ContentSize, float ProgressRatio)
+	{
+		OnProgress.ExecuteIfBound(BytesReceived, ContentSize, ProgressRatio);
+	}), FOnFileToStorageDownloadCompleteNative::CreateLambda([OnComplete](EDownloadToStorageResult Result, const FString& SavedPath, UFileToStorageDownloader* Downloader)
+	{
+		OnComplete.ExecuteIfBound(Result, SavedPath, Downloader);
+	}));
+}
+
+UFileToStorageDownloader* UFileToStorageDownloader::DownloadFileToStorageDelta(const FString& URL, const FString& SignatureURL, const FString& SavePath, float Timeout, const FString& ContentType, const FOnDownloadProgressNative& OnProgress, const FOnFileToStorageDownloadCompleteNative& OnComplete)
+{
+	UFileToStorageDownloader* Downloader = NewObject<UFileToStorageDownloader>(StaticClass());
+	Downloader->AddToRoot();
+	Downloader->OnDownloadProgress = OnProgress;
+	Downloader->OnDownloadComplete = OnComplete;
+	Downloader->DownloadFileToStorageDelta(URL, SignatureURL, SavePath, Timeout, ContentType);
+	return Downloader;
+}
+
 bool UFileToStorageDownloader::CancelDownload()
 {
 	if (RuntimeChunkDownloaderPtr.IsValid())
@@ -41,14 +61,14 @@ bool UFileToStorageDownloader::CancelDownload()
 	return false;
 }
 
-void UFileToStorageDownloader::DownloadFileToStorage(const FString& URL, const FString& SavePath, float Timeout, const FString& ContentType, bool bForceByPayload)
+bool UFileToStorageDownloader::ValidateDownloadParameters(const FString& URL, const FString& SavePath, float& Timeout)
 {
 	if (URL.IsEmpty())
 	{
 		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("You have not provided an URL to download the file"));
 		OnDownloadComplete.ExecuteIfBound(EDownloadToStorageResult::InvalidURL, SavePath, this);
 		RemoveFromRoot();
-		return;
+		return false;
 	}
 
 	if (SavePath.IsEmpty())
@@ -56,7 +76,7 @@ void UFileToStorageDownloader::DownloadFileToStorage(const FString& URL, const F
 		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("You have not provided a path to save the file"));
 		OnDownloadComplete.ExecuteIfBound(EDownloadToStorageResult::InvalidSavePath, SavePath, this);
 		RemoveFromRoot();
-		return;
+		return false;
 	}
 
 	if (Timeout < 0)
@@ -65,104 +85,88 @@ void UFileToStorageDownloader::DownloadFileToStorage(const FString& URL, const F
 		Timeout = 0;
 	}
 
-	FileSavePath = SavePath;
-
-	auto OnProgress = [this](int64 BytesReceived, int64 ContentSize)
-	{
-		BroadcastProgress(BytesReceived, ContentSize, ContentSize <= 0 ? 0 : static_cast<float>(BytesReceived) / ContentSize);
-	};
+	return true;
+}
 
-	auto OnResult = [this](FRuntimeChunkDownloaderResult&& Result) mutable
+void UFileToStorageDownloader::DownloadFileToStorage(const FString& URL, const FString& SavePath, float Timeout, const FString& ContentType, bool bForceByPayload)
+{
+	if (!ValidateDownloadParameters(URL, SavePath, Timeout))
 	{
-		OnComplete_Internal(Result.Result, MoveTemp(Result.Data));
-	};
+		return;
+	}
 
-	RuntimeChunkDownloaderPtr = MakeShared<FRuntimeChunkDownloader>();
+	FileSavePath = SavePath;
 
-	if (bForceByPayload)
+	// The object only wraps the download handle, which performs the download and saves the file
+	const TSharedRef<FRuntimeDownloadHandle> Handle = FRuntimeDownloadHandle::DownloadToStorage(URL, SavePath, Timeout, ContentType, bForceByPayload, [this](int64 BytesReceived, int64 ContentSize)
 	{
-		RuntimeChunkDownloaderPtr->DownloadFileByPayload(URL, Timeout, ContentType, OnProgress).Next(OnResult);
-	}
-	else
+		BroadcastProgress(BytesReceived, ContentSize, ContentSize <= 0 ? 0 : static_cast<float>(BytesReceived) / ContentSize);
+	}, [this](EDownloadToStorageResult Result, const FString& SavedPath)
 	{
-		RuntimeChunkDownloaderPtr->DownloadFile(URL, Timeout, ContentType, TNumericLimits<TArray<uint8>::SizeType>::Max(), OnProgress).Next(OnResult);
-	}
+		TRACE_CPUPROFILER_EVENT_SCOPE(UFileToStorageDownloader::BroadcastDownloadComplete);
+		RemoveFromRoot();
+		OnDownloadComplete.ExecuteIfBound(Result, SavedPath, this);
+	}, GetExecutionPolicy());
+	RuntimeChunkDownloaderPtr = Handle->GetDownloader();
+	RuntimeChunkDownloaderPtr->SetCancelOnSessionEnd(true);
 }
 
-void UFileToStorageDownloader::OnComplete_Internal(EDownloadToMemoryResult Result, TArray64<uint8> DownloadedContent)
+void UFileToStorageDownloader::DownloadFileToStorageDelta(const FString& URL, const FString& SignatureURL, const FString& SavePath, float Timeout, const FString& ContentType)
 {
-	RemoveFromRoot();
-
-	if (Result != EDownloadToMemoryResult::Success && Result != EDownloadToMemoryResult::SucceededByPayload)
+	if (!ValidateDownloadParameters(URL, SavePath, Timeout))
 	{
-		// TODO: redesign in a more elegant way
-		switch (Result)
-		{
-		case EDownloadToMemoryResult::Cancelled:
-			OnDownloadComplete.ExecuteIfBound(EDownloadToStorageResult::Cancelled, FileSavePath, this);
-			break;
-		case EDownloadToMemoryResult::DownloadFailed:
-			OnDownloadComplete.ExecuteIfBound(EDownloadToStorageResult::DownloadFailed, FileSavePath, this);
-			break;
-		case EDownloadToMemoryResult::InvalidURL:
-			OnDownloadComplete.ExecuteIfBound(EDownloadToStorageResult::InvalidURL, FileSavePath, this);
-			break;
-		}
 		return;
 	}
 
-	if (!DownloadedContent.IsValidIndex(0))
+	if (SignatureURL.IsEmpty())
 	{
-		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("An error occurred while downloading the file to storage"));
-		OnDownloadComplete.ExecuteIfBound(EDownloadToStorageResult::DownloadFailed, FileSavePath, this);
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("You have not provided an URL to download the block signature of the file"));
+		OnDownloadComplete.ExecuteIfBound(EDownloadToStorageResult::InvalidURL, SavePath, this);
+		RemoveFromRoot();
 		return;
 	}
 
-	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	FileSavePath = SavePath;
 
-	// Create save directory if it does not exist
-	{
-		FString Path, Filename, Extension;
-		FPaths::Split(FileSavePath, Path, Filename, Extension);
-		if (!PlatformFile.DirectoryExists(*Path))
-		{
-			if (!PlatformFile.CreateDirectoryTree(*Path))
-			{
-				UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to create a directory '%s' to save the downloaded file"), *Path);
-				OnDownloadComplete.ExecuteIfBound(EDownloadToStorageResult::DirectoryCreationFailed, FileSavePath, this);
-				return;
-			}
-		}
-	}
+	const FRuntimeDownloadExecutionPolicy ExecutionPolicy = GetExecutionPolicy();
+	TSharedRef<FRuntimeDeltaDownloader> DeltaDownloader = MakeShared<FRuntimeDeltaDownloader>();
+	DeltaDownloader->SetExecutionPolicy(ExecutionPolicy);
+	DeltaDownloader->SetCancelOnSessionEnd(true);
+	RuntimeChunkDownloaderPtr = DeltaDownloader;
 
-	// Delete the file if it already exists
-	if (FPaths::FileExists(*FileSavePath))
+	DeltaDownloader->DownloadFileDelta(URL, SignatureURL, SavePath, Timeout, ContentType, ExecutionPolicy.WrapProgress([this](int64 BytesReceived, int64 ContentSize)
 	{
-		IFileManager& FileManager = IFileManager::Get();
-		if (!FileManager.Delete(*FileSavePath))
-		{
-			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Something went wrong while deleting the existing file '%s'"), *FileSavePath);
-			OnDownloadComplete.ExecuteIfBound(EDownloadToStorageResult::SaveFailed, FileSavePath, this);
-			return;
-		}
-	}
+		BroadcastProgress(BytesReceived, ContentSize, ContentSize <= 0 ? 0 : static_cast<float>(BytesReceived) / ContentSize);
+	})).Next([this](FRuntimeChunkDownloaderResult&& Result) mutable
+	{
+		OnComplete_Internal(Result.Result, MoveTemp(Result.Data));
+	});
+}
 
-	IFileHandle* FileHandle = PlatformFile.OpenWrite(*FileSavePath);
-	if (!FileHandle)
+void UFileToStorageDownloader::OnComplete_Internal(EDownloadToMemoryResult Result, TArray64<uint8> DownloadedContent)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UFileToStorageDownloader::OnComplete_Internal);
+
+	auto BroadcastResult = [this](EDownloadToStorageResult StorageResult)
 	{
-		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Something went wrong while saving the file '%s'"), *FileSavePath);
-		OnDownloadComplete.ExecuteIfBound(EDownloadToStorageResult::SaveFailed, FileSavePath, this);
-		return;
-	}
+		TRACE_CPUPROFILER_EVENT_SCOPE(UFileToStorageDownloader::BroadcastDownloadComplete);
+		RemoveFromRoot();
+		OnDownloadComplete.ExecuteIfBound(StorageResult, FileSavePath, this);
+	};
 
-	if (!FileHandle->Write(DownloadedContent.GetData(), DownloadedContent.Num()))
+	if (!GetExecutionPolicy().bProcessOnWorkerThreads)
 	{
-		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Something went wrong while writing the response data to the file '%s'"), *FileSavePath);
-		delete FileHandle;
-		OnDownloadComplete.ExecuteIfBound(EDownloadToStorageResult::SaveFailed, FileSavePath, this);
+		BroadcastResult(FRuntimeDownloadHandle::SaveDownloadedData(Result, DownloadedContent, FileSavePath));
 		return;
 	}
 
-	delete FileHandle;
-	OnDownloadComplete.ExecuteIfBound(Result == EDownloadToMemoryResult::SucceededByPayload ? EDownloadToStorageResult::SucceededByPayload : EDownloadToStorageResult::Success, FileSavePath, this);
+	// The file is written on a worker thread, while the object stays rooted until the result is broadcast on the game thread
+	Async(EAsyncExecution::ThreadPool, [Result, DownloadedContent = MoveTemp(DownloadedContent), SavePath = FileSavePath, BroadcastResult]()
+	{
+		const EDownloadToStorageResult StorageResult = FRuntimeDownloadHandle::SaveDownloadedData(Result, DownloadedContent, SavePath);
+		AsyncTask(ENamedThreads::GameThread, [BroadcastResult, StorageResult]()
+		{
+			BroadcastResult(StorageResult);
+		});
+	});
 }
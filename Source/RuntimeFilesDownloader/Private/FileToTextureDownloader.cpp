@@ -0,0 +1,497 @@
+// Georgy Treshchev 2024.
+
+#include "FileToTextureDownloader.h"
+
+#include "FileToMemoryDownloader.h"
+#include "RuntimeChunkDownloader.h"
+#include "RuntimeFilesDownloaderDefines.h"
+#include "RuntimeFilesDownloaderProfiling.h"
+#include "Async/Async.h"
+#include "Engine/Texture2D.h"
+#include "IImageWrapper.h"
+#include "IImageWrapperModule.h"
+#include "Modules/ModuleManager.h"
+#include "RuntimeTextureCache.h"
+
+namespace
+{
+	/**
+	 * Downscale the BGRA8 image by half by averaging 2x2 blocks of pixels
+	 */
+	TArray64<uint8> HalveImage(const TArray64<uint8>& Image, int32 Width, int32 Height, int32& OutWidth, int32& OutHeight)
+	{
+		OutWidth = FMath::Max(Width / 2, 1);
+		OutHeight = FMath::Max(Height / 2, 1);
+
+		TArray64<uint8> HalvedImage;
+		HalvedImage.SetNumUninitialized(static_cast<int64>(OutWidth) * OutHeight * 4);
+
+		const uint8* Source = Image.GetData();
+		uint8* Destination = HalvedImage.GetData();
+		for (int32 Y = 0; Y < OutHeight; ++Y)
+		{
+			const int32 SourceY0 = FMath::Min(Y * 2, Height - 1);
+			const int32 SourceY1 = FMath::Min(Y * 2 + 1, Height - 1);
+			for (int32 X = 0; X < OutWidth; ++X)
+			{
+				const int32 SourceX0 = FMath::Min(X * 2, Width - 1);
+				const int32 SourceX1 = FMath::Min(X * 2 + 1, Width - 1);
+				const uint8* Pixel00 = Source + (static_cast<int64>(SourceY0) * Width + SourceX0) * 4;
+				const uint8* Pixel01 = Source + (static_cast<int64>(SourceY0) * Width + SourceX1) * 4;
+				const uint8* Pixel10 = Source + (static_cast<int64>(SourceY1) * Width + SourceX0) * 4;
+				const uint8* Pixel11 = Source + (static_cast<int64>(SourceY1) * Width + SourceX1) * 4;
+				for (int32 Channel = 0; Channel < 4; ++Channel)
+				{
+					*Destination++ = static_cast<uint8>((Pixel00[Channel] + Pixel01[Channel] + Pixel10[Channel] + Pixel11[Channel] + 2) / 4);
+				}
+			}
+		}
+
+		return HalvedImage;
+	}
+
+	/**
+	 * Resize the BGRA8 image using bilinear filtering. Intended for scale factors between 0.5 and 1, larger reductions should be done with HalveImage first
+	 */
+	TArray64<uint8> ResizeImageBilinear(const TArray64<uint8>& Image, int32 Width, int32 Height, int32 NewWidth, int32 NewHeight)
+	{
+		TArray64<uint8> ResizedImage;
+		ResizedImage.SetNumUninitialized(static_cast<int64>(NewWidth) * NewHeight * 4);
+
+		const float ScaleX = static_cast<float>(Width) / NewWidth;
+		const float ScaleY = static_cast<float>(Height) / NewHeight;
+		const uint8* Source = Image.GetData();
+		uint8* Destination = ResizedImage.GetData();
+		for (int32 Y = 0; Y < NewHeight; ++Y)
+		{
+			const float SourceY = FMath::Clamp((Y + 0.5f) * ScaleY - 0.5f, 0.0f, static_cast<float>(Height - 1));
+			const int32 SourceY0 = FMath::FloorToInt(SourceY);
+			const int32 SourceY1 = FMath::Min(SourceY0 + 1, Height - 1);
+			const float AlphaY = SourceY - SourceY0;
+			for (int32 X = 0; X < NewWidth; ++X)
+			{
+				const float SourceX = FMath::Clamp((X + 0.5f) * ScaleX - 0.5f, 0.0f, static_cast<float>(Width - 1));
+				const int32 SourceX0 = FMath::FloorToInt(SourceX);
+				const int32 SourceX1 = FMath::Min(SourceX0 + 1, Width - 1);
+				const float AlphaX = SourceX - SourceX0;
+				const uint8* Pixel00 = Source + (static_cast<int64>(SourceY0) * Width + SourceX0) * 4;
+				const uint8* Pixel01 = Source + (static_cast<int64>(SourceY0) * Width + SourceX1) * 4;
+				const uint8* Pixel10 = Source + (static_cast<int64>(SourceY1) * Width + SourceX0) * 4;
+				const uint8* Pixel11 = Source + (static_cast<int64>(SourceY1) * Width + SourceX1) * 4;
+				for (int32 Channel = 0; Channel < 4; ++Channel)
+				{
+					const float Top = FMath::Lerp<float>(Pixel00[Channel], Pixel01[Channel], AlphaX);
+					const float Bottom = FMath::Lerp<float>(Pixel10[Channel], Pixel11[Channel], AlphaX);
+					*Destination++ = static_cast<uint8>(FMath::Clamp(FMath::RoundToInt(FMath::Lerp(Top, Bottom, AlphaY)), 0, 255));
+				}
+			}
+		}
+
+		return ResizedImage;
+	}
+
+	/**
+	 * A cached texture request waiting for the download of the same texture that is already in progress
+	 */
+	struct FPendingTextureRequest
+	{
+		/** The downloader the request was made with */
+		TWeakObjectPtr<UFileToTextureDownloader> Downloader;
+
+		/** The parameters of the request, used to make it again if the download it waits for is canceled */
+		FString URL;
+		float Timeout;
+		bool bGenerateMips;
+		FIntPoint MaxSize;
+	};
+
+	/**
+	 * Get the requests waiting for the cached textures being downloaded, by cache key. Only accessed on the game thread
+	 * A key is present for as long as its texture is being downloaded, even if no request is waiting for it
+	 */
+	TMap<FString, TArray<FPendingTextureRequest>>& GetPendingTextureRequests()
+	{
+		static TMap<FString, TArray<FPendingTextureRequest>> PendingTextureRequests;
+		return PendingTextureRequests;
+	}
+}
+
+UFileToTextureDownloader* UFileToTextureDownloader::DownloadFileToTexture(const FString& URL, float Timeout, bool bGenerateMips, const FOnDownloadProgress& OnProgress, const FOnFileToTextureDownloadComplete& OnComplete)
+{
+	return DownloadFileToTexture(URL, Timeout, bGenerateMips, FOnDownloadProgressNative::CreateLambda([OnProgress](int64 BytesReceived, int64 ContentSize, float ProgressRatio)
+	{
+		OnProgress.ExecuteIfBound(BytesReceived, ContentSize, ProgressRatio);
+	}), FOnFileToTextureDownloadCompleteNative::CreateLambda([OnComplete](UTexture2D* Texture, EDownloadToTextureResult Result, UFileToTextureDownloader* Downloader)
+	{
+		OnComplete.ExecuteIfBound(Texture, Result, Downloader);
+	}));
+}
+
+UFileToTextureDownloader* UFileToTextureDownloader::DownloadFileToTexture(const FString& URL, float Timeout, bool bGenerateMips, const FOnDownloadProgressNative& OnProgress, const FOnFileToTextureDownloadCompleteNative& OnComplete)
+{
+	UFileToTextureDownloader* Downloader = NewObject<UFileToTextureDownloader>(StaticClass());
+	Downloader->AddToRoot();
+	Downloader->OnDownloadProgress = OnProgress;
+	Downloader->OnDownloadComplete = OnComplete;
+	Downloader->DownloadFileToTexture(URL, Timeout, bGenerateMips, FIntPoint::ZeroValue, false);
+	return Downloader;
+}
+
+UFileToTextureDownloader* UFileToTextureDownloader::DownloadFileToTextureCached(const FString& URL, float Timeout, bool bGenerateMips, int32 MaxWidth, int32 MaxHeight, const FOnDownloadProgress& OnProgress, const FOnFileToTextureDownloadComplete& OnComplete)
+{
+	return DownloadFileToTextureCached(URL, Timeout, bGenerateMips, FIntPoint(MaxWidth, MaxHeight), FOnDownloadProgressNative::CreateLambda([OnProgress](int64 BytesReceived, int64 ContentSize, float ProgressRatio)
+	{
+		OnProgress.ExecuteIfBound(BytesReceived, ContentSize, ProgressRatio);
+	}), FOnFileToTextureDownloadCompleteNative::CreateLambda([OnComplete](UTexture2D* Texture, EDownloadToTextureResult Result, UFileToTextureDownloader* Downloader)
+	{
+		OnComplete.ExecuteIfBound(Texture, Result, Downloader);
+	}));
+}
+
+UFileToTextureDownloader* UFileToTextureDownloader::DownloadFileToTextureCached(const FString& URL, float Timeout, bool bGenerateMips, const FIntPoint& MaxSize, const FOnDownloadProgressNative& OnProgress, const FOnFileToTextureDownloadCompleteNative& OnComplete)
+{
+	UFileToTextureDownloader* Downloader = NewObject<UFileToTextureDownloader>(StaticClass());
+	Downloader->AddToRoot();
+	Downloader->OnDownloadProgress = OnProgress;
+	Downloader->OnDownloadComplete = OnComplete;
+	Downloader->DownloadFileToTexture(URL, Timeout, bGenerateMips, MaxSize, true);
+	return Downloader;
+}
+
+bool UFileToTextureDownloader::DecodeImage(const TArray64<uint8>& ImageData, bool bGenerateMips, const FIntPoint& MaxSize, TArray<TArray64<uint8>>& OutMips, int32& OutWidth, int32& OutHeight)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UFileToTextureDownloader::DecodeImage);
+	RUNTIMEFILESDOWNLOADER_LLM_SCOPE;
+
+	// The module is loaded on the game thread before decoding starts, so it is only looked up here
+	IImageWrapperModule* ImageWrapperModule = FModuleManager::GetModulePtr<IImageWrapperModule>(TEXT("ImageWrapper"));
+	if (!ImageWrapperModule)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to decode the image: the ImageWrapper module is not loaded"));
+		return false;
+	}
+
+	const EImageFormat ImageFormat = ImageWrapperModule->DetectImageFormat(ImageData.GetData(), ImageData.Num());
+	if (ImageFormat == EImageFormat::Invalid)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to decode the image: the format is not recognized"));
+		return false;
+	}
+
+	TSharedPtr<IImageWrapper> ImageWrapper = ImageWrapperModule->CreateImageWrapper(ImageFormat);
+	if (!ImageWrapper.IsValid() || !ImageWrapper->SetCompressed(ImageData.GetData(), ImageData.Num()))
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to decode the image: the data is corrupted"));
+		return false;
+	}
+
+	OutWidth = ImageWrapper->GetWidth();
+	OutHeight = ImageWrapper->GetHeight();
+
+	OutMips.Reset();
+	TArray64<uint8>& FullSizeMip = OutMips.AddDefaulted_GetRef();
+#if UE_VERSION_OLDER_THAN(5, 0, 0)
+	TArray<uint8> RawData;
+	if (!ImageWrapper->GetRaw(ERGBFormat::BGRA, 8, RawData))
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to decode the image into BGRA8 pixels"));
+		return false;
+	}
+	FullSizeMip = TArray64<uint8>(MoveTemp(RawData));
+#else
+	if (!ImageWrapper->GetRaw(ERGBFormat::BGRA, 8, FullSizeMip))
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to decode the image into BGRA8 pixels"));
+		return false;
+	}
+#endif
+
+	if (OutWidth <= 0 || OutHeight <= 0 || FullSizeMip.Num() != static_cast<int64>(OutWidth) * OutHeight * 4)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to decode the image: unexpected size of the decoded data"));
+		return false;
+	}
+
+	// Downscale to fit the maximum size, preserving the aspect ratio
+	float Scale = 1.0f;
+	if (MaxSize.X > 0)
+	{
+		Scale = FMath::Min(Scale, static_cast<float>(MaxSize.X) / OutWidth);
+	}
+	if (MaxSize.Y > 0)
+	{
+		Scale = FMath::Min(Scale, static_cast<float>(MaxSize.Y) / OutHeight);
+	}
+	if (Scale < 1.0f)
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(UFileToTextureDownloader::DownscaleImage);
+
+		const int32 TargetWidth = FMath::Max(FMath::RoundToInt(OutWidth * Scale), 1);
+		const int32 TargetHeight = FMath::Max(FMath::RoundToInt(OutHeight * Scale), 1);
+
+		// Halving averages all the pixels, so it is used for as long as possible before the final bilinear resize
+		while (OutWidth >= TargetWidth * 2 && OutHeight >= TargetHeight * 2)
+		{
+			FullSizeMip = HalveImage(FullSizeMip, OutWidth, OutHeight, OutWidth, OutHeight);
+		}
+		if (OutWidth != TargetWidth || OutHeight != TargetHeight)
+		{
+			FullSizeMip = ResizeImageBilinear(FullSizeMip, OutWidth, OutHeight, TargetWidth, TargetHeight);
+			OutWidth = TargetWidth;
+			OutHeight = TargetHeight;
+		}
+	}
+
+	if (!bGenerateMips)
+	{
+		return true;
+	}
+
+	TRACE_CPUPROFILER_EVENT_SCOPE(UFileToTextureDownloader::GenerateMips);
+
+	// Each mip is produced from the previous one by averaging 2x2 blocks of pixels
+	int32 MipWidth = OutWidth, MipHeight = OutHeight;
+	while (MipWidth > 1 || MipHeight > 1)
+	{
+		TArray64<uint8> Mip = HalveImage(OutMips.Last(), MipWidth, MipHeight, MipWidth, MipHeight);
+		OutMips.Add(MoveTemp(Mip));
+	}
+
+	return true;
+}
+
+UTexture2D* UFileToTextureDownloader::CreateTextureFromMips(TArray<TArray64<uint8>>&& Mips, int32 Width, int32 Height)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UFileToTextureDownloader::CreateTextureFromMips);
+	check(IsInGameThread());
+
+	if (Mips.Num() == 0)
+	{
+		return nullptr;
+	}
+
+	UTexture2D* Texture = UTexture2D::CreateTransient(Width, Height, PF_B8G8R8A8);
+	if (!Texture)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to create a texture of size %dx%d"), Width, Height);
+		return nullptr;
+	}
+
+#if UE_VERSION_OLDER_THAN(5, 0, 0)
+	FTexturePlatformData* PlatformData = Texture->PlatformData;
+#else
+	FTexturePlatformData* PlatformData = Texture->GetPlatformData();
+#endif
+
+	int32 MipWidth = Width, MipHeight = Height;
+	for (int32 MipIndex = 0; MipIndex < Mips.Num(); ++MipIndex)
+	{
+		// The transient texture is created with the first mip, the rest are added here
+		if (!PlatformData->Mips.IsValidIndex(MipIndex))
+		{
+			FTexture2DMipMap* MipMap = new FTexture2DMipMap();
+			MipMap->SizeX = MipWidth;
+			MipMap->SizeY = MipHeight;
+			PlatformData->Mips.Add(MipMap);
+		}
+
+		FTexture2DMipMap& MipMap = PlatformData->Mips[MipIndex];
+		void* MipData = MipMap.BulkData.Lock(LOCK_READ_WRITE);
+		MipData = MipMap.BulkData.Realloc(Mips[MipIndex].Num());
+		FMemory::Memcpy(MipData, Mips[MipIndex].GetData(), Mips[MipIndex].Num());
+		MipMap.BulkData.Unlock();
+
+		// The decoded data is no longer needed once copied into the bulk data
+		Mips[MipIndex].Empty();
+
+		MipWidth = FMath::Max(MipWidth / 2, 1);
+		MipHeight = FMath::Max(MipHeight / 2, 1);
+	}
+
+	// The pixel data is uploaded to the GPU on the rendering thread
+	Texture->UpdateResource();
+	return Texture;
+}
+
+bool UFileToTextureDownloader::CancelDownload()
+{
+	// The download may already be finished while the image is being decoded, in which case the texture is not created
+	bCanceled = true;
+
+	// A request waiting for the same texture being downloaded by another request is completed right away, leaving the download to the others
+	bool bWasWaiting = false;
+	for (TPair<FString, TArray<FPendingTextureRequest>>& PendingTextureRequests : GetPendingTextureRequests())
+	{
+		bWasWaiting |= PendingTextureRequests.Value.RemoveAll([this](const FPendingTextureRequest& Request) { return Request.Downloader.Get() == this; }) > 0;
+	}
+
+	if (bWasWaiting)
+	{
+		OnComplete_Internal(nullptr, EDownloadToTextureResult::Cancelled);
+		return true;
+	}
+
+	if (RuntimeChunkDownloaderPtr.IsValid())
+	{
+		RuntimeChunkDownloaderPtr->CancelDownload();
+		return true;
+	}
+	return false;
+}
+
+void UFileToTextureDownloader::DownloadFileToTexture(const FString& URL, float Timeout, bool bGenerateMips, const FIntPoint& MaxSize, bool bUseCache)
+{
+	if (URL.IsEmpty())
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("You have not provided an URL to download the image"));
+		OnComplete_Internal(nullptr, EDownloadToTextureResult::InvalidURL);
+		return;
+	}
+
+	if (Timeout < 0)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("The specified timeout (%f) is less than 0, setting it to 0"), Timeout);
+		Timeout = 0;
+	}
+
+	const FString CacheKey = bUseCache ? FRuntimeTextureCache::MakeKey(URL, MaxSize, bGenerateMips) : FString();
+	if (bUseCache)
+	{
+		if (UTexture2D* CachedTexture = FRuntimeTextureCache::Get().Find(CacheKey))
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Using the cached texture for %s"), *URL);
+
+			// Completed on the next tick, as a download would be, so that the caller receives the downloader before the completion delegate is executed
+			TWeakObjectPtr<UFileToTextureDownloader> WeakThis = this;
+			TWeakObjectPtr<UTexture2D> WeakTexture = CachedTexture;
+			AsyncTask(ENamedThreads::GameThread, [WeakThis, WeakTexture, URL, Timeout, bGenerateMips, MaxSize]()
+			{
+				if (!WeakThis.IsValid())
+				{
+					return;
+				}
+
+				if (WeakThis->bCanceled)
+				{
+					WeakThis->OnComplete_Internal(nullptr, EDownloadToTextureResult::Cancelled);
+					return;
+				}
+
+				// The texture may have been evicted from the cache and collected meanwhile
+				if (!WeakTexture.IsValid())
+				{
+					WeakThis->DownloadFileToTexture(URL, Timeout, bGenerateMips, MaxSize, true);
+					return;
+				}
+
+				WeakThis->OnComplete_Internal(WeakTexture.Get(), EDownloadToTextureResult::Success);
+			});
+			return;
+		}
+
+		// Concurrent requests for the same texture wait for the download in progress instead of downloading and decoding the image again
+		if (TArray<FPendingTextureRequest>* PendingTextureRequests = GetPendingTextureRequests().Find(CacheKey))
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Waiting for the texture for %s that is already being downloaded"), *URL);
+			PendingTextureRequests->Add(FPendingTextureRequest{this, URL, Timeout, bGenerateMips, MaxSize});
+			return;
+		}
+
+		GetPendingTextureRequests().Add(CacheKey);
+		PendingCacheKey = CacheKey;
+	}
+
+	// Loading the module is only allowed on the game thread, so it is done before decoding on a worker thread
+	FModuleManager::LoadModuleChecked<IImageWrapperModule>(TEXT("ImageWrapper"));
+
+	RuntimeChunkDownloaderPtr = MakeShared<FRuntimeChunkDownloader>();
+	RuntimeChunkDownloaderPtr->SetCancelOnSessionEnd(true);
+	RuntimeChunkDownloaderPtr->DownloadFile(URL, Timeout, FString(), TNumericLimits<TArray<uint8>::SizeType>::Max(), [this](int64 BytesReceived, int64 ContentSize)
+	{
+		BroadcastProgress(BytesReceived, ContentSize, ContentSize <= 0 ? 0 : static_cast<float>(BytesReceived) / ContentSize);
+	}).Next([this, bGenerateMips, MaxSize, CacheKey](FRuntimeChunkDownloaderResult&& Result) mutable
+	{
+		if (Result.Result != EDownloadToMemoryResult::Success && Result.Result != EDownloadToMemoryResult::SucceededByPayload)
+		{
+			OnComplete_Internal(nullptr, Result.Result == EDownloadToMemoryResult::Cancelled ? EDownloadToTextureResult::Cancelled : EDownloadToTextureResult::DownloadFailed);
+			return;
+		}
+
+		// Decode on a worker thread, so that the game thread and the other downloads keep going meanwhile
+		TWeakObjectPtr<UFileToTextureDownloader> WeakThis = this;
+		Async(EAsyncExecution::ThreadPool, [WeakThis, bGenerateMips, MaxSize, CacheKey, ImageData = MoveTemp(Result.Data)]()
+		{
+			TArray<TArray64<uint8>> Mips;
+			int32 Width = 0, Height = 0;
+			const bool bDecoded = DecodeImage(ImageData, bGenerateMips, MaxSize, Mips, Width, Height);
+
+			AsyncTask(ENamedThreads::GameThread, [WeakThis, CacheKey, bDecoded, Mips = MoveTemp(Mips), Width, Height]() mutable
+			{
+				if (!WeakThis.IsValid())
+				{
+					return;
+				}
+
+				if (!bDecoded)
+				{
+					WeakThis->OnComplete_Internal(nullptr, EDownloadToTextureResult::DecodeFailed);
+					return;
+				}
+
+				if (WeakThis->bCanceled)
+				{
+					WeakThis->OnComplete_Internal(nullptr, EDownloadToTextureResult::Cancelled);
+					return;
+				}
+
+				UTexture2D* Texture = CreateTextureFromMips(MoveTemp(Mips), Width, Height);
+				if (Texture && !CacheKey.IsEmpty())
+				{
+					FRuntimeTextureCache::Get().Add(CacheKey, Texture);
+				}
+				WeakThis->OnComplete_Internal(Texture, Texture ? EDownloadToTextureResult::Success : EDownloadToTextureResult::DecodeFailed);
+			});
+		});
+	});
+}
+
+void UFileToTextureDownloader::OnComplete_Internal(UTexture2D* Texture, EDownloadToTextureResult Result)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UFileToTextureDownloader::BroadcastDownloadComplete);
+	RemoveFromRoot();
+	OnDownloadComplete.ExecuteIfBound(Texture, Result, this);
+
+	if (!PendingCacheKey.IsEmpty())
+	{
+		const FString CacheKey = MoveTemp(PendingCacheKey);
+		PendingCacheKey.Reset();
+		CompletePendingTextureRequests(CacheKey, Texture, Result);
+	}
+}
+
+void UFileToTextureDownloader::CompletePendingTextureRequests(const FString& CacheKey, UTexture2D* Texture, EDownloadToTextureResult Result)
+{
+	TArray<FPendingTextureRequest> PendingTextureRequests;
+	if (!GetPendingTextureRequests().RemoveAndCopyValue(CacheKey, PendingTextureRequests))
+	{
+		return;
+	}
+
+	for (const FPendingTextureRequest& Request : PendingTextureRequests)
+	{
+		UFileToTextureDownloader* Downloader = Request.Downloader.Get();
+		if (!Downloader)
+		{
+			continue;
+		}
+
+		// Canceling the download only cancels the request it was made for, so the waiting requests download the texture again, the first of them leading
+		if (Result == EDownloadToTextureResult::Cancelled)
+		{
+			Downloader->DownloadFileToTexture(Request.URL, Request.Timeout, Request.bGenerateMips, Request.MaxSize, true);
+			continue;
+		}
+
+		Downloader->OnComplete_Internal(Texture, Result);
+	}
+}
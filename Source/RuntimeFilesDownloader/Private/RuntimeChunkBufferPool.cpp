@@ -0,0 +1,84 @@
+// Georgy Treshchev 2024.
+
+#include "RuntimeChunkBufferPool.h"
+
+#include "RuntimeFilesDownloaderProfiling.h"
+
+FRuntimeChunkBufferPool& FRuntimeChunkBufferPool::Get()
+{
+	static FRuntimeChunkBufferPool Pool;
+	return Pool;
+}
+
+TArray64<uint8> FRuntimeChunkBufferPool::Acquire(int64 MinCapacity)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeChunkBufferPool::Acquire);
+
+	{
+		FScopeLock ScopeLock(&Lock);
+
+		// The smallest buffer that fits is taken, so that large buffers remain available for large chunks
+		// Buffers more than twice as large as needed are not taken at all, since a small chunk would otherwise hold on to a large allocation for its whole lifetime
+		const int64 MaxCapacity = MinCapacity * 2;
+		int32 BestIndex = INDEX_NONE;
+		for (int32 Index = 0; Index < Buffers.Num(); ++Index)
+		{
+			if (Buffers[Index].Max() >= MinCapacity && Buffers[Index].Max() <= MaxCapacity && (BestIndex == INDEX_NONE || Buffers[Index].Max() < Buffers[BestIndex].Max()))
+			{
+				BestIndex = Index;
+			}
+		}
+
+		if (BestIndex != INDEX_NONE)
+		{
+			TArray64<uint8> Buffer = MoveTemp(Buffers[BestIndex]);
+			Buffers.RemoveAtSwap(BestIndex);
+			PooledBytes -= Buffer.Max();
+			return Buffer;
+		}
+	}
+
+	RUNTIMEFILESDOWNLOADER_LLM_SCOPE;
+	TArray64<uint8> Buffer;
+	Buffer.Reserve(MinCapacity);
+	return Buffer;
+}
+
+void FRuntimeChunkBufferPool::Release(TArray64<uint8>&& Buffer)
+{
+	if (Buffer.Max() <= 0)
+	{
+		return;
+	}
+
+	Buffer.Reset();
+
+	FScopeLock ScopeLock(&Lock);
+	if (Buffers.Num() >= MaxBuffers || PooledBytes + Buffer.Max() > MaxBytes)
+	{
+		return;
+	}
+
+	PooledBytes += Buffer.Max();
+	Buffers.Add(MoveTemp(Buffer));
+}
+
+void FRuntimeChunkBufferPool::Trim()
+{
+	FScopeLock ScopeLock(&Lock);
+	Buffers.Empty();
+	PooledBytes = 0;
+}
+
+void FRuntimeChunkBufferPool::SetLimits(int32 InMaxBuffers, int64 InMaxBytes)
+{
+	FScopeLock ScopeLock(&Lock);
+	MaxBuffers = FMath::Max(InMaxBuffers, 0);
+	MaxBytes = FMath::Max<int64>(InMaxBytes, 0);
+
+	while (Buffers.Num() > 0 && (Buffers.Num() > MaxBuffers || PooledBytes > MaxBytes))
+	{
+		PooledBytes -= Buffers.Last().Max();
+		Buffers.Pop();
+	}
+}
@@ -3,8 +3,22 @@
 #include "RuntimeChunkDownloader.h"
 
 #include "FileToMemoryDownloader.h"
+#include "RuntimeChunkBufferPool.h"
 #include "RuntimeFilesDownloaderDefines.h"
+#include "RuntimeFilesDownloaderProfiling.h"
+#include "RuntimeFilesDownloaderSettings.h"
+#include "RuntimeStreamDecompressor.h"
+#include "Async/Async.h"
+#include "Containers/Queue.h"
 #include "Misc/EngineVersionComparison.h"
+#include "Misc/Paths.h"
+#include "Serialization/Archive.h"
+#include "Templates/Atomic.h"
+#include "HAL/PlatformTime.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#if UE_VERSION_NEWER_THAN(5, 0, 0)
+#include "ProfilingDebugging/CountersTrace.h"
+#endif
 
 #if PLATFORM_ANDROID
 #include "Async/Future.h"
@@ -13,27 +27,525 @@
 #include "Android/AndroidPlatformMisc.h"
 #endif
 
+CSV_DEFINE_CATEGORY(RuntimeFilesDownloader, true);
+
+#if UE_VERSION_NEWER_THAN(5, 0, 0)
+TRACE_DECLARE_INT_COUNTER(RuntimeFilesDownloader_BytesReceived, TEXT("RuntimeFilesDownloader/BytesReceived"));
+TRACE_DECLARE_INT_COUNTER(RuntimeFilesDownloader_BytesWasted, TEXT("RuntimeFilesDownloader/BytesWasted"));
+TRACE_DECLARE_FLOAT_COUNTER(RuntimeFilesDownloader_Throughput, TEXT("RuntimeFilesDownloader/Throughput"));
+#endif
+
+namespace
+{
+	/** The maximum number of bytes requested at once by a multi-range request, limited by the size of the HTTP response content array */
+	constexpr int64 MaxRangeRequestSize = TNumericLimits<int32>::Max();
+
+	/** The maximum number of ranges requested at once by a multi-range request, since servers limit the number of ranges and the header length */
+	constexpr int32 MaxRangesPerRequest = 32;
+
+	/** The maximum number of chunk request statistics kept per downloader */
+	constexpr int32 MaxRecordedChunkStats = 256;
+
+	/** Guards the session downloaders */
+	FCriticalSection SessionDownloadersLock;
+
+	/** Downloaders canceled together when the session ends */
+	TArray<TWeakPtr<FRuntimeChunkDownloader>> SessionDownloaders;
+
+	/**
+	 * Check whether the content encoding of a response can be decoded. Only gzip and deflate are requested, so that any other encoding, e.g. br or zstd, is unexpected
+	 */
+	bool IsSupportedContentEncoding(const FString& ContentEncoding)
+	{
+		return ContentEncoding.Equals(TEXT("gzip"), ESearchCase::IgnoreCase) || ContentEncoding.Equals(TEXT("x-gzip"), ESearchCase::IgnoreCase) || ContentEncoding.Equals(TEXT("deflate"), ESearchCase::IgnoreCase);
+	}
+
+#if !UE_VERSION_OLDER_THAN(5, 4, 0)
+	/** The size of the segments a streamed payload is split into */
+	constexpr int64 PayloadSegmentSize = 16 * 1024 * 1024;
+
+	/**
+	 * Archive the response body of a payload request is streamed into, split into segments so that it is neither limited to 2 GB nor reallocated as it grows
+	 * The body is written on the HTTP thread, while the segments are checked and delivered on the game thread
+	 */
+	class FPayloadSegmentStream : public FArchive
+	{
+	public:
+		FPayloadSegmentStream(int64 InResumeOffset, bool bInValidatorSent)
+			: ReceivedBytes(0)
+			, ResumeOffset(InResumeOffset)
+			, bValidatorSent(bInValidatorSent)
+			, bResponseChecked(false)
+			, bResponseAccepted(false)
+			, bContentEncoded(false)
+			, BytesToSkip(0)
+			, DeliveredBytes(0)
+		{
+			SetIsSaving(true);
+		}
+
+		//~ Begin FArchive Interface
+		virtual void Serialize(void* Data, int64 Num) override
+		{
+			const uint8* Bytes = static_cast<const uint8*>(Data);
+			while (Num > 0)
+			{
+				if (CurrentSegment.Max() == 0)
+				{
+					CurrentSegment = FRuntimeChunkBufferPool::Get().Acquire(PayloadSegmentSize);
+				}
+
+				const int64 CopySize = FMath::Min(Num, PayloadSegmentSize - CurrentSegment.Num());
+				CurrentSegment.Append(Bytes, CopySize);
+				Bytes += CopySize;
+				Num -= CopySize;
+				ReceivedBytes += CopySize;
+
+				if (CurrentSegment.Num() >= PayloadSegmentSize)
+				{
+					Segments.Enqueue(MoveTemp(CurrentSegment));
+					CurrentSegment = TArray64<uint8>();
+				}
+			}
+		}
+
+		virtual FString GetArchiveName() const override
+		{
+			return TEXT("FPayloadSegmentStream");
+		}
+		//~ End FArchive Interface
+
+		/**
+		 * Check the response before any data is delivered, so that neither an error page nor the part of the file already delivered is passed on
+		 *
+		 * @param Response The response, whose headers may not have been received yet
+		 * @param ContentRangeStart The start of the range in the Content-Range header of the response, or -1 if there is none
+		 * @return Whether the response has been checked, regardless of whether it was accepted
+		 */
+		bool CheckResponse(const FHttpResponsePtr& Response, int64 ContentRangeStart)
+		{
+			if (bResponseChecked)
+			{
+				return true;
+			}
+
+			if (!Response.IsValid() || Response->GetResponseCode() <= 0)
+			{
+				return false;
+			}
+
+			bResponseChecked = true;
+
+			// The ETag of an encoded response identifies the encoded data, so that only the date of the file can be used to continue with the rest of it
+			const FString ContentEncoding = Response->GetHeader(TEXT("Content-Encoding"));
+			bContentEncoded = !ContentEncoding.IsEmpty() && !ContentEncoding.Equals(TEXT("identity"), ESearchCase::IgnoreCase);
+			Validator = bContentEncoded ? Response->GetHeader(TEXT("Last-Modified")) : FRuntimeContentInfo{0, Response->GetHeader(TEXT("ETag")), Response->GetHeader(TEXT("Last-Modified"))}.GetRangeValidator();
+
+			// Only the request for the whole file asks for an encoding, since the bytes of an encoded response cannot be matched with the bytes already delivered
+			if (bContentEncoded && (ResumeOffset > 0 || !IsSupportedContentEncoding(ContentEncoding)))
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to decode the payload received with content encoding '%s'"), *ContentEncoding);
+				return true;
+			}
+
+			const int32 ResponseCode = Response->GetResponseCode();
+			if (ResponseCode == EHttpResponseCodes::PartialContent && ResumeOffset > 0)
+			{
+				bResponseAccepted = ContentRangeStart == ResumeOffset;
+			}
+			else if (ResponseCode == EHttpResponseCodes::Ok)
+			{
+				// The whole file is sent again, which is only usable if it could not have changed since the delivered bytes were downloaded
+				bResponseAccepted = ResumeOffset == 0 || !bValidatorSent;
+				BytesToSkip = ResumeOffset;
+			}
+			return true;
+		}
+
+		/**
+		 * Deliver the complete segments received so far
+		 *
+		 * @param OnSegmentDownloaded The function called with each segment
+		 * @param bFinal Whether the response is complete, so that the last incomplete segment is delivered as well
+		 */
+		void DeliverSegments(const FRuntimeChunkDownloader::FOnChunkDownloaded& OnSegmentDownloaded, bool bFinal)
+		{
+			if (!bResponseAccepted)
+			{
+				return;
+			}
+
+			if (bFinal && CurrentSegment.Num() > 0)
+			{
+				Segments.Enqueue(MoveTemp(CurrentSegment));
+				CurrentSegment = TArray64<uint8>();
+			}
+
+			TArray64<uint8> Segment;
+			while (Segments.Dequeue(Segment))
+			{
+				if (BytesToSkip > 0)
+				{
+					const int64 SkipSize = FMath::Min(BytesToSkip, Segment.Num());
+					Segment.RemoveAt(0, SkipSize, EAllowShrinking::No);
+					BytesToSkip -= SkipSize;
+				}
+
+				if (Segment.Num() > 0)
+				{
+					DeliveredBytes += Segment.Num();
+					OnSegmentDownloaded(MoveTemp(Segment));
+				}
+				Segment = TArray64<uint8>();
+			}
+		}
+
+		/** The number of bytes of the response body received so far */
+		TAtomic<int64> ReceivedBytes;
+
+		/** The number of bytes of the file delivered by the previous requests */
+		const int64 ResumeOffset;
+
+		/** Whether the request was sent with the If-Range header */
+		const bool bValidatorSent;
+
+		/** Whether the response has been checked */
+		bool bResponseChecked;
+
+		/** Whether the response is the file the data is delivered from */
+		bool bResponseAccepted;
+
+		/** Whether the response body is encoded for the transfer */
+		bool bContentEncoded;
+
+		/** The number of bytes at the start of the response body that have already been delivered */
+		int64 BytesToSkip;
+
+		/** The number of bytes delivered by this request */
+		int64 DeliveredBytes;
+
+		/** The ETag or Last-Modified header of the file, used to continue the download if interrupted */
+		FString Validator;
+
+	private:
+		/** The segment being filled */
+		TArray64<uint8> CurrentSegment;
+
+		/** The complete segments waiting to be delivered */
+		TQueue<TArray64<uint8>, EQueueMode::Spsc> Segments;
+	};
+
+	/** The size of the slices a segment is decompressed in, so that the decompressed data is split into segments close to their size */
+	constexpr int64 DecodeSliceSize = 64 * 1024;
+#endif
+}
+
+#if !UE_VERSION_OLDER_THAN(5, 4, 0)
+/**
+ * Decoder of the segments of a streamed payload, decompressing them on worker threads while the rest of the payload is still being received, so that the compressed payload is never kept in memory as a whole
+ * A segment can be encoded for the transfer and the file itself can be compressed, in which case both are decompressed one after another
+ * The decoded data is passed on in segments of about the same size, in order, on the game thread. Segments that do not need to be decompressed are passed on as they are
+ */
+class FRuntimePayloadSegmentDecoder : public TSharedFromThis<FRuntimePayloadSegmentDecoder, ESPMode::ThreadSafe>
+{
+public:
+	/**
+	 * @param InOnSegmentDecoded The function called with each decoded segment on the game thread
+	 * @param bInDecompressFile Whether the file itself may be compressed, in which case it is decompressed if it starts with a compression header
+	 */
+	FRuntimePayloadSegmentDecoder(const FRuntimeChunkDownloader::FOnChunkDownloaded& InOnSegmentDecoded, bool bInDecompressFile)
+		: OnSegmentDecoded(InOnSegmentDecoded)
+		, bDecompressFile(bInDecompressFile)
+		, bDecoding(bInDecompressFile)
+		, FileBytes(0)
+		, bFileStarted(false)
+		, bLastSegmentEncoded(false)
+		, bDecodeFailed(false)
+	{
+	}
+
+	/**
+	 * Decode the next segment of the payload. Called on the game thread
+	 *
+	 * @param Segment The segment as received
+	 * @param bContentEncoded Whether the segment is part of a response encoded for the transfer
+	 */
+	void Decode(TArray64<uint8>&& Segment, bool bContentEncoded)
+	{
+		// As long as nothing needs to be decompressed, the segments are passed on right away
+		if (!bDecoding && !bContentEncoded)
+		{
+			FileBytes += Segment.Num();
+			OnSegmentDecoded(MoveTemp(Segment));
+			return;
+		}
+
+		if (bContentEncoded && !ContentDecompressor.IsValid())
+		{
+			ContentDecompressor = MakeUnique<FRuntimeStreamDecompressor>();
+		}
+		bDecoding = true;
+
+		RunStep([Segment = MoveTemp(Segment), bContentEncoded](FRuntimePayloadSegmentDecoder& Decoder, TArray<TArray64<uint8>>& OutDecodedSegments) mutable
+		{
+			return Decoder.DecodeSegment(MoveTemp(Segment), bContentEncoded, OutDecodedSegments);
+		}, nullptr);
+	}
+
+	/**
+	 * Pass on the rest of the decoded data once all segments have been decoded. Called on the game thread
+	 *
+	 * @param bFinal Whether the payload is complete, so that the compressed data is checked not to be truncated
+	 * @return A future that resolves on the game thread to whether all segments have been decoded successfully
+	 */
+	TFuture<bool> Flush(bool bFinal)
+	{
+		if (!bDecoding)
+		{
+			return MakeFulfilledPromise<bool>(true).GetFuture();
+		}
+
+		TSharedPtr<TPromise<bool>> PromisePtr = MakeShared<TPromise<bool>>();
+		RunStep([bFinal](FRuntimePayloadSegmentDecoder& Decoder, TArray<TArray64<uint8>>& OutDecodedSegments)
+		{
+			return Decoder.FinishDecoding(bFinal, OutDecodedSegments);
+		}, PromisePtr);
+		return PromisePtr->GetFuture();
+	}
+
+	/**
+	 * Check whether any segment has been encoded for the transfer. Called on the game thread
+	 */
+	bool WasContentEncoded() const
+	{
+		return ContentDecompressor.IsValid();
+	}
+
+	/**
+	 * Get the number of bytes of the file, before decompressing the file itself, decoded so far. Only valid on the game thread once flushed
+	 */
+	int64 GetFileBytes() const
+	{
+		return FileBytes;
+	}
+
+private:
+	using FDecodeStep = TUniqueFunction<bool(FRuntimePayloadSegmentDecoder&, TArray<TArray64<uint8>>&)>;
+
+	/**
+	 * Run the decoding step on a worker thread once the previous steps are done, and pass on the segments it decoded on the game thread
+	 *
+	 * @param Step The step to run, returning whether the data has been decoded successfully so far
+	 * @param PromisePtr The promise resolved with the result of the step once its segments have been passed on, if any
+	 */
+	void RunStep(FDecodeStep&& Step, const TSharedPtr<TPromise<bool>>& PromisePtr)
+	{
+		TSharedRef<FRuntimePayloadSegmentDecoder, ESPMode::ThreadSafe> ThisRef = AsShared();
+		TFuture<void> PreviousStepFuture = MoveTemp(StepFuture);
+		StepFuture = Async(EAsyncExecution::ThreadPool, [ThisRef, PromisePtr, Step = MoveTemp(Step), PreviousStepFuture = MoveTemp(PreviousStepFuture)]() mutable
+		{
+			TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimePayloadSegmentDecoder::RunStep);
+			RUNTIMEFILESDOWNLOADER_LLM_SCOPE;
+
+			if (PreviousStepFuture.IsValid())
+			{
+				PreviousStepFuture.Wait();
+			}
+
+			TArray<TArray64<uint8>> DecodedSegments;
+			const bool bSucceeded = Step(*ThisRef, DecodedSegments);
+
+			AsyncTask(ENamedThreads::GameThread, [ThisRef, PromisePtr, bSucceeded, DecodedSegments = MoveTemp(DecodedSegments)]() mutable
+			{
+				RUNTIMEFILESDOWNLOADER_GAME_THREAD_SCOPE;
+
+				for (TArray64<uint8>& DecodedSegment : DecodedSegments)
+				{
+					ThisRef->OnSegmentDecoded(MoveTemp(DecodedSegment));
+				}
+
+				if (PromisePtr.IsValid())
+				{
+					PromisePtr->SetValue(bSucceeded);
+				}
+			});
+		});
+	}
+
+	/**
+	 * Decode the segment, removing the transfer encoding first. Called on a worker thread
+	 */
+	bool DecodeSegment(TArray64<uint8>&& Segment, bool bContentEncoded, TArray<TArray64<uint8>>& OutDecodedSegments)
+	{
+		bLastSegmentEncoded = bContentEncoded;
+		if (!bContentEncoded)
+		{
+			DecodeFile(Segment.GetData(), Segment.Num(), OutDecodedSegments);
+		}
+		else
+		{
+			for (int64 SliceOffset = 0; SliceOffset < Segment.Num() && !bDecodeFailed; SliceOffset += DecodeSliceSize)
+			{
+				FileSlice.Reset();
+				bDecodeFailed = !ContentDecompressor->Decompress(Segment.GetData() + SliceOffset, FMath::Min(DecodeSliceSize, Segment.Num() - SliceOffset), FileSlice);
+				DecodeFile(FileSlice.GetData(), FileSlice.Num(), OutDecodedSegments);
+			}
+		}
+
+		FRuntimeChunkBufferPool::Get().Release(MoveTemp(Segment));
+		return !bDecodeFailed;
+	}
+
+	/**
+	 * Decompress the data of the file if the file itself is compressed, splitting the data into segments. Called on a worker thread
+	 */
+	void DecodeFile(const uint8* Data, int64 Size, TArray<TArray64<uint8>>& OutDecodedSegments)
+	{
+		if (Size <= 0 || bDecodeFailed)
+		{
+			return;
+		}
+
+		FileBytes += Size;
+
+		// Whether the file is compressed can only be checked once its first bytes are received
+		if (!bFileStarted)
+		{
+			bFileStarted = true;
+			if (bDecompressFile && FRuntimeStreamDecompressor::IsCompressed(Data, Size))
+			{
+				FileDecompressor = MakeUnique<FRuntimeStreamDecompressor>();
+			}
+		}
+
+		for (int64 SliceOffset = 0; SliceOffset < Size && !bDecodeFailed; SliceOffset += DecodeSliceSize)
+		{
+			if (DecodedSegment.Max() == 0)
+			{
+				DecodedSegment = FRuntimeChunkBufferPool::Get().Acquire(PayloadSegmentSize);
+			}
+
+			const int64 SliceSize = FMath::Min(DecodeSliceSize, Size - SliceOffset);
+			if (FileDecompressor.IsValid())
+			{
+				bDecodeFailed = !FileDecompressor->Decompress(Data + SliceOffset, SliceSize, DecodedSegment);
+			}
+			else
+			{
+				DecodedSegment.Append(Data + SliceOffset, SliceSize);
+			}
+
+			if (DecodedSegment.Num() >= PayloadSegmentSize)
+			{
+				OutDecodedSegments.Add(MoveTemp(DecodedSegment));
+				DecodedSegment = TArray64<uint8>();
+			}
+		}
+	}
+
+	/**
+	 * Pass on the last incomplete decoded segment. Called on a worker thread
+	 */
+	bool FinishDecoding(bool bFinal, TArray<TArray64<uint8>>& OutDecodedSegments)
+	{
+		if (DecodedSegment.Num() > 0)
+		{
+			OutDecodedSegments.Add(MoveTemp(DecodedSegment));
+		}
+		else
+		{
+			FRuntimeChunkBufferPool::Get().Release(MoveTemp(DecodedSegment));
+		}
+		DecodedSegment = TArray64<uint8>();
+
+		// A response encoded for the transfer may have been followed by the rest of the file unencoded, so only the encoding of the last one has to be complete
+		const bool bContentTruncated = bLastSegmentEncoded && !ContentDecompressor->IsFinished();
+		const bool bFileTruncated = FileDecompressor.IsValid() && !FileDecompressor->IsFinished();
+		if (bFinal && !bDecodeFailed && (bContentTruncated || bFileTruncated))
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to decompress the downloaded data: the compressed stream is truncated"));
+			bDecodeFailed = true;
+		}
+		return !bDecodeFailed;
+	}
+
+	/** The function called with each decoded segment on the game thread */
+	FRuntimeChunkDownloader::FOnChunkDownloaded OnSegmentDecoded;
+
+	/** Whether the file itself may be compressed */
+	const bool bDecompressFile;
+
+	/** Whether the segments are decoded on worker threads. Once set, all further segments are, so that they are passed on in order. Only used on the game thread */
+	bool bDecoding;
+
+	/** The future of the last decoding step, which the next step waits for */
+	TFuture<void> StepFuture;
+
+	/** The decompressor of the transfer encoding, created on the game thread before the first encoded segment is decoded */
+	TUniquePtr<FRuntimeStreamDecompressor> ContentDecompressor;
+
+	/** The number of bytes of the file decoded so far. Used on the game thread until the decoding starts, and on worker threads afterwards */
+	int64 FileBytes;
+
+	/** Whether the first bytes of the file have been decoded. Only used on worker threads */
+	bool bFileStarted;
+
+	/** Whether the last segment was encoded for the transfer. Only used on worker threads */
+	bool bLastSegmentEncoded;
+
+	/** The data of the file decoded from the last slice of an encoded segment. Only used on worker threads */
+	TArray64<uint8> FileSlice;
+
+	/** The decompressor of the file, if it is compressed. Only used on worker threads */
+	TUniquePtr<FRuntimeStreamDecompressor> FileDecompressor;
+
+	/** The decoded segment being filled. Only used on worker threads */
+	TArray64<uint8> DecodedSegment;
+
+	/** Whether the data could not be decompressed. Only used on worker threads */
+	bool bDecodeFailed;
+};
+#endif
+
 FRuntimeChunkDownloader::FRuntimeChunkDownloader()
 	: bCanceled(false)
-{}
+	, bPaused(false)
+	, DownloadStartTime(0)
+	, AllocatedBufferMemory(0)
+	, bAcceptCompressedContent(GetDefault<URuntimeFilesDownloaderSettings>()->bAcceptCompressedContent)
+	, bDecompressCompressedFiles(GetDefault<URuntimeFilesDownloaderSettings>()->bDecompressCompressedFiles)
+	, bFastStart(GetDefault<URuntimeFilesDownloaderSettings>()->bFastStartDownloads)
+	, ExecutionPolicy(FRuntimeDownloadExecutionPolicy::FromSettings())
+	, bBackground(false)
+{
+	INC_DWORD_STAT(STAT_RuntimeFilesDownloader_ActiveDownloads);
+}
 
 FRuntimeChunkDownloader::~FRuntimeChunkDownloader()
 {
+	DEC_DWORD_STAT(STAT_RuntimeFilesDownloader_ActiveDownloads);
+	DEC_DWORD_STAT_BY(STAT_RuntimeFilesDownloader_QueuedRequests, PendingResumeFunctions.Num());
 	UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("FRuntimeChunkDownloader destroyed"));
 }
 
 TFuture<FRuntimeChunkDownloaderResult> FRuntimeChunkDownloader::DownloadFile(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, const FOnProgress& OnProgress)
 {
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeChunkDownloader::DownloadFile);
+
 	if (bCanceled)
 	{
 		UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file download from %s"), *URL);
 		return MakeFulfilledPromise<FRuntimeChunkDownloaderResult>(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::Cancelled, TArray64<uint8>()}).GetFuture();
 	}
 
+	MarkDownloadStarted();
+
 	TSharedPtr<TPromise<FRuntimeChunkDownloaderResult>> PromisePtr = MakeShared<TPromise<FRuntimeChunkDownloaderResult>>();
 	TWeakPtr<FRuntimeChunkDownloader> WeakThisPtr = AsShared();
-	GetContentSize(URL, Timeout).Next([WeakThisPtr, PromisePtr, URL, Timeout, ContentType, MaxChunkSize, OnProgress](int64 ContentSize) mutable
+	ProbeContent(URL, Timeout, ContentType, MaxChunkSize, OnProgress).Next([WeakThisPtr, PromisePtr, URL, Timeout, ContentType, MaxChunkSize, OnProgress](FContentProbe&& Probe) mutable
 	{
+		const int64 ContentSize = Probe.ContentSize;
+
 		TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
 		if (!SharedThis.IsValid())
 		{
@@ -51,6 +563,13 @@ TFuture<FRuntimeChunkDownloaderResult> FRuntimeChunkDownloader::DownloadFile(con
 
 		auto DownloadByPayload = [SharedThis, WeakThisPtr, PromisePtr, URL, Timeout, ContentType, OnProgress]()
 		{
+			// Everything received by chunks so far is discarded in favor of the payload
+#if UE_VERSION_NEWER_THAN(5, 0, 0)
+			TRACE_COUNTER_ADD(RuntimeFilesDownloader_BytesWasted, SharedThis->Stats.BytesReceived - SharedThis->Stats.BytesWasted);
+#endif
+			SharedThis->Stats.BytesWasted = SharedThis->Stats.BytesReceived;
+			++SharedThis->Stats.RetryCount;
+
 			SharedThis->DownloadFileByPayload(URL, Timeout, ContentType, OnProgress).Next([WeakThisPtr, PromisePtr, URL, Timeout, ContentType, OnProgress](FRuntimeChunkDownloaderResult Result) mutable
 			{
 				TSharedPtr<FRuntimeChunkDownloader> InternalSharedThis = WeakThisPtr.Pin();
@@ -79,6 +598,33 @@ TFuture<FRuntimeChunkDownloaderResult> FRuntimeChunkDownloader::DownloadFile(con
 			return;
 		}
 
+		// The whole file was received while probing the content, e.g. because it fits in the first chunk
+		if (Probe.FirstChunk.Num() >= ContentSize)
+		{
+			if (!Probe.bWholeFile)
+			{
+				// The first chunk of a ranged response has not been decompressed yet, unlike a response with the whole file
+				SharedThis->DecompressIfNeeded(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::Success, MoveTemp(Probe.FirstChunk)}, URL, FString()).Next([PromisePtr](FRuntimeChunkDownloaderResult&& DecompressedResult)
+				{
+					PromisePtr->SetValue(MoveTemp(DecompressedResult));
+				});
+				return;
+			}
+			PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::Success, MoveTemp(Probe.FirstChunk)});
+			return;
+		}
+
+		// A server that does not accept ranges would send the whole file for the first chunk, so it is downloaded in a single request right away
+		if (!Probe.bAcceptsRanges)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("The server of %s does not accept range requests. Downloading the file by payload"), *URL);
+			SharedThis->DownloadFileByPayload(URL, Timeout, ContentType, OnProgress).Next([PromisePtr](FRuntimeChunkDownloaderResult&& Result)
+			{
+				PromisePtr->SetValue(MoveTemp(Result));
+			});
+			return;
+		}
+
 		if (MaxChunkSize <= 0)
 		{
 			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file chunk from %s: MaxChunkSize is <= 0. Trying to download the file by payload"), *URL);
@@ -88,19 +634,46 @@ TFuture<FRuntimeChunkDownloaderResult> FRuntimeChunkDownloader::DownloadFile(con
 
 		TSharedPtr<TArray64<uint8>> OverallDownloadedDataPtr = MakeShared<TArray64<uint8>>();
 		{
+			TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeChunkDownloader::AllocateDownloadBuffer);
+			RUNTIMEFILESDOWNLOADER_LLM_SCOPE;
 			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Pre-allocating %lld bytes for file download from %s"), ContentSize, *URL);
 			OverallDownloadedDataPtr->SetNumUninitialized(ContentSize);
+			SharedThis->AllocatedBufferMemory = ContentSize;
+		}
+
+		// The first chunk received while probing the content is kept, and the download continues after it
+		const int64 FirstChunkSize = Probe.FirstChunk.Num();
+		if (FirstChunkSize > 0)
+		{
+			FMemory::Memcpy(OverallDownloadedDataPtr->GetData(), Probe.FirstChunk.GetData(), FirstChunkSize);
+			FRuntimeChunkBufferPool::Get().Release(MoveTemp(Probe.FirstChunk));
 		}
 
 		FInt64Vector2 ChunkRange;
 		{
-			ChunkRange.X = 0;
-			ChunkRange.Y = FMath::Min(MaxChunkSize, ContentSize) - 1;
+			ChunkRange.X = FirstChunkSize;
+			ChunkRange.Y = FMath::Min(FirstChunkSize + MaxChunkSize, ContentSize) - 1;
 		}
 
 		TSharedPtr<int64> ChunkOffsetPtr = MakeShared<int64>(ChunkRange.X);
 		TSharedPtr<bool> bChunkDownloadedFilledPtr = MakeShared<bool>(false);
 
+		// The chunks are copied into the result data on the thread their response is processed on, so the copies overlap with the download of the next chunks without another hop to a worker thread
+		TSharedPtr<TAtomic<int64>> CopiedEndPtr = MakeShared<TAtomic<int64>>(ChunkRange.X);
+		SharedThis->ChunkSink = [OverallDownloadedDataPtr, CopiedEndPtr](int64 Offset, const uint8* Data, int64 Size)
+		{
+			if (Offset < 0 || Size < 0 || Offset + Size > OverallDownloadedDataPtr->Num())
+			{
+				return false;
+			}
+
+			TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeChunkDownloader::CopyChunk);
+			FMemory::Memcpy(OverallDownloadedDataPtr->GetData() + Offset, Data, Size);
+			*CopiedEndPtr = Offset + Size;
+			return true;
+		};
+		SharedThis->ChunkSinkEndPtr = CopiedEndPtr;
+
 		auto OnChunkDownloadedFilled = [bChunkDownloadedFilledPtr]()
 		{
 			if (bChunkDownloadedFilledPtr.IsValid())
@@ -109,7 +682,7 @@ TFuture<FRuntimeChunkDownloaderResult> FRuntimeChunkDownloader::DownloadFile(con
 			}
 		};
 
-		auto OnChunkDownloaded = [WeakThisPtr, PromisePtr, URL, ContentSize, Timeout, ContentType, OnProgress, DownloadByPayload, OverallDownloadedDataPtr, bChunkDownloadedFilledPtr, ChunkOffsetPtr, OnChunkDownloadedFilled](TArray64<uint8>&& ResultData) mutable
+		auto OnChunkDownloaded = [WeakThisPtr, PromisePtr, URL, ContentSize, Timeout, ContentType, OnProgress, DownloadByPayload, OverallDownloadedDataPtr, bChunkDownloadedFilledPtr, ChunkOffsetPtr, CopiedEndPtr, OnChunkDownloadedFilled](TArray64<uint8>&& ResultData) mutable
 		{
 			TSharedPtr<FRuntimeChunkDownloader> InternalSharedThis = WeakThisPtr.Pin();
 			if (!InternalSharedThis.IsValid())
@@ -120,7 +693,10 @@ TFuture<FRuntimeChunkDownloaderResult> FRuntimeChunkDownloader::DownloadFile(con
 				return;
 			}
 
-			if (ResultData.Num() <= 0)
+			// A chunk copied into the result data when its response was processed is passed on without its data
+			const int64 ChunkOffset = *ChunkOffsetPtr;
+			const int64 ChunkSize = ResultData.Num() > 0 ? ResultData.Num() : *CopiedEndPtr - ChunkOffset;
+			if (ChunkSize <= 0)
 			{
 				UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to download file chunk from %s: result data is empty"), *URL);
 				PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, TArray64<uint8>()});
@@ -137,7 +713,7 @@ TFuture<FRuntimeChunkDownloaderResult> FRuntimeChunkDownloader::DownloadFile(con
 			}
 
 			// Calculate the currently size of the downloaded content in the result buffer
-			const int64 CurrentlyDownloadedSize = *ChunkOffsetPtr + ResultData.Num();
+			const int64 CurrentlyDownloadedSize = ChunkOffset + ChunkSize;
 
 			// Check if some values are out of range
 			{
@@ -158,23 +734,40 @@ TFuture<FRuntimeChunkDownloaderResult> FRuntimeChunkDownloader::DownloadFile(con
 				}
 			}
 
-			// Append the downloaded chunk to the result data
-			FMemory::Memcpy(OverallDownloadedDataPtr->GetData() + *ChunkOffsetPtr, ResultData.GetData(), ResultData.Num());
+			// Append the downloaded chunk to the result data, unless it has already been copied there when its response was processed, e.g. unlike the segments of a payload download
+			if (*CopiedEndPtr < CurrentlyDownloadedSize)
+			{
+				TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeChunkDownloader::CopyChunk);
+				FMemory::Memcpy(OverallDownloadedDataPtr->GetData() + ChunkOffset, ResultData.GetData(), ChunkSize);
+				*CopiedEndPtr = CurrentlyDownloadedSize;
+			}
+			FRuntimeChunkBufferPool::Get().Release(MoveTemp(ResultData));
 
 			// If the download is complete, return the result data
-			if (*ChunkOffsetPtr + ResultData.Num() >= ContentSize)
+			if (ChunkOffset + ChunkSize >= ContentSize)
 			{
-				PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::Success, MoveTemp(*OverallDownloadedDataPtr.Get())});
+				InternalSharedThis->ChunkSink = nullptr;
+				InternalSharedThis->ChunkSinkEndPtr.Reset();
+				InternalSharedThis->DecompressIfNeeded(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::Success, MoveTemp(*OverallDownloadedDataPtr.Get())}, URL, FString()).Next([PromisePtr](FRuntimeChunkDownloaderResult&& DecompressedResult)
+				{
+					PromisePtr->SetValue(MoveTemp(DecompressedResult));
+				});
 				OnChunkDownloadedFilled();
 				return;
 			}
 
 			// Increase the offset by the size of the downloaded chunk
-			*ChunkOffsetPtr += ResultData.Num();
+			*ChunkOffsetPtr += ChunkSize;
 		};
 
-		SharedThis->DownloadFilePerChunk(URL, Timeout, ContentType, MaxChunkSize, ChunkRange, OnProgress, OnChunkDownloaded).Next([PromisePtr, bChunkDownloadedFilledPtr, URL, OverallDownloadedDataPtr, OnChunkDownloadedFilled, DownloadByPayload](EDownloadToMemoryResult Result) mutable
+		SharedThis->DownloadFilePerChunk(URL, Timeout, ContentType, MaxChunkSize, ChunkRange, OnProgress, OnChunkDownloaded).Next([WeakThisPtr, PromisePtr, bChunkDownloadedFilledPtr, URL, OverallDownloadedDataPtr, OnChunkDownloadedFilled, DownloadByPayload](EDownloadToMemoryResult Result) mutable
 		{
+			if (TSharedPtr<FRuntimeChunkDownloader> FinishedSharedThis = WeakThisPtr.Pin())
+			{
+				FinishedSharedThis->ChunkSink = nullptr;
+				FinishedSharedThis->ChunkSinkEndPtr.Reset();
+			}
+
 			// Only return data if no chunk was downloaded
 			if (bChunkDownloadedFilledPtr.IsValid() && (*bChunkDownloadedFilledPtr.Get() == false))
 			{
@@ -186,44 +779,200 @@ TFuture<FRuntimeChunkDownloaderResult> FRuntimeChunkDownloader::DownloadFile(con
 					return;
 				}
 				OverallDownloadedDataPtr->Shrink();
-				PromisePtr->SetValue(FRuntimeChunkDownloaderResult{Result, MoveTemp(*OverallDownloadedDataPtr.Get())});
+
+				TSharedPtr<FRuntimeChunkDownloader> InternalSharedThis = WeakThisPtr.Pin();
+				if (!InternalSharedThis.IsValid())
+				{
+					PromisePtr->SetValue(FRuntimeChunkDownloaderResult{Result, MoveTemp(*OverallDownloadedDataPtr.Get())});
+					return;
+				}
+
+				InternalSharedThis->DecompressIfNeeded(FRuntimeChunkDownloaderResult{Result, MoveTemp(*OverallDownloadedDataPtr.Get())}, URL, FString()).Next([PromisePtr](FRuntimeChunkDownloaderResult&& DecompressedResult)
+				{
+					PromisePtr->SetValue(MoveTemp(DecompressedResult));
+				});
 			}
 		});
 	});
-	return PromisePtr->GetFuture();
+	// The content information is only reused within the download, so that a later download checks the file on the server again
+	return PromisePtr->GetFuture().Next([WeakThisPtr, URL](FRuntimeChunkDownloaderResult&& Result)
+	{
+		if (TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin())
+		{
+			SharedThis->KnownContentInfos.Remove(URL);
+		}
+		return MoveTemp(Result);
+	});
 }
 
-TFuture<EDownloadToMemoryResult> FRuntimeChunkDownloader::DownloadFilePerChunk(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, FInt64Vector2 ChunkRange, const FOnProgress& OnProgress, const FOnChunkDownloaded& OnChunkDownloaded)
+TFuture<FRuntimeChunkDownloaderBufferResult> FRuntimeChunkDownloader::DownloadFileToBuffer(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, const FOnAllocateBuffer& AllocateBuffer, const FOnProgress& OnProgress)
 {
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeChunkDownloader::DownloadFileToBuffer);
+
 	if (bCanceled)
 	{
-		UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file chunk download from %s"), *URL);
-		return MakeFulfilledPromise<EDownloadToMemoryResult>(EDownloadToMemoryResult::Cancelled).GetFuture();
+		UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file download from %s"), *URL);
+		return MakeFulfilledPromise<FRuntimeChunkDownloaderBufferResult>(FRuntimeChunkDownloaderBufferResult{EDownloadToMemoryResult::Cancelled, nullptr, 0}).GetFuture();
 	}
 
-	TSharedPtr<TPromise<EDownloadToMemoryResult>> PromisePtr = MakeShared<TPromise<EDownloadToMemoryResult>>();
+	MarkDownloadStarted();
+
+	TSharedPtr<TPromise<FRuntimeChunkDownloaderBufferResult>> PromisePtr = MakeShared<TPromise<FRuntimeChunkDownloaderBufferResult>>();
 	TWeakPtr<FRuntimeChunkDownloader> WeakThisPtr = AsShared();
-	GetContentSize(URL, Timeout).Next([WeakThisPtr, PromisePtr, URL, Timeout, ContentType, MaxChunkSize, OnProgress, OnChunkDownloaded, ChunkRange](int64 ContentSize) mutable
+	GetContentSize(URL, Timeout).Next([WeakThisPtr, PromisePtr, URL, Timeout, ContentType, MaxChunkSize, AllocateBuffer, OnProgress](int64 ContentSize)
 	{
 		TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
 		if (!SharedThis.IsValid())
 		{
-			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to download file chunk from %s: downloader has been destroyed"), *URL);
-			PromisePtr->SetValue(EDownloadToMemoryResult::DownloadFailed);
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to download file from %s: downloader has been destroyed"), *URL);
+			PromisePtr->SetValue(FRuntimeChunkDownloaderBufferResult{EDownloadToMemoryResult::DownloadFailed, nullptr, 0});
 			return;
 		}
-		
+
 		if (SharedThis->bCanceled)
 		{
-			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file chunk download from %s"), *URL);
-			PromisePtr->SetValue(EDownloadToMemoryResult::Cancelled);
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file download from %s"), *URL);
+			PromisePtr->SetValue(FRuntimeChunkDownloaderBufferResult{EDownloadToMemoryResult::Cancelled, nullptr, 0});
 			return;
 		}
 
+		// Without the content size the destination can only be allocated once the whole payload is received
 		if (ContentSize <= 0)
 		{
-			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Unable to get content size for %s. Trying to download the file by payload"), *URL);
-			SharedThis->DownloadFileByPayload(URL, Timeout, ContentType, OnProgress).Next([WeakThisPtr, PromisePtr, URL, Timeout, ContentType, OnChunkDownloaded, OnProgress](FRuntimeChunkDownloaderResult Result) mutable
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Unable to get content size for %s. Trying to download the file by payload and copy it into the destination"), *URL);
+			SharedThis->DownloadFileByPayload(URL, Timeout, ContentType, OnProgress).Next([PromisePtr, URL, AllocateBuffer](FRuntimeChunkDownloaderResult&& Result)
+			{
+				if (Result.Result != EDownloadToMemoryResult::Success && Result.Result != EDownloadToMemoryResult::SucceededByPayload)
+				{
+					PromisePtr->SetValue(FRuntimeChunkDownloaderBufferResult{Result.Result, nullptr, 0});
+					return;
+				}
+
+				uint8* Buffer = AllocateBuffer(Result.Data.Num());
+				if (!Buffer)
+				{
+					UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file from %s: no destination was provided for %lld bytes"), *URL, Result.Data.Num());
+					PromisePtr->SetValue(FRuntimeChunkDownloaderBufferResult{EDownloadToMemoryResult::DownloadFailed, nullptr, 0});
+					return;
+				}
+
+				FMemory::Memcpy(Buffer, Result.Data.GetData(), Result.Data.Num());
+				PromisePtr->SetValue(FRuntimeChunkDownloaderBufferResult{Result.Result, Buffer, Result.Data.Num()});
+			});
+			return;
+		}
+
+		if (MaxChunkSize <= 0)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file from %s: MaxChunkSize is <= 0"), *URL);
+			PromisePtr->SetValue(FRuntimeChunkDownloaderBufferResult{EDownloadToMemoryResult::DownloadFailed, nullptr, 0});
+			return;
+		}
+
+		uint8* Buffer;
+		{
+			TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeChunkDownloader::AllocateDownloadBuffer);
+			Buffer = AllocateBuffer(ContentSize);
+		}
+
+		if (!Buffer)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file from %s: no destination was provided for %lld bytes"), *URL, ContentSize);
+			PromisePtr->SetValue(FRuntimeChunkDownloaderBufferResult{EDownloadToMemoryResult::DownloadFailed, nullptr, 0});
+			return;
+		}
+
+		TSharedPtr<int64> ChunkOffsetPtr = MakeShared<int64>(0);
+		auto OnChunkDownloaded = [Buffer, ContentSize, ChunkOffsetPtr](TArray64<uint8>&& ChunkData)
+		{
+			// Never write past the size the destination was provided for
+			const int64 CopySize = FMath::Min<int64>(ChunkData.Num(), ContentSize - *ChunkOffsetPtr);
+			if (CopySize > 0)
+			{
+				TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeChunkDownloader::CopyChunk);
+				FMemory::Memcpy(Buffer + *ChunkOffsetPtr, ChunkData.GetData(), CopySize);
+				*ChunkOffsetPtr += CopySize;
+			}
+			FRuntimeChunkBufferPool::Get().Release(MoveTemp(ChunkData));
+		};
+
+		const FInt64Vector2 ChunkRange(0, FMath::Min(MaxChunkSize, ContentSize) - 1);
+		SharedThis->DownloadFilePerChunk(URL, Timeout, ContentType, MaxChunkSize, ChunkRange, OnProgress, OnChunkDownloaded).Next([PromisePtr, URL, Buffer, ContentSize, ChunkOffsetPtr](EDownloadToMemoryResult Result)
+		{
+			if (Result == EDownloadToMemoryResult::Success && *ChunkOffsetPtr != ContentSize)
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file from %s: received %lld bytes, expected %lld"), *URL, *ChunkOffsetPtr, ContentSize);
+				Result = EDownloadToMemoryResult::DownloadFailed;
+			}
+			PromisePtr->SetValue(FRuntimeChunkDownloaderBufferResult{Result, Buffer, *ChunkOffsetPtr});
+		});
+	});
+	return PromisePtr->GetFuture();
+}
+
+TFuture<FRuntimeChunkDownloaderBufferResult> FRuntimeChunkDownloader::DownloadFileToBuffer(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, uint8* Buffer, int64 BufferSize, const FOnProgress& OnProgress)
+{
+	return DownloadFileToBuffer(URL, Timeout, ContentType, MaxChunkSize, [Buffer, BufferSize, URL](int64 ContentSize) -> uint8*
+	{
+		if (ContentSize > BufferSize)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("The file from %s (%lld bytes) does not fit into the provided buffer of %lld bytes"), *URL, ContentSize, BufferSize);
+			return nullptr;
+		}
+		return Buffer;
+	}, OnProgress);
+}
+
+TFuture<EDownloadToMemoryResult> FRuntimeChunkDownloader::DownloadFilePerChunk(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, FInt64Vector2 ChunkRange, const FOnProgress& OnProgress, const FOnChunkDownloaded& OnChunkDownloaded)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeChunkDownloader::DownloadFilePerChunk);
+
+	if (bCanceled)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file chunk download from %s"), *URL);
+		return MakeFulfilledPromise<EDownloadToMemoryResult>(EDownloadToMemoryResult::Cancelled).GetFuture();
+	}
+
+	MarkDownloadStarted();
+
+	TSharedPtr<TPromise<EDownloadToMemoryResult>> PromisePtr = MakeShared<TPromise<EDownloadToMemoryResult>>();
+	TWeakPtr<FRuntimeChunkDownloader> WeakThisPtr = AsShared();
+
+	// Only the download of the whole file starts with the first chunk, a specified range is requested as is
+	const bool bRangeSpecified = ChunkRange.X != 0 || ChunkRange.Y != 0;
+	ProbeContent(URL, Timeout, ContentType, bRangeSpecified ? 0 : MaxChunkSize, OnProgress).Next([WeakThisPtr, PromisePtr, URL, Timeout, ContentType, MaxChunkSize, OnProgress, OnChunkDownloaded, ChunkRange](FContentProbe&& Probe) mutable
+	{
+		const int64 ContentSize = Probe.ContentSize;
+
+		TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
+		if (!SharedThis.IsValid())
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to download file chunk from %s: downloader has been destroyed"), *URL);
+			PromisePtr->SetValue(EDownloadToMemoryResult::DownloadFailed);
+			return;
+		}
+		
+		if (SharedThis->bCanceled)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file chunk download from %s"), *URL);
+			PromisePtr->SetValue(EDownloadToMemoryResult::Cancelled);
+			return;
+		}
+
+		// A server that does not accept ranges is asked for the whole file in a single request, unless the download continues from the middle of the file
+		const bool bRangesUnsupported = !Probe.bAcceptsRanges && ChunkRange.X == 0;
+		if (ContentSize <= 0 || bRangesUnsupported)
+		{
+			if (bRangesUnsupported)
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("The server of %s does not accept range requests. Downloading the file by payload"), *URL);
+			}
+			else
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Unable to get content size for %s. Trying to download the file by payload"), *URL);
+			}
+			// The file is delivered in segments as it arrives, so that its size is not limited by the payload kept in memory
+			SharedThis->DownloadFileByPayloadPerSegment(URL, Timeout, ContentType, OnProgress, OnChunkDownloaded).Next([WeakThisPtr, PromisePtr, URL](EDownloadToMemoryResult Result)
 			{
 				TSharedPtr<FRuntimeChunkDownloader> InternalSharedThis = WeakThisPtr.Pin();
 				if (!InternalSharedThis.IsValid())
@@ -240,22 +989,12 @@ TFuture<EDownloadToMemoryResult> FRuntimeChunkDownloader::DownloadFilePerChunk(c
 					return;
 				}
 
-				if (Result.Result != EDownloadToMemoryResult::Success && Result.Result != EDownloadToMemoryResult::SucceededByPayload)
-				{
-					UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file chunk from %s: %s"), *URL, *UEnum::GetValueAsString(Result.Result));
-					PromisePtr->SetValue(Result.Result);
-					return;
-				}
-
-				if (Result.Data.Num() <= 0)
+				if (Result != EDownloadToMemoryResult::Success && Result != EDownloadToMemoryResult::SucceededByPayload)
 				{
-					UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file chunk from %s: downloaded content is empty"), *URL);
-					PromisePtr->SetValue(EDownloadToMemoryResult::DownloadFailed);
-					return;
+					UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file chunk from %s: %s"), *URL, *UEnum::GetValueAsString(Result));
 				}
 
-				PromisePtr->SetValue(Result.Result);
-				OnChunkDownloaded(MoveTemp(Result.Data));
+				PromisePtr->SetValue(Result);
 			});
 			return;
 		}
@@ -267,6 +1006,19 @@ TFuture<EDownloadToMemoryResult> FRuntimeChunkDownloader::DownloadFilePerChunk(c
 			return;
 		}
 
+		// The first chunk received while probing the content is delivered, and the download continues after it
+		if (Probe.FirstChunk.Num() > 0)
+		{
+			const int64 FirstChunkSize = Probe.FirstChunk.Num();
+			OnChunkDownloaded(MoveTemp(Probe.FirstChunk));
+			if (FirstChunkSize >= ContentSize)
+			{
+				PromisePtr->SetValue(EDownloadToMemoryResult::Success);
+				return;
+			}
+			ChunkRange = FInt64Vector2(FirstChunkSize, FMath::Min(FirstChunkSize + MaxChunkSize, ContentSize) - 1);
+		}
+
 		// If the chunk range is not specified, determine the range based on the max chunk size and the content size
 		if (ChunkRange.X == 0 && ChunkRange.Y == 0)
 		{
@@ -291,7 +1043,7 @@ TFuture<EDownloadToMemoryResult> FRuntimeChunkDownloader::DownloadFilePerChunk(c
 			}
 		};
 
-		SharedThis->DownloadFileByChunk(URL, Timeout, ContentType, ContentSize, ChunkRange, OnProgressInternal).Next([WeakThisPtr, PromisePtr, URL, Timeout, ContentType, ContentSize, MaxChunkSize, OnChunkDownloaded, OnProgress, ChunkRange](FRuntimeChunkDownloaderResult&& Result)
+		SharedThis->RequestChunk(URL, Timeout, ContentType, ContentSize, ChunkRange, OnProgressInternal, true).Next([WeakThisPtr, PromisePtr, URL, Timeout, ContentType, ContentSize, MaxChunkSize, OnChunkDownloaded, OnProgress, ChunkRange](FRuntimeChunkDownloaderResult&& Result)
 		{
 			TSharedPtr<FRuntimeChunkDownloader> InternalSharedThis = WeakThisPtr.Pin();
 			if (!InternalSharedThis.IsValid())
@@ -315,12 +1067,19 @@ TFuture<EDownloadToMemoryResult> FRuntimeChunkDownloader::DownloadFilePerChunk(c
 				return;
 			}
 
-			OnChunkDownloaded(MoveTemp(Result.Data));
+			// The chunk may extend to the end of the file if the server ignored the range
+			// A chunk copied straight into the destination of the download by the chunk sink has no data, so its end is taken from the sink
+			const bool bCopiedBySink = Result.Data.Num() == 0 && InternalSharedThis->ChunkSinkEndPtr.IsValid();
+			const int64 ReceivedEnd = bCopiedBySink ? static_cast<int64>(*InternalSharedThis->ChunkSinkEndPtr) - 1 : ChunkRange.X + Result.Data.Num() - 1;
+			{
+				TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeChunkDownloader::BroadcastChunkDownloaded);
+				OnChunkDownloaded(MoveTemp(Result.Data));
+			}
 
 			// Check if the download is complete
-			if (ContentSize > ChunkRange.Y + 1)
+			if (ContentSize > ReceivedEnd + 1)
 			{
-				const int64 ChunkStart = ChunkRange.Y + 1;
+				const int64 ChunkStart = ReceivedEnd + 1;
 				const int64 ChunkEnd = FMath::Min(ChunkStart + MaxChunkSize, ContentSize) - 1;
 
 				InternalSharedThis->DownloadFilePerChunk(URL, Timeout, ContentType, MaxChunkSize, FInt64Vector2(ChunkStart, ChunkEnd), OnProgress, OnChunkDownloaded).Next([WeakThisPtr, PromisePtr](EDownloadToMemoryResult InternalResult)
@@ -335,11 +1094,26 @@ TFuture<EDownloadToMemoryResult> FRuntimeChunkDownloader::DownloadFilePerChunk(c
 		});
 	});
 
-	return PromisePtr->GetFuture();
+	// The content information is only reused within the download, so that a later download checks the file on the server again
+	return PromisePtr->GetFuture().Next([WeakThisPtr, URL](EDownloadToMemoryResult Result)
+	{
+		if (TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin())
+		{
+			SharedThis->KnownContentInfos.Remove(URL);
+		}
+		return Result;
+	});
 }
 
 TFuture<FRuntimeChunkDownloaderResult> FRuntimeChunkDownloader::DownloadFileByChunk(const FString& URL, float Timeout, const FString& ContentType, int64 ContentSize, FInt64Vector2 ChunkRange, const FOnProgress& OnProgress)
 {
+	return RequestChunk(URL, Timeout, ContentType, ContentSize, ChunkRange, OnProgress, false);
+}
+
+TFuture<FRuntimeChunkDownloaderResult> FRuntimeChunkDownloader::RequestChunk(const FString& URL, float Timeout, const FString& ContentType, int64 ContentSize, FInt64Vector2 ChunkRange, const FOnProgress& OnProgress, bool bAcceptRestOfFile)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeChunkDownloader::DownloadFileByChunk);
+
 	if (bCanceled)
 	{
 		UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file download from %s"), *URL);
@@ -358,8 +1132,38 @@ TFuture<FRuntimeChunkDownloaderResult> FRuntimeChunkDownloader::DownloadFileByCh
 		return MakeFulfilledPromise<FRuntimeChunkDownloaderResult>(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, TArray64<uint8>()}).GetFuture();
 	}
 
+	MarkDownloadStarted();
+
+	TSharedPtr<TPromise<FRuntimeChunkDownloaderResult>> PromisePtr = MakeShared<TPromise<FRuntimeChunkDownloaderResult>>();
 	TWeakPtr<FRuntimeChunkDownloader> WeakThisPtr = AsShared();
 
+	// The chunk of a paused download is requested once resumed, so that neither the chunk nor the download it belongs to fails
+	auto RequestOnceResumed = [WeakThisPtr, PromisePtr, URL, Timeout, ContentType, ContentSize, ChunkRange, OnProgress, bAcceptRestOfFile](FRuntimeChunkDownloader& Downloader)
+	{
+		Downloader.RunWhenResumed([WeakThisPtr, PromisePtr, URL, Timeout, ContentType, ContentSize, ChunkRange, OnProgress, bAcceptRestOfFile]()
+		{
+			TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
+			if (!SharedThis.IsValid())
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to resume file chunk download from %s: downloader has been destroyed"), *URL);
+				PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, TArray64<uint8>()});
+				return;
+			}
+
+			SharedThis->RequestChunk(URL, Timeout, ContentType, ContentSize, ChunkRange, OnProgress, bAcceptRestOfFile).Next([PromisePtr](FRuntimeChunkDownloaderResult&& Result)
+			{
+				PromisePtr->SetValue(MoveTemp(Result));
+			});
+		});
+	};
+
+	if (IsPaused())
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Download from %s is paused. The chunk {%lld; %lld} will be requested once resumed"), *URL, ChunkRange.X, ChunkRange.Y);
+		RequestOnceResumed(*this);
+		return PromisePtr->GetFuture();
+	}
+
 #if UE_VERSION_NEWER_THAN(4, 26, 0)
 	const TSharedRef<IHttpRequest, ESPMode::ThreadSafe> HttpRequestRef = FHttpModule::Get().CreateRequest();
 #else
@@ -380,8 +1184,14 @@ TFuture<FRuntimeChunkDownloaderResult> FRuntimeChunkDownloader::DownloadFileByCh
 		HttpRequestRef->SetHeader(TEXT("Content-Type"), ContentType);
 	}
 
+	SetCommonHeaders(HttpRequestRef, false);
+
 	const FString RangeHeaderValue = FString::Format(TEXT("bytes={0}-{1}"), {ChunkRange.X, ChunkRange.Y});
 	HttpRequestRef->SetHeader(TEXT("Range"), RangeHeaderValue);
+	if (!IfRangeValidator.IsEmpty())
+	{
+		HttpRequestRef->SetHeader(TEXT("If-Range"), IfRangeValidator);
+	}
 
 	HttpRequestRef->
 #if UE_VERSION_OLDER_THAN(5, 4, 0)
@@ -390,18 +1200,30 @@ TFuture<FRuntimeChunkDownloaderResult> FRuntimeChunkDownloader::DownloadFileByCh
 		OnRequestProgress64().BindLambda([WeakThisPtr, ContentSize, ChunkRange, OnProgress](FHttpRequestPtr Request, uint64 BytesSent, uint64 BytesReceived)
 #endif
 	{
+		RUNTIMEFILESDOWNLOADER_GAME_THREAD_SCOPE;
+
 		TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
 		if (SharedThis.IsValid())
 		{
+			if (BytesReceived > 0 && SharedThis->Stats.TimeToFirstByte < 0)
+			{
+				SharedThis->Stats.TimeToFirstByte = static_cast<float>(FPlatformTime::Seconds() - SharedThis->DownloadStartTime);
+			}
+
 			const float Progress = ContentSize <= 0 ? 0.0f : static_cast<float>(BytesReceived) / ContentSize;
 			UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Downloaded %lld bytes of file chunk from %s. Range: {%lld; %lld}, Overall: %lld, Progress: %f"), static_cast<int64>(BytesReceived), *Request->GetURL(), ChunkRange.X, ChunkRange.Y, ContentSize, Progress);
 			OnProgress(BytesReceived, ContentSize);
 		}
 	});
 
-	TSharedPtr<TPromise<FRuntimeChunkDownloaderResult>> PromisePtr = MakeShared<TPromise<FRuntimeChunkDownloaderResult>>();
-	HttpRequestRef->OnProcessRequestComplete().BindLambda([WeakThisPtr, PromisePtr, URL, ChunkRange](FHttpRequestPtr Request, FHttpResponsePtr Response, bool bSuccess) mutable
+	const double RequestStartTime = FPlatformTime::Seconds();
+	TSharedRef<FRuntimeFilesDownloaderInFlightRequestStat> InFlightRequestStat = MakeShared<FRuntimeFilesDownloaderInFlightRequestStat>(ChunkRange.Y - ChunkRange.X + 1, !bBackground);
+	HttpRequestRef->OnProcessRequestComplete().BindLambda([WeakThisPtr, PromisePtr, URL, ContentSize, ChunkRange, bAcceptRestOfFile, RequestStartTime, InFlightRequestStat, RequestOnceResumed](FHttpRequestPtr Request, FHttpResponsePtr Response, bool bSuccess) mutable
 	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeChunkDownloader::OnChunkRequestComplete);
+		RUNTIMEFILESDOWNLOADER_GAME_THREAD_SCOPE;
+		RUNTIMEFILESDOWNLOADER_LLM_SCOPE;
+
 		TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
 		if (!SharedThis.IsValid())
 		{
@@ -417,124 +1239,168 @@ TFuture<FRuntimeChunkDownloaderResult> FRuntimeChunkDownloader::DownloadFileByCh
 			return;
 		}
 
+		const int64 ReceivedSize = Response.IsValid() ? static_cast<int64>(Response->GetContent().Num()) : 0;
+		auto RecordChunkStats = [&SharedThis, &ChunkRange, ReceivedSize, RequestStartTime](bool bSucceeded)
+		{
+			FRuntimeChunkDownloadStats ChunkStats;
+			ChunkStats.Offset = ChunkRange.X;
+			ChunkStats.Size = ReceivedSize;
+			ChunkStats.Duration = static_cast<float>(FPlatformTime::Seconds() - RequestStartTime);
+			ChunkStats.bSucceeded = bSucceeded;
+			SharedThis->AddChunkStats(ChunkStats);
+			SharedThis->RecordReceivedBytes(ReceivedSize);
+			if (!bSucceeded)
+			{
+				SharedThis->Stats.BytesWasted += ReceivedSize;
+			}
+		};
+
+		// The request was interrupted by pausing, so it will be made again once resumed
+		if (SharedThis->WasInterruptedByPause(Request))
+		{
+			RecordChunkStats(false);
+			++SharedThis->Stats.RetryCount;
+			RequestOnceResumed(*SharedThis);
+			return;
+		}
+
 		if (!bSuccess || !Response.IsValid())
 		{
+			RecordChunkStats(false);
 			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file chunk from %s: request failed"), *Request->GetURL());
 			PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, TArray64<uint8>()});
 			return;
 		}
 
-		if (Response->GetContentLength() <= 0)
+		// The server sends the whole file instead of the range if it no longer matches the If-Range validator
+		if (!SharedThis->IfRangeValidator.IsEmpty() && Response->GetResponseCode() == EHttpResponseCodes::Ok)
 		{
-			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file chunk from %s: content length is 0"), *Request->GetURL());
+			RecordChunkStats(false);
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file chunk from %s: the file has changed on the server since %s"), *Request->GetURL(), *SharedThis->IfRangeValidator);
 			PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, TArray64<uint8>()});
 			return;
 		}
 
-		const int64 ContentLength = FCString::Atoi64(*Response->GetHeader("Content-Length"));
-
-		if (ContentLength != ChunkRange.Y - ChunkRange.X + 1)
+		// The received size is checked rather than the Content-Length header, which is absent if the response is sent with chunked transfer encoding
+		if (ReceivedSize <= 0)
 		{
-			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file chunk from %s: content length (%lld) does not match the expected length (%lld)"), *Request->GetURL(), ContentLength, ChunkRange.Y - ChunkRange.X + 1);
+			RecordChunkStats(false);
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file chunk from %s: content length is 0"), *Request->GetURL());
 			PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, TArray64<uint8>()});
 			return;
 		}
 
-		UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Successfully downloaded file chunk from %s. Range: {%lld; %lld}, Overall: %lld"), *Request->GetURL(), ChunkRange.X, ChunkRange.Y, ContentLength);
-		PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::Success, TArray64<uint8>(Response->GetContent())});
-	});
-
-	if (!HttpRequestRef->ProcessRequest())
-	{
-		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file chunk from %s: request failed"), *URL);
-		return MakeFulfilledPromise<FRuntimeChunkDownloaderResult>(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, TArray64<uint8>()}).GetFuture();
-	}
-
-	HttpRequestPtr = HttpRequestRef;
-	return PromisePtr->GetFuture();
-}
-
-TFuture<FRuntimeChunkDownloaderResult> FRuntimeChunkDownloader::DownloadFileByPayload(const FString& URL, float Timeout, const FString& ContentType, const FOnProgress& OnProgress)
-{
-	if (bCanceled)
-	{
-		UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file download from %s"), *URL);
-		return MakeFulfilledPromise<FRuntimeChunkDownloaderResult>(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::Cancelled, TArray64<uint8>()}).GetFuture();
-	}
+		// The range of the file the result is taken from, and its offset in the response content
+		FInt64Vector2 ResultRange = ChunkRange;
+		int64 ResultOffset = 0;
 
-	TWeakPtr<FRuntimeChunkDownloader> WeakThisPtr = AsShared();
+		if (Response->GetResponseCode() == EHttpResponseCodes::Ok)
+		{
+			// The server ignored the range and sent the whole file, so it will not be asked for ranges of this file again
+			if (FRuntimeContentInfo* KnownContentInfo = SharedThis->KnownContentInfos.Find(URL))
+			{
+				KnownContentInfo->bAcceptsRanges = false;
+			}
 
-#if UE_VERSION_NEWER_THAN(4, 26, 0)
-	const TSharedRef<IHttpRequest, ESPMode::ThreadSafe> HttpRequestRef = FHttpModule::Get().CreateRequest();
-#else
-	const TSharedRef<IHttpRequest> HttpRequestRef = FHttpModule::Get().CreateRequest();
-#endif
+			const FString ResponseEncoding = Response->GetHeader(TEXT("Content-Encoding"));
+			if (ReceivedSize != ContentSize || !(ResponseEncoding.IsEmpty() || ResponseEncoding.Equals(TEXT("identity"), ESearchCase::IgnoreCase)))
+			{
+				RecordChunkStats(false);
+				UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file chunk from %s: the server ignored the range and sent %lld bytes, expected the whole file of %lld bytes"), *Request->GetURL(), ReceivedSize, ContentSize);
+				PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, TArray64<uint8>()});
+				return;
+			}
 
-	HttpRequestRef->SetVerb("GET");
-	HttpRequestRef->SetURL(URL);
+			// A caller that only takes the requested range fails rather than receiving more than it asked for, and the file is downloaded without ranges from now on
+			if (!bAcceptRestOfFile)
+			{
+				RecordChunkStats(false);
+				UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file chunk from %s: the server ignored the range {%lld; %lld} and sent the whole file"), *Request->GetURL(), ChunkRange.X, ChunkRange.Y);
+				PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, TArray64<uint8>()});
+				return;
+			}
 
-#if UE_VERSION_NEWER_THAN(4, 26, 0)
-	HttpRequestRef->SetTimeout(Timeout);
-#else
-	UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("The Timeout feature is only supported in engine version 4.26 or later. Please update your engine to use this feature"));
-#endif
+			// The rest of the file is taken from the whole file instead of downloading it again
+			ResultRange.Y = ContentSize - 1;
+			ResultOffset = ResultRange.X;
 
-	HttpRequestRef->
-#if UE_VERSION_OLDER_THAN(5, 4, 0)
-		OnRequestProgress().BindLambda([WeakThisPtr, OnProgress](FHttpRequestPtr Request, int32 BytesSent, int32 BytesReceived)
-#else
-		OnRequestProgress64().BindLambda([WeakThisPtr, OnProgress](FHttpRequestPtr Request, uint64 BytesSent, uint64 BytesReceived)
-#endif
-	{
-		TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
-		if (SharedThis.IsValid())
-		{
-			const int64 ContentLength = Request->GetContentLength();
-			const float Progress = ContentLength <= 0 ? 0.0f : static_cast<float>(BytesReceived) / ContentLength;
-			UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Downloaded %lld bytes of file chunk from %s by payload. Overall: %lld, Progress: %f"), static_cast<int64>(BytesReceived), *Request->GetURL(), static_cast<int64>(Request->GetContentLength()), Progress);
-			OnProgress(BytesReceived, ContentLength);
+			const int64 UnusedSize = ReceivedSize - (ResultRange.Y - ResultRange.X + 1);
+			if (UnusedSize > 0)
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("The server of %s ignored the range {%lld; %lld} and sent the whole file, %lld bytes of it are unused"), *Request->GetURL(), ChunkRange.X, ChunkRange.Y, UnusedSize);
+				SharedThis->Stats.BytesWasted += UnusedSize;
+			}
 		}
-	});
+		else if (Response->GetResponseCode() == EHttpResponseCodes::PartialContent)
+		{
+			FInt64Vector2 ContentRange;
+			int64 TotalSize;
+			if (!ParseContentRange(Response->GetHeader(TEXT("Content-Range")), ContentRange, TotalSize) || ContentRange != ChunkRange || (TotalSize > 0 && TotalSize != ContentSize))
+			{
+				RecordChunkStats(false);
+				UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file chunk from %s: the content range '%s' does not match the requested range {%lld; %lld} of %lld bytes"), *Request->GetURL(), *Response->GetHeader(TEXT("Content-Range")), ChunkRange.X, ChunkRange.Y, ContentSize);
+				PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, TArray64<uint8>()});
+				return;
+			}
 
-	TSharedPtr<TPromise<FRuntimeChunkDownloaderResult>> PromisePtr = MakeShared<TPromise<FRuntimeChunkDownloaderResult>>();
-	HttpRequestRef->OnProcessRequestComplete().BindLambda([WeakThisPtr, PromisePtr, URL](FHttpRequestPtr Request, FHttpResponsePtr Response, bool bSuccess) mutable
-	{
-		TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
-		if (!SharedThis.IsValid())
+			if (ReceivedSize != ChunkRange.Y - ChunkRange.X + 1)
+			{
+				RecordChunkStats(false);
+				UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file chunk from %s: content length (%lld) does not match the expected length (%lld)"), *Request->GetURL(), ReceivedSize, ChunkRange.Y - ChunkRange.X + 1);
+				PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, TArray64<uint8>()});
+				return;
+			}
+		}
+		else
 		{
-			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to download file from %s by payload: downloader has been destroyed"), *URL);
+			RecordChunkStats(false);
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file chunk from %s: unexpected response code %d"), *Request->GetURL(), Response->GetResponseCode());
 			PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, TArray64<uint8>()});
 			return;
 		}
 
-		if (SharedThis->bCanceled)
-		{
-			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file download from %s by payload"), *URL);
-			PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::Cancelled, TArray64<uint8>()});
-			return;
-		}
+		RecordChunkStats(true);
+		SharedThis->RecordBufferMemory(ReceivedSize * 2);
 
-		if (!bSuccess || !Response.IsValid())
+		UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Successfully downloaded file chunk from %s. Range: {%lld; %lld}, Overall: %lld"), *Request->GetURL(), ResultRange.X, ResultRange.Y, ReceivedSize);
+		// The response content is copied into a pooled buffer, so that no new allocation is made per chunk, unless it is copied straight into the destination of the download
+		auto CopyResponseContent = [ResultOffset, ResultStart = ResultRange.X, ResultSize = ResultRange.Y - ResultRange.X + 1, ChunkSink = SharedThis->ChunkSink](const FHttpResponsePtr& ChunkResponse)
 		{
-			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file from %s by payload: request failed"), *Request->GetURL());
-			PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, TArray64<uint8>()});
-			return;
-		}
+			TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeChunkDownloader::CopyResponseContent);
+			const TArray<uint8>& Content = ChunkResponse->GetContent();
+			if (ChunkSink && ChunkSink(ResultStart, Content.GetData() + ResultOffset, ResultSize))
+			{
+				return TArray64<uint8>();
+			}
+
+			TArray64<uint8> ChunkData = FRuntimeChunkBufferPool::Get().Acquire(ResultSize);
+			ChunkData.Append(Content.GetData() + ResultOffset, ResultSize);
+			return ChunkData;
+		};
 
-		if (Response->GetContentLength() <= 0)
+#if UE_VERSION_NEWER_THAN(4, 26, 0)
+		// The response is only thread-safe to share since UE 4.26, so older versions copy it on the game thread
+		if (SharedThis->ExecutionPolicy.bProcessOnWorkerThreads)
 		{
-			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file from %s by payload: content length is 0"), *Request->GetURL());
-			PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, TArray64<uint8>()});
+			Async(EAsyncExecution::ThreadPool, [PromisePtr, Response, CopyResponseContent]()
+			{
+				FRuntimeChunkDownloaderResult Result{EDownloadToMemoryResult::Success, CopyResponseContent(Response)};
+				AsyncTask(ENamedThreads::GameThread, [PromisePtr, Result = MoveTemp(Result)]() mutable
+				{
+					RUNTIMEFILESDOWNLOADER_GAME_THREAD_SCOPE;
+					PromisePtr->SetValue(MoveTemp(Result));
+				});
+			});
 			return;
 		}
+#endif
 
-		UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Successfully downloaded file from %s by payload. Overall: %lld"), *Request->GetURL(), static_cast<int64>(Response->GetContentLength()));
-		return PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::SucceededByPayload, TArray64<uint8>(Response->GetContent())});
+		PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::Success, CopyResponseContent(Response)});
 	});
 
 	if (!HttpRequestRef->ProcessRequest())
 	{
-		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file from %s by payload: request failed"), *URL);
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file chunk from %s: request failed"), *URL);
 		return MakeFulfilledPromise<FRuntimeChunkDownloaderResult>(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, TArray64<uint8>()}).GetFuture();
 	}
 
@@ -542,17 +1408,1068 @@ TFuture<FRuntimeChunkDownloaderResult> FRuntimeChunkDownloader::DownloadFileByPa
 	return PromisePtr->GetFuture();
 }
 
-TFuture<int64> FRuntimeChunkDownloader::GetContentSize(const FString& URL, float Timeout)
+TFuture<EDownloadToMemoryResult> FRuntimeChunkDownloader::DownloadFileByRanges(const FString& URL, float Timeout, const FString& ContentType, const TArray<FInt64Vector2>& Ranges, int64 MergeGapThreshold, const FOnProgress& OnProgress, const FOnRangeDownloaded& OnRangeDownloaded)
 {
-	TSharedPtr<TPromise<int64>> PromisePtr = MakeShared<TPromise<int64>>();
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeChunkDownloader::DownloadFileByRanges);
 
-#if UE_VERSION_NEWER_THAN(4, 26, 0)
-	const TSharedRef<IHttpRequest, ESPMode::ThreadSafe> HttpRequestRef = FHttpModule::Get().CreateRequest();
-#else
+	if (bCanceled)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file download from %s"), *URL);
+		return MakeFulfilledPromise<EDownloadToMemoryResult>(EDownloadToMemoryResult::Cancelled).GetFuture();
+	}
+
+	TArray<FInt64Vector2> SortedRanges = Ranges;
+	SortedRanges.Sort([](const FInt64Vector2& A, const FInt64Vector2& B)
+	{
+		return A.X < B.X;
+	});
+
+	for (const FInt64Vector2& Range : SortedRanges)
+	{
+		if (Range.X < 0 || Range.X > Range.Y || Range.Y - Range.X + 1 > MaxRangeRequestSize)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file ranges from %s: range (%lld; %lld) is invalid or too large for a single request"), *URL, Range.X, Range.Y);
+			return MakeFulfilledPromise<EDownloadToMemoryResult>(EDownloadToMemoryResult::DownloadFailed).GetFuture();
+		}
+	}
+
+	// Merge the ranges that overlap or are close to each other, and split the merged ranges into requests
+	TSharedPtr<TArray<FRangeRequest>> Requests = MakeShared<TArray<FRangeRequest>>();
+	int64 TotalBytes = 0, RequestBytes = 0;
+	for (const FInt64Vector2& Range : SortedRanges)
+	{
+		if (Requests->Num() > 0)
+		{
+			FRangeRequest& LastRequest = Requests->Last();
+			FInt64Vector2& LastMergedRange = LastRequest.MergedRanges.Last();
+			const int64 MergedRangeEnd = FMath::Max(LastMergedRange.Y, Range.Y);
+			const int64 AddedBytes = MergedRangeEnd - LastMergedRange.Y;
+			if (Range.X <= LastMergedRange.Y + 1 + FMath::Max<int64>(MergeGapThreshold, 0) && RequestBytes + AddedBytes <= MaxRangeRequestSize)
+			{
+				LastMergedRange.Y = MergedRangeEnd;
+				LastRequest.Ranges.Add(Range);
+				RequestBytes += AddedBytes;
+				TotalBytes += AddedBytes;
+				continue;
+			}
+
+			const int64 RangeSize = Range.Y - Range.X + 1;
+			if (LastRequest.MergedRanges.Num() < MaxRangesPerRequest && RequestBytes + RangeSize <= MaxRangeRequestSize)
+			{
+				LastRequest.MergedRanges.Add(Range);
+				LastRequest.Ranges.Add(Range);
+				RequestBytes += RangeSize;
+				TotalBytes += RangeSize;
+				continue;
+			}
+		}
+
+		FRangeRequest& Request = Requests->AddDefaulted_GetRef();
+		Request.MergedRanges.Add(Range);
+		Request.Ranges.Add(Range);
+		RequestBytes = Range.Y - Range.X + 1;
+		TotalBytes += RequestBytes;
+	}
+
+	if (Requests->Num() == 0)
+	{
+		return MakeFulfilledPromise<EDownloadToMemoryResult>(EDownloadToMemoryResult::Success).GetFuture();
+	}
+
+	UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Downloading %d ranges (%lld bytes) from %s using %d requests"), Ranges.Num(), TotalBytes, *URL, Requests->Num());
+
+	MarkDownloadStarted();
+	return DownloadRangeRequests(URL, Timeout, ContentType, Requests, 0, 0, TotalBytes, OnProgress, OnRangeDownloaded);
+}
+
+TFuture<EDownloadToMemoryResult> FRuntimeChunkDownloader::DownloadRangeRequests(const FString& URL, float Timeout, const FString& ContentType, const TSharedPtr<TArray<FRangeRequest>>& Requests, int32 RequestIndex, int64 CompletedBytes, int64 TotalBytes, const FOnProgress& OnProgress, const FOnRangeDownloaded& OnRangeDownloaded)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeChunkDownloader::DownloadRangeRequests);
+
+	if (bCanceled)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file download from %s"), *URL);
+		return MakeFulfilledPromise<EDownloadToMemoryResult>(EDownloadToMemoryResult::Cancelled).GetFuture();
+	}
+
+	if (!Requests->IsValidIndex(RequestIndex))
+	{
+		OnProgress(TotalBytes, TotalBytes);
+		return MakeFulfilledPromise<EDownloadToMemoryResult>(EDownloadToMemoryResult::Success).GetFuture();
+	}
+
+	TSharedPtr<TPromise<EDownloadToMemoryResult>> PromisePtr = MakeShared<TPromise<EDownloadToMemoryResult>>();
+	TWeakPtr<FRuntimeChunkDownloader> WeakThisPtr = AsShared();
+
+	auto DeferUntilResumed = [WeakThisPtr, PromisePtr, URL, Timeout, ContentType, Requests, RequestIndex, CompletedBytes, TotalBytes, OnProgress, OnRangeDownloaded](FRuntimeChunkDownloader& Downloader)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Download from %s is paused. The outstanding ranges will be requested once resumed"), *URL);
+
+		Downloader.RunWhenResumed([WeakThisPtr, PromisePtr, URL, Timeout, ContentType, Requests, RequestIndex, CompletedBytes, TotalBytes, OnProgress, OnRangeDownloaded]()
+		{
+			TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
+			if (!SharedThis.IsValid())
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to resume file ranges download from %s: downloader has been destroyed"), *URL);
+				PromisePtr->SetValue(EDownloadToMemoryResult::DownloadFailed);
+				return;
+			}
+
+			SharedThis->DownloadRangeRequests(URL, Timeout, ContentType, Requests, RequestIndex, CompletedBytes, TotalBytes, OnProgress, OnRangeDownloaded).Next([PromisePtr](EDownloadToMemoryResult Result)
+			{
+				PromisePtr->SetValue(Result);
+			});
+		});
+	};
+
+	if (IsPaused())
+	{
+		DeferUntilResumed(*this);
+		return PromisePtr->GetFuture();
+	}
+
+	const FRangeRequest& RangeRequest = (*Requests)[RequestIndex];
+	int64 RequestBytes = 0;
+	TArray<FString> RangeStrings;
+	for (const FInt64Vector2& MergedRange : RangeRequest.MergedRanges)
+	{
+		RangeStrings.Add(FString::Printf(TEXT("%lld-%lld"), MergedRange.X, MergedRange.Y));
+		RequestBytes += MergedRange.Y - MergedRange.X + 1;
+	}
+
+#if UE_VERSION_NEWER_THAN(4, 26, 0)
+	const TSharedRef<IHttpRequest, ESPMode::ThreadSafe> HttpRequestRef = FHttpModule::Get().CreateRequest();
+#else
+	const TSharedRef<IHttpRequest> HttpRequestRef = FHttpModule::Get().CreateRequest();
+#endif
+
+	HttpRequestRef->SetVerb("GET");
+	HttpRequestRef->SetURL(URL);
+
+#if UE_VERSION_NEWER_THAN(4, 26, 0)
+	HttpRequestRef->SetTimeout(Timeout);
+#else
+	UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("The Timeout feature is only supported in engine version 4.26 or later. Please update your engine to use this feature"));
+#endif
+
+	if (!ContentType.IsEmpty())
+	{
+		HttpRequestRef->SetHeader(TEXT("Content-Type"), ContentType);
+	}
+
+	// Compressed transfer is not requested, since the byte ranges would then refer to the compressed representation
+	HttpRequestRef->SetHeader(TEXT("Range"), TEXT("bytes=") + FString::Join(RangeStrings, TEXT(",")));
+
+	HttpRequestRef->
+#if UE_VERSION_OLDER_THAN(5, 4, 0)
+		OnRequestProgress().BindLambda([WeakThisPtr, CompletedBytes, TotalBytes, RequestBytes, OnProgress](FHttpRequestPtr Request, int32 BytesSent, int32 BytesReceived)
+#else
+		OnRequestProgress64().BindLambda([WeakThisPtr, CompletedBytes, TotalBytes, RequestBytes, OnProgress](FHttpRequestPtr Request, uint64 BytesSent, uint64 BytesReceived)
+#endif
+	{
+		RUNTIMEFILESDOWNLOADER_GAME_THREAD_SCOPE;
+
+		TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
+		if (SharedThis.IsValid())
+		{
+			if (BytesReceived > 0 && SharedThis->Stats.TimeToFirstByte < 0)
+			{
+				SharedThis->Stats.TimeToFirstByte = static_cast<float>(FPlatformTime::Seconds() - SharedThis->DownloadStartTime);
+			}
+
+			// The multipart body also contains the part headers, so the progress is clamped to the requested bytes
+			OnProgress(CompletedBytes + FMath::Min<int64>(BytesReceived, RequestBytes), TotalBytes);
+		}
+	});
+
+	const double RequestStartTime = FPlatformTime::Seconds();
+	TSharedRef<FRuntimeFilesDownloaderInFlightRequestStat> InFlightRequestStat = MakeShared<FRuntimeFilesDownloaderInFlightRequestStat>(RequestBytes, !bBackground);
+	HttpRequestRef->OnProcessRequestComplete().BindLambda([WeakThisPtr, PromisePtr, URL, Timeout, ContentType, Requests, RequestIndex, CompletedBytes, TotalBytes, RequestBytes, OnProgress, OnRangeDownloaded, DeferUntilResumed, RequestStartTime, InFlightRequestStat](FHttpRequestPtr Request, FHttpResponsePtr Response, bool bSuccess) mutable
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeChunkDownloader::OnRangeRequestComplete);
+		RUNTIMEFILESDOWNLOADER_GAME_THREAD_SCOPE;
+		RUNTIMEFILESDOWNLOADER_LLM_SCOPE;
+
+		TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
+		if (!SharedThis.IsValid())
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to download file ranges from %s: downloader has been destroyed"), *URL);
+			PromisePtr->SetValue(EDownloadToMemoryResult::DownloadFailed);
+			return;
+		}
+
+		if (SharedThis->bCanceled)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file ranges download from %s"), *URL);
+			PromisePtr->SetValue(EDownloadToMemoryResult::Cancelled);
+			return;
+		}
+
+		const FRangeRequest& RangeRequest = (*Requests)[RequestIndex];
+		const int64 ReceivedSize = Response.IsValid() ? static_cast<int64>(Response->GetContent().Num()) : 0;
+		auto RecordRequestStats = [&SharedThis, &RangeRequest, ReceivedSize, RequestStartTime](bool bSucceeded)
+		{
+			FRuntimeChunkDownloadStats ChunkStats;
+			ChunkStats.Offset = RangeRequest.MergedRanges[0].X;
+			ChunkStats.Size = ReceivedSize;
+			ChunkStats.Duration = static_cast<float>(FPlatformTime::Seconds() - RequestStartTime);
+			ChunkStats.bSucceeded = bSucceeded;
+			SharedThis->AddChunkStats(ChunkStats);
+			SharedThis->RecordReceivedBytes(ReceivedSize);
+			if (!bSucceeded)
+			{
+				SharedThis->Stats.BytesWasted += ReceivedSize;
+			}
+		};
+
+		// The request was interrupted by pausing, so it will be made again once resumed
+		if (SharedThis->WasInterruptedByPause(Request))
+		{
+			RecordRequestStats(false);
+			++SharedThis->Stats.RetryCount;
+			DeferUntilResumed(*SharedThis);
+			return;
+		}
+
+		if (!bSuccess || !Response.IsValid())
+		{
+			RecordRequestStats(false);
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file ranges from %s: request failed"), *Request->GetURL());
+			PromisePtr->SetValue(EDownloadToMemoryResult::DownloadFailed);
+			return;
+		}
+
+		// Find out which parts of the file the response contains
+		const TArray<uint8>& Content = Response->GetContent();
+		TArray<TPair<FInt64Vector2, int64>> Parts;
+		const int32 ResponseCode = Response->GetResponseCode();
+		if (ResponseCode == EHttpResponseCodes::PartialContent)
+		{
+			const FString ResponseContentType = Response->GetHeader(TEXT("Content-Type"));
+			if (ResponseContentType.StartsWith(TEXT("multipart/byteranges")))
+			{
+				if (!ParseMultipartByteRanges(Content, ResponseContentType, Parts))
+				{
+					Parts.Reset();
+				}
+			}
+			else
+			{
+				FInt64Vector2 PartRange;
+				int64 TotalSize;
+				if (ParseContentRange(Response->GetHeader(TEXT("Content-Range")), PartRange, TotalSize) && PartRange.Y - PartRange.X + 1 == Content.Num())
+				{
+					Parts.Add(TPair<FInt64Vector2, int64>(PartRange, 0));
+				}
+			}
+		}
+		else if (ResponseCode == EHttpResponseCodes::Ok && Content.Num() > 0)
+		{
+			// The server ignored the Range header and sent the whole file
+			Parts.Add(TPair<FInt64Vector2, int64>(FInt64Vector2(0, Content.Num() - 1), 0));
+		}
+
+		if (Parts.Num() == 0)
+		{
+			RecordRequestStats(false);
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file ranges from %s: unexpected response (code %d, Content-Type '%s')"), *Request->GetURL(), ResponseCode, *Response->GetHeader(TEXT("Content-Type")));
+			PromisePtr->SetValue(EDownloadToMemoryResult::DownloadFailed);
+			return;
+		}
+
+		// Make sure every requested range is present before delivering any of them
+		TArray<int32> RangePartIndices;
+		RangePartIndices.Reserve(RangeRequest.Ranges.Num());
+		for (const FInt64Vector2& Range : RangeRequest.Ranges)
+		{
+			const int32 PartIndex = Parts.IndexOfByPredicate([&Range](const TPair<FInt64Vector2, int64>& Part)
+			{
+				return Part.Key.X <= Range.X && Range.Y <= Part.Key.Y;
+			});
+
+			if (PartIndex == INDEX_NONE)
+			{
+				RecordRequestStats(false);
+				UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file ranges from %s: the response does not contain the range {%lld; %lld}"), *Request->GetURL(), Range.X, Range.Y);
+				PromisePtr->SetValue(EDownloadToMemoryResult::DownloadFailed);
+				return;
+			}
+			RangePartIndices.Add(PartIndex);
+		}
+
+		RecordRequestStats(true);
+		SharedThis->RecordBufferMemory(ReceivedSize * 2);
+		if (ReceivedSize > RequestBytes)
+		{
+			SharedThis->Stats.BytesWasted += ReceivedSize - RequestBytes;
+		}
+
+		UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Successfully downloaded %d file ranges from %s. Received: %lld, Requested: %lld"), RangeRequest.Ranges.Num(), *Request->GetURL(), ReceivedSize, RequestBytes);
+
+		{
+			TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeChunkDownloader::BroadcastRangesDownloaded);
+			for (int32 RangeIndex = 0; RangeIndex < RangeRequest.Ranges.Num(); ++RangeIndex)
+			{
+				const FInt64Vector2& Range = RangeRequest.Ranges[RangeIndex];
+				const TPair<FInt64Vector2, int64>& Part = Parts[RangePartIndices[RangeIndex]];
+				OnRangeDownloaded(Range, TArray64<uint8>(Content.GetData() + Part.Value + (Range.X - Part.Key.X), Range.Y - Range.X + 1));
+			}
+		}
+
+		SharedThis->DownloadRangeRequests(URL, Timeout, ContentType, Requests, RequestIndex + 1, CompletedBytes + RequestBytes, TotalBytes, OnProgress, OnRangeDownloaded).Next([PromisePtr](EDownloadToMemoryResult Result)
+		{
+			PromisePtr->SetValue(Result);
+		});
+	});
+
+	if (!HttpRequestRef->ProcessRequest())
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file ranges from %s: request failed"), *URL);
+		return MakeFulfilledPromise<EDownloadToMemoryResult>(EDownloadToMemoryResult::DownloadFailed).GetFuture();
+	}
+
+	HttpRequestPtr = HttpRequestRef;
+	return PromisePtr->GetFuture();
+}
+
+TFuture<FRuntimeChunkDownloaderResult> FRuntimeChunkDownloader::DownloadFileByPayload(const FString& URL, float Timeout, const FString& ContentType, const FOnProgress& OnProgress)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeChunkDownloader::DownloadFileByPayload);
+
+	if (bCanceled)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file download from %s"), *URL);
+		return MakeFulfilledPromise<FRuntimeChunkDownloaderResult>(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::Cancelled, TArray64<uint8>()}).GetFuture();
+	}
+
+	if (IsPaused())
+	{
+		TSharedPtr<TPromise<FRuntimeChunkDownloaderResult>> PromisePtr = MakeShared<TPromise<FRuntimeChunkDownloaderResult>>();
+		DeferPayloadDownloadUntilResumed(PromisePtr, URL, Timeout, ContentType, OnProgress);
+		return PromisePtr->GetFuture();
+	}
+
+#if !UE_VERSION_OLDER_THAN(5, 4, 0)
+	// The body is received in segments that are copied into the result as they are delivered, so that it is neither limited to 2 GB nor kept in memory twice
+	// The result is allocated at once as soon as the size of the response is known, and only grows with the segments if the size is not sent or the data is decompressed
+	// A compressed file is decompressed segment by segment while it is received
+	TSharedPtr<TPromise<FRuntimeChunkDownloaderResult>> PromisePtr = MakeShared<TPromise<FRuntimeChunkDownloaderResult>>();
+	TWeakPtr<FRuntimeChunkDownloader> WeakThisPtr = AsShared();
+	TSharedRef<TArray64<uint8>> DataRef = MakeShared<TArray64<uint8>>();
+	const FOnProgress OnPayloadProgress = [DataRef, OnProgress](int64 BytesReceived, int64 ContentSize)
+	{
+		if (ContentSize > DataRef->Max())
+		{
+			DataRef->Reserve(ContentSize);
+		}
+		OnProgress(BytesReceived, ContentSize);
+	};
+
+	DownloadPayloadSegments(URL, Timeout, ContentType, OnPayloadProgress, [DataRef](TArray64<uint8>&& Segment)
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeChunkDownloader::CopyPayloadSegment);
+		DataRef->Append(Segment);
+		FRuntimeChunkBufferPool::Get().Release(MoveTemp(Segment));
+	}, bDecompressCompressedFiles && IsCompressedFileURL(URL)).Next([WeakThisPtr, PromisePtr, URL, DataRef](EDownloadToMemoryResult Result)
+	{
+		if (Result != EDownloadToMemoryResult::SucceededByPayload)
+		{
+			PromisePtr->SetValue(FRuntimeChunkDownloaderResult{Result, TArray64<uint8>()});
+			return;
+		}
+
+		TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
+		if (!SharedThis.IsValid())
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to download file from %s by payload: downloader has been destroyed"), *URL);
+			PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, TArray64<uint8>()});
+			return;
+		}
+
+		SharedThis->RecordBufferMemory(DataRef->Max());
+		PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::SucceededByPayload, MoveTemp(*DataRef)});
+	});
+	return PromisePtr->GetFuture();
+#else
+	MarkDownloadStarted();
+
+	TWeakPtr<FRuntimeChunkDownloader> WeakThisPtr = AsShared();
+
+#if UE_VERSION_NEWER_THAN(4, 26, 0)
+	const TSharedRef<IHttpRequest, ESPMode::ThreadSafe> HttpRequestRef = FHttpModule::Get().CreateRequest();
+#else
+	const TSharedRef<IHttpRequest> HttpRequestRef = FHttpModule::Get().CreateRequest();
+#endif
+
+	HttpRequestRef->SetVerb("GET");
+	HttpRequestRef->SetURL(URL);
+
+#if UE_VERSION_NEWER_THAN(4, 26, 0)
+	HttpRequestRef->SetTimeout(Timeout);
+#else
+	UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("The Timeout feature is only supported in engine version 4.26 or later. Please update your engine to use this feature"));
+#endif
+
+	SetCommonHeaders(HttpRequestRef, true);
+
+	HttpRequestRef->
+#if UE_VERSION_OLDER_THAN(5, 4, 0)
+		OnRequestProgress().BindLambda([WeakThisPtr, OnProgress](FHttpRequestPtr Request, int32 BytesSent, int32 BytesReceived)
+#else
+		OnRequestProgress64().BindLambda([WeakThisPtr, OnProgress](FHttpRequestPtr Request, uint64 BytesSent, uint64 BytesReceived)
+#endif
+	{
+		RUNTIMEFILESDOWNLOADER_GAME_THREAD_SCOPE;
+
+		TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
+		if (SharedThis.IsValid())
+		{
+			if (BytesReceived > 0 && SharedThis->Stats.TimeToFirstByte < 0)
+			{
+				SharedThis->Stats.TimeToFirstByte = static_cast<float>(FPlatformTime::Seconds() - SharedThis->DownloadStartTime);
+			}
+
+			const int64 ContentLength = Request->GetContentLength();
+			const float Progress = ContentLength <= 0 ? 0.0f : static_cast<float>(BytesReceived) / ContentLength;
+			UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Downloaded %lld bytes of file chunk from %s by payload. Overall: %lld, Progress: %f"), static_cast<int64>(BytesReceived), *Request->GetURL(), static_cast<int64>(Request->GetContentLength()), Progress);
+			OnProgress(BytesReceived, ContentLength);
+		}
+	});
+
+	TSharedRef<FRuntimeFilesDownloaderInFlightRequestStat> InFlightRequestStat = MakeShared<FRuntimeFilesDownloaderInFlightRequestStat>(0, !bBackground);
+	TSharedPtr<TPromise<FRuntimeChunkDownloaderResult>> PromisePtr = MakeShared<TPromise<FRuntimeChunkDownloaderResult>>();
+	HttpRequestRef->OnProcessRequestComplete().BindLambda([WeakThisPtr, PromisePtr, URL, Timeout, ContentType, OnProgress, InFlightRequestStat](FHttpRequestPtr Request, FHttpResponsePtr Response, bool bSuccess) mutable
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeChunkDownloader::OnPayloadRequestComplete);
+		RUNTIMEFILESDOWNLOADER_GAME_THREAD_SCOPE;
+		RUNTIMEFILESDOWNLOADER_LLM_SCOPE;
+
+		TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
+		if (!SharedThis.IsValid())
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to download file from %s by payload: downloader has been destroyed"), *URL);
+			PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, TArray64<uint8>()});
+			return;
+		}
+
+		if (SharedThis->bCanceled)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file download from %s by payload"), *URL);
+			PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::Cancelled, TArray64<uint8>()});
+			return;
+		}
+
+		// The payload cannot be partially kept, so the request interrupted by pausing will be made again once resumed
+		if (SharedThis->WasInterruptedByPause(Request))
+		{
+			++SharedThis->Stats.RetryCount;
+			SharedThis->DeferPayloadDownloadUntilResumed(PromisePtr, URL, Timeout, ContentType, OnProgress);
+			return;
+		}
+
+		if (!bSuccess || !Response.IsValid())
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file from %s by payload: request failed"), *Request->GetURL());
+			PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, TArray64<uint8>()});
+			return;
+		}
+
+		if (Response->GetContent().Num() <= 0)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file from %s by payload: content length is 0"), *Request->GetURL());
+			PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, TArray64<uint8>()});
+			return;
+		}
+
+		SharedThis->RecordReceivedBytes(Response->GetContent().Num());
+		SharedThis->RecordBufferMemory(static_cast<int64>(Response->GetContent().Num()) * 2);
+
+		UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Successfully downloaded file from %s by payload. Overall: %lld"), *Request->GetURL(), static_cast<int64>(Response->GetContent().Num()));
+		SharedThis->DecompressIfNeeded(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::SucceededByPayload, TArray64<uint8>(Response->GetContent())}, Request->GetURL(), Response->GetHeader(TEXT("Content-Encoding"))).Next([PromisePtr](FRuntimeChunkDownloaderResult&& DecompressedResult)
+		{
+			PromisePtr->SetValue(MoveTemp(DecompressedResult));
+		});
+	});
+
+	if (!HttpRequestRef->ProcessRequest())
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file from %s by payload: request failed"), *URL);
+		return MakeFulfilledPromise<FRuntimeChunkDownloaderResult>(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, TArray64<uint8>()}).GetFuture();
+	}
+
+	HttpRequestPtr = HttpRequestRef;
+	return PromisePtr->GetFuture();
+#endif
+}
+
+TFuture<EDownloadToMemoryResult> FRuntimeChunkDownloader::DownloadFileByPayloadPerSegment(const FString& URL, float Timeout, const FString& ContentType, const FOnProgress& OnProgress, const FOnChunkDownloaded& OnSegmentDownloaded)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeChunkDownloader::DownloadFileByPayloadPerSegment);
+
+	if (bCanceled)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file download from %s"), *URL);
+		return MakeFulfilledPromise<EDownloadToMemoryResult>(EDownloadToMemoryResult::Cancelled).GetFuture();
+	}
+
+#if UE_VERSION_OLDER_THAN(5, 4, 0)
+	// The response body cannot be streamed before UE 5.4, so the whole payload is delivered as a single segment
+	TSharedPtr<TPromise<EDownloadToMemoryResult>> PromisePtr = MakeShared<TPromise<EDownloadToMemoryResult>>();
+	DownloadFileByPayload(URL, Timeout, ContentType, OnProgress).Next([PromisePtr, OnSegmentDownloaded](FRuntimeChunkDownloaderResult&& Result)
+	{
+		if (Result.Result == EDownloadToMemoryResult::SucceededByPayload)
+		{
+			OnSegmentDownloaded(MoveTemp(Result.Data));
+		}
+		PromisePtr->SetValue(Result.Result);
+	});
+	return PromisePtr->GetFuture();
+#else
+	// The segments are delivered as stored on the server, the same way as the chunks of a file downloaded by chunks
+	return DownloadPayloadSegments(URL, Timeout, ContentType, OnProgress, OnSegmentDownloaded, false);
+#endif
+}
+
+#if !UE_VERSION_OLDER_THAN(5, 4, 0)
+TFuture<EDownloadToMemoryResult> FRuntimeChunkDownloader::DownloadPayloadSegments(const FString& URL, float Timeout, const FString& ContentType, const FOnProgress& OnProgress, const FOnChunkDownloaded& OnSegmentDownloaded, bool bDecompressFile)
+{
+	TSharedRef<FRuntimePayloadSegmentDecoder, ESPMode::ThreadSafe> DecoderRef = MakeShared<FRuntimePayloadSegmentDecoder, ESPMode::ThreadSafe>(OnSegmentDownloaded, bDecompressFile);
+	TSharedPtr<TPromise<EDownloadToMemoryResult>> RequestPromisePtr = MakeShared<TPromise<EDownloadToMemoryResult>>();
+	TSharedPtr<TPromise<EDownloadToMemoryResult>> PromisePtr = MakeShared<TPromise<EDownloadToMemoryResult>>();
+	RequestPromisePtr->GetFuture().Next([PromisePtr, DecoderRef, URL](EDownloadToMemoryResult Result)
+	{
+		// The result is only reported once the segments still being decoded have been delivered, so that none is delivered after it
+		DecoderRef->Flush(Result == EDownloadToMemoryResult::SucceededByPayload).Next([PromisePtr, URL, Result](bool bDecoded)
+		{
+			if (!bDecoded && Result == EDownloadToMemoryResult::SucceededByPayload)
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file from %s by payload: unable to decode the downloaded data"), *URL);
+				PromisePtr->SetValue(EDownloadToMemoryResult::DownloadFailed);
+				return;
+			}
+			PromisePtr->SetValue(Result);
+		});
+	});
+
+	RequestPayloadSegments(RequestPromisePtr, URL, Timeout, ContentType, OnProgress, DecoderRef, 0, FString());
+	return PromisePtr->GetFuture();
+}
+
+void FRuntimeChunkDownloader::RequestPayloadSegments(const TSharedPtr<TPromise<EDownloadToMemoryResult>>& PromisePtr, const FString& URL, float Timeout, const FString& ContentType, const FOnProgress& OnProgress, const TSharedRef<FRuntimePayloadSegmentDecoder, ESPMode::ThreadSafe>& DecoderRef, int64 ResumeOffset, const FString& ResumeValidator)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeChunkDownloader::RequestPayloadSegments);
+
+	TWeakPtr<FRuntimeChunkDownloader> WeakThisPtr = AsShared();
+	if (bCanceled)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file download from %s by payload"), *URL);
+		PromisePtr->SetValue(EDownloadToMemoryResult::Cancelled);
+		return;
+	}
+
+	if (IsPaused())
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Download from %s by payload is paused. It will continue from %lld bytes once resumed"), *URL, ResumeOffset);
+
+		RunWhenResumed([WeakThisPtr, PromisePtr, URL, Timeout, ContentType, OnProgress, DecoderRef, ResumeOffset, ResumeValidator]()
+		{
+			TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
+			if (!SharedThis.IsValid())
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to resume file download from %s by payload: downloader has been destroyed"), *URL);
+				PromisePtr->SetValue(EDownloadToMemoryResult::DownloadFailed);
+				return;
+			}
+
+			SharedThis->RequestPayloadSegments(PromisePtr, URL, Timeout, ContentType, OnProgress, DecoderRef, ResumeOffset, ResumeValidator);
+		});
+		return;
+	}
+
+	MarkDownloadStarted();
+
+	const TSharedRef<IHttpRequest, ESPMode::ThreadSafe> HttpRequestRef = FHttpModule::Get().CreateRequest();
+	HttpRequestRef->SetVerb("GET");
+	HttpRequestRef->SetURL(URL);
+	HttpRequestRef->SetTimeout(Timeout);
+
+	// Only the whole file may be encoded for the transfer, since it is decoded as it arrives from its start, and only once, since the decoding cannot start over
+	SetCommonHeaders(HttpRequestRef, ResumeOffset == 0 && !DecoderRef->WasContentEncoded());
+
+	if (ResumeOffset > 0)
+	{
+		HttpRequestRef->SetHeader(TEXT("Range"), FString::Format(TEXT("bytes={0}-"), {ResumeOffset}));
+		if (!ResumeValidator.IsEmpty())
+		{
+			HttpRequestRef->SetHeader(TEXT("If-Range"), ResumeValidator);
+		}
+	}
+
+	TSharedRef<FPayloadSegmentStream, ESPMode::ThreadSafe> StreamRef = MakeShared<FPayloadSegmentStream, ESPMode::ThreadSafe>(ResumeOffset, !ResumeValidator.IsEmpty());
+	if (!HttpRequestRef->SetResponseBodyReceiveStream(StreamRef))
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file from %s by payload: unable to stream the response body"), *URL);
+		PromisePtr->SetValue(EDownloadToMemoryResult::DownloadFailed);
+		return;
+	}
+
+	const FOnChunkDownloaded OnSegmentDownloaded = [DecoderRef, StreamRef](TArray64<uint8>&& Segment)
+	{
+		DecoderRef->Decode(MoveTemp(Segment), StreamRef->bContentEncoded);
+	};
+
+	auto CheckResponse = [StreamRef](const FHttpResponsePtr& Response)
+	{
+		FInt64Vector2 ContentRange;
+		int64 TotalSize;
+		const bool bHasContentRange = Response.IsValid() && ParseContentRange(Response->GetHeader(TEXT("Content-Range")), ContentRange, TotalSize);
+		return StreamRef->CheckResponse(Response, bHasContentRange ? ContentRange.X : -1);
+	};
+
+	HttpRequestRef->OnRequestProgress64().BindLambda([WeakThisPtr, OnProgress, OnSegmentDownloaded, StreamRef, CheckResponse, ResumeOffset](FHttpRequestPtr Request, uint64 BytesSent, uint64 BytesReceived)
+	{
+		RUNTIMEFILESDOWNLOADER_GAME_THREAD_SCOPE;
+
+		TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
+		if (!SharedThis.IsValid())
+		{
+			return;
+		}
+
+		if (BytesReceived > 0 && SharedThis->Stats.TimeToFirstByte < 0)
+		{
+			SharedThis->Stats.TimeToFirstByte = static_cast<float>(FPlatformTime::Seconds() - SharedThis->DownloadStartTime);
+		}
+
+		// The segments are delivered while the body is still being received, so that they do not pile up in memory
+		const FHttpResponsePtr Response = Request->GetResponse();
+		if (CheckResponse(Response))
+		{
+			StreamRef->DeliverSegments(OnSegmentDownloaded, false);
+		}
+
+		// The content length is unknown for chunked transfer encoding, in which case the progress is reported with a content size of 0
+		const int64 ContentLength = Response.IsValid() ? static_cast<int64>(Response->GetContentLength()) : 0;
+		const int64 ContentSize = ContentLength > 0 ? ResumeOffset + ContentLength : 0;
+		UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Downloaded %lld bytes of file from %s by payload. Overall: %lld"), ResumeOffset + static_cast<int64>(BytesReceived), *Request->GetURL(), ContentSize);
+		OnProgress(ResumeOffset + static_cast<int64>(BytesReceived), ContentSize);
+	});
+
+	TSharedRef<FRuntimeFilesDownloaderInFlightRequestStat> InFlightRequestStat = MakeShared<FRuntimeFilesDownloaderInFlightRequestStat>(0, !bBackground);
+	HttpRequestRef->OnProcessRequestComplete().BindLambda([WeakThisPtr, PromisePtr, URL, Timeout, ContentType, OnProgress, DecoderRef, OnSegmentDownloaded, ResumeOffset, ResumeValidator, StreamRef, CheckResponse, InFlightRequestStat](FHttpRequestPtr Request, FHttpResponsePtr Response, bool bSuccess)
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeChunkDownloader::OnPayloadSegmentsRequestComplete);
+		RUNTIMEFILESDOWNLOADER_GAME_THREAD_SCOPE;
+		RUNTIMEFILESDOWNLOADER_LLM_SCOPE;
+
+		TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
+		if (!SharedThis.IsValid())
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to download file from %s by payload: downloader has been destroyed"), *URL);
+			PromisePtr->SetValue(EDownloadToMemoryResult::DownloadFailed);
+			return;
+		}
+
+		if (SharedThis->bCanceled)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled file download from %s by payload"), *URL);
+			PromisePtr->SetValue(EDownloadToMemoryResult::Cancelled);
+			return;
+		}
+
+		// Everything received is delivered, even if the request was interrupted, since the download continues after it
+		if (CheckResponse(Response))
+		{
+			StreamRef->DeliverSegments(OnSegmentDownloaded, true);
+		}
+		SharedThis->RecordReceivedBytes(StreamRef->ReceivedBytes);
+
+		const int64 DeliveredBytes = ResumeOffset + StreamRef->DeliveredBytes;
+		if (SharedThis->WasInterruptedByPause(Request) && (StreamRef->bResponseAccepted || !StreamRef->bResponseChecked))
+		{
+			++SharedThis->Stats.RetryCount;
+			const FString Validator = StreamRef->bResponseChecked ? StreamRef->Validator : ResumeValidator;
+
+			// The rest of the file is requested after the bytes decoded so far, which differ from the bytes received if the response was encoded
+			DecoderRef->Flush(false).Next([WeakThisPtr, PromisePtr, URL, Timeout, ContentType, OnProgress, DecoderRef, Validator](bool bDecoded)
+			{
+				TSharedPtr<FRuntimeChunkDownloader> FlushedSharedThis = WeakThisPtr.Pin();
+				if (!FlushedSharedThis.IsValid() || !bDecoded)
+				{
+					UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to continue file download from %s by payload"), *URL);
+					PromisePtr->SetValue(EDownloadToMemoryResult::DownloadFailed);
+					return;
+				}
+
+				FlushedSharedThis->RequestPayloadSegments(PromisePtr, URL, Timeout, ContentType, OnProgress, DecoderRef, DecoderRef->GetFileBytes(), Validator);
+			});
+			return;
+		}
+
+		if (!bSuccess || !Response.IsValid())
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file from %s by payload: request failed after %lld bytes"), *URL, DeliveredBytes);
+			PromisePtr->SetValue(EDownloadToMemoryResult::DownloadFailed);
+			return;
+		}
+
+		if (!StreamRef->bResponseAccepted)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file from %s by payload: unexpected response code %d"), *URL, Response->GetResponseCode());
+			PromisePtr->SetValue(EDownloadToMemoryResult::DownloadFailed);
+			return;
+		}
+
+		if (DeliveredBytes <= 0)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file from %s by payload: content is empty"), *URL);
+			PromisePtr->SetValue(EDownloadToMemoryResult::DownloadFailed);
+			return;
+		}
+
+		UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Successfully downloaded file from %s by payload in segments. Overall: %lld"), *URL, DeliveredBytes);
+		PromisePtr->SetValue(EDownloadToMemoryResult::SucceededByPayload);
+	});
+
+	if (!HttpRequestRef->ProcessRequest())
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file from %s by payload: request failed"), *URL);
+		PromisePtr->SetValue(EDownloadToMemoryResult::DownloadFailed);
+		return;
+	}
+
+	HttpRequestPtr = HttpRequestRef;
+}
+#endif
+
+TFuture<int64> FRuntimeChunkDownloader::GetContentSize(const FString& URL, float Timeout)
+{
+	TSharedPtr<TPromise<int64>> PromisePtr = MakeShared<TPromise<int64>>();
+	GetContentInfo(URL, Timeout).Next([PromisePtr](const FRuntimeContentInfo& ContentInfo)
+	{
+		PromisePtr->SetValue(ContentInfo.Size);
+	});
+	return PromisePtr->GetFuture();
+}
+
+TFuture<FRuntimeContentInfo> FRuntimeChunkDownloader::GetContentInfo(const FString& URL, float Timeout)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeChunkDownloader::GetContentInfo);
+
+	// The information is requested once per URL, e.g. for the admission check and then for each chunk of the download
+	if (const FRuntimeContentInfo* KnownContentInfo = KnownContentInfos.Find(URL))
+	{
+		return MakeFulfilledPromise<FRuntimeContentInfo>(*KnownContentInfo).GetFuture();
+	}
+
+	MarkDownloadStarted();
+
+	TSharedPtr<TPromise<FRuntimeContentInfo>> PromisePtr = MakeShared<TPromise<FRuntimeContentInfo>>();
+	TWeakPtr<FRuntimeChunkDownloader> WeakThisPtr = AsShared();
+
+	// The information of a paused download is requested once resumed, so that the download does not move on to its chunks while paused
+	auto RequestOnceResumed = [WeakThisPtr, PromisePtr, URL, Timeout](FRuntimeChunkDownloader& Downloader)
+	{
+		Downloader.RunWhenResumed([WeakThisPtr, PromisePtr, URL, Timeout]()
+		{
+			TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
+			if (!SharedThis.IsValid() || SharedThis->bCanceled)
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to resume getting size of file from %s: download has been canceled"), *URL);
+				PromisePtr->SetValue(FRuntimeContentInfo());
+				return;
+			}
+
+			SharedThis->GetContentInfo(URL, Timeout).Next([PromisePtr](const FRuntimeContentInfo& ContentInfo)
+			{
+				PromisePtr->SetValue(ContentInfo);
+			});
+		});
+	};
+
+	if (IsPaused())
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Download from %s is paused. Its size will be requested once resumed"), *URL);
+		RequestOnceResumed(*this);
+		return PromisePtr->GetFuture();
+	}
+
+#if UE_VERSION_NEWER_THAN(4, 26, 0)
+	const TSharedRef<IHttpRequest, ESPMode::ThreadSafe> HttpRequestRef = FHttpModule::Get().CreateRequest();
+#else
+	const TSharedRef<IHttpRequest> HttpRequestRef = FHttpModule::Get().CreateRequest();
+#endif
+
+	HttpRequestRef->SetVerb("HEAD");
+	HttpRequestRef->SetURL(URL);
+	SetCommonHeaders(HttpRequestRef, false);
+
+#if UE_VERSION_NEWER_THAN(4, 26, 0)
+	HttpRequestRef->SetTimeout(Timeout);
+#else
+	UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("The Timeout feature is only supported in engine version 4.26 or later. Please update your engine to use this feature"));
+#endif
+
+	const double RequestStartTime = FPlatformTime::Seconds();
+	TSharedRef<FRuntimeFilesDownloaderInFlightRequestStat> InFlightRequestStat = MakeShared<FRuntimeFilesDownloaderInFlightRequestStat>(0, !bBackground);
+	HttpRequestRef->OnProcessRequestComplete().BindLambda([WeakThisPtr, PromisePtr, URL, RequestStartTime, InFlightRequestStat, RequestOnceResumed](const FHttpRequestPtr& Request, const FHttpResponsePtr& Response, const bool bSucceeded)
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeChunkDownloader::OnContentSizeRequestComplete);
+		RUNTIMEFILESDOWNLOADER_GAME_THREAD_SCOPE;
+
+		TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
+		if (SharedThis.IsValid())
+		{
+			if (SharedThis->WasInterruptedByPause(Request))
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Getting size of file from %s was interrupted by pausing. It will be requested again once resumed"), *URL);
+				RequestOnceResumed(*SharedThis);
+				return;
+			}
+
+			SharedThis->Stats.ContentSizeRequestLatency = static_cast<float>(FPlatformTime::Seconds() - RequestStartTime);
+		}
+
+		if (!bSucceeded || !Response.IsValid())
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to get size of file from %s: request failed"), *URL);
+			PromisePtr->SetValue(FRuntimeContentInfo());
+			return;
+		}
+
+		FRuntimeContentInfo ContentInfo;
+		ContentInfo.Size = FCString::Atoi64(*Response->GetHeader("Content-Length"));
+		if (ContentInfo.Size <= 0)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to get size of file from %s: content length is %lld, expected > 0"), *URL, ContentInfo.Size);
+			PromisePtr->SetValue(FRuntimeContentInfo());
+			return;
+		}
+
+		ContentInfo.ETag = Response->GetHeader(TEXT("ETag"));
+		ContentInfo.LastModified = Response->GetHeader(TEXT("Last-Modified"));
+
+		// The absence of the header does not mean ranges are not accepted, only an explicit "none" does
+		ContentInfo.bAcceptsRanges = !Response->GetHeader(TEXT("Accept-Ranges")).TrimStartAndEnd().Equals(TEXT("none"), ESearchCase::IgnoreCase);
+
+		UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Got size of file from %s: %lld"), *URL, ContentInfo.Size);
+		if (SharedThis.IsValid())
+		{
+			SharedThis->KnownContentInfos.Add(URL, ContentInfo);
+		}
+		PromisePtr->SetValue(MoveTemp(ContentInfo));
+	});
+
+	if (!HttpRequestRef->ProcessRequest())
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to get size of file from %s: request failed"), *URL);
+		return MakeFulfilledPromise<FRuntimeContentInfo>(FRuntimeContentInfo()).GetFuture();
+	}
+
+	HttpRequestPtr = HttpRequestRef;
+	return PromisePtr->GetFuture();
+}
+
+void FRuntimeChunkDownloader::CancelDownload()
+{
+	bCanceled = true;
+	if (HttpRequestPtr.IsValid())
+	{
+#if UE_VERSION_NEWER_THAN(4, 26, 0)
+		const TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> HttpRequest = HttpRequestPtr.Pin();
+#else
+		const TSharedPtr<IHttpRequest> HttpRequest = HttpRequestPtr.Pin();
+#endif
+
+		HttpRequest->CancelRequest();
+	}
+	UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Download canceled"));
+
+	// Let the deferred downloads finish as canceled
+	ResumeDownload();
+}
+
+void FRuntimeChunkDownloader::PauseDownload()
+{
+#if UE_VERSION_NEWER_THAN(4, 26, 0)
+	TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> HttpRequest;
+#else
+	TSharedPtr<IHttpRequest> HttpRequest;
+#endif
+	{
+		FScopeLock Lock(&PauseLock);
+		if (bCanceled || bPaused)
+		{
+			return;
+		}
+
+		bPaused = true;
+		HttpRequest = HttpRequestPtr.Pin();
+
+		// The request is marked before it is canceled, since its completion may be called right away
+		InterruptedHttpRequestPtr = HttpRequest;
+	}
+
+	if (HttpRequest.IsValid())
+	{
+		HttpRequest->CancelRequest();
+	}
+	UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Download paused"));
+}
+
+void FRuntimeChunkDownloader::ResumeDownload()
+{
+	TArray<TFunction<void()>> ResumeFunctions;
+	{
+		FScopeLock Lock(&PauseLock);
+		if (!bPaused)
+		{
+			return;
+		}
+
+		bPaused = false;
+		ResumeFunctions = MoveTemp(PendingResumeFunctions);
+	}
+	UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Download resumed"));
+
+	DEC_DWORD_STAT_BY(STAT_RuntimeFilesDownloader_QueuedRequests, ResumeFunctions.Num());
+	for (TFunction<void()>& ResumeFunction : ResumeFunctions)
+	{
+		ResumeFunction();
+	}
+}
+
+void FRuntimeChunkDownloader::SetCancelOnSessionEnd(bool bCancel)
+{
+	FScopeLock Lock(&SessionDownloadersLock);
+	SessionDownloaders.RemoveAllSwap([this](const TWeakPtr<FRuntimeChunkDownloader>& Downloader)
+	{
+		return !Downloader.IsValid() || Downloader.HasSameObject(this);
+	});
+	if (bCancel)
+	{
+		SessionDownloaders.Add(AsShared());
+	}
+}
+
+void FRuntimeChunkDownloader::CancelSessionDownloads()
+{
+	TArray<TSharedPtr<FRuntimeChunkDownloader>> Downloaders;
+	{
+		FScopeLock Lock(&SessionDownloadersLock);
+		for (const TWeakPtr<FRuntimeChunkDownloader>& Downloader : SessionDownloaders)
+		{
+			if (TSharedPtr<FRuntimeChunkDownloader> PinnedDownloader = Downloader.Pin())
+			{
+				Downloaders.Add(PinnedDownloader);
+			}
+		}
+		SessionDownloaders.Reset();
+	}
+
+	for (const TSharedPtr<FRuntimeChunkDownloader>& Downloader : Downloaders)
+	{
+		Downloader->CancelDownload();
+	}
+}
+
+bool FRuntimeChunkDownloader::IsPaused() const
+{
+	FScopeLock Lock(&PauseLock);
+	return bPaused;
+}
+
+const FRuntimeFilesDownloaderStats& FRuntimeChunkDownloader::GetStats() const
+{
+	return Stats;
+}
+
+void FRuntimeChunkDownloader::SetAcceptCompressedContent(bool bAccept)
+{
+	bAcceptCompressedContent = bAccept;
+}
+
+void FRuntimeChunkDownloader::SetDecompressCompressedFiles(bool bDecompress)
+{
+	bDecompressCompressedFiles = bDecompress;
+}
+
+void FRuntimeChunkDownloader::SetExecutionPolicy(const FRuntimeDownloadExecutionPolicy& InExecutionPolicy)
+{
+	ExecutionPolicy = InExecutionPolicy;
+}
+
+const FRuntimeDownloadExecutionPolicy& FRuntimeChunkDownloader::GetExecutionPolicy() const
+{
+	return ExecutionPolicy;
+}
+
+void FRuntimeChunkDownloader::SetBackground(bool bInBackground)
+{
+	bBackground = bInBackground;
+}
+
+bool FRuntimeChunkDownloader::IsBackground() const
+{
+	return bBackground;
+}
+
+int32 FRuntimeChunkDownloader::GetForegroundRequestCount()
+{
+	return FRuntimeFilesDownloaderInFlightRequestStat::GetForegroundRequestCounter();
+}
+
+void FRuntimeChunkDownloader::SetIfRangeValidator(const FString& InIfRangeValidator)
+{
+	IfRangeValidator = InIfRangeValidator;
+}
+
+void FRuntimeChunkDownloader::SetFastStart(bool bInFastStart)
+{
+	bFastStart = bInFastStart;
+}
+
+TFuture<FRuntimeChunkDownloader::FContentProbe> FRuntimeChunkDownloader::ProbeContent(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, const FOnProgress& OnProgress)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeChunkDownloader::ProbeContent);
+
+	TSharedPtr<TPromise<FContentProbe>> PromisePtr = MakeShared<TPromise<FContentProbe>>();
+	TWeakPtr<FRuntimeChunkDownloader> WeakThisPtr = AsShared();
+
+	auto RequestContentSize = [WeakThisPtr, PromisePtr, URL, Timeout]()
+	{
+		TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
+		if (!SharedThis.IsValid())
+		{
+			PromisePtr->SetValue(FContentProbe());
+			return;
+		}
+
+		SharedThis->GetContentInfo(URL, Timeout).Next([PromisePtr](const FRuntimeContentInfo& ContentInfo)
+		{
+			FContentProbe Probe;
+			Probe.ContentSize = ContentInfo.Size;
+			Probe.bAcceptsRanges = ContentInfo.bAcceptsRanges;
+			PromisePtr->SetValue(MoveTemp(Probe));
+		});
+	};
+
+	// A paused download must not start transferring data, and a known size needs no request at all
+	if (!bFastStart || IsPaused() || MaxChunkSize <= 0 || KnownContentInfos.Contains(URL))
+	{
+		RequestContentSize();
+		return PromisePtr->GetFuture();
+	}
+
+	MarkDownloadStarted();
+
+#if UE_VERSION_NEWER_THAN(4, 26, 0)
+	const TSharedRef<IHttpRequest, ESPMode::ThreadSafe> HttpRequestRef = FHttpModule::Get().CreateRequest();
+#else
 	const TSharedRef<IHttpRequest> HttpRequestRef = FHttpModule::Get().CreateRequest();
 #endif
 
-	HttpRequestRef->SetVerb("HEAD");
+	HttpRequestRef->SetVerb("GET");
 	HttpRequestRef->SetURL(URL);
 
 #if UE_VERSION_NEWER_THAN(4, 26, 0)
@@ -561,51 +2478,445 @@ TFuture<int64> FRuntimeChunkDownloader::GetContentSize(const FString& URL, float
 	UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("The Timeout feature is only supported in engine version 4.26 or later. Please update your engine to use this feature"));
 #endif
 
-	HttpRequestRef->OnProcessRequestComplete().BindLambda([PromisePtr, URL](const FHttpRequestPtr& Request, const FHttpResponsePtr& Response, const bool bSucceeded)
+	if (!ContentType.IsEmpty())
+	{
+		HttpRequestRef->SetHeader(TEXT("Content-Type"), ContentType);
+	}
+
+	SetCommonHeaders(HttpRequestRef, false);
+	HttpRequestRef->SetHeader(TEXT("Range"), FString::Format(TEXT("bytes=0-{0}"), {MaxChunkSize - 1}));
+
+	if (!IfRangeValidator.IsEmpty())
 	{
-		if (!bSucceeded || !Response.IsValid())
+		HttpRequestRef->SetHeader(TEXT("If-Range"), IfRangeValidator);
+	}
+
+	HttpRequestRef->
+#if UE_VERSION_OLDER_THAN(5, 4, 0)
+		OnRequestProgress().BindLambda([WeakThisPtr, OnProgress](FHttpRequestPtr Request, int32 BytesSent, int32 BytesReceived)
+#else
+		OnRequestProgress64().BindLambda([WeakThisPtr, OnProgress](FHttpRequestPtr Request, uint64 BytesSent, uint64 BytesReceived)
+#endif
+	{
+		RUNTIMEFILESDOWNLOADER_GAME_THREAD_SCOPE;
+
+		TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
+		if (SharedThis.IsValid())
 		{
-			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to get size of file from %s: request failed"), *URL);
-			PromisePtr->SetValue(0);
+			if (BytesReceived > 0 && SharedThis->Stats.TimeToFirstByte < 0)
+			{
+				SharedThis->Stats.TimeToFirstByte = static_cast<float>(FPlatformTime::Seconds() - SharedThis->DownloadStartTime);
+			}
+
+			// The size of the file is known as soon as the headers of the response are received
+			int64 ContentSize = 0;
+			const FHttpResponsePtr Response = Request->GetResponse();
+			if (Response.IsValid())
+			{
+				FInt64Vector2 ContentRange;
+				if (!ParseContentRange(Response->GetHeader(TEXT("Content-Range")), ContentRange, ContentSize))
+				{
+					ContentSize = Response->GetContentLength();
+				}
+			}
+			OnProgress(BytesReceived, ContentSize);
+		}
+	});
+
+	const double RequestStartTime = FPlatformTime::Seconds();
+	TSharedRef<FRuntimeFilesDownloaderInFlightRequestStat> InFlightRequestStat = MakeShared<FRuntimeFilesDownloaderInFlightRequestStat>(MaxChunkSize, !bBackground);
+	HttpRequestRef->OnProcessRequestComplete().BindLambda([WeakThisPtr, PromisePtr, URL, RequestStartTime, InFlightRequestStat, RequestContentSize](FHttpRequestPtr Request, FHttpResponsePtr Response, bool bSuccess)
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeChunkDownloader::OnProbeRequestComplete);
+		RUNTIMEFILESDOWNLOADER_GAME_THREAD_SCOPE;
+		RUNTIMEFILESDOWNLOADER_LLM_SCOPE;
+
+		TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
+		if (!SharedThis.IsValid() || SharedThis->bCanceled)
+		{
+			PromisePtr->SetValue(FContentProbe());
+			return;
+		}
+
+		const int64 ReceivedSize = Response.IsValid() ? static_cast<int64>(Response->GetContent().Num()) : 0;
+		SharedThis->Stats.ContentSizeRequestLatency = static_cast<float>(FPlatformTime::Seconds() - RequestStartTime);
+		SharedThis->RecordReceivedBytes(ReceivedSize);
+
+		FRuntimeContentInfo ContentInfo;
+		bool bWholeFile = false;
+		if (bSuccess && Response.IsValid() && Response->GetResponseCode() == EHttpResponseCodes::PartialContent)
+		{
+			FInt64Vector2 ContentRange;
+			if (ParseContentRange(Response->GetHeader(TEXT("Content-Range")), ContentRange, ContentInfo.Size) && ContentRange.X == 0 && ContentRange.Y + 1 == ReceivedSize)
+			{
+				ContentInfo.ETag = Response->GetHeader(TEXT("ETag"));
+				ContentInfo.LastModified = Response->GetHeader(TEXT("Last-Modified"));
+			}
+			else
+			{
+				ContentInfo.Size = 0;
+			}
+		}
+		else if (bSuccess && Response.IsValid() && Response->GetResponseCode() == EHttpResponseCodes::Ok && ReceivedSize > 0)
+		{
+			// The server ignored the range and sent the whole file, which is kept instead of being requested again
+			ContentInfo.Size = ReceivedSize;
+			bWholeFile = true;
+		}
+
+		if (ContentInfo.Size <= 0)
+		{
+			// The probe was interrupted, e.g. by pausing, or the server answered the range unexpectedly, so the size is requested separately
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Unable to get the size of the file from %s from its first chunk, requesting the size separately"), *URL);
+			SharedThis->Stats.BytesWasted += ReceivedSize;
+			RequestContentSize();
+			return;
+		}
+
+		FRuntimeChunkDownloadStats ChunkStats;
+		ChunkStats.Offset = 0;
+		ChunkStats.Size = ReceivedSize;
+		ChunkStats.Duration = static_cast<float>(FPlatformTime::Seconds() - RequestStartTime);
+		ChunkStats.bSucceeded = true;
+		SharedThis->AddChunkStats(ChunkStats);
+
+		// A compressed full response has the size of the compressed data, which is not the size of the file for range requests
+		if (!bWholeFile)
+		{
+			SharedThis->KnownContentInfos.Add(URL, ContentInfo);
+		}
+
+		UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Got size of file from %s with its first %lld bytes: %lld"), *URL, ReceivedSize, ContentInfo.Size);
+		auto CopyResponseContent = [](const FHttpResponsePtr& ProbeResponse)
+		{
+			TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeChunkDownloader::CopyResponseContent);
+			const TArray<uint8>& Content = ProbeResponse->GetContent();
+			TArray64<uint8> ChunkData = FRuntimeChunkBufferPool::Get().Acquire(Content.Num());
+			ChunkData.Append(Content.GetData(), Content.Num());
+			return ChunkData;
+		};
+
+		// The whole file is decompressed here, so that it is delivered the same way as a file downloaded by payload
+		if (bWholeFile)
+		{
+			SharedThis->DecompressIfNeeded(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::Success, CopyResponseContent(Response)}, URL, Response->GetHeader(TEXT("Content-Encoding"))).Next([PromisePtr](FRuntimeChunkDownloaderResult&& DecompressedResult)
+			{
+				FContentProbe Probe;
+				if (DecompressedResult.Result == EDownloadToMemoryResult::Success)
+				{
+					Probe.ContentSize = DecompressedResult.Data.Num();
+					Probe.FirstChunk = MoveTemp(DecompressedResult.Data);
+					Probe.bWholeFile = true;
+				}
+				PromisePtr->SetValue(MoveTemp(Probe));
+			});
 			return;
 		}
 
-		const int64 ContentLength = FCString::Atoi64(*Response->GetHeader("Content-Length"));
-		if (ContentLength <= 0)
+		const int64 ContentSize = ContentInfo.Size;
+#if UE_VERSION_NEWER_THAN(4, 26, 0)
+		if (SharedThis->ExecutionPolicy.bProcessOnWorkerThreads)
 		{
-			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to get size of file from %s: content length is %lld, expected > 0"), *URL, ContentLength);
-			PromisePtr->SetValue(0);
+			Async(EAsyncExecution::ThreadPool, [PromisePtr, Response, CopyResponseContent, ContentSize]()
+			{
+				FContentProbe Probe{ContentSize, CopyResponseContent(Response), false, true};
+				AsyncTask(ENamedThreads::GameThread, [PromisePtr, Probe = MoveTemp(Probe)]() mutable
+				{
+					RUNTIMEFILESDOWNLOADER_GAME_THREAD_SCOPE;
+					PromisePtr->SetValue(MoveTemp(Probe));
+				});
+			});
 			return;
 		}
+#endif
 
-		UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Got size of file from %s: %lld"), *URL, ContentLength);
-		PromisePtr->SetValue(ContentLength);
+		PromisePtr->SetValue(FContentProbe{ContentSize, CopyResponseContent(Response), false, true});
 	});
 
 	if (!HttpRequestRef->ProcessRequest())
 	{
-		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to get size of file from %s: request failed"), *URL);
-		return MakeFulfilledPromise<int64>(0).GetFuture();
+		UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to request the first chunk of the file from %s, requesting the size separately"), *URL);
+		RequestContentSize();
+		return PromisePtr->GetFuture();
 	}
 
 	HttpRequestPtr = HttpRequestRef;
 	return PromisePtr->GetFuture();
 }
 
-void FRuntimeChunkDownloader::CancelDownload()
+TFuture<FRuntimeChunkDownloaderResult> FRuntimeChunkDownloader::DecompressIfNeeded(FRuntimeChunkDownloaderResult&& Result, const FString& URL, const FString& ResponseContentEncoding) const
 {
-	bCanceled = true;
-	if (HttpRequestPtr.IsValid())
+	if (Result.Result != EDownloadToMemoryResult::Success && Result.Result != EDownloadToMemoryResult::SucceededByPayload)
+	{
+		return MakeFulfilledPromise<FRuntimeChunkDownloaderResult>(MoveTemp(Result)).GetFuture();
+	}
+
+	// Data in an encoding that cannot be decoded is not passed on as if it were the file
+	const bool bContentEncoded = !ResponseContentEncoding.IsEmpty() && !ResponseContentEncoding.Equals(TEXT("identity"), ESearchCase::IgnoreCase);
+	if (bContentEncoded && !IsSupportedContentEncoding(ResponseContentEncoding))
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download file from %s: unsupported content encoding '%s'"), *URL, *ResponseContentEncoding);
+		FRuntimeChunkBufferPool::Get().Release(MoveTemp(Result.Data));
+		return MakeFulfilledPromise<FRuntimeChunkDownloaderResult>(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, TArray64<uint8>()}).GetFuture();
+	}
+
+	// The data is only decompressed if it is declared to be compressed, since the compression header can occur at the start of any file by chance
+	const bool bCompressedFile = bDecompressCompressedFiles && IsCompressedFileURL(URL);
+	if (!(bContentEncoded || bCompressedFile) || !FRuntimeStreamDecompressor::IsCompressed(Result.Data.GetData(), Result.Data.Num()))
+	{
+		return MakeFulfilledPromise<FRuntimeChunkDownloaderResult>(MoveTemp(Result)).GetFuture();
+	}
+
+	TSharedPtr<TPromise<FRuntimeChunkDownloaderResult>> PromisePtr = MakeShared<TPromise<FRuntimeChunkDownloaderResult>>();
+	Async(EAsyncExecution::ThreadPool, [PromisePtr, Result = MoveTemp(Result)]() mutable
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeChunkDownloader::Decompress);
+		RUNTIMEFILESDOWNLOADER_LLM_SCOPE;
+
+		TArray64<uint8> DecompressedData;
+		if (FRuntimeStreamDecompressor::DecompressBuffer(Result.Data, DecompressedData))
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Decompressed the downloaded data from %lld to %lld bytes"), Result.Data.Num(), DecompressedData.Num());
+			Result.Data = MoveTemp(DecompressedData);
+		}
+		else
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to decompress the downloaded data, delivering it as received"));
+		}
+
+		AsyncTask(ENamedThreads::GameThread, [PromisePtr, Result = MoveTemp(Result)]() mutable
+		{
+			RUNTIMEFILESDOWNLOADER_GAME_THREAD_SCOPE;
+			PromisePtr->SetValue(MoveTemp(Result));
+		});
+	});
+	return PromisePtr->GetFuture();
+}
+
+bool FRuntimeChunkDownloader::IsCompressedFileURL(const FString& URL)
+{
+	FString Path = URL;
+	int32 QueryIndex;
+	if (Path.FindChar(TEXT('?'), QueryIndex))
 	{
+		Path.LeftInline(QueryIndex);
+	}
+
+	const FString Extension = FPaths::GetExtension(Path);
+	return Extension.Equals(TEXT("gz"), ESearchCase::IgnoreCase) || Extension.Equals(TEXT("zz"), ESearchCase::IgnoreCase);
+}
+
 #if UE_VERSION_NEWER_THAN(4, 26, 0)
-		const TSharedPtr<IHttpRequest, ESPMode::ThreadSafe> HttpRequest = HttpRequestPtr.Pin();
+void FRuntimeChunkDownloader::SetCommonHeaders(const TSharedRef<IHttpRequest, ESPMode::ThreadSafe>& HttpRequestRef, bool bWholeBody) const
 #else
-		const TSharedPtr<IHttpRequest> HttpRequest = HttpRequestPtr.Pin();
+void FRuntimeChunkDownloader::SetCommonHeaders(const TSharedRef<IHttpRequest>& HttpRequestRef, bool bWholeBody) const
 #endif
+{
+	// A compressed range would be a range of the compressed data, which cannot be decompressed on its own or joined with ranges of the uncompressed file
+	if (bAcceptCompressedContent && bWholeBody)
+	{
+		HttpRequestRef->SetHeader(TEXT("Accept-Encoding"), TEXT("gzip, deflate"));
+	}
+}
 
-		HttpRequest->CancelRequest();
+bool FRuntimeChunkDownloader::ParseContentRange(const FString& ContentRangeHeader, FInt64Vector2& OutRange, int64& OutTotalSize)
+{
+	FString RangeString, TotalSizeString, StartString, EndString;
+	if (!ContentRangeHeader.TrimStartAndEnd().StartsWith(TEXT("bytes"))
+		|| !ContentRangeHeader.TrimStartAndEnd().RightChop(5).TrimStart().Split(TEXT("/"), &RangeString, &TotalSizeString)
+		|| !RangeString.Split(TEXT("-"), &StartString, &EndString)
+		|| !StartString.TrimStartAndEnd().IsNumeric() || !EndString.TrimStartAndEnd().IsNumeric())
+	{
+		return false;
 	}
-	UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Download canceled"));
+
+	OutRange = FInt64Vector2(FCString::Atoi64(*StartString.TrimStartAndEnd()), FCString::Atoi64(*EndString.TrimStartAndEnd()));
+	TotalSizeString.TrimStartAndEndInline();
+	OutTotalSize = TotalSizeString.IsNumeric() ? FCString::Atoi64(*TotalSizeString) : -1;
+	return OutRange.X >= 0 && OutRange.X <= OutRange.Y;
+}
+
+bool FRuntimeChunkDownloader::ParseMultipartByteRanges(const TArray<uint8>& Content, const FString& ContentTypeHeader, TArray<TPair<FInt64Vector2, int64>>& OutParts)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeChunkDownloader::ParseMultipartByteRanges);
+
+	FString Boundary;
+	{
+		const int32 BoundaryIndex = ContentTypeHeader.Find(TEXT("boundary="), ESearchCase::IgnoreCase);
+		if (BoundaryIndex == INDEX_NONE)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to parse the multipart/byteranges response: there is no boundary in '%s'"), *ContentTypeHeader);
+			return false;
+		}
+
+		Boundary = ContentTypeHeader.Mid(BoundaryIndex + 9);
+		int32 ParameterEndIndex;
+		if (Boundary.FindChar(TEXT(';'), ParameterEndIndex))
+		{
+			Boundary.LeftInline(ParameterEndIndex);
+		}
+		Boundary.TrimStartAndEndInline();
+		Boundary.TrimQuotesInline();
+	}
+
+	const FTCHARToUTF8 DelimiterUTF8(*(TEXT("--") + Boundary));
+	const TArrayView<const uint8> Delimiter(reinterpret_cast<const uint8*>(DelimiterUTF8.Get()), DelimiterUTF8.Length());
+	static const uint8 HeadersEnd[] = {'\r', '\n', '\r', '\n'};
+
+	auto FindBytes = [&Content](TArrayView<const uint8> Needle, int64 From) -> int64
+	{
+		for (int64 Index = From; Index + Needle.Num() <= Content.Num(); ++Index)
+		{
+			if (FMemory::Memcmp(Content.GetData() + Index, Needle.GetData(), Needle.Num()) == 0)
+			{
+				return Index;
+			}
+		}
+		return INDEX_NONE;
+	};
+
+	int64 Position = FindBytes(Delimiter, 0);
+	while (Position != INDEX_NONE)
+	{
+		Position += Delimiter.Num();
+
+		// The closing delimiter is followed by two dashes
+		if (Position + 2 <= Content.Num() && Content[Position] == '-' && Content[Position + 1] == '-')
+		{
+			return OutParts.Num() > 0;
+		}
+
+		const int64 HeadersEndPosition = FindBytes(TArrayView<const uint8>(HeadersEnd, UE_ARRAY_COUNT(HeadersEnd)), Position);
+		if (HeadersEndPosition == INDEX_NONE)
+		{
+			break;
+		}
+
+		const FUTF8ToTCHAR HeadersConverter(reinterpret_cast<const ANSICHAR*>(Content.GetData() + Position), HeadersEndPosition - Position);
+		const FString Headers(HeadersConverter.Length(), HeadersConverter.Get());
+		TArray<FString> HeaderLines;
+		Headers.ParseIntoArrayLines(HeaderLines);
+
+		FInt64Vector2 PartRange;
+		int64 TotalSize;
+		bool bRangeFound = false;
+		for (const FString& HeaderLine : HeaderLines)
+		{
+			FString HeaderName, HeaderValue;
+			if (HeaderLine.Split(TEXT(":"), &HeaderName, &HeaderValue) && HeaderName.TrimStartAndEnd().Equals(TEXT("Content-Range"), ESearchCase::IgnoreCase))
+			{
+				bRangeFound = ParseContentRange(HeaderValue, PartRange, TotalSize);
+				break;
+			}
+		}
+
+		const int64 DataPosition = HeadersEndPosition + UE_ARRAY_COUNT(HeadersEnd);
+		if (!bRangeFound || DataPosition + (PartRange.Y - PartRange.X + 1) > Content.Num())
+		{
+			break;
+		}
+
+		OutParts.Add(TPair<FInt64Vector2, int64>(PartRange, DataPosition));
+		Position = FindBytes(Delimiter, DataPosition + (PartRange.Y - PartRange.X + 1));
+	}
+
+	UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to parse the multipart/byteranges response: the body is malformed or truncated"));
+	return false;
+}
+
+void FRuntimeChunkDownloader::MarkDownloadStarted()
+{
+	if (DownloadStartTime <= 0)
+	{
+		DownloadStartTime = FPlatformTime::Seconds();
+	}
+}
+
+void FRuntimeChunkDownloader::RecordReceivedBytes(int64 Bytes)
+{
+	MarkDownloadStarted();
+
+	Stats.BytesReceived += Bytes;
+	Stats.Duration = static_cast<float>(FPlatformTime::Seconds() - DownloadStartTime);
+	Stats.Throughput = Stats.Duration <= 0 ? 0.0f : static_cast<float>(Stats.BytesReceived) / Stats.Duration;
+
+	CSV_CUSTOM_STAT(RuntimeFilesDownloader, BytesReceived, static_cast<float>(Bytes), ECsvCustomStatOp::Accumulate);
+	CSV_CUSTOM_STAT(RuntimeFilesDownloader, ThroughputKBps, Stats.Throughput / 1024.0f, ECsvCustomStatOp::Set);
+
+#if UE_VERSION_NEWER_THAN(5, 0, 0)
+	TRACE_COUNTER_ADD(RuntimeFilesDownloader_BytesReceived, Bytes);
+	TRACE_COUNTER_SET(RuntimeFilesDownloader_Throughput, Stats.Throughput);
+#endif
+}
+
+void FRuntimeChunkDownloader::RecordBufferMemory(int64 TransientBytes)
+{
+	Stats.PeakBufferMemory = FMath::Max(Stats.PeakBufferMemory, AllocatedBufferMemory + TransientBytes);
+	CSV_CUSTOM_STAT(RuntimeFilesDownloader, PeakBufferMemoryMB, static_cast<float>(Stats.PeakBufferMemory) / (1024.0f * 1024.0f), ECsvCustomStatOp::Max);
+}
+
+void FRuntimeChunkDownloader::AddChunkStats(const FRuntimeChunkDownloadStats& ChunkStats)
+{
+	++Stats.ChunkCount;
+	if (Stats.Chunks.Num() >= MaxRecordedChunkStats)
+	{
+#if UE_VERSION_OLDER_THAN(5, 4, 0)
+		Stats.Chunks.RemoveAt(0, Stats.Chunks.Num() - MaxRecordedChunkStats + 1, false);
+#else
+		Stats.Chunks.RemoveAt(0, Stats.Chunks.Num() - MaxRecordedChunkStats + 1, EAllowShrinking::No);
+#endif
+	}
+	Stats.Chunks.Add(ChunkStats);
+}
+
+void FRuntimeChunkDownloader::RunWhenResumed(TFunction<void()>&& Function)
+{
+	{
+		FScopeLock Lock(&PauseLock);
+		if (bPaused)
+		{
+			INC_DWORD_STAT(STAT_RuntimeFilesDownloader_QueuedRequests);
+			PendingResumeFunctions.Add(MoveTemp(Function));
+			return;
+		}
+	}
+
+	// The download was resumed in the meantime
+	Function();
+}
+
+bool FRuntimeChunkDownloader::WasInterruptedByPause(const FHttpRequestPtr& Request)
+{
+	FScopeLock Lock(&PauseLock);
+	if (!Request.IsValid() || InterruptedHttpRequestPtr.Pin().Get() != Request.Get())
+	{
+		return false;
+	}
+
+	InterruptedHttpRequestPtr.Reset();
+	return true;
+}
+
+void FRuntimeChunkDownloader::DeferPayloadDownloadUntilResumed(const TSharedPtr<TPromise<FRuntimeChunkDownloaderResult>>& PromisePtr, const FString& URL, float Timeout, const FString& ContentType, const FOnProgress& OnProgress)
+{
+	UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Download from %s by payload is paused. It will be requested once resumed"), *URL);
+
+	TWeakPtr<FRuntimeChunkDownloader> WeakThisPtr = AsShared();
+	RunWhenResumed([WeakThisPtr, PromisePtr, URL, Timeout, ContentType, OnProgress]()
+	{
+		TSharedPtr<FRuntimeChunkDownloader> SharedThis = WeakThisPtr.Pin();
+		if (!SharedThis.IsValid())
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to resume file download from %s by payload: downloader has been destroyed"), *URL);
+			PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, TArray64<uint8>()});
+			return;
+		}
+
+		SharedThis->DownloadFileByPayload(URL, Timeout, ContentType, OnProgress).Next([PromisePtr](FRuntimeChunkDownloaderResult&& Result)
+		{
+			PromisePtr->SetValue(MoveTemp(Result));
+		});
+	});
 }
 
 TFuture<bool> FRuntimeChunkDownloader::CheckAndRequestPermissions()
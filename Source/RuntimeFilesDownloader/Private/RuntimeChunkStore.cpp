@@ -0,0 +1,669 @@
+// Georgy Treshchev 2024.
+
+#include "RuntimeChunkStore.h"
+
+#include "FileToMemoryDownloader.h"
+#include "FileToStorageDownloader.h"
+#include "RuntimeFilesDownloaderDefines.h"
+#include "RuntimeFilesDownloaderProfiling.h"
+#include "Async/Async.h"
+#include "Dom/JsonObject.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Guid.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+
+namespace
+{
+	/** The maximum size of a single range request covering several adjacent chunks */
+	constexpr int64 MaxChunkFetchSize = 16 * 1024 * 1024;
+
+	/**
+	 * Get the table of random values used by the gear rolling hash to find chunk boundaries
+	 * The values must never change, otherwise the chunk boundaries of the existing manifests would no longer be reproducible
+	 */
+	const uint64* GetGearTable()
+	{
+		static const TArray<uint64> GearTable = []()
+		{
+			TArray<uint64> Table;
+			Table.SetNumUninitialized(256);
+
+			// SplitMix64 with a fixed seed
+			uint64 State = 0x52464443484E4B53ull;
+			for (uint64& Value : Table)
+			{
+				State += 0x9E3779B97F4A7C15ull;
+				uint64 Mixed = State;
+				Mixed = (Mixed ^ (Mixed >> 30)) * 0xBF58476D1CE4E5B9ull;
+				Mixed = (Mixed ^ (Mixed >> 27)) * 0x94D049BB133111EBull;
+				Value = Mixed ^ (Mixed >> 31);
+			}
+			return Table;
+		}();
+		return GearTable.GetData();
+	}
+
+	/**
+	 * Check whether the path is a relative path that stays inside the install directory
+	 */
+	bool IsSafeRelativePath(const FString& Path)
+	{
+		return !Path.IsEmpty() && FPaths::IsRelative(Path) && !Path.StartsWith(TEXT("/")) && !Path.StartsWith(TEXT("\\")) && !Path.Contains(TEXT(".."));
+	}
+
+	/**
+	 * Save the chunk by writing a temporary file first and moving it into place, so that a chunk in the store is never partially written
+	 * The temporary file name is unique, since several downloaders sharing the store may save the same chunk at once
+	 */
+	bool SaveChunkAtomically(const uint8* ChunkData, int64 ChunkSize, const FString& ChunkPath)
+	{
+		IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+		const FString TempChunkPath = FString::Printf(TEXT("%s.%s.tmp"), *ChunkPath, *FGuid::NewGuid().ToString());
+
+		const FString ChunkDirectory = FPaths::GetPath(ChunkPath);
+		if (!PlatformFile.DirectoryExists(*ChunkDirectory) && !PlatformFile.CreateDirectoryTree(*ChunkDirectory))
+		{
+			return false;
+		}
+
+		TUniquePtr<IFileHandle> FileHandle(PlatformFile.OpenWrite(*TempChunkPath));
+		const bool bWritten = FileHandle.IsValid() && FileHandle->Write(ChunkData, ChunkSize) && FileHandle->Flush();
+		FileHandle.Reset();
+
+		if (!bWritten || !IFileManager::Get().Move(*ChunkPath, *TempChunkPath, true))
+		{
+			PlatformFile.DeleteFile(*TempChunkPath);
+			return false;
+		}
+		return true;
+	}
+}
+
+bool FRuntimeChunkManifest::FromJson(const FString& JsonString, FRuntimeChunkManifest& OutManifest)
+{
+	TSharedPtr<FJsonObject> RootObject;
+	const TSharedRef<TJsonReader<>> JsonReader = TJsonReaderFactory<>::Create(JsonString);
+	if (!FJsonSerializer::Deserialize(JsonReader, RootObject) || !RootObject.IsValid())
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to parse the chunk manifest: invalid JSON"));
+		return false;
+	}
+
+	const TArray<TSharedPtr<FJsonValue>>* FileValues;
+	if (!RootObject->TryGetArrayField(TEXT("Files"), FileValues))
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to parse the chunk manifest: there is no 'Files' array"));
+		return false;
+	}
+
+	OutManifest.Files.Reset(FileValues->Num());
+	for (const TSharedPtr<FJsonValue>& FileValue : *FileValues)
+	{
+		const TSharedPtr<FJsonObject>* FileObject;
+		const TArray<TSharedPtr<FJsonValue>>* ChunkValues;
+		double FileSize = 0;
+		FRuntimeChunkManifestFile& File = OutManifest.Files.AddDefaulted_GetRef();
+		if (!FileValue->TryGetObject(FileObject)
+			|| !(*FileObject)->TryGetStringField(TEXT("Path"), File.Path)
+			|| !(*FileObject)->TryGetStringField(TEXT("URL"), File.URL)
+			|| !(*FileObject)->TryGetNumberField(TEXT("Size"), FileSize)
+			|| !(*FileObject)->TryGetArrayField(TEXT("Chunks"), ChunkValues))
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to parse the chunk manifest: file entry %d is invalid"), OutManifest.Files.Num() - 1);
+			return false;
+		}
+
+		if (!IsSafeRelativePath(File.Path))
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to parse the chunk manifest: the path '%s' is not a relative path inside the install directory"), *File.Path);
+			return false;
+		}
+		File.Size = static_cast<int64>(FileSize);
+
+		int64 ExpectedOffset = 0;
+		File.Chunks.Reserve(ChunkValues->Num());
+		for (const TSharedPtr<FJsonValue>& ChunkValue : *ChunkValues)
+		{
+			const TSharedPtr<FJsonObject>* ChunkObject;
+			FString HashString;
+			double ChunkSize = 0;
+			if (!ChunkValue->TryGetObject(ChunkObject)
+				|| !(*ChunkObject)->TryGetStringField(TEXT("Hash"), HashString)
+				|| !(*ChunkObject)->TryGetNumberField(TEXT("Size"), ChunkSize)
+				|| HashString.Len() != sizeof(FSHAHash::Hash) * 2
+				|| ChunkSize <= 0)
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to parse the chunk manifest: chunk entry of the file '%s' is invalid"), *File.Path);
+				return false;
+			}
+
+			FRuntimeChunkManifestChunk& Chunk = File.Chunks.AddDefaulted_GetRef();
+			Chunk.Hash.FromString(HashString);
+			Chunk.Offset = ExpectedOffset;
+			Chunk.Size = static_cast<int64>(ChunkSize);
+			ExpectedOffset += Chunk.Size;
+		}
+
+		if (ExpectedOffset != File.Size)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to parse the chunk manifest: the chunks of the file '%s' cover %lld bytes, but the file size is %lld bytes"), *File.Path, ExpectedOffset, File.Size);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+FString FRuntimeChunkManifest::ToJson() const
+{
+	TArray<TSharedPtr<FJsonValue>> FileValues;
+	FileValues.Reserve(Files.Num());
+	for (const FRuntimeChunkManifestFile& File : Files)
+	{
+		TArray<TSharedPtr<FJsonValue>> ChunkValues;
+		ChunkValues.Reserve(File.Chunks.Num());
+		for (const FRuntimeChunkManifestChunk& Chunk : File.Chunks)
+		{
+			TSharedRef<FJsonObject> ChunkObject = MakeShared<FJsonObject>();
+			ChunkObject->SetStringField(TEXT("Hash"), Chunk.Hash.ToString());
+			ChunkObject->SetNumberField(TEXT("Size"), static_cast<double>(Chunk.Size));
+			ChunkValues.Add(MakeShared<FJsonValueObject>(ChunkObject));
+		}
+
+		TSharedRef<FJsonObject> FileObject = MakeShared<FJsonObject>();
+		FileObject->SetStringField(TEXT("Path"), File.Path);
+		FileObject->SetStringField(TEXT("URL"), File.URL);
+		FileObject->SetNumberField(TEXT("Size"), static_cast<double>(File.Size));
+		FileObject->SetArrayField(TEXT("Chunks"), ChunkValues);
+		FileValues.Add(MakeShared<FJsonValueObject>(FileObject));
+	}
+
+	TSharedRef<FJsonObject> RootObject = MakeShared<FJsonObject>();
+	RootObject->SetArrayField(TEXT("Files"), FileValues);
+
+	FString JsonString;
+	const TSharedRef<TJsonWriter<>> JsonWriter = TJsonWriterFactory<>::Create(&JsonString);
+	FJsonSerializer::Serialize(RootObject, JsonWriter);
+	return JsonString;
+}
+
+FRuntimeChunkManifestFile FRuntimeChunkManifest::GenerateFile(const FString& Path, const FString& URL, const uint8* Data, int64 Size, int64 MinChunkSize, int64 AverageChunkSize, int64 MaxChunkSize)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeChunkManifest::GenerateFile);
+
+	FRuntimeChunkManifestFile File;
+	File.Path = Path;
+	File.URL = URL;
+	File.Size = Size;
+
+	MinChunkSize = FMath::Max<int64>(MinChunkSize, 1);
+	MaxChunkSize = FMath::Max(MaxChunkSize, MinChunkSize);
+	const uint64 BoundaryMask = FMath::RoundDownToPowerOfTwo64(static_cast<uint64>(FMath::Max<int64>(AverageChunkSize, 1))) - 1;
+	const uint64* GearTable = GetGearTable();
+
+	auto AddChunk = [&File, Data](int64 Offset, int64 ChunkSize)
+	{
+		FRuntimeChunkManifestChunk& Chunk = File.Chunks.AddDefaulted_GetRef();
+		Chunk.Offset = Offset;
+		Chunk.Size = ChunkSize;
+		FSHA1::HashBuffer(Data + Offset, ChunkSize, Chunk.Hash.Hash);
+	};
+
+	int64 ChunkStart = 0;
+	uint64 Hash = 0;
+	for (int64 Position = 0; Position < Size; ++Position)
+	{
+		Hash = (Hash << 1) + GearTable[Data[Position]];
+
+		const int64 ChunkSize = Position - ChunkStart + 1;
+		if ((ChunkSize >= MinChunkSize && (Hash & BoundaryMask) == 0) || ChunkSize >= MaxChunkSize)
+		{
+			AddChunk(ChunkStart, ChunkSize);
+			ChunkStart = Position + 1;
+			Hash = 0;
+		}
+	}
+
+	if (ChunkStart < Size)
+	{
+		AddChunk(ChunkStart, Size - ChunkStart);
+	}
+
+	return File;
+}
+
+FRuntimeChunkStoreDownloader::FRuntimeChunkStoreDownloader(const FString& InStoreDirectory)
+	: StoreDirectory(InStoreDirectory)
+{
+}
+
+TFuture<EDownloadToStorageResult> FRuntimeChunkStoreDownloader::DownloadManifestFiles(const FRuntimeChunkManifest& Manifest, const FString& InstallDirectory, float Timeout, const FString& ContentType, int32 MaxConcurrentDownloads, const FOnProgress& OnProgress)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeChunkStoreDownloader::DownloadManifestFiles);
+
+	if (bCanceled)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled downloading the files of the chunk manifest"));
+		return MakeFulfilledPromise<EDownloadToStorageResult>(EDownloadToStorageResult::Cancelled).GetFuture();
+	}
+
+	MarkDownloadStarted();
+
+	TSharedRef<FChunkFetchState> State = MakeShared<FChunkFetchState>();
+	State->Manifest = Manifest;
+	State->InstallDirectory = InstallDirectory;
+	State->Timeout = Timeout;
+	State->ContentType = ContentType;
+	State->MaxConcurrentDownloads = FMath::Max(MaxConcurrentDownloads, 1);
+	State->OnProgress = OnProgress;
+	State->PromisePtr = MakeShared<TPromise<EDownloadToStorageResult>>();
+
+	TWeakPtr<FRuntimeChunkStoreDownloader> WeakThisPtr = StaticCastSharedRef<FRuntimeChunkStoreDownloader>(AsShared());
+
+	// Verifying the chunks already in the store reads every one of them, so it is done on a worker thread
+	Async(EAsyncExecution::ThreadPool, [WeakThisPtr, State]()
+	{
+		if (TSharedPtr<FRuntimeChunkStoreDownloader> SharedThis = WeakThisPtr.Pin())
+		{
+			SharedThis->CreateChunkFetches(*State);
+		}
+
+		AsyncTask(ENamedThreads::GameThread, [WeakThisPtr, State]()
+		{
+			TSharedPtr<FRuntimeChunkStoreDownloader> SharedThis = WeakThisPtr.Pin();
+			if (!SharedThis.IsValid() || SharedThis->bCanceled)
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled downloading the files of the chunk manifest"));
+				State->PromisePtr->SetValue(EDownloadToStorageResult::Cancelled);
+				return;
+			}
+
+			SharedThis->StartNextChunkFetches(State);
+		});
+	});
+
+	return State->PromisePtr->GetFuture();
+}
+
+void FRuntimeChunkStoreDownloader::CancelDownload()
+{
+	FRuntimeChunkDownloader::CancelDownload();
+	for (const TSharedPtr<FRuntimeChunkDownloader>& FetchDownloader : FetchDownloaders)
+	{
+		FetchDownloader->CancelDownload();
+	}
+}
+
+void FRuntimeChunkStoreDownloader::PauseDownload()
+{
+	FRuntimeChunkDownloader::PauseDownload();
+	for (const TSharedPtr<FRuntimeChunkDownloader>& FetchDownloader : FetchDownloaders)
+	{
+		FetchDownloader->PauseDownload();
+	}
+}
+
+void FRuntimeChunkStoreDownloader::ResumeDownload()
+{
+	FRuntimeChunkDownloader::ResumeDownload();
+	for (const TSharedPtr<FRuntimeChunkDownloader>& FetchDownloader : FetchDownloaders)
+	{
+		FetchDownloader->ResumeDownload();
+	}
+}
+
+bool FRuntimeChunkStoreDownloader::HasChunk(const FRuntimeChunkManifestChunk& Chunk) const
+{
+	TArray64<uint8> ChunkData;
+	return LoadChunk(Chunk, ChunkData);
+}
+
+FString FRuntimeChunkStoreDownloader::GetChunkPath(const FSHAHash& Hash) const
+{
+	const FString HashString = Hash.ToString();
+	return StoreDirectory / HashString.Left(2) / HashString + TEXT(".chunk");
+}
+
+int64 FRuntimeChunkStoreDownloader::RemoveUnreferencedChunks(const TArray<FRuntimeChunkManifest>& Manifests) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeChunkStoreDownloader::RemoveUnreferencedChunks);
+
+	TSet<FString> ReferencedChunks;
+	for (const FRuntimeChunkManifest& Manifest : Manifests)
+	{
+		for (const FRuntimeChunkManifestFile& File : Manifest.Files)
+		{
+			for (const FRuntimeChunkManifestChunk& Chunk : File.Chunks)
+			{
+				ReferencedChunks.Add(Chunk.Hash.ToString());
+			}
+		}
+	}
+
+	TArray<FString> ChunkPaths;
+	IFileManager& FileManager = IFileManager::Get();
+	FileManager.FindFilesRecursive(ChunkPaths, *StoreDirectory, TEXT("*.chunk"), true, false);
+
+	int64 FreedBytes = 0;
+	for (const FString& ChunkPath : ChunkPaths)
+	{
+		if (ReferencedChunks.Contains(FPaths::GetBaseFilename(ChunkPath)))
+		{
+			continue;
+		}
+
+		const int64 ChunkSize = FileManager.FileSize(*ChunkPath);
+		if (FileManager.Delete(*ChunkPath))
+		{
+			FreedBytes += FMath::Max<int64>(ChunkSize, 0);
+		}
+		else
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Unable to delete the unreferenced chunk '%s'"), *ChunkPath);
+		}
+	}
+
+	UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Removed unreferenced chunks from the chunk store '%s', freed %lld bytes"), *StoreDirectory, FreedBytes);
+	return FreedBytes;
+}
+
+void FRuntimeChunkStoreDownloader::CreateChunkFetches(FChunkFetchState& State) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeChunkStoreDownloader::CreateChunkFetches);
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+
+	// Schedule each missing chunk once, merging adjacent missing chunks of the same file into a single range request
+	TSet<FSHAHash> CheckedChunks;
+	int64 ReusedBytes = 0;
+	for (const FRuntimeChunkManifestFile& File : State.Manifest.Files)
+	{
+		bool bCanMergeWithLastFetch = false;
+		for (const FRuntimeChunkManifestChunk& Chunk : File.Chunks)
+		{
+			bool bAlreadyChecked = false;
+			CheckedChunks.Add(Chunk.Hash, &bAlreadyChecked);
+			if (bAlreadyChecked || HasChunk(Chunk))
+			{
+				ReusedBytes += Chunk.Size;
+				bCanMergeWithLastFetch = false;
+				continue;
+			}
+
+			// A corrupted chunk is removed, so that it is replaced by the downloaded one
+			const FString ChunkPath = GetChunkPath(Chunk.Hash);
+			if (PlatformFile.FileExists(*ChunkPath))
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("The chunk %s in the chunk store '%s' is corrupted and will be downloaded again"), *Chunk.Hash.ToString(), *StoreDirectory);
+				PlatformFile.DeleteFile(*ChunkPath);
+			}
+			State.TotalBytes += Chunk.Size;
+
+			const int64 ChunkEnd = Chunk.Offset + Chunk.Size - 1;
+			if (bCanMergeWithLastFetch && ChunkEnd - State.Fetches.Last().Range.X + 1 <= MaxChunkFetchSize)
+			{
+				State.Fetches.Last().Range.Y = ChunkEnd;
+				State.Fetches.Last().Chunks.Add(Chunk);
+				continue;
+			}
+
+			FChunkFetch& Fetch = State.Fetches.AddDefaulted_GetRef();
+			Fetch.URL = File.URL;
+			Fetch.FileSize = File.Size;
+			Fetch.Range = FInt64Vector2(Chunk.Offset, ChunkEnd);
+			Fetch.Chunks.Add(Chunk);
+			bCanMergeWithLastFetch = true;
+		}
+	}
+
+	UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Installing %d files from the chunk manifest: reusing %lld bytes from the chunk store '%s', downloading %lld bytes in %d requests"), State.Manifest.Files.Num(), ReusedBytes, *StoreDirectory, State.TotalBytes, State.Fetches.Num());
+}
+
+void FRuntimeChunkStoreDownloader::StartNextChunkFetches(const TSharedRef<FChunkFetchState>& State)
+{
+	if (bCanceled && !State->FailureResult.IsSet())
+	{
+		State->FailureResult = EDownloadToStorageResult::Cancelled;
+	}
+
+	TWeakPtr<FRuntimeChunkStoreDownloader> WeakThisPtr = StaticCastSharedRef<FRuntimeChunkStoreDownloader>(AsShared());
+	while (!State->FailureResult.IsSet() && State->ActiveDownloads < State->MaxConcurrentDownloads && State->NextFetchIndex < State->Fetches.Num())
+	{
+		const int32 FetchIndex = State->NextFetchIndex++;
+		const FChunkFetch& Fetch = State->Fetches[FetchIndex];
+		++State->ActiveDownloads;
+
+		// Each range request uses its own downloader, since a downloader tracks a single request at a time
+		TSharedRef<FRuntimeChunkDownloader> FetchDownloader = MakeShared<FRuntimeChunkDownloader>();
+		FetchDownloader->SetExecutionPolicy(ExecutionPolicy);
+		FetchDownloader->SetBackground(bBackground);
+		if (bPaused)
+		{
+			FetchDownloader->PauseDownload();
+		}
+		FetchDownloaders.Add(FetchDownloader);
+
+		FetchDownloader->DownloadFileByChunk(Fetch.URL, State->Timeout, State->ContentType, Fetch.FileSize, Fetch.Range, [State, FetchIndex](int64 BytesReceived, int64 ContentSize)
+		{
+			State->ActiveBytes.Add(FetchIndex, BytesReceived);
+			if (State->OnProgress)
+			{
+				int64 ReceivedBytes = State->CompletedBytes;
+				for (const TPair<int32, int64>& ActiveBytes : State->ActiveBytes)
+				{
+					ReceivedBytes += ActiveBytes.Value;
+				}
+				State->OnProgress(ReceivedBytes, State->TotalBytes);
+			}
+		}).Next([WeakThisPtr, State, FetchIndex, FetchDownloader](FRuntimeChunkDownloaderResult&& Result)
+		{
+			if (TSharedPtr<FRuntimeChunkStoreDownloader> SharedThis = WeakThisPtr.Pin())
+			{
+				SharedThis->FetchDownloaders.Remove(FetchDownloader);
+			}
+
+			const FChunkFetch& Fetch = State->Fetches[FetchIndex];
+			if (Result.Result != EDownloadToMemoryResult::Success || Result.Data.Num() != Fetch.Range.Y - Fetch.Range.X + 1)
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download chunks {%lld; %lld} from %s"), Fetch.Range.X, Fetch.Range.Y, *Fetch.URL);
+				OnChunkFetchComplete(WeakThisPtr, State, FetchIndex, Result.Result == EDownloadToMemoryResult::Cancelled ? EDownloadToStorageResult::Cancelled : EDownloadToStorageResult::DownloadFailed);
+				return;
+			}
+
+			// Verify and store the chunks on a worker thread
+			Async(EAsyncExecution::ThreadPool, [WeakThisPtr, State, FetchIndex, Data = MoveTemp(Result.Data)]()
+			{
+				TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeChunkStoreDownloader::StoreChunks);
+
+				const FChunkFetch& Fetch = State->Fetches[FetchIndex];
+				TOptional<EDownloadToStorageResult> FailureResult;
+				if (TSharedPtr<FRuntimeChunkStoreDownloader> SharedThis = WeakThisPtr.Pin())
+				{
+					for (const FRuntimeChunkManifestChunk& Chunk : Fetch.Chunks)
+					{
+						const uint8* ChunkData = Data.GetData() + (Chunk.Offset - Fetch.Range.X);
+
+						FSHAHash ChunkHash;
+						FSHA1::HashBuffer(ChunkData, Chunk.Size, ChunkHash.Hash);
+						if (ChunkHash != Chunk.Hash)
+						{
+							UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("The chunk %s downloaded from %s does not match its hash"), *Chunk.Hash.ToString(), *Fetch.URL);
+							FailureResult = EDownloadToStorageResult::DownloadFailed;
+							break;
+						}
+
+						if (!SaveChunkAtomically(ChunkData, Chunk.Size, SharedThis->GetChunkPath(Chunk.Hash)))
+						{
+							UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to save the chunk %s to the chunk store '%s'"), *Chunk.Hash.ToString(), *SharedThis->StoreDirectory);
+							FailureResult = EDownloadToStorageResult::SaveFailed;
+							break;
+						}
+					}
+				}
+				else
+				{
+					FailureResult = EDownloadToStorageResult::Cancelled;
+				}
+
+				AsyncTask(ENamedThreads::GameThread, [WeakThisPtr, State, FetchIndex, FailureResult]()
+				{
+					OnChunkFetchComplete(WeakThisPtr, State, FetchIndex, FailureResult);
+				});
+			});
+		});
+	}
+
+	if (State->ActiveDownloads == 0 && (State->FailureResult.IsSet() || State->NextFetchIndex >= State->Fetches.Num()))
+	{
+		FetchDownloaders.Reset();
+		FinishInstall(WeakThisPtr, State);
+	}
+}
+
+void FRuntimeChunkStoreDownloader::OnChunkFetchComplete(const TWeakPtr<FRuntimeChunkStoreDownloader>& WeakThisPtr, const TSharedRef<FChunkFetchState>& State, int32 FetchIndex, TOptional<EDownloadToStorageResult> FailureResult)
+{
+	--State->ActiveDownloads;
+	State->ActiveBytes.Remove(FetchIndex);
+	if (!FailureResult.IsSet())
+	{
+		const FChunkFetch& Fetch = State->Fetches[FetchIndex];
+		State->CompletedBytes += Fetch.Range.Y - Fetch.Range.X + 1;
+	}
+
+	TSharedPtr<FRuntimeChunkStoreDownloader> SharedThis = WeakThisPtr.Pin();
+	if (!SharedThis.IsValid() && !FailureResult.IsSet())
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to download the files of the chunk manifest: downloader has been destroyed"));
+		FailureResult = EDownloadToStorageResult::Cancelled;
+	}
+
+	// The first failure stops the install, and the range requests still being downloaded are canceled
+	if (FailureResult.IsSet() && !State->FailureResult.IsSet())
+	{
+		State->FailureResult = FailureResult;
+		if (SharedThis.IsValid())
+		{
+			for (const TSharedPtr<FRuntimeChunkDownloader>& FetchDownloader : SharedThis->FetchDownloaders)
+			{
+				FetchDownloader->CancelDownload();
+			}
+		}
+	}
+
+	if (SharedThis.IsValid())
+	{
+		SharedThis->StartNextChunkFetches(State);
+	}
+	else if (State->ActiveDownloads == 0)
+	{
+		FinishInstall(WeakThisPtr, State);
+	}
+}
+
+void FRuntimeChunkStoreDownloader::FinishInstall(const TWeakPtr<FRuntimeChunkStoreDownloader>& WeakThisPtr, const TSharedRef<FChunkFetchState>& State)
+{
+	if (State->FailureResult.IsSet())
+	{
+		State->PromisePtr->SetValue(State->FailureResult.GetValue());
+		return;
+	}
+
+	if (State->OnProgress)
+	{
+		State->OnProgress(State->TotalBytes, State->TotalBytes);
+	}
+
+	Async(EAsyncExecution::ThreadPool, [WeakThisPtr, State]()
+	{
+		TSharedPtr<FRuntimeChunkStoreDownloader> SharedThis = WeakThisPtr.Pin();
+		const EDownloadToStorageResult AssembleResult = SharedThis.IsValid() ? SharedThis->AssembleFiles(State->Manifest, State->InstallDirectory) : EDownloadToStorageResult::Cancelled;
+
+		AsyncTask(ENamedThreads::GameThread, [State, AssembleResult]()
+		{
+			State->PromisePtr->SetValue(AssembleResult);
+		});
+	});
+}
+
+bool FRuntimeChunkStoreDownloader::LoadChunk(const FRuntimeChunkManifestChunk& Chunk, TArray64<uint8>& OutData) const
+{
+	const FString ChunkPath = GetChunkPath(Chunk.Hash);
+	if (IFileManager::Get().FileSize(*ChunkPath) != Chunk.Size || !FFileHelper::LoadFileToArray(OutData, *ChunkPath, FILEREAD_Silent) || OutData.Num() != Chunk.Size)
+	{
+		return false;
+	}
+
+	FSHAHash ChunkHash;
+	FSHA1::HashBuffer(OutData.GetData(), OutData.Num(), ChunkHash.Hash);
+	return ChunkHash == Chunk.Hash;
+}
+
+EDownloadToStorageResult FRuntimeChunkStoreDownloader::AssembleFiles(const FRuntimeChunkManifest& Manifest, const FString& InstallDirectory) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeChunkStoreDownloader::AssembleFiles);
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+
+	for (const FRuntimeChunkManifestFile& File : Manifest.Files)
+	{
+		// Manifests generated in code are not parsed, so their paths are checked here as well
+		if (!IsSafeRelativePath(File.Path))
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to reassemble the file '%s': the path is not a relative path inside the install directory"), *File.Path);
+			return EDownloadToStorageResult::SaveFailed;
+		}
+
+		const FString FilePath = InstallDirectory / File.Path;
+		const FString TempFilePath = FilePath + TEXT(".tmp");
+
+		const FString FileDirectory = FPaths::GetPath(FilePath);
+		if (!PlatformFile.DirectoryExists(*FileDirectory) && !PlatformFile.CreateDirectoryTree(*FileDirectory))
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to create a directory '%s' to reassemble the file"), *FileDirectory);
+			return EDownloadToStorageResult::DirectoryCreationFailed;
+		}
+
+		TUniquePtr<IFileHandle> FileHandle(PlatformFile.OpenWrite(*TempFilePath));
+		if (!FileHandle)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Something went wrong while saving the file '%s'"), *TempFilePath);
+			return EDownloadToStorageResult::SaveFailed;
+		}
+
+		TArray64<uint8> ChunkData;
+		for (const FRuntimeChunkManifestChunk& Chunk : File.Chunks)
+		{
+			// The chunks are verified again, since the store is shared and may have changed since they were checked
+			if (!LoadChunk(Chunk, ChunkData) || !FileHandle->Write(ChunkData.GetData(), ChunkData.Num()))
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to reassemble the file '%s' from the chunk %s"), *FilePath, *Chunk.Hash.ToString());
+				FileHandle.Reset();
+				PlatformFile.DeleteFile(*TempFilePath);
+				return EDownloadToStorageResult::SaveFailed;
+			}
+		}
+		FileHandle.Reset();
+
+		// Replace the existing file only once the new one is complete
+		if (PlatformFile.FileExists(*FilePath) && !PlatformFile.DeleteFile(*FilePath))
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Something went wrong while deleting the existing file '%s'"), *FilePath);
+			PlatformFile.DeleteFile(*TempFilePath);
+			return EDownloadToStorageResult::SaveFailed;
+		}
+
+		if (!PlatformFile.MoveFile(*FilePath, *TempFilePath))
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Something went wrong while moving the reassembled file to '%s'"), *FilePath);
+			return EDownloadToStorageResult::SaveFailed;
+		}
+	}
+
+	UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Successfully reassembled %d files from the chunk store in '%s'"), Manifest.Files.Num(), *InstallDirectory);
+	return EDownloadToStorageResult::Success;
+}
@@ -0,0 +1,567 @@
+// Georgy Treshchev 2024.
+
+#include "RuntimeDeltaDownloader.h"
+
+#include "FileToMemoryDownloader.h"
+#include "RuntimeFilesDownloaderDefines.h"
+#include "RuntimeFilesDownloaderProfiling.h"
+#include "Async/Async.h"
+#include "GenericPlatform/GenericPlatformFile.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/Paths.h"
+#include "Serialization/LargeMemoryReader.h"
+#include "Serialization/LargeMemoryWriter.h"
+
+namespace
+{
+	/** Magic number identifying the block signature binary format ("RFDS") */
+	constexpr uint32 BlockSignatureMagic = 0x53444652;
+
+	/** Version of the block signature binary format */
+	constexpr uint32 BlockSignatureVersion = 1;
+
+	/** The maximum size of a single range request, limited by the size of the HTTP response content array */
+	constexpr int64 MaxRangeSize = TNumericLimits<int32>::Max();
+
+	/** The size of the slices the local copy of a file is read in while matching its blocks */
+	constexpr int64 LocalReadSize = 4 * 1024 * 1024;
+
+	/** The size of the block signature binary format, excluding the blocks */
+	constexpr int64 BlockSignatureHeaderSize = sizeof(uint32) * 2 + sizeof(int64) + sizeof(int32) * 2 + sizeof(FSHAHash::Hash);
+
+	/** The size of a single block in the block signature binary format */
+	constexpr int64 BlockSignatureBlockSize = sizeof(uint32) + sizeof(FSHAHash::Hash);
+
+	/**
+	 * Provides the local data of a file through a window that only moves forward, either from memory or read from a file handle in slices
+	 * This way, the local copy does not have to be loaded as a whole to be matched against the block signature
+	 */
+	class FLocalDataWindow
+	{
+	public:
+		FLocalDataWindow(const uint8* InData, int64 InSize)
+			: Data(InData)
+			, Size(InSize)
+			, File(nullptr)
+			, BufferOffset(0)
+		{
+		}
+
+		explicit FLocalDataWindow(IFileHandle& InFile)
+			: Data(nullptr)
+			, Size(InFile.Size())
+			, File(&InFile)
+			, BufferOffset(0)
+		{
+		}
+
+		/**
+		 * Get the size of the local data in bytes
+		 */
+		int64 GetSize() const
+		{
+			return Size;
+		}
+
+		/**
+		 * Get the local data at the position. The returned pointer is only valid until the next call
+		 *
+		 * @param Position The position in the local data, not lower than in the previous calls
+		 * @param Count The number of bytes that must be available at the position
+		 * @return The data at the position, or nullptr if it could not be read
+		 */
+		const uint8* Get(int64 Position, int64 Count)
+		{
+			if (!File)
+			{
+				return Data + Position;
+			}
+
+			if (Position < BufferOffset || Position + Count > BufferOffset + Buffer.Num())
+			{
+				// The window holds at least twice the requested bytes, so that a block rolling byte by byte is not read again at every position when blocks are larger than the slices
+				const int64 BytesToRead = FMath::Min(FMath::Max(Count * 2, LocalReadSize), Size - Position);
+				BufferOffset = Position;
+				Buffer.SetNumUninitialized(FMath::Max<int64>(BytesToRead, 0));
+				if (BytesToRead < Count || !File->Seek(Position) || !File->Read(Buffer.GetData(), BytesToRead))
+				{
+					UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Unable to read %lld bytes at %lld of the local copy of the file"), Count, Position);
+					Buffer.Reset();
+					return nullptr;
+				}
+			}
+			return Buffer.GetData() + (Position - BufferOffset);
+		}
+
+	private:
+		/** The local data if it is in memory */
+		const uint8* Data;
+
+		/** The size of the local data in bytes */
+		int64 Size;
+
+		/** The local file if the data is read from it */
+		IFileHandle* File;
+
+		/** The position of the buffer in the local file */
+		int64 BufferOffset;
+
+		/** The slice of the local file that has been read */
+		TArray64<uint8> Buffer;
+	};
+
+	/**
+	 * Find the blocks of the signature that are present anywhere in the local data using the rolling checksum
+	 */
+	TArray<int64> FindMatchingBlocksInWindow(const FRuntimeBlockSignature& Signature, FLocalDataWindow& Window)
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeBlockSignature::FindMatchingBlocks);
+
+		const int32 BlockSize = Signature.BlockSize;
+		const int64 LocalSize = Window.GetSize();
+
+		TArray<int64> BlockSources;
+		BlockSources.Init(INDEX_NONE, Signature.GetBlockCount());
+
+		// Only full blocks are matched using the rolling checksum, the trailing partial block is always downloaded
+		const int32 FullBlockCount = static_cast<int32>(Signature.FileSize / BlockSize);
+		if (FullBlockCount == 0 || LocalSize < BlockSize)
+		{
+			return BlockSources;
+		}
+
+		TMultiMap<uint32, int32> WeakHashToBlocks;
+		for (int32 BlockIndex = 0; BlockIndex < FullBlockCount; ++BlockIndex)
+		{
+			WeakHashToBlocks.Add(Signature.WeakHashes[BlockIndex], BlockIndex);
+		}
+
+		uint32 A = 0, B = 0;
+		auto InitializeWindow = [&A, &B, &Window, BlockSize](int64 Position)
+		{
+			const uint8* LocalData = Window.Get(Position, BlockSize);
+			if (!LocalData)
+			{
+				return false;
+			}
+
+			A = 0;
+			B = 0;
+			for (int32 Index = 0; Index < BlockSize; ++Index)
+			{
+				A += LocalData[Index];
+				B += static_cast<uint32>(BlockSize - Index) * LocalData[Index];
+			}
+			return true;
+		};
+
+		int32 MatchedBlockCount = 0;
+		int64 Position = 0;
+		if (!InitializeWindow(Position))
+		{
+			return BlockSources;
+		}
+
+		while (Position + BlockSize <= LocalSize && MatchedBlockCount < FullBlockCount)
+		{
+			const uint32 WeakHash = (A & 0xFFFF) | ((B & 0xFFFF) << 16);
+
+			bool bMatched = false;
+			bool bStrongHashComputed = false;
+			FSHAHash StrongHash;
+			for (TMultiMap<uint32, int32>::TConstKeyIterator It = WeakHashToBlocks.CreateConstKeyIterator(WeakHash); It; ++It)
+			{
+				if (!bStrongHashComputed)
+				{
+					const uint8* BlockData = Window.Get(Position, BlockSize);
+					if (!BlockData)
+					{
+						return BlockSources;
+					}
+
+					FSHA1::HashBuffer(BlockData, BlockSize, StrongHash.Hash);
+					bStrongHashComputed = true;
+				}
+
+				const int32 BlockIndex = It.Value();
+				if (Signature.StrongHashes[BlockIndex] == StrongHash)
+				{
+					bMatched = true;
+					if (BlockSources[BlockIndex] == INDEX_NONE)
+					{
+						BlockSources[BlockIndex] = Position;
+						++MatchedBlockCount;
+					}
+				}
+			}
+
+			if (bMatched)
+			{
+				Position += BlockSize;
+				if (Position + BlockSize <= LocalSize && !InitializeWindow(Position))
+				{
+					break;
+				}
+				continue;
+			}
+
+			// Roll the window by one byte
+			if (Position + BlockSize < LocalSize)
+			{
+				const uint8* LocalData = Window.Get(Position, BlockSize + 1);
+				if (!LocalData)
+				{
+					break;
+				}
+
+				const uint32 OutByte = LocalData[0];
+				const uint32 InByte = LocalData[BlockSize];
+				A = A - OutByte + InByte;
+				B = B - static_cast<uint32>(BlockSize) * OutByte + A;
+			}
+			++Position;
+		}
+
+		return BlockSources;
+	}
+}
+
+FRuntimeBlockSignature FRuntimeBlockSignature::Generate(const uint8* Data, int64 Size, int32 BlockSize)
+{
+	FRuntimeBlockSignature Signature;
+	Signature.FileSize = Size;
+	Signature.BlockSize = FMath::Max(BlockSize, 1);
+
+	const int64 BlockCount = (Size + Signature.BlockSize - 1) / Signature.BlockSize;
+	Signature.WeakHashes.Reserve(BlockCount);
+	Signature.StrongHashes.Reserve(BlockCount);
+
+	for (int64 BlockOffset = 0; BlockOffset < Size; BlockOffset += Signature.BlockSize)
+	{
+		const int64 CurrentBlockSize = FMath::Min<int64>(Signature.BlockSize, Size - BlockOffset);
+		Signature.WeakHashes.Add(ComputeWeakHash(Data + BlockOffset, CurrentBlockSize));
+
+		FSHAHash& StrongHash = Signature.StrongHashes.AddDefaulted_GetRef();
+		FSHA1::HashBuffer(Data + BlockOffset, CurrentBlockSize, StrongHash.Hash);
+	}
+
+	FSHA1::HashBuffer(Data, Size, Signature.FileHash.Hash);
+	return Signature;
+}
+
+bool FRuntimeBlockSignature::FromBytes(const TArray64<uint8>& Bytes, FRuntimeBlockSignature& OutSignature)
+{
+	FLargeMemoryReader Reader(Bytes.GetData(), Bytes.Num());
+
+	uint32 Magic = 0, Version = 0;
+	int32 BlockCount = 0;
+	Reader << Magic << Version;
+	if (Reader.IsError() || Magic != BlockSignatureMagic || Version != BlockSignatureVersion)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to parse the block signature: unknown format (magic %u, version %u)"), Magic, Version);
+		return false;
+	}
+
+	Reader << OutSignature.FileSize << OutSignature.BlockSize << BlockCount;
+	if (Reader.IsError() || OutSignature.FileSize < 0 || OutSignature.BlockSize <= 0 || BlockCount < 0 || BlockCount != (OutSignature.FileSize + OutSignature.BlockSize - 1) / OutSignature.BlockSize)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to parse the block signature: invalid header (file size %lld, block size %d, block count %d)"), OutSignature.FileSize, OutSignature.BlockSize, BlockCount);
+		return false;
+	}
+
+	// The block count is checked against the size of the data before anything is allocated for the blocks
+	if (Bytes.Num() != BlockSignatureHeaderSize + BlockCount * BlockSignatureBlockSize)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to parse the block signature: its size (%lld) does not match the size of %d blocks"), Bytes.Num(), BlockCount);
+		return false;
+	}
+
+	OutSignature.WeakHashes.SetNumUninitialized(BlockCount);
+	OutSignature.StrongHashes.SetNum(BlockCount);
+	for (int32 BlockIndex = 0; BlockIndex < BlockCount; ++BlockIndex)
+	{
+		Reader << OutSignature.WeakHashes[BlockIndex];
+		Reader.Serialize(OutSignature.StrongHashes[BlockIndex].Hash, sizeof(FSHAHash::Hash));
+	}
+	Reader.Serialize(OutSignature.FileHash.Hash, sizeof(FSHAHash::Hash));
+
+	if (Reader.IsError())
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to parse the block signature: the data is truncated"));
+		return false;
+	}
+
+	return true;
+}
+
+TArray64<uint8> FRuntimeBlockSignature::ToBytes() const
+{
+	FLargeMemoryWriter Writer;
+
+	uint32 Magic = BlockSignatureMagic, Version = BlockSignatureVersion;
+	int64 SerializedFileSize = FileSize;
+	int32 SerializedBlockSize = BlockSize, BlockCount = GetBlockCount();
+	Writer << Magic << Version << SerializedFileSize << SerializedBlockSize << BlockCount;
+
+	for (int32 BlockIndex = 0; BlockIndex < BlockCount; ++BlockIndex)
+	{
+		uint32 WeakHash = WeakHashes[BlockIndex];
+		Writer << WeakHash;
+		Writer.Serialize(const_cast<uint8*>(StrongHashes[BlockIndex].Hash), sizeof(FSHAHash::Hash));
+	}
+	Writer.Serialize(const_cast<uint8*>(FileHash.Hash), sizeof(FSHAHash::Hash));
+
+	return TArray64<uint8>(Writer.GetData(), Writer.TotalSize());
+}
+
+uint32 FRuntimeBlockSignature::ComputeWeakHash(const uint8* Data, int64 Size)
+{
+	uint32 A = 0, B = 0;
+	for (int64 Index = 0; Index < Size; ++Index)
+	{
+		A += Data[Index];
+		B += static_cast<uint32>(Size - Index) * Data[Index];
+	}
+	return (A & 0xFFFF) | ((B & 0xFFFF) << 16);
+}
+
+TArray<int64> FRuntimeBlockSignature::FindMatchingBlocks(const uint8* LocalData, int64 LocalSize) const
+{
+	FLocalDataWindow Window(LocalData, LocalSize);
+	return FindMatchingBlocksInWindow(*this, Window);
+}
+
+TArray<int64> FRuntimeBlockSignature::FindMatchingBlocks(IFileHandle& LocalFile) const
+{
+	FLocalDataWindow Window(LocalFile);
+	return FindMatchingBlocksInWindow(*this, Window);
+}
+
+TFuture<FRuntimeChunkDownloaderResult> FRuntimeDeltaDownloader::DownloadFileDelta(const FString& URL, const FString& SignatureURL, const FString& LocalFilePath, float Timeout, const FString& ContentType, const FOnProgress& OnProgress)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeDeltaDownloader::DownloadFileDelta);
+
+	if (bCanceled)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled delta file download from %s"), *URL);
+		return MakeFulfilledPromise<FRuntimeChunkDownloaderResult>(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::Cancelled, TArray64<uint8>()}).GetFuture();
+	}
+
+	if (!FPaths::FileExists(LocalFilePath))
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("There is no local copy of the file at '%s' to update. Downloading the whole file from %s"), *LocalFilePath, *URL);
+		return DownloadFile(URL, Timeout, ContentType, MaxRangeSize, OnProgress);
+	}
+
+	MarkDownloadStarted();
+
+	TSharedPtr<TPromise<FRuntimeChunkDownloaderResult>> PromisePtr = MakeShared<TPromise<FRuntimeChunkDownloaderResult>>();
+	TWeakPtr<FRuntimeDeltaDownloader> WeakThisPtr = StaticCastSharedRef<FRuntimeDeltaDownloader>(AsShared());
+
+	DownloadFile(SignatureURL, Timeout, FString(), MaxRangeSize, [](int64, int64) {}).Next([WeakThisPtr, PromisePtr, URL, SignatureURL, LocalFilePath, Timeout, ContentType, OnProgress](FRuntimeChunkDownloaderResult&& SignatureResult)
+	{
+		TSharedPtr<FRuntimeDeltaDownloader> SharedThis = WeakThisPtr.Pin();
+		if (!SharedThis.IsValid())
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to download delta file from %s: downloader has been destroyed"), *URL);
+			PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, TArray64<uint8>()});
+			return;
+		}
+
+		if (SharedThis->bCanceled)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled delta file download from %s"), *URL);
+			PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::Cancelled, TArray64<uint8>()});
+			return;
+		}
+
+		TSharedPtr<FRuntimeBlockSignature> SignaturePtr = MakeShared<FRuntimeBlockSignature>();
+		if ((SignatureResult.Result != EDownloadToMemoryResult::Success && SignatureResult.Result != EDownloadToMemoryResult::SucceededByPayload) || !FRuntimeBlockSignature::FromBytes(SignatureResult.Data, *SignaturePtr))
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Unable to get the block signature from %s. Downloading the whole file from %s"), *SignatureURL, *URL);
+			SharedThis->DownloadWholeFile(PromisePtr, URL, Timeout, ContentType, OnProgress);
+			return;
+		}
+
+		// The file size of the signature is checked against the file on the server before a buffer of that size is allocated, so the file is downloaded as a whole if its size is unknown
+		SharedThis->GetContentInfo(URL, Timeout).Next([WeakThisPtr, PromisePtr, URL, LocalFilePath, Timeout, ContentType, OnProgress, SignaturePtr](const FRuntimeContentInfo& ContentInfo)
+		{
+			TSharedPtr<FRuntimeDeltaDownloader> ContentInfoSharedThis = WeakThisPtr.Pin();
+			if (!ContentInfoSharedThis.IsValid())
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to download delta file from %s: downloader has been destroyed"), *URL);
+				PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, TArray64<uint8>()});
+				return;
+			}
+
+			if (ContentInfo.Size <= 0)
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Unable to verify the file size of %lld bytes described by the block signature. Downloading the whole file from %s"), SignaturePtr->FileSize, *URL);
+				ContentInfoSharedThis->DownloadWholeFile(PromisePtr, URL, Timeout, ContentType, OnProgress);
+				return;
+			}
+
+			if (ContentInfo.Size != SignaturePtr->FileSize)
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("The block signature describes a file of %lld bytes, but the file on the server has %lld bytes. Downloading the whole file from %s"), SignaturePtr->FileSize, ContentInfo.Size, *URL);
+				ContentInfoSharedThis->DownloadWholeFile(PromisePtr, URL, Timeout, ContentType, OnProgress);
+				return;
+			}
+
+			ContentInfoSharedThis->ReuseLocalBlocks(PromisePtr, URL, LocalFilePath, Timeout, ContentType, OnProgress, SignaturePtr);
+		});
+	});
+
+	return PromisePtr->GetFuture();
+}
+
+void FRuntimeDeltaDownloader::ReuseLocalBlocks(const TSharedPtr<TPromise<FRuntimeChunkDownloaderResult>>& PromisePtr, const FString& URL, const FString& LocalFilePath, float Timeout, const FString& ContentType, const FOnProgress& OnProgress, const TSharedPtr<FRuntimeBlockSignature>& SignaturePtr)
+{
+	TWeakPtr<FRuntimeDeltaDownloader> WeakThisPtr = StaticCastSharedRef<FRuntimeDeltaDownloader>(AsShared());
+
+	// Match the local copy against the signature and assemble the reused blocks on a worker thread, reading the local copy in slices instead of loading it as a whole
+	Async(EAsyncExecution::ThreadPool, [WeakThisPtr, PromisePtr, URL, LocalFilePath, Timeout, ContentType, OnProgress, SignaturePtr]()
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeDeltaDownloader::ReuseLocalBlocks);
+		RUNTIMEFILESDOWNLOADER_LLM_SCOPE;
+
+		TUniquePtr<IFileHandle> LocalFile(FPlatformFileManager::Get().GetPlatformFile().OpenRead(*LocalFilePath));
+		TArray<int64> BlockSources;
+		if (LocalFile.IsValid())
+		{
+			BlockSources = SignaturePtr->FindMatchingBlocks(*LocalFile);
+		}
+		else
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Unable to open the local copy of the file at '%s'"), *LocalFilePath);
+			BlockSources.Init(INDEX_NONE, SignaturePtr->GetBlockCount());
+		}
+
+		TSharedPtr<TArray64<uint8>> DataPtr = MakeShared<TArray64<uint8>>();
+		DataPtr->SetNumUninitialized(SignaturePtr->FileSize);
+
+		TSharedPtr<TArray<FInt64Vector2>> MissingRanges = MakeShared<TArray<FInt64Vector2>>();
+		int64 ReusedBytes = 0;
+		for (int32 BlockIndex = 0; BlockIndex < BlockSources.Num(); ++BlockIndex)
+		{
+			const int64 BlockOffset = static_cast<int64>(BlockIndex) * SignaturePtr->BlockSize;
+			const int64 CurrentBlockSize = FMath::Min<int64>(SignaturePtr->BlockSize, SignaturePtr->FileSize - BlockOffset);
+
+			// A block that cannot be read from the local copy is downloaded instead
+			if (BlockSources[BlockIndex] != INDEX_NONE && LocalFile->Seek(BlockSources[BlockIndex]) && LocalFile->Read(DataPtr->GetData() + BlockOffset, CurrentBlockSize))
+			{
+				ReusedBytes += CurrentBlockSize;
+				continue;
+			}
+
+			// Merge adjacent missing blocks into a single range request
+			const int64 BlockEnd = BlockOffset + CurrentBlockSize - 1;
+			if (MissingRanges->Num() > 0 && MissingRanges->Last().Y + 1 == BlockOffset && BlockEnd - MissingRanges->Last().X + 1 <= MaxRangeSize)
+			{
+				MissingRanges->Last().Y = BlockEnd;
+			}
+			else
+			{
+				MissingRanges->Add(FInt64Vector2(BlockOffset, BlockEnd));
+			}
+		}
+		LocalFile.Reset();
+
+		UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Reusing %lld of %lld bytes from the local copy '%s'. Requesting %d ranges from %s"), ReusedBytes, SignaturePtr->FileSize, *LocalFilePath, MissingRanges->Num(), *URL);
+
+		AsyncTask(ENamedThreads::GameThread, [WeakThisPtr, PromisePtr, URL, Timeout, ContentType, OnProgress, SignaturePtr, DataPtr, MissingRanges, ReusedBytes]()
+		{
+			RUNTIMEFILESDOWNLOADER_GAME_THREAD_SCOPE;
+
+			TSharedPtr<FRuntimeDeltaDownloader> SharedThis = WeakThisPtr.Pin();
+			if (!SharedThis.IsValid())
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to download delta file from %s: downloader has been destroyed"), *URL);
+				PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, TArray64<uint8>()});
+				return;
+			}
+
+			SharedThis->AllocatedBufferMemory = SignaturePtr->FileSize;
+			SharedThis->DownloadMissingRanges(URL, Timeout, ContentType, DataPtr, MissingRanges, ReusedBytes, OnProgress).Next([WeakThisPtr, PromisePtr, URL, Timeout, ContentType, OnProgress, SignaturePtr, DataPtr](EDownloadToMemoryResult Result)
+			{
+				TSharedPtr<FRuntimeDeltaDownloader> InternalSharedThis = WeakThisPtr.Pin();
+				if (!InternalSharedThis.IsValid() || Result == EDownloadToMemoryResult::Cancelled)
+				{
+					PromisePtr->SetValue(FRuntimeChunkDownloaderResult{Result == EDownloadToMemoryResult::Cancelled ? Result : EDownloadToMemoryResult::DownloadFailed, TArray64<uint8>()});
+					return;
+				}
+
+				if (Result != EDownloadToMemoryResult::Success)
+				{
+					UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Unable to download the changed blocks. Downloading the whole file from %s"), *URL);
+					InternalSharedThis->Stats.BytesWasted = InternalSharedThis->Stats.BytesReceived;
+					++InternalSharedThis->Stats.RetryCount;
+					InternalSharedThis->DownloadWholeFile(PromisePtr, URL, Timeout, ContentType, OnProgress);
+					return;
+				}
+
+				// The reassembled file is hashed on a worker thread, since it can be large
+				Async(EAsyncExecution::ThreadPool, [WeakThisPtr, PromisePtr, URL, Timeout, ContentType, OnProgress, SignaturePtr, DataPtr]()
+				{
+					TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeDeltaDownloader::VerifyFileHash);
+
+					FSHAHash FileHash;
+					FSHA1::HashBuffer(DataPtr->GetData(), DataPtr->Num(), FileHash.Hash);
+					const bool bFileHashMatches = FileHash == SignaturePtr->FileHash;
+
+					AsyncTask(ENamedThreads::GameThread, [WeakThisPtr, PromisePtr, URL, Timeout, ContentType, OnProgress, DataPtr, bFileHashMatches]()
+					{
+						RUNTIMEFILESDOWNLOADER_GAME_THREAD_SCOPE;
+
+						TSharedPtr<FRuntimeDeltaDownloader> VerifiedSharedThis = WeakThisPtr.Pin();
+						if (!VerifiedSharedThis.IsValid())
+						{
+							UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to download delta file from %s: downloader has been destroyed"), *URL);
+							PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::DownloadFailed, TArray64<uint8>()});
+							return;
+						}
+
+						if (!bFileHashMatches)
+						{
+							UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("The file reassembled from the local copy and the changed blocks does not match the signature. Downloading the whole file from %s"), *URL);
+							VerifiedSharedThis->Stats.BytesWasted = VerifiedSharedThis->Stats.BytesReceived;
+							++VerifiedSharedThis->Stats.RetryCount;
+							VerifiedSharedThis->DownloadWholeFile(PromisePtr, URL, Timeout, ContentType, OnProgress);
+							return;
+						}
+
+						UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Successfully downloaded delta file from %s"), *URL);
+						PromisePtr->SetValue(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::Success, MoveTemp(*DataPtr)});
+					});
+				});
+			});
+		});
+	});
+}
+
+void FRuntimeDeltaDownloader::DownloadWholeFile(const TSharedPtr<TPromise<FRuntimeChunkDownloaderResult>>& PromisePtr, const FString& URL, float Timeout, const FString& ContentType, const FOnProgress& OnProgress)
+{
+	DownloadFile(URL, Timeout, ContentType, MaxRangeSize, OnProgress).Next([PromisePtr](FRuntimeChunkDownloaderResult&& Result)
+	{
+		PromisePtr->SetValue(MoveTemp(Result));
+	});
+}
+
+TFuture<EDownloadToMemoryResult> FRuntimeDeltaDownloader::DownloadMissingRanges(const FString& URL, float Timeout, const FString& ContentType, const TSharedPtr<TArray64<uint8>>& DataPtr, const TSharedPtr<TArray<FInt64Vector2>>& MissingRanges, int64 ReusedBytes, const FOnProgress& OnProgress)
+{
+	const int64 FileSize = DataPtr->Num();
+	if (MissingRanges->Num() == 0)
+	{
+		OnProgress(FileSize, FileSize);
+		return MakeFulfilledPromise<EDownloadToMemoryResult>(EDownloadToMemoryResult::Success).GetFuture();
+	}
+
+	return DownloadFileByRanges(URL, Timeout, ContentType, *MissingRanges, 0, [OnProgress, ReusedBytes, FileSize](int64 BytesReceived, int64 TotalBytes)
+	{
+		OnProgress(ReusedBytes + BytesReceived, FileSize);
+	}, [DataPtr](FInt64Vector2 Range, TArray64<uint8>&& RangeData)
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeDeltaDownloader::CopyRange);
+		FMemory::Memcpy(DataPtr->GetData() + Range.X, RangeData.GetData(), RangeData.Num());
+	});
+}
@@ -0,0 +1,765 @@
+// Georgy Treshchev 2024.
+
+#include "RuntimeDirectorySync.h"
+
+#include "FileToMemoryDownloader.h"
+#include "FileToStorageDownloader.h"
+#include "RuntimeDownloadHandle.h"
+#include "RuntimeFilesDownloaderDefines.h"
+#include "RuntimeFilesDownloaderProfiling.h"
+#include "RuntimeFilesDownloaderSettings.h"
+#include "Async/Async.h"
+#include "Dom/JsonObject.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+
+namespace
+{
+	/** The name of the directory inside the synced directory where the sync keeps its metadata */
+	const TCHAR* SyncMetadataDirectoryName = TEXT(".runtimesync");
+
+	/** The size of the blocks local files are hashed by */
+	constexpr int64 HashBlockSize = 1024 * 1024;
+
+	/**
+	 * Check whether the path stays inside the synced directory
+	 */
+	bool IsSafeRelativePath(const FString& Path)
+	{
+		return !Path.IsEmpty() && FPaths::IsRelative(Path) && !Path.StartsWith(TEXT("/")) && !Path.Contains(TEXT("..")) && !Path.StartsWith(SyncMetadataDirectoryName);
+	}
+
+	/**
+	 * Save the string to the file by writing a temporary file first and moving it into place, so that the file is never partially written
+	 */
+	bool SaveStringToFileAtomically(const FString& String, const FString& FilePath)
+	{
+		const FString TempFilePath = FilePath + TEXT(".tmp");
+		if (!FFileHelper::SaveStringToFile(String, *TempFilePath))
+		{
+			return false;
+		}
+		return IFileManager::Get().Move(*FilePath, *TempFilePath, true);
+	}
+
+	/**
+	 * Serialize the JSON object to a string
+	 */
+	FString SerializeJson(const TSharedRef<FJsonObject>& RootObject)
+	{
+		FString JsonString;
+		const TSharedRef<TJsonWriter<>> JsonWriter = TJsonWriterFactory<>::Create(&JsonString);
+		FJsonSerializer::Serialize(RootObject, JsonWriter);
+		return JsonString;
+	}
+
+	/**
+	 * Load and deserialize the JSON object from the file
+	 */
+	TSharedPtr<FJsonObject> LoadJsonFile(const FString& FilePath)
+	{
+		FString JsonString;
+		if (!FFileHelper::LoadFileToString(JsonString, *FilePath))
+		{
+			return nullptr;
+		}
+
+		TSharedPtr<FJsonObject> RootObject;
+		const TSharedRef<TJsonReader<>> JsonReader = TJsonReaderFactory<>::Create(JsonString);
+		if (!FJsonSerializer::Deserialize(JsonReader, RootObject))
+		{
+			return nullptr;
+		}
+		return RootObject;
+	}
+}
+
+bool FRuntimeSyncManifest::FromJson(const FString& JsonString, const FString& BaseURL, FRuntimeSyncManifest& OutManifest)
+{
+	TSharedPtr<FJsonObject> RootObject;
+	const TSharedRef<TJsonReader<>> JsonReader = TJsonReaderFactory<>::Create(JsonString);
+	if (!FJsonSerializer::Deserialize(JsonReader, RootObject) || !RootObject.IsValid())
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to parse the sync manifest: invalid JSON"));
+		return false;
+	}
+
+	const TArray<TSharedPtr<FJsonValue>>* FileValues;
+	if (!RootObject->TryGetArrayField(TEXT("Files"), FileValues))
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to parse the sync manifest: there is no 'Files' array"));
+		return false;
+	}
+
+	OutManifest.Files.Reset(FileValues->Num());
+	for (const TSharedPtr<FJsonValue>& FileValue : *FileValues)
+	{
+		const TSharedPtr<FJsonObject>* FileObject;
+		FString HashString;
+		double FileSize = 0;
+		FRuntimeSyncManifestFile& File = OutManifest.Files.AddDefaulted_GetRef();
+		if (!FileValue->TryGetObject(FileObject)
+			|| !(*FileObject)->TryGetStringField(TEXT("Path"), File.Path)
+			|| !(*FileObject)->TryGetNumberField(TEXT("Size"), FileSize)
+			|| !(*FileObject)->TryGetStringField(TEXT("Hash"), HashString)
+			|| HashString.Len() != sizeof(FSHAHash::Hash) * 2
+			|| FileSize < 0)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to parse the sync manifest: file entry %d is invalid"), OutManifest.Files.Num() - 1);
+			return false;
+		}
+
+		File.Path.ReplaceInline(TEXT("\\"), TEXT("/"));
+		if (!IsSafeRelativePath(File.Path))
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to parse the sync manifest: the path '%s' is not a relative path inside the synced directory"), *File.Path);
+			return false;
+		}
+
+		if (!(*FileObject)->TryGetStringField(TEXT("URL"), File.URL) || File.URL.IsEmpty())
+		{
+			if (BaseURL.IsEmpty())
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to parse the sync manifest: the file '%s' has no URL and there is no base URL to resolve it against"), *File.Path);
+				return false;
+			}
+			File.URL = BaseURL / File.Path;
+		}
+
+		File.Size = static_cast<int64>(FileSize);
+		File.Hash.FromString(HashString);
+	}
+
+	return true;
+}
+
+FString FRuntimeSyncManifest::ToJson() const
+{
+	TArray<TSharedPtr<FJsonValue>> FileValues;
+	FileValues.Reserve(Files.Num());
+	for (const FRuntimeSyncManifestFile& File : Files)
+	{
+		TSharedRef<FJsonObject> FileObject = MakeShared<FJsonObject>();
+		FileObject->SetStringField(TEXT("Path"), File.Path);
+		FileObject->SetStringField(TEXT("URL"), File.URL);
+		FileObject->SetNumberField(TEXT("Size"), static_cast<double>(File.Size));
+		FileObject->SetStringField(TEXT("Hash"), File.Hash.ToString());
+		FileValues.Add(MakeShared<FJsonValueObject>(FileObject));
+	}
+
+	TSharedRef<FJsonObject> RootObject = MakeShared<FJsonObject>();
+	RootObject->SetArrayField(TEXT("Files"), FileValues);
+	return SerializeJson(RootObject);
+}
+
+TFuture<EDownloadToStorageResult> FRuntimeDirectorySyncDownloader::SyncDirectory(const FRuntimeSyncManifest& Manifest, const FString& LocalDirectory, float Timeout, const FString& ContentType, int32 MaxConcurrentDownloads, const FOnProgress& OnProgress)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeDirectorySyncDownloader::SyncDirectory);
+
+	if (bCanceled)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled syncing the directory '%s'"), *LocalDirectory);
+		return MakeFulfilledPromise<EDownloadToStorageResult>(EDownloadToStorageResult::Cancelled).GetFuture();
+	}
+
+	if (LocalDirectory.IsEmpty())
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("You have not provided a directory to sync"));
+		return MakeFulfilledPromise<EDownloadToStorageResult>(EDownloadToStorageResult::InvalidSavePath).GetFuture();
+	}
+
+	MarkDownloadStarted();
+
+	TSharedRef<FSyncDownloadState> State = MakeShared<FSyncDownloadState>();
+	State->Manifest = Manifest;
+	State->LocalDirectory = FPaths::ConvertRelativePathToFull(LocalDirectory);
+	FPaths::NormalizeDirectoryName(State->LocalDirectory);
+	State->Timeout = FMath::Max(Timeout, 0.0f);
+	State->ContentType = ContentType;
+	State->MaxConcurrentDownloads = FMath::Max(MaxConcurrentDownloads, 1);
+	State->OnProgress = OnProgress;
+	State->PromisePtr = MakeShared<TPromise<EDownloadToStorageResult>>();
+
+	TWeakPtr<FRuntimeDirectorySyncDownloader> WeakThisPtr = StaticCastSharedRef<FRuntimeDirectorySyncDownloader>(AsShared());
+
+	// Comparing the directory with the manifest touches every local file, so it is done on a worker thread
+	Async(EAsyncExecution::ThreadPool, [WeakThisPtr, State]()
+	{
+		auto CompleteOnGameThread = [State](EDownloadToStorageResult Result)
+		{
+			AsyncTask(ENamedThreads::GameThread, [State, Result]()
+			{
+				State->PromisePtr->SetValue(Result);
+			});
+		};
+
+		// A commit interrupted by a previous sync is completed first, so that the directory is compared in a consistent state
+		if (!ApplyCommitJournal(State->LocalDirectory))
+		{
+			CompleteOnGameThread(EDownloadToStorageResult::SaveFailed);
+			return;
+		}
+
+		State->Plan = CreateSyncPlan(State->Manifest, State->LocalDirectory);
+
+		if (State->Plan.TotalBytes > 0 && GetDefault<URuntimeFilesDownloaderSettings>()->bCheckDiskSpaceBeforeDownload)
+		{
+			const FString StagingPath = GetSyncMetadataDirectory(State->LocalDirectory) / TEXT("Staging");
+			const ERuntimeStorageAdmissionResult AdmissionResult = FRuntimeStorageAdmission::Get().Reserve(StagingPath, State->Plan.TotalBytes, State->Reservation);
+			if (AdmissionResult != ERuntimeStorageAdmissionResult::Admitted)
+			{
+				CompleteOnGameThread(AdmissionResult == ERuntimeStorageAdmissionResult::QuotaExceeded ? EDownloadToStorageResult::QuotaExceeded : EDownloadToStorageResult::NotEnoughSpace);
+				return;
+			}
+		}
+
+		AsyncTask(ENamedThreads::GameThread, [WeakThisPtr, State]()
+		{
+			TSharedPtr<FRuntimeDirectorySyncDownloader> SharedThis = WeakThisPtr.Pin();
+			if (!SharedThis.IsValid() || SharedThis->bCanceled)
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled syncing the directory '%s'"), *State->LocalDirectory);
+				State->PromisePtr->SetValue(EDownloadToStorageResult::Cancelled);
+				return;
+			}
+
+			UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Syncing the directory '%s' with %d files: downloading %d files (%lld bytes), deleting %d stale files"),
+			       *State->LocalDirectory, State->Manifest.Files.Num(), State->Plan.FilesToDownload.Num(), State->Plan.TotalBytes, State->Plan.StaleFiles.Num());
+			SharedThis->StartNextDownloads(State);
+		});
+	});
+
+	return State->PromisePtr->GetFuture();
+}
+
+TFuture<EDownloadToStorageResult> FRuntimeDirectorySyncDownloader::SyncDirectoryFromURL(const FString& ManifestURL, const FString& LocalDirectory, float Timeout, const FString& ContentType, int32 MaxConcurrentDownloads, const FOnProgress& OnProgress)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeDirectorySyncDownloader::SyncDirectoryFromURL);
+
+	if (ManifestURL.IsEmpty())
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("You have not provided an URL to download the sync manifest"));
+		return MakeFulfilledPromise<EDownloadToStorageResult>(EDownloadToStorageResult::InvalidURL).GetFuture();
+	}
+
+	TSharedPtr<TPromise<EDownloadToStorageResult>> PromisePtr = MakeShared<TPromise<EDownloadToStorageResult>>();
+	TWeakPtr<FRuntimeDirectorySyncDownloader> WeakThisPtr = StaticCastSharedRef<FRuntimeDirectorySyncDownloader>(AsShared());
+
+	DownloadFileByPayload(ManifestURL, Timeout, FString(), [](int64, int64) {}).Next([WeakThisPtr, PromisePtr, ManifestURL, LocalDirectory, Timeout, ContentType, MaxConcurrentDownloads, OnProgress](FRuntimeChunkDownloaderResult&& Result)
+	{
+		TSharedPtr<FRuntimeDirectorySyncDownloader> SharedThis = WeakThisPtr.Pin();
+		if (!SharedThis.IsValid())
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to sync the directory '%s': downloader has been destroyed"), *LocalDirectory);
+			PromisePtr->SetValue(EDownloadToStorageResult::Cancelled);
+			return;
+		}
+
+		if (Result.Result != EDownloadToMemoryResult::Success && Result.Result != EDownloadToMemoryResult::SucceededByPayload)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download the sync manifest from %s"), *ManifestURL);
+			PromisePtr->SetValue(Result.Result == EDownloadToMemoryResult::Cancelled ? EDownloadToStorageResult::Cancelled : EDownloadToStorageResult::DownloadFailed);
+			return;
+		}
+
+		// A manifest of many files takes a while to parse, so it is parsed on a worker thread
+		Async(EAsyncExecution::ThreadPool, [WeakThisPtr, PromisePtr, ManifestURL, LocalDirectory, Timeout, ContentType, MaxConcurrentDownloads, OnProgress, Data = MoveTemp(Result.Data)]()
+		{
+			TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeDirectorySyncDownloader::ParseManifest);
+
+			int32 BaseURLLength = INDEX_NONE;
+			const FString BaseURL = ManifestURL.FindLastChar(TEXT('/'), BaseURLLength) ? ManifestURL.Left(BaseURLLength) : FString();
+			const FUTF8ToTCHAR JsonConverter(reinterpret_cast<const ANSICHAR*>(Data.GetData()), static_cast<int32>(Data.Num()));
+			const FString JsonString(JsonConverter.Length(), JsonConverter.Get());
+
+			FRuntimeSyncManifest Manifest;
+			if (!FRuntimeSyncManifest::FromJson(JsonString, BaseURL, Manifest))
+			{
+				AsyncTask(ENamedThreads::GameThread, [PromisePtr]()
+				{
+					PromisePtr->SetValue(EDownloadToStorageResult::DownloadFailed);
+				});
+				return;
+			}
+
+			AsyncTask(ENamedThreads::GameThread, [WeakThisPtr, PromisePtr, LocalDirectory, Timeout, ContentType, MaxConcurrentDownloads, OnProgress, Manifest = MoveTemp(Manifest)]()
+			{
+				TSharedPtr<FRuntimeDirectorySyncDownloader> ParsedSharedThis = WeakThisPtr.Pin();
+				if (!ParsedSharedThis.IsValid())
+				{
+					UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to sync the directory '%s': downloader has been destroyed"), *LocalDirectory);
+					PromisePtr->SetValue(EDownloadToStorageResult::Cancelled);
+					return;
+				}
+
+				if (ParsedSharedThis->bCanceled)
+				{
+					UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Canceled syncing the directory '%s'"), *LocalDirectory);
+					PromisePtr->SetValue(EDownloadToStorageResult::Cancelled);
+					return;
+				}
+
+				ParsedSharedThis->SyncDirectory(Manifest, LocalDirectory, Timeout, ContentType, MaxConcurrentDownloads, OnProgress).Next([PromisePtr](EDownloadToStorageResult SyncResult)
+				{
+					PromisePtr->SetValue(SyncResult);
+				});
+			});
+		});
+	});
+
+	return PromisePtr->GetFuture();
+}
+
+void FRuntimeDirectorySyncDownloader::CancelDownload()
+{
+	FRuntimeChunkDownloader::CancelDownload();
+	for (const TSharedPtr<FRuntimeChunkDownloader>& FileDownloader : FileDownloaders)
+	{
+		FileDownloader->CancelDownload();
+	}
+}
+
+void FRuntimeDirectorySyncDownloader::PauseDownload()
+{
+	FRuntimeChunkDownloader::PauseDownload();
+	for (const TSharedPtr<FRuntimeChunkDownloader>& FileDownloader : FileDownloaders)
+	{
+		FileDownloader->PauseDownload();
+	}
+}
+
+void FRuntimeDirectorySyncDownloader::ResumeDownload()
+{
+	FRuntimeChunkDownloader::ResumeDownload();
+	for (const TSharedPtr<FRuntimeChunkDownloader>& FileDownloader : FileDownloaders)
+	{
+		FileDownloader->ResumeDownload();
+	}
+}
+
+FRuntimeDirectorySyncDownloader::FSyncPlan FRuntimeDirectorySyncDownloader::CreateSyncPlan(const FRuntimeSyncManifest& Manifest, const FString& LocalDirectory)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeDirectorySyncDownloader::CreateSyncPlan);
+
+	FSyncPlan Plan;
+	const TMap<FString, FLocalFileState> CachedFileStates = LoadFileStates(LocalDirectory);
+
+	// A single pass over the directory gathers the metadata of all the local files, instead of querying each file separately
+	TMap<FString, FFileStatData> LocalFiles;
+	{
+		const FString DirectoryPrefix = LocalDirectory + TEXT("/");
+		const FString MetadataPrefix = DirectoryPrefix + SyncMetadataDirectoryName + TEXT("/");
+		IFileManager::Get().IterateDirectoryStatRecursively(*LocalDirectory, [&LocalFiles, &DirectoryPrefix, &MetadataPrefix](const TCHAR* FilenameOrDirectory, const FFileStatData& StatData)
+		{
+			FString FilePath = FilenameOrDirectory;
+			FilePath.ReplaceInline(TEXT("\\"), TEXT("/"));
+			if (!StatData.bIsDirectory && FilePath.StartsWith(DirectoryPrefix) && !FilePath.StartsWith(MetadataPrefix))
+			{
+				LocalFiles.Add(FilePath.RightChop(DirectoryPrefix.Len()), StatData);
+			}
+			return true;
+		});
+	}
+
+	for (int32 FileIndex = 0; FileIndex < Manifest.Files.Num(); ++FileIndex)
+	{
+		const FRuntimeSyncManifestFile& File = Manifest.Files[FileIndex];
+
+		bool bUpToDate = false;
+		const FFileStatData* LocalFile = LocalFiles.Find(File.Path);
+		if (LocalFile && LocalFile->FileSize == File.Size)
+		{
+			// The file is only hashed if it was changed since the cached hash was computed
+			const FLocalFileState* CachedFileState = CachedFileStates.Find(File.Path);
+			FLocalFileState FileState;
+			bool bHashed = true;
+			if (CachedFileState && CachedFileState->Size == LocalFile->FileSize && CachedFileState->ModificationTime == LocalFile->ModificationTime)
+			{
+				FileState = *CachedFileState;
+			}
+			else
+			{
+				FileState.Size = LocalFile->FileSize;
+				FileState.ModificationTime = LocalFile->ModificationTime;
+				bHashed = HashFile(LocalDirectory / File.Path, FileState.Hash);
+				Plan.bFileStatesChanged = true;
+			}
+
+			if (bHashed && FileState.Hash == File.Hash)
+			{
+				Plan.FileStates.Add(File.Path, FileState);
+				bUpToDate = true;
+			}
+		}
+
+		if (!bUpToDate)
+		{
+			Plan.FilesToDownload.Add(FileIndex);
+			Plan.TotalBytes += File.Size;
+		}
+		LocalFiles.Remove(File.Path);
+	}
+
+	LocalFiles.GetKeys(Plan.StaleFiles);
+	Plan.bFileStatesChanged |= Plan.FileStates.Num() != CachedFileStates.Num();
+	return Plan;
+}
+
+void FRuntimeDirectorySyncDownloader::StartNextDownloads(const TSharedRef<FSyncDownloadState>& State)
+{
+	if (bCanceled && !State->FailureResult.IsSet())
+	{
+		State->FailureResult = EDownloadToStorageResult::Cancelled;
+	}
+
+	TWeakPtr<FRuntimeDirectorySyncDownloader> WeakThisPtr = StaticCastSharedRef<FRuntimeDirectorySyncDownloader>(AsShared());
+	while (!State->FailureResult.IsSet() && State->ActiveDownloads < State->MaxConcurrentDownloads && State->NextFileIndex < State->Plan.FilesToDownload.Num())
+	{
+		const int32 FileIndex = State->Plan.FilesToDownload[State->NextFileIndex++];
+		const FRuntimeSyncManifestFile& File = State->Manifest.Files[FileIndex];
+		++State->ActiveDownloads;
+
+		TSharedRef<FRuntimeChunkDownloader> FileDownloader = MakeShared<FRuntimeChunkDownloader>();
+		FileDownloader->SetExecutionPolicy(ExecutionPolicy);
+		FileDownloader->SetBackground(bBackground);
+		if (bPaused)
+		{
+			FileDownloader->PauseDownload();
+		}
+		FileDownloaders.Add(FileDownloader);
+
+		FileDownloader->DownloadFile(File.URL, State->Timeout, State->ContentType, TNumericLimits<TArray<uint8>::SizeType>::Max(), [State, FileIndex](int64 BytesReceived, int64 ContentSize)
+		{
+			State->ActiveBytes.Add(FileIndex, BytesReceived);
+			if (State->OnProgress)
+			{
+				int64 ReceivedBytes = State->CompletedBytes;
+				for (const TPair<int32, int64>& ActiveBytes : State->ActiveBytes)
+				{
+					ReceivedBytes += ActiveBytes.Value;
+				}
+				State->OnProgress(ReceivedBytes, State->Plan.TotalBytes);
+			}
+		}).Next([WeakThisPtr, State, FileIndex, FileDownloader](FRuntimeChunkDownloaderResult&& Result)
+		{
+			if (TSharedPtr<FRuntimeDirectorySyncDownloader> SharedThis = WeakThisPtr.Pin())
+			{
+				SharedThis->FileDownloaders.Remove(FileDownloader);
+			}
+
+			if (Result.Result != EDownloadToMemoryResult::Success && Result.Result != EDownloadToMemoryResult::SucceededByPayload)
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to download the file '%s' of the sync manifest"), *State->Manifest.Files[FileIndex].Path);
+				OnFileComplete(WeakThisPtr, State, FileIndex, Result.Result == EDownloadToMemoryResult::Cancelled ? EDownloadToStorageResult::Cancelled : EDownloadToStorageResult::DownloadFailed);
+				return;
+			}
+
+			// The file is verified and written to the staging directory on a worker thread
+			Async(EAsyncExecution::ThreadPool, [WeakThisPtr, State, FileIndex, Data = MoveTemp(Result.Data)]()
+			{
+				const FRuntimeSyncManifestFile& File = State->Manifest.Files[FileIndex];
+				TOptional<EDownloadToStorageResult> FailureResult;
+
+				FSHAHash DataHash;
+				FSHA1::HashBuffer(Data.GetData(), Data.Num(), DataHash.Hash);
+				if (Data.Num() != File.Size || DataHash != File.Hash)
+				{
+					UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to sync the file '%s': the downloaded data (%lld bytes, hash %s) does not match the manifest (%lld bytes, hash %s)"),
+					       *File.Path, Data.Num(), *DataHash.ToString(), File.Size, *File.Hash.ToString());
+					FailureResult = EDownloadToStorageResult::DownloadFailed;
+				}
+				else
+				{
+					const FString StagedPath = GetSyncMetadataDirectory(State->LocalDirectory) / TEXT("Staging") / File.Path;
+					const EDownloadToStorageResult SaveResult = FRuntimeDownloadHandle::SaveDownloadedData(EDownloadToMemoryResult::Success, Data, StagedPath);
+					if (SaveResult != EDownloadToStorageResult::Success)
+					{
+						FailureResult = SaveResult;
+					}
+				}
+
+				AsyncTask(ENamedThreads::GameThread, [WeakThisPtr, State, FileIndex, FailureResult]()
+				{
+					OnFileComplete(WeakThisPtr, State, FileIndex, FailureResult);
+				});
+			});
+		});
+	}
+
+	if (State->ActiveDownloads == 0 && (State->FailureResult.IsSet() || State->NextFileIndex >= State->Plan.FilesToDownload.Num()))
+	{
+		FileDownloaders.Reset();
+		FinishSync(State);
+	}
+}
+
+void FRuntimeDirectorySyncDownloader::OnFileComplete(const TWeakPtr<FRuntimeDirectorySyncDownloader>& WeakThisPtr, const TSharedRef<FSyncDownloadState>& State, int32 FileIndex, TOptional<EDownloadToStorageResult> FailureResult)
+{
+	--State->ActiveDownloads;
+	State->ActiveBytes.Remove(FileIndex);
+	if (!FailureResult.IsSet())
+	{
+		State->CompletedBytes += State->Manifest.Files[FileIndex].Size;
+	}
+
+	TSharedPtr<FRuntimeDirectorySyncDownloader> SharedThis = WeakThisPtr.Pin();
+	if (!SharedThis.IsValid() && !FailureResult.IsSet())
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to sync the directory '%s': downloader has been destroyed"), *State->LocalDirectory);
+		FailureResult = EDownloadToStorageResult::Cancelled;
+	}
+
+	// The first failure stops the sync, and the files still being downloaded are canceled
+	if (FailureResult.IsSet() && !State->FailureResult.IsSet())
+	{
+		State->FailureResult = FailureResult;
+		if (SharedThis.IsValid())
+		{
+			for (const TSharedPtr<FRuntimeChunkDownloader>& FileDownloader : SharedThis->FileDownloaders)
+			{
+				FileDownloader->CancelDownload();
+			}
+		}
+	}
+
+	if (SharedThis.IsValid())
+	{
+		SharedThis->StartNextDownloads(State);
+	}
+	else if (State->ActiveDownloads == 0)
+	{
+		FinishSync(State);
+	}
+}
+
+void FRuntimeDirectorySyncDownloader::FinishSync(const TSharedRef<FSyncDownloadState>& State)
+{
+	if (State->bFinished)
+	{
+		return;
+	}
+	State->bFinished = true;
+
+	Async(EAsyncExecution::ThreadPool, [State]()
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeDirectorySyncDownloader::FinishSync);
+
+		const FString MetadataDirectory = GetSyncMetadataDirectory(State->LocalDirectory);
+		EDownloadToStorageResult Result = EDownloadToStorageResult::Success;
+
+		if (State->FailureResult.IsSet())
+		{
+			// Nothing has been moved into the directory yet, so discarding the staged files leaves it unchanged
+			IFileManager::Get().DeleteDirectory(*(MetadataDirectory / TEXT("Staging")), false, true);
+			Result = State->FailureResult.GetValue();
+		}
+		else if (State->Plan.FilesToDownload.Num() > 0 || State->Plan.StaleFiles.Num() > 0)
+		{
+			TArray<TSharedPtr<FJsonValue>> MoveValues, DeleteValues;
+			for (const int32 FileIndex : State->Plan.FilesToDownload)
+			{
+				MoveValues.Add(MakeShared<FJsonValueString>(State->Manifest.Files[FileIndex].Path));
+			}
+			for (const FString& StaleFile : State->Plan.StaleFiles)
+			{
+				DeleteValues.Add(MakeShared<FJsonValueString>(StaleFile));
+			}
+
+			TSharedRef<FJsonObject> JournalObject = MakeShared<FJsonObject>();
+			JournalObject->SetArrayField(TEXT("Moves"), MoveValues);
+			JournalObject->SetArrayField(TEXT("Deletes"), DeleteValues);
+
+			// Once the journal is written the commit is decided, and an interrupted commit is completed by the next sync
+			IFileManager::Get().MakeDirectory(*MetadataDirectory, true);
+			if (!SaveStringToFileAtomically(SerializeJson(JournalObject), MetadataDirectory / TEXT("Commit.json")) || !ApplyCommitJournal(State->LocalDirectory))
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to commit the sync of the directory '%s'"), *State->LocalDirectory);
+				Result = EDownloadToStorageResult::SaveFailed;
+			}
+			else
+			{
+				for (const int32 FileIndex : State->Plan.FilesToDownload)
+				{
+					const FRuntimeSyncManifestFile& File = State->Manifest.Files[FileIndex];
+					const FFileStatData StatData = IFileManager::Get().GetStatData(*(State->LocalDirectory / File.Path));
+					FLocalFileState& FileState = State->Plan.FileStates.Add(File.Path);
+					FileState.Size = StatData.FileSize;
+					FileState.ModificationTime = StatData.ModificationTime;
+					FileState.Hash = File.Hash;
+				}
+				State->Plan.bFileStatesChanged = true;
+			}
+		}
+
+		if (Result == EDownloadToStorageResult::Success && State->Plan.bFileStatesChanged && !SaveFileStates(State->LocalDirectory, State->Plan.FileStates))
+		{
+			// The directory is in sync, only the next comparison will need to hash the files again
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to save the cached file metadata of the directory '%s'"), *State->LocalDirectory);
+		}
+
+		State->Reservation.Reset();
+		UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Finished syncing the directory '%s': %s"), *State->LocalDirectory, *UEnum::GetValueAsString(Result));
+
+		AsyncTask(ENamedThreads::GameThread, [State, Result]()
+		{
+			State->PromisePtr->SetValue(Result);
+		});
+	});
+}
+
+bool FRuntimeDirectorySyncDownloader::ApplyCommitJournal(const FString& LocalDirectory)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeDirectorySyncDownloader::ApplyCommitJournal);
+
+	const FString MetadataDirectory = GetSyncMetadataDirectory(LocalDirectory);
+	const FString JournalPath = MetadataDirectory / TEXT("Commit.json");
+	if (!FPaths::FileExists(JournalPath))
+	{
+		return true;
+	}
+
+	const TSharedPtr<FJsonObject> JournalObject = LoadJsonFile(JournalPath);
+	const TArray<TSharedPtr<FJsonValue>>* MoveValues;
+	const TArray<TSharedPtr<FJsonValue>>* DeleteValues;
+	if (!JournalObject.IsValid() || !JournalObject->TryGetArrayField(TEXT("Moves"), MoveValues) || !JournalObject->TryGetArrayField(TEXT("Deletes"), DeleteValues))
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to read the sync commit journal '%s'"), *JournalPath);
+		return false;
+	}
+
+	IFileManager& FileManager = IFileManager::Get();
+
+	// Files moved before an interruption are no longer staged, so replaying the journal skips them
+	for (const TSharedPtr<FJsonValue>& MoveValue : *MoveValues)
+	{
+		const FString Path = MoveValue->AsString();
+		const FString StagedPath = MetadataDirectory / TEXT("Staging") / Path;
+		if (!IsSafeRelativePath(Path) || !FPaths::FileExists(StagedPath))
+		{
+			continue;
+		}
+
+		const FString TargetPath = LocalDirectory / Path;
+		FileManager.MakeDirectory(*FPaths::GetPath(TargetPath), true);
+		if (!FileManager.Move(*TargetPath, *StagedPath, true))
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to move the synced file '%s' into place"), *TargetPath);
+			return false;
+		}
+	}
+
+	for (const TSharedPtr<FJsonValue>& DeleteValue : *DeleteValues)
+	{
+		const FString Path = DeleteValue->AsString();
+		const FString TargetPath = LocalDirectory / Path;
+		if (IsSafeRelativePath(Path) && FPaths::FileExists(TargetPath) && !FileManager.Delete(*TargetPath))
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to delete the stale file '%s'"), *TargetPath);
+		}
+	}
+
+	FileManager.DeleteDirectory(*(MetadataDirectory / TEXT("Staging")), false, true);
+	FileManager.Delete(*JournalPath);
+	return true;
+}
+
+FString FRuntimeDirectorySyncDownloader::GetSyncMetadataDirectory(const FString& LocalDirectory)
+{
+	return LocalDirectory / SyncMetadataDirectoryName;
+}
+
+TMap<FString, FRuntimeDirectorySyncDownloader::FLocalFileState> FRuntimeDirectorySyncDownloader::LoadFileStates(const FString& LocalDirectory)
+{
+	TMap<FString, FLocalFileState> FileStates;
+
+	const TSharedPtr<FJsonObject> RootObject = LoadJsonFile(GetSyncMetadataDirectory(LocalDirectory) / TEXT("State.json"));
+	const TArray<TSharedPtr<FJsonValue>>* FileValues;
+	if (!RootObject.IsValid() || !RootObject->TryGetArrayField(TEXT("Files"), FileValues))
+	{
+		return FileStates;
+	}
+
+	FileStates.Reserve(FileValues->Num());
+	for (const TSharedPtr<FJsonValue>& FileValue : *FileValues)
+	{
+		const TSharedPtr<FJsonObject>* FileObject;
+		FString Path, SizeString, TicksString, HashString;
+		if (!FileValue->TryGetObject(FileObject)
+			|| !(*FileObject)->TryGetStringField(TEXT("Path"), Path)
+			|| !(*FileObject)->TryGetStringField(TEXT("Size"), SizeString)
+			|| !(*FileObject)->TryGetStringField(TEXT("Time"), TicksString)
+			|| !(*FileObject)->TryGetStringField(TEXT("Hash"), HashString)
+			|| HashString.Len() != sizeof(FSHAHash::Hash) * 2)
+		{
+			continue;
+		}
+
+		// Sizes and times are stored as strings, as JSON numbers cannot represent all 64-bit values
+		FLocalFileState& FileState = FileStates.Add(Path);
+		FileState.Size = FCString::Atoi64(*SizeString);
+		FileState.ModificationTime = FDateTime(FCString::Atoi64(*TicksString));
+		FileState.Hash.FromString(HashString);
+	}
+
+	return FileStates;
+}
+
+bool FRuntimeDirectorySyncDownloader::SaveFileStates(const FString& LocalDirectory, const TMap<FString, FLocalFileState>& FileStates)
+{
+	TArray<TSharedPtr<FJsonValue>> FileValues;
+	FileValues.Reserve(FileStates.Num());
+	for (const TPair<FString, FLocalFileState>& FileState : FileStates)
+	{
+		TSharedRef<FJsonObject> FileObject = MakeShared<FJsonObject>();
+		FileObject->SetStringField(TEXT("Path"), FileState.Key);
+		FileObject->SetStringField(TEXT("Size"), FString::Printf(TEXT("%lld"), FileState.Value.Size));
+		FileObject->SetStringField(TEXT("Time"), FString::Printf(TEXT("%lld"), FileState.Value.ModificationTime.GetTicks()));
+		FileObject->SetStringField(TEXT("Hash"), FileState.Value.Hash.ToString());
+		FileValues.Add(MakeShared<FJsonValueObject>(FileObject));
+	}
+
+	TSharedRef<FJsonObject> RootObject = MakeShared<FJsonObject>();
+	RootObject->SetArrayField(TEXT("Files"), FileValues);
+
+	const FString MetadataDirectory = GetSyncMetadataDirectory(LocalDirectory);
+	IFileManager::Get().MakeDirectory(*MetadataDirectory, true);
+	return SaveStringToFileAtomically(SerializeJson(RootObject), MetadataDirectory / TEXT("State.json"));
+}
+
+bool FRuntimeDirectorySyncDownloader::HashFile(const FString& FilePath, FSHAHash& OutHash)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeDirectorySyncDownloader::HashFile);
+
+	TUniquePtr<IFileHandle> FileHandle(FPlatformFileManager::Get().GetPlatformFile().OpenRead(*FilePath));
+	if (!FileHandle.IsValid())
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Unable to open the file '%s' to hash it"), *FilePath);
+		return false;
+	}
+
+	TArray<uint8> Buffer;
+	Buffer.SetNumUninitialized(static_cast<int32>(FMath::Min<int64>(HashBlockSize, FMath::Max<int64>(FileHandle->Size(), 1))));
+
+	FSHA1 HashState;
+	int64 RemainingBytes = FileHandle->Size();
+	while (RemainingBytes > 0)
+	{
+		const int64 BlockSize = FMath::Min<int64>(RemainingBytes, Buffer.Num());
+		if (!FileHandle->Read(Buffer.GetData(), BlockSize))
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Unable to read the file '%s' to hash it"), *FilePath);
+			return false;
+		}
+		HashState.Update(Buffer.GetData(), static_cast<uint32>(BlockSize));
+		RemainingBytes -= BlockSize;
+	}
+
+	HashState.Final();
+	HashState.GetHash(OutHash.Hash);
+	return true;
+}
@@ -0,0 +1,56 @@
+// Georgy Treshchev 2024.
+
+#include "RuntimeDownloadAwaitable.h"
+
+FRuntimeDownloadCancellationToken::FRuntimeDownloadCancellationToken()
+	: State(MakeShared<FState, ESPMode::ThreadSafe>())
+{
+}
+
+void FRuntimeDownloadCancellationToken::Cancel() const
+{
+	TArray<TWeakPtr<FRuntimeChunkDownloader>> Downloaders;
+	{
+		FScopeLock Lock(&State->Lock);
+		State->bCanceled = true;
+		Downloaders = MoveTemp(State->Downloaders);
+	}
+
+	for (const TWeakPtr<FRuntimeChunkDownloader>& Downloader : Downloaders)
+	{
+		if (TSharedPtr<FRuntimeChunkDownloader> PinnedDownloader = Downloader.Pin())
+		{
+			PinnedDownloader->CancelDownload();
+		}
+	}
+}
+
+bool FRuntimeDownloadCancellationToken::IsCanceled() const
+{
+	return State->bCanceled;
+}
+
+void FRuntimeDownloadCancellationToken::Register(const TSharedRef<FRuntimeChunkDownloader>& Downloader) const
+{
+	{
+		FScopeLock Lock(&State->Lock);
+		if (!State->bCanceled)
+		{
+			State->Downloaders.RemoveAllSwap([](const TWeakPtr<FRuntimeChunkDownloader>& RegisteredDownloader)
+			{
+				return !RegisteredDownloader.IsValid();
+			});
+			State->Downloaders.Add(Downloader);
+			return;
+		}
+	}
+
+	Downloader->CancelDownload();
+}
+
+TSharedRef<FRuntimeChunkDownloader> FRuntimeDownloadCancellationToken::MakeDownloader() const
+{
+	TSharedRef<FRuntimeChunkDownloader> Downloader = MakeShared<FRuntimeChunkDownloader>();
+	Register(Downloader);
+	return Downloader;
+}
@@ -0,0 +1,48 @@
+// Georgy Treshchev 2024.
+
+#include "RuntimeDownloadExecutionPolicy.h"
+#include "RuntimeFilesDownloaderSettings.h"
+#include "HAL/PlatformTime.h"
+
+FRuntimeDownloadExecutionPolicy FRuntimeDownloadExecutionPolicy::FromSettings()
+{
+	const URuntimeFilesDownloaderSettings* Settings = GetDefault<URuntimeFilesDownloaderSettings>();
+
+	FRuntimeDownloadExecutionPolicy Policy;
+	Policy.bProcessOnWorkerThreads = Settings->bProcessDownloadsOnWorkerThreads;
+	Policy.ProgressInterval = FMath::Max(Settings->ProgressCallbackInterval, 0.0f);
+	return Policy;
+}
+
+TFunction<void(int64, int64)> FRuntimeDownloadExecutionPolicy::WrapProgress(const TFunction<void(int64, int64)>& OnProgress) const
+{
+	if (!OnProgress)
+	{
+		return OnProgress;
+	}
+
+	if (CallbackExecutor == ERuntimeDownloadExecutor::Inline && ProgressInterval <= 0.0f)
+	{
+		return OnProgress;
+	}
+
+	// Progress is reported by the HTTP module on the game thread, so the time of the last delivered update needs no synchronization
+	TSharedRef<double> LastDeliveryTime = MakeShared<double>(0.0);
+	const ERuntimeDownloadExecutor Executor = CallbackExecutor;
+	const double Interval = ProgressInterval;
+	return [OnProgress, LastDeliveryTime, Executor, Interval](int64 BytesReceived, int64 ContentSize)
+	{
+		const double CurrentTime = FPlatformTime::Seconds();
+		const bool bFinalUpdate = ContentSize > 0 && BytesReceived >= ContentSize;
+		if (!bFinalUpdate && CurrentTime - *LastDeliveryTime < Interval)
+		{
+			return;
+		}
+
+		*LastDeliveryTime = CurrentTime;
+		RuntimeDownloadExecutor::Execute(Executor, [OnProgress, BytesReceived, ContentSize]()
+		{
+			OnProgress(BytesReceived, ContentSize);
+		});
+	};
+}
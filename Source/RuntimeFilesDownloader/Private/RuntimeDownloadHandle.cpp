@@ -0,0 +1,278 @@
+// Georgy Treshchev 2024.
+
+#include "RuntimeDownloadHandle.h"
+
+#include "FileToMemoryDownloader.h"
+#include "FileToStorageDownloader.h"
+#include "RuntimeFilesDownloaderDefines.h"
+#include "RuntimeFilesDownloaderProfiling.h"
+#include "RuntimePrefetchManager.h"
+#include "RuntimeStorageAdmission.h"
+#include "RuntimeFilesDownloaderSettings.h"
+#include "Async/Async.h"
+#include "GenericPlatform/GenericPlatformFile.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/Paths.h"
+
+FRuntimeDownloadHandle::FRuntimeDownloadHandle(const TSharedRef<FRuntimeChunkDownloader>& InDownloader)
+	: Downloader(InDownloader)
+	, bComplete(false)
+{
+}
+
+TSharedRef<FRuntimeDownloadHandle> FRuntimeDownloadHandle::DownloadToMemory(const FString& URL, float Timeout, const FString& ContentType, bool bForceByPayload, const FRuntimeChunkDownloader::FOnProgress& OnProgress, const FOnMemoryDownloadComplete& OnComplete, const FRuntimeDownloadExecutionPolicy& ExecutionPolicy)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeDownloadHandle::DownloadToMemory);
+
+	TSharedRef<FRuntimeDownloadHandle> Handle = MakeShared<FRuntimeDownloadHandle>(MakeShared<FRuntimeChunkDownloader>());
+	Handle->Downloader->SetExecutionPolicy(ExecutionPolicy);
+
+	// The continuation keeps the handle and thus the downloader alive until the download is complete
+	const ERuntimeDownloadExecutor CallbackExecutor = ExecutionPolicy.CallbackExecutor;
+	StartDownloadToMemory(Handle, URL, Timeout, ContentType, bForceByPayload, ExecutionPolicy.WrapProgress(OnProgress), [Handle, OnComplete, CallbackExecutor](FRuntimeChunkDownloaderResult&& Result)
+	{
+		Handle->bComplete = true;
+		RuntimeDownloadExecutor::Execute(CallbackExecutor, [OnComplete, DownloadResult = Result.Result, Data = MakeRuntimeSharedBuffer(MoveTemp(Result.Data))]()
+		{
+			TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeDownloadHandle::BroadcastDownloadComplete);
+			OnComplete(DownloadResult, Data);
+		});
+	});
+	return Handle;
+}
+
+TSharedRef<FRuntimeDownloadHandle> FRuntimeDownloadHandle::DownloadToStorage(const FString& URL, const FString& SavePath, float Timeout, const FString& ContentType, bool bForceByPayload, const FRuntimeChunkDownloader::FOnProgress& OnProgress, const FOnStorageDownloadComplete& OnComplete, const FRuntimeDownloadExecutionPolicy& ExecutionPolicy)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeDownloadHandle::DownloadToStorage);
+
+	TSharedRef<FRuntimeDownloadHandle> Handle = MakeShared<FRuntimeDownloadHandle>(MakeShared<FRuntimeChunkDownloader>());
+	Handle->Downloader->SetExecutionPolicy(ExecutionPolicy);
+
+	const ERuntimeDownloadExecutor CallbackExecutor = ExecutionPolicy.CallbackExecutor;
+	if (SavePath.IsEmpty())
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("You have not provided a path to save the file"));
+		Handle->bComplete = true;
+		RuntimeDownloadExecutor::Execute(CallbackExecutor, [OnComplete, SavePath]()
+		{
+			OnComplete(EDownloadToStorageResult::InvalidSavePath, SavePath);
+		});
+		return Handle;
+	}
+
+	const bool bSaveOnWorkerThread = ExecutionPolicy.bProcessOnWorkerThreads;
+	const FRuntimeChunkDownloader::FOnProgress WrappedOnProgress = ExecutionPolicy.WrapProgress(OnProgress);
+	auto StartDownload = [Handle, URL, SavePath, Timeout, ContentType, bForceByPayload, WrappedOnProgress, OnComplete, CallbackExecutor, bSaveOnWorkerThread](const FRuntimeStorageReservationPtr& Reservation)
+	{
+		StartDownloadToMemory(Handle, URL, Timeout, ContentType, bForceByPayload, WrappedOnProgress, [Handle, SavePath, OnComplete, CallbackExecutor, bSaveOnWorkerThread, Reservation](FRuntimeChunkDownloaderResult&& Result)
+		{
+			// The reservation is held until the file is saved, after which the space is accounted for by the file itself
+			auto SaveAndComplete = [Handle, SavePath, OnComplete, CallbackExecutor, Reservation, Result = MoveTemp(Result)]() mutable
+			{
+				const EDownloadToStorageResult SaveResult = SaveDownloadedData(Result.Result, Result.Data, SavePath);
+				Reservation.Reset();
+				Handle->bComplete = true;
+				RuntimeDownloadExecutor::Execute(CallbackExecutor, [OnComplete, SaveResult, SavePath]()
+				{
+					TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeDownloadHandle::BroadcastDownloadComplete);
+					OnComplete(SaveResult, SavePath);
+				});
+			};
+
+			if (bSaveOnWorkerThread)
+			{
+				Async(EAsyncExecution::ThreadPool, MoveTemp(SaveAndComplete));
+			}
+			else
+			{
+				SaveAndComplete();
+			}
+		});
+	};
+
+	// Downloading by payload skips the content size request, so there is nothing to check the storage against
+	if (bForceByPayload || URL.IsEmpty() || !GetDefault<URuntimeFilesDownloaderSettings>()->bCheckDiskSpaceBeforeDownload)
+	{
+		StartDownload(nullptr);
+		return Handle;
+	}
+
+	// The content size is remembered by the downloader, so the download does not request it again
+	Handle->Downloader->GetContentSize(URL, FMath::Max(Timeout, 0.0f)).Next([Handle, SavePath, OnComplete, CallbackExecutor, StartDownload](int64 ContentSize)
+	{
+		if (ContentSize <= 0)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Unable to check the free space for '%s' as the content size is unknown"), *SavePath);
+			StartDownload(nullptr);
+			return;
+		}
+
+		FRuntimeStorageReservationPtr Reservation;
+		const ERuntimeStorageAdmissionResult AdmissionResult = FRuntimeStorageAdmission::Get().Reserve(SavePath, ContentSize, Reservation);
+		if (AdmissionResult == ERuntimeStorageAdmissionResult::Admitted)
+		{
+			StartDownload(Reservation);
+			return;
+		}
+
+		const EDownloadToStorageResult StorageResult = AdmissionResult == ERuntimeStorageAdmissionResult::QuotaExceeded ? EDownloadToStorageResult::QuotaExceeded : EDownloadToStorageResult::NotEnoughSpace;
+		Handle->bComplete = true;
+		RuntimeDownloadExecutor::Execute(CallbackExecutor, [OnComplete, StorageResult, SavePath]()
+		{
+			OnComplete(StorageResult, SavePath);
+		});
+	});
+	return Handle;
+}
+
+TSharedRef<FRuntimeDownloadHandle> FRuntimeDownloadHandle::GetContentSize(const FString& URL, float Timeout, const FOnContentSize& OnComplete, const FRuntimeDownloadExecutionPolicy& ExecutionPolicy)
+{
+	TSharedRef<FRuntimeDownloadHandle> Handle = MakeShared<FRuntimeDownloadHandle>(MakeShared<FRuntimeChunkDownloader>());
+	const ERuntimeDownloadExecutor CallbackExecutor = ExecutionPolicy.CallbackExecutor;
+	Handle->Downloader->GetContentSize(URL, FMath::Max(Timeout, 0.0f)).Next([Handle, OnComplete, CallbackExecutor](int64 ContentSize)
+	{
+		Handle->bComplete = true;
+		RuntimeDownloadExecutor::Execute(CallbackExecutor, [OnComplete, ContentSize]()
+		{
+			OnComplete(ContentSize);
+		});
+	});
+	return Handle;
+}
+
+void FRuntimeDownloadHandle::StartDownloadToMemory(const TSharedRef<FRuntimeDownloadHandle>& Handle, const FString& URL, float Timeout, const FString& ContentType, bool bForceByPayload, const FRuntimeChunkDownloader::FOnProgress& OnProgress, TFunction<void(FRuntimeChunkDownloaderResult&&)>&& OnResult)
+{
+	if (URL.IsEmpty())
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("You have not provided an URL to download the file"));
+		OnResult(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::InvalidURL, TArray64<uint8>()});
+		return;
+	}
+
+	auto OnDownloaded = [OnResult = MoveTemp(OnResult)](FRuntimeChunkDownloaderResult&& Result)
+	{
+		OnResult(MoveTemp(Result));
+	};
+
+	// A prefetch of the same file is taken over, so the bytes it has already downloaded are reused. Its execution policy is kept, as it may have chunk copies in flight
+	if (!bForceByPayload && IsInGameThread() && FRuntimePrefetchManager::IsAvailable())
+	{
+		TSharedPtr<FRuntimeChunkDownloader> PrefetchDownloader;
+		TFuture<FRuntimeChunkDownloaderResult> PrefetchFuture;
+		if (FRuntimePrefetchManager::Get().Claim(URL, OnProgress, PrefetchDownloader, PrefetchFuture))
+		{
+			Handle->Downloader = PrefetchDownloader.ToSharedRef();
+			PrefetchFuture.Next(MoveTemp(OnDownloaded));
+			return;
+		}
+	}
+
+	const float ValidTimeout = FMath::Max(Timeout, 0.0f);
+	if (bForceByPayload)
+	{
+		Handle->Downloader->DownloadFileByPayload(URL, ValidTimeout, ContentType, OnProgress).Next(MoveTemp(OnDownloaded));
+	}
+	else
+	{
+		Handle->Downloader->DownloadFile(URL, ValidTimeout, ContentType, TNumericLimits<TArray<uint8>::SizeType>::Max(), OnProgress).Next(MoveTemp(OnDownloaded));
+	}
+}
+
+EDownloadToStorageResult FRuntimeDownloadHandle::SaveDownloadedData(EDownloadToMemoryResult Result, const TArray64<uint8>& Data, const FString& SavePath)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeDownloadHandle::SaveDownloadedData);
+
+	switch (Result)
+	{
+	case EDownloadToMemoryResult::Success:
+	case EDownloadToMemoryResult::SucceededByPayload:
+		break;
+	case EDownloadToMemoryResult::Cancelled:
+		return EDownloadToStorageResult::Cancelled;
+	case EDownloadToMemoryResult::InvalidURL:
+		return EDownloadToStorageResult::InvalidURL;
+	default:
+		return EDownloadToStorageResult::DownloadFailed;
+	}
+
+	if (!Data.IsValidIndex(0))
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("An error occurred while downloading the file to storage"));
+		return EDownloadToStorageResult::DownloadFailed;
+	}
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+
+	// Create save directory if it does not exist
+	{
+		FString Path, Filename, Extension;
+		FPaths::Split(SavePath, Path, Filename, Extension);
+		if (!PlatformFile.DirectoryExists(*Path))
+		{
+			if (!PlatformFile.CreateDirectoryTree(*Path))
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to create a directory '%s' to save the downloaded file"), *Path);
+				return EDownloadToStorageResult::DirectoryCreationFailed;
+			}
+		}
+	}
+
+	// Delete the file if it already exists
+	if (FPaths::FileExists(*SavePath))
+	{
+		IFileManager& FileManager = IFileManager::Get();
+		if (!FileManager.Delete(*SavePath))
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Something went wrong while deleting the existing file '%s'"), *SavePath);
+			return EDownloadToStorageResult::SaveFailed;
+		}
+	}
+
+	IFileHandle* FileHandle = PlatformFile.OpenWrite(*SavePath);
+	if (!FileHandle)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Something went wrong while saving the file '%s'"), *SavePath);
+		return EDownloadToStorageResult::SaveFailed;
+	}
+
+	bool bWritten;
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeDownloadHandle::WriteFile);
+		bWritten = FileHandle->Write(Data.GetData(), Data.Num());
+	}
+	delete FileHandle;
+
+	if (!bWritten)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Something went wrong while writing the response data to the file '%s'"), *SavePath);
+		return EDownloadToStorageResult::SaveFailed;
+	}
+
+	return Result == EDownloadToMemoryResult::SucceededByPayload ? EDownloadToStorageResult::SucceededByPayload : EDownloadToStorageResult::Success;
+}
+
+void FRuntimeDownloadHandle::Cancel()
+{
+	Downloader->CancelDownload();
+}
+
+void FRuntimeDownloadHandle::Pause()
+{
+	Downloader->PauseDownload();
+}
+
+void FRuntimeDownloadHandle::Resume()
+{
+	Downloader->ResumeDownload();
+}
+
+bool FRuntimeDownloadHandle::IsPaused() const
+{
+	return Downloader->IsPaused();
+}
+
+const FRuntimeFilesDownloaderStats& FRuntimeDownloadHandle::GetStats() const
+{
+	return Downloader->GetStats();
+}
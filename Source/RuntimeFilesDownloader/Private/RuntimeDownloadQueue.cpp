@@ -0,0 +1,722 @@
+// Georgy Treshchev 2024.
+
+#include "RuntimeDownloadQueue.h"
+
+#include "FileToMemoryDownloader.h"
+#include "FileToStorageDownloader.h"
+#include "RuntimeChunkBufferPool.h"
+#include "RuntimeDownloadHandle.h"
+#include "RuntimeFilesDownloaderDefines.h"
+#include "RuntimeFilesDownloaderProfiling.h"
+#include "RuntimeFilesDownloaderSettings.h"
+#include "Async/Async.h"
+#include "Dom/JsonObject.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+
+namespace
+{
+	/** The shared download queue, created on first use */
+	TUniquePtr<FRuntimeDownloadQueue> SharedDownloadQueue;
+
+	/** The size of the chunks jobs are downloaded by. Each written chunk is a point the job can be resumed from */
+	constexpr int64 QueueChunkSize = 4 * 1024 * 1024;
+
+	/** The minimum interval between two saves of the journal caused by progress, in seconds */
+	constexpr double JournalSaveInterval = 1.0;
+}
+
+FRuntimeDownloadQueue::FRuntimeDownloadQueue()
+	: LastJournalSaveTime(0)
+{
+	LoadJournal();
+}
+
+FRuntimeDownloadQueue::~FRuntimeDownloadQueue()
+{
+	// The ranges written so far are kept in the journal, so that the active job continues from them in the next run
+	SaveJournal(true);
+	if (ActiveJob.IsValid() && ActiveJob->Downloader.IsValid())
+	{
+		ActiveJob->Downloader->CancelDownload();
+	}
+
+	// The journal is saved on the thread pool, so the last save is waited for before the queue goes away
+	if (JournalSaveFuture.IsValid())
+	{
+		JournalSaveFuture.Wait();
+	}
+}
+
+FRuntimeDownloadQueue& FRuntimeDownloadQueue::Get()
+{
+	check(IsInGameThread());
+	if (!SharedDownloadQueue.IsValid())
+	{
+		SharedDownloadQueue = MakeUnique<FRuntimeDownloadQueue>();
+	}
+	return *SharedDownloadQueue;
+}
+
+bool FRuntimeDownloadQueue::IsAvailable()
+{
+	return SharedDownloadQueue.IsValid();
+}
+
+void FRuntimeDownloadQueue::Shutdown()
+{
+	SharedDownloadQueue.Reset();
+}
+
+FString FRuntimeDownloadQueue::GetJournalPath()
+{
+	return FPaths::ProjectSavedDir() / TEXT("RuntimeFilesDownloader") / TEXT("DownloadQueue.json");
+}
+
+FGuid FRuntimeDownloadQueue::Enqueue(const FString& URL, const FString& SavePath, float Timeout, const FString& ContentType, const FRuntimeChunkDownloader::FOnProgress& OnProgress, const FOnJobComplete& OnComplete)
+{
+	if (URL.IsEmpty())
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("You have not provided an URL to queue the download"));
+		if (OnComplete)
+		{
+			OnComplete(EDownloadToStorageResult::InvalidURL, SavePath);
+		}
+		return FGuid();
+	}
+
+	if (SavePath.IsEmpty())
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("You have not provided a path to save the file queued for download from %s"), *URL);
+		if (OnComplete)
+		{
+			OnComplete(EDownloadToStorageResult::InvalidSavePath, SavePath);
+		}
+		return FGuid();
+	}
+
+	const FString FullSavePath = FPaths::ConvertRelativePathToFull(SavePath);
+
+	// Queuing a download recorded by a previous run, e.g. by a patcher started again, takes it over instead of starting from scratch
+	for (const TSharedRef<FJob>& Job : Jobs)
+	{
+		if (Job->URL == URL && Job->SavePath == FullSavePath)
+		{
+			Job->Timeout = FMath::Max(Timeout, 0.0f);
+			Job->ContentType = ContentType;
+			Job->OnProgress = OnProgress;
+			Job->OnComplete = OnComplete;
+			Job->bHeldBack = false;
+			UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Download of %s to '%s' is already queued as job %s"), *URL, *FullSavePath, *Job->Id.ToString());
+			StartNextJob();
+			return Job->Id;
+		}
+	}
+
+	TSharedRef<FJob> Job = MakeShared<FJob>();
+	Job->Id = FGuid::NewGuid();
+	Job->URL = URL;
+	Job->SavePath = FullSavePath;
+	Job->Timeout = FMath::Max(Timeout, 0.0f);
+	Job->ContentType = ContentType;
+	Job->OnProgress = OnProgress;
+	Job->OnComplete = OnComplete;
+	Jobs.Add(Job);
+	SaveJournal(true);
+
+	UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Queued download of %s to '%s' as job %s"), *URL, *FullSavePath, *Job->Id.ToString());
+	StartNextJob();
+	return Job->Id;
+}
+
+void FRuntimeDownloadQueue::Cancel(const FGuid& JobId)
+{
+	const int32 JobIndex = Jobs.IndexOfByPredicate([&JobId](const TSharedRef<FJob>& Job)
+	{
+		return Job->Id == JobId;
+	});
+	if (JobIndex == INDEX_NONE)
+	{
+		return;
+	}
+
+	TSharedRef<FJob> Job = Jobs[JobIndex];
+	Jobs.RemoveAt(JobIndex);
+	SaveJournal(true);
+
+	if (IsActiveJob(Job))
+	{
+		ActiveJob.Reset();
+		Job->Downloader->CancelDownload();
+		Job->Downloader.Reset();
+		Job->Reservation.Reset();
+	}
+
+	// The partial file is deleted once the chunks being written to it are written
+	Async(EAsyncExecution::ThreadPool, [PartialFilePath = GetPartialFilePath(*Job), PartialFile = MoveTemp(Job->PartialFile), WriteFuture = MoveTemp(Job->WriteFuture)]() mutable
+	{
+		if (WriteFuture.IsValid())
+		{
+			WriteFuture.Wait();
+		}
+		PartialFile.Reset();
+		IFileManager::Get().Delete(*PartialFilePath, false, false, true);
+	});
+
+	UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Canceled queued download of %s (job %s)"), *Job->URL, *Job->Id.ToString());
+	if (Job->OnComplete)
+	{
+		Job->OnComplete(EDownloadToStorageResult::Cancelled, Job->SavePath);
+	}
+	JobCompleteDelegate.Broadcast(Job->Id, EDownloadToStorageResult::Cancelled, Job->SavePath);
+
+	StartNextJob();
+}
+
+int32 FRuntimeDownloadQueue::ResumeJournaledJobs()
+{
+	for (const TSharedRef<FJob>& Job : Jobs)
+	{
+		Job->bHeldBack = false;
+	}
+
+	UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Resuming %d queued downloads"), Jobs.Num());
+	StartNextJob();
+	return Jobs.Num();
+}
+
+bool FRuntimeDownloadQueue::IsQueued(const FGuid& JobId) const
+{
+	return Jobs.ContainsByPredicate([&JobId](const TSharedRef<FJob>& Job)
+	{
+		return Job->Id == JobId;
+	});
+}
+
+bool FRuntimeDownloadQueue::GetJobProgress(const FGuid& JobId, int64& OutBytesDownloaded, int64& OutContentSize) const
+{
+	for (const TSharedRef<FJob>& Job : Jobs)
+	{
+		if (Job->Id == JobId)
+		{
+			OutBytesDownloaded = Job->BytesDownloaded;
+			OutContentSize = Job->ContentSize;
+			return true;
+		}
+	}
+	return false;
+}
+
+void FRuntimeDownloadQueue::StartNextJob()
+{
+	if (ActiveJob.IsValid())
+	{
+		return;
+	}
+
+	for (const TSharedRef<FJob>& Job : Jobs)
+	{
+		if (!Job->bHeldBack)
+		{
+			StartJob(Job);
+			return;
+		}
+	}
+}
+
+void FRuntimeDownloadQueue::StartJob(const TSharedRef<FJob>& Job)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeDownloadQueue::StartJob);
+
+	ActiveJob = Job;
+
+	// The chunks are written to the partial file as received, so a file downloaded at once must be saved as received as well, instead of being decompressed by its extension
+	Job->Downloader = MakeShared<FRuntimeChunkDownloader>();
+	Job->Downloader->SetDecompressCompressedFiles(false);
+
+	UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Starting queued download of %s to '%s' (job %s)"), *Job->URL, *Job->SavePath, *Job->Id.ToString());
+
+	Job->Downloader->GetContentInfo(Job->URL, Job->Timeout).Next([Job](const FRuntimeContentInfo& ContentInfo)
+	{
+		if (!IsAvailable() || !Get().IsActiveJob(Job))
+		{
+			return;
+		}
+
+		FRuntimeDownloadQueue& Queue = Get();
+
+		// Without the size the file cannot be downloaded by ranges, so it is downloaded at once and cannot be resumed
+		if (ContentInfo.Size <= 0)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Unable to get content size for %s. The queued download will not be resumable"), *Job->URL);
+			Job->CompletedRanges.Reset();
+			Job->ContentSize = 0;
+			Job->Downloader->DownloadFileByPayload(Job->URL, Job->Timeout, Job->ContentType, MakeProgressFunction(Job)).Next([Job](FRuntimeChunkDownloaderResult&& Result)
+			{
+				if (!IsAvailable() || !Get().IsActiveJob(Job))
+				{
+					return;
+				}
+
+				if (Result.Result != EDownloadToMemoryResult::Success && Result.Result != EDownloadToMemoryResult::SucceededByPayload)
+				{
+					Get().CompleteJob(Job, Result.Result == EDownloadToMemoryResult::Cancelled ? EDownloadToStorageResult::Cancelled : EDownloadToStorageResult::DownloadFailed);
+					return;
+				}
+
+				Async(EAsyncExecution::ThreadPool, [Job, Result = MoveTemp(Result)]()
+				{
+					const EDownloadToStorageResult SaveResult = FRuntimeDownloadHandle::SaveDownloadedData(Result.Result, Result.Data, Job->SavePath);
+					AsyncTask(ENamedThreads::GameThread, [Job, SaveResult]()
+					{
+						if (IsAvailable() && Get().IsActiveJob(Job))
+						{
+							Get().CompleteJob(Job, SaveResult);
+						}
+					});
+				});
+			});
+			return;
+		}
+
+		// The recorded ranges belong to another version of the file if it has changed on the server since
+		if (Job->ContentSize > 0 && (Job->ContentSize != ContentInfo.Size || Job->ETag != ContentInfo.ETag || Job->LastModified != ContentInfo.LastModified))
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("The file %s has changed on the server since the queued download started, downloading it from the start"), *Job->URL);
+			Job->CompletedRanges.Reset();
+		}
+
+		Job->ContentSize = ContentInfo.Size;
+		Job->ETag = ContentInfo.ETag;
+		Job->LastModified = ContentInfo.LastModified;
+		Job->Downloader->SetIfRangeValidator(ContentInfo.GetRangeValidator());
+		Queue.SaveJournal(true);
+
+		const int64 ResumeOffset = GetContiguousBytes(Job->CompletedRanges);
+		if (GetDefault<URuntimeFilesDownloaderSettings>()->bCheckDiskSpaceBeforeDownload)
+		{
+			const ERuntimeStorageAdmissionResult AdmissionResult = FRuntimeStorageAdmission::Get().Reserve(GetPartialFilePath(*Job), Job->ContentSize, Job->Reservation);
+			if (AdmissionResult != ERuntimeStorageAdmissionResult::Admitted)
+			{
+				Queue.CompleteJob(Job, AdmissionResult == ERuntimeStorageAdmissionResult::QuotaExceeded ? EDownloadToStorageResult::QuotaExceeded : EDownloadToStorageResult::NotEnoughSpace);
+				return;
+			}
+		}
+
+		// The partial file is cut to the recorded ranges, since the data written after the last save of the journal cannot be trusted. A restarted job waits for its previous handle to be closed first
+		Async(EAsyncExecution::ThreadPool, [Job, PartialFilePath = GetPartialFilePath(*Job), ResumeOffset, CloseFuture = MoveTemp(Job->WriteFuture)]()
+		{
+			if (CloseFuture.IsValid())
+			{
+				CloseFuture.Wait();
+			}
+
+			IFileManager::Get().MakeDirectory(*FPaths::GetPath(PartialFilePath), true);
+			TSharedPtr<IFileHandle, ESPMode::ThreadSafe> PartialFile(FPlatformFileManager::Get().GetPlatformFile().OpenWrite(*PartialFilePath, true, false));
+
+			int64 WriteOffset = 0;
+			if (PartialFile.IsValid())
+			{
+				WriteOffset = FMath::Min(ResumeOffset, PartialFile->Size());
+				if (!PartialFile->Truncate(WriteOffset) || !PartialFile->Seek(WriteOffset))
+				{
+					PartialFile.Reset();
+				}
+			}
+
+			AsyncTask(ENamedThreads::GameThread, [Job, PartialFile, WriteOffset, PartialFilePath]()
+			{
+				if (!IsAvailable() || !Get().IsActiveJob(Job))
+				{
+					return;
+				}
+
+				if (!PartialFile.IsValid())
+				{
+					UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to open the partial file '%s' of the queued download of %s"), *PartialFilePath, *Job->URL);
+					Get().CompleteJob(Job, EDownloadToStorageResult::SaveFailed);
+					return;
+				}
+
+				Job->CompletedRanges.Reset();
+				if (WriteOffset > 0)
+				{
+					Job->CompletedRanges.Add(FInt64Vector2(0, WriteOffset - 1));
+					UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Resuming queued download of %s from %lld of %lld bytes"), *Job->URL, WriteOffset, Job->ContentSize);
+				}
+
+				Job->PartialFile = PartialFile;
+				Job->WriteFuture = MakeFulfilledPromise<void>().GetFuture();
+				Job->bWriteFailed = MakeShared<TAtomic<bool>, ESPMode::ThreadSafe>(false);
+				Job->WriteOffset = WriteOffset;
+				Job->BytesDownloaded = WriteOffset;
+				Get().DownloadRemainingChunks(Job);
+			});
+		});
+	});
+}
+
+void FRuntimeDownloadQueue::DownloadRemainingChunks(const TSharedRef<FJob>& Job)
+{
+	auto FinishJob = [Job]()
+	{
+		// The partial file is only moved into place once all the chunks have been written to it
+		Async(EAsyncExecution::ThreadPool, [Job, PartialFile = MoveTemp(Job->PartialFile), WriteFuture = MoveTemp(Job->WriteFuture), bWriteFailed = Job->bWriteFailed]() mutable
+		{
+			WriteFuture.Wait();
+
+			const bool bComplete = !*bWriteFailed && PartialFile->Size() == Job->ContentSize;
+			PartialFile.Reset();
+
+			EDownloadToStorageResult Result = EDownloadToStorageResult::Success;
+			if (!bComplete)
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to write the partial file of the queued download of %s"), *Job->URL);
+				Result = EDownloadToStorageResult::SaveFailed;
+			}
+			else if (!IFileManager::Get().Move(*Job->SavePath, *GetPartialFilePath(*Job), true))
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to move the downloaded file to '%s'"), *Job->SavePath);
+				Result = EDownloadToStorageResult::SaveFailed;
+			}
+
+			AsyncTask(ENamedThreads::GameThread, [Job, Result]()
+			{
+				if (IsAvailable() && Get().IsActiveJob(Job))
+				{
+					Get().CompleteJob(Job, Result);
+				}
+			});
+		});
+	};
+
+	if (Job->WriteOffset >= Job->ContentSize)
+	{
+		FinishJob();
+		return;
+	}
+
+	auto OnChunkDownloaded = [Job](TArray64<uint8>&& ChunkData)
+	{
+		if (!IsAvailable() || !Get().IsActiveJob(Job))
+		{
+			return;
+		}
+
+		const FInt64Vector2 Range(Job->WriteOffset, Job->WriteOffset + ChunkData.Num() - 1);
+		Job->WriteOffset += ChunkData.Num();
+
+		// The write overlaps with the download of the next chunk. The data is flushed before the range is recorded, so that the journal never lists data that is not on disk
+		TFuture<void> PreviousWriteFuture = MoveTemp(Job->WriteFuture);
+		Job->WriteFuture = Async(EAsyncExecution::ThreadPool, [Job, Range, PreviousWriteFuture = MoveTemp(PreviousWriteFuture), PartialFile = Job->PartialFile, bWriteFailed = Job->bWriteFailed, ChunkData = MoveTemp(ChunkData)]() mutable
+		{
+			TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeDownloadQueue::WriteChunk);
+
+			PreviousWriteFuture.Wait();
+			if (!*bWriteFailed && !(PartialFile->Write(ChunkData.GetData(), ChunkData.Num()) && PartialFile->Flush()))
+			{
+				*bWriteFailed = true;
+			}
+			PartialFile.Reset();
+			FRuntimeChunkBufferPool::Get().Release(MoveTemp(ChunkData));
+
+			if (!*bWriteFailed)
+			{
+				AsyncTask(ENamedThreads::GameThread, [Job, Range]()
+				{
+					if (IsAvailable() && Get().IsActiveJob(Job))
+					{
+						Get().OnChunkWritten(Job, Range);
+					}
+				});
+			}
+		});
+	};
+
+	const FInt64Vector2 ChunkRange(Job->WriteOffset, FMath::Min(Job->WriteOffset + QueueChunkSize, Job->ContentSize) - 1);
+	Job->Downloader->DownloadFilePerChunk(Job->URL, Job->Timeout, Job->ContentType, QueueChunkSize, ChunkRange, MakeProgressFunction(Job), OnChunkDownloaded).Next([Job, FinishJob](EDownloadToMemoryResult Result)
+	{
+		if (!IsAvailable() || !Get().IsActiveJob(Job))
+		{
+			return;
+		}
+
+		if (Result != EDownloadToMemoryResult::Success && Result != EDownloadToMemoryResult::SucceededByPayload)
+		{
+			Get().CompleteJob(Job, Result == EDownloadToMemoryResult::Cancelled ? EDownloadToStorageResult::Cancelled : EDownloadToStorageResult::DownloadFailed);
+			return;
+		}
+
+		FinishJob();
+	});
+}
+
+void FRuntimeDownloadQueue::OnChunkWritten(const TSharedRef<FJob>& Job, FInt64Vector2 Range)
+{
+	AddRange(Job->CompletedRanges, Range);
+	SaveJournal(false);
+}
+
+void FRuntimeDownloadQueue::CompleteJob(const TSharedRef<FJob>& Job, EDownloadToStorageResult Result)
+{
+	if (IsActiveJob(Job))
+	{
+		ActiveJob.Reset();
+	}
+	Job->Downloader.Reset();
+	Job->Reservation.Reset();
+
+	if (Result == EDownloadToStorageResult::Cancelled)
+	{
+		// The download was canceled from outside of the queue rather than by the queue, so the job has not completed and is restarted from the ranges written so far
+		UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Queued download of %s was canceled from outside of the queue, restarting it"), *Job->URL);
+		Job->WriteFuture = Async(EAsyncExecution::ThreadPool, [PartialFile = MoveTemp(Job->PartialFile), WriteFuture = MoveTemp(Job->WriteFuture)]() mutable
+		{
+			if (WriteFuture.IsValid())
+			{
+				WriteFuture.Wait();
+			}
+			PartialFile.Reset();
+		});
+		SaveJournal(true);
+		StartNextJob();
+		return;
+	}
+
+	bool bRemove = true;
+	if (Result != EDownloadToStorageResult::Success)
+	{
+		++Job->Attempts;
+		Job->bHeldBack = true;
+		bRemove = Job->Attempts >= GetDefault<URuntimeFilesDownloaderSettings>()->DownloadQueueMaxAttempts;
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Queued download of %s failed (attempt %d): %s"), *Job->URL, Job->Attempts, *UEnum::GetValueAsString(Result));
+	}
+
+	if (Result != EDownloadToStorageResult::Success)
+	{
+		// The partial file is closed once the chunks being written to it are written, and deleted if the job is dropped
+		Async(EAsyncExecution::ThreadPool, [PartialFilePath = GetPartialFilePath(*Job), PartialFile = MoveTemp(Job->PartialFile), WriteFuture = MoveTemp(Job->WriteFuture), bRemove]() mutable
+		{
+			if (WriteFuture.IsValid())
+			{
+				WriteFuture.Wait();
+			}
+			PartialFile.Reset();
+			if (bRemove)
+			{
+				IFileManager::Get().Delete(*PartialFilePath, false, false, true);
+			}
+		});
+	}
+
+	if (bRemove)
+	{
+		Jobs.Remove(Job);
+	}
+	SaveJournal(true);
+
+	UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Queued download of %s to '%s' completed: %s"), *Job->URL, *Job->SavePath, *UEnum::GetValueAsString(Result));
+	if (Job->OnComplete)
+	{
+		Job->OnComplete(Result, Job->SavePath);
+	}
+	JobCompleteDelegate.Broadcast(Job->Id, Result, Job->SavePath);
+
+	StartNextJob();
+}
+
+bool FRuntimeDownloadQueue::IsActiveJob(const TSharedRef<FJob>& Job) const
+{
+	return ActiveJob == Job;
+}
+
+FRuntimeChunkDownloader::FOnProgress FRuntimeDownloadQueue::MakeProgressFunction(const TSharedRef<FJob>& Job)
+{
+	return [Job](int64 BytesReceived, int64 ContentSize)
+	{
+		Job->BytesDownloaded = BytesReceived;
+		if (Job->OnProgress)
+		{
+			Job->OnProgress(BytesReceived, ContentSize);
+		}
+	};
+}
+
+FString FRuntimeDownloadQueue::GetPartialFilePath(const FJob& Job)
+{
+	return Job.SavePath + TEXT(".part");
+}
+
+int64 FRuntimeDownloadQueue::GetContiguousBytes(const TArray<FInt64Vector2>& Ranges)
+{
+	return Ranges.Num() > 0 && Ranges[0].X == 0 ? Ranges[0].Y + 1 : 0;
+}
+
+void FRuntimeDownloadQueue::AddRange(TArray<FInt64Vector2>& Ranges, FInt64Vector2 Range)
+{
+	int32 InsertIndex = 0;
+	while (InsertIndex < Ranges.Num() && Ranges[InsertIndex].X < Range.X)
+	{
+		++InsertIndex;
+	}
+	Ranges.Insert(Range, InsertIndex);
+
+	// Ranges that overlap or touch are merged, so that a sequential download is recorded as a single range
+	for (int32 RangeIndex = FMath::Max(InsertIndex - 1, 0); RangeIndex + 1 < Ranges.Num();)
+	{
+		if (Ranges[RangeIndex + 1].X <= Ranges[RangeIndex].Y + 1)
+		{
+			Ranges[RangeIndex].Y = FMath::Max(Ranges[RangeIndex].Y, Ranges[RangeIndex + 1].Y);
+			Ranges.RemoveAt(RangeIndex + 1);
+		}
+		else if (RangeIndex >= InsertIndex)
+		{
+			break;
+		}
+		else
+		{
+			++RangeIndex;
+		}
+	}
+}
+
+void FRuntimeDownloadQueue::LoadJournal()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeDownloadQueue::LoadJournal);
+
+	FString JsonString;
+	if (!FFileHelper::LoadFileToString(JsonString, *GetJournalPath()))
+	{
+		return;
+	}
+
+	TSharedPtr<FJsonObject> RootObject;
+	const TSharedRef<TJsonReader<>> JsonReader = TJsonReaderFactory<>::Create(JsonString);
+	const TArray<TSharedPtr<FJsonValue>>* JobValues;
+	if (!FJsonSerializer::Deserialize(JsonReader, RootObject) || !RootObject.IsValid() || !RootObject->TryGetArrayField(TEXT("Jobs"), JobValues))
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to parse the download queue journal '%s', the queued downloads are lost"), *GetJournalPath());
+		return;
+	}
+
+	for (const TSharedPtr<FJsonValue>& JobValue : *JobValues)
+	{
+		const TSharedPtr<FJsonObject>* JobObject;
+		FString IdString, ContentSizeString;
+		double Timeout = 0, Attempts = 0;
+		const TArray<TSharedPtr<FJsonValue>>* RangeValues;
+		TSharedRef<FJob> Job = MakeShared<FJob>();
+		if (!JobValue->TryGetObject(JobObject)
+			|| !(*JobObject)->TryGetStringField(TEXT("Id"), IdString) || !FGuid::Parse(IdString, Job->Id)
+			|| !(*JobObject)->TryGetStringField(TEXT("URL"), Job->URL)
+			|| !(*JobObject)->TryGetStringField(TEXT("SavePath"), Job->SavePath)
+			|| !(*JobObject)->TryGetNumberField(TEXT("Timeout"), Timeout)
+			|| !(*JobObject)->TryGetStringField(TEXT("ContentType"), Job->ContentType)
+			|| !(*JobObject)->TryGetStringField(TEXT("ContentSize"), ContentSizeString)
+			|| !(*JobObject)->TryGetStringField(TEXT("ETag"), Job->ETag)
+			|| !(*JobObject)->TryGetStringField(TEXT("LastModified"), Job->LastModified)
+			|| !(*JobObject)->TryGetNumberField(TEXT("Attempts"), Attempts)
+			|| !(*JobObject)->TryGetArrayField(TEXT("CompletedRanges"), RangeValues))
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Skipping an invalid job in the download queue journal '%s'"), *GetJournalPath());
+			continue;
+		}
+
+		// Sizes and offsets are stored as strings, as JSON numbers cannot represent all 64-bit values
+		Job->Timeout = static_cast<float>(Timeout);
+		Job->ContentSize = FCString::Atoi64(*ContentSizeString);
+		Job->Attempts = static_cast<int32>(Attempts);
+		for (const TSharedPtr<FJsonValue>& RangeValue : *RangeValues)
+		{
+			FString StartString, EndString;
+			if (RangeValue->AsString().Split(TEXT("-"), &StartString, &EndString) && StartString.IsNumeric() && EndString.IsNumeric())
+			{
+				const FInt64Vector2 Range(FCString::Atoi64(*StartString), FCString::Atoi64(*EndString));
+				if (Range.X <= Range.Y && (Job->ContentSize <= 0 || Range.Y < Job->ContentSize))
+				{
+					AddRange(Job->CompletedRanges, Range);
+				}
+			}
+		}
+
+		Job->BytesDownloaded = GetContiguousBytes(Job->CompletedRanges);
+		Job->bHeldBack = true;
+		Jobs.Add(Job);
+	}
+
+	UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Loaded %d queued downloads from the journal '%s'"), Jobs.Num(), *GetJournalPath());
+}
+
+void FRuntimeDownloadQueue::SaveJournal(bool bForce)
+{
+	const double CurrentTime = FPlatformTime::Seconds();
+	if (!bForce && CurrentTime - LastJournalSaveTime < JournalSaveInterval)
+	{
+		return;
+	}
+	LastJournalSaveTime = CurrentTime;
+
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeDownloadQueue::SaveJournal);
+
+	FString JsonString;
+	if (Jobs.Num() > 0)
+	{
+		TArray<TSharedPtr<FJsonValue>> JobValues;
+		JobValues.Reserve(Jobs.Num());
+		for (const TSharedRef<FJob>& Job : Jobs)
+		{
+			TArray<TSharedPtr<FJsonValue>> RangeValues;
+			for (const FInt64Vector2& Range : Job->CompletedRanges)
+			{
+				RangeValues.Add(MakeShared<FJsonValueString>(FString::Printf(TEXT("%lld-%lld"), Range.X, Range.Y)));
+			}
+
+			TSharedRef<FJsonObject> JobObject = MakeShared<FJsonObject>();
+			JobObject->SetStringField(TEXT("Id"), Job->Id.ToString());
+			JobObject->SetStringField(TEXT("URL"), Job->URL);
+			JobObject->SetStringField(TEXT("SavePath"), Job->SavePath);
+			JobObject->SetNumberField(TEXT("Timeout"), Job->Timeout);
+			JobObject->SetStringField(TEXT("ContentType"), Job->ContentType);
+			JobObject->SetStringField(TEXT("ContentSize"), FString::Printf(TEXT("%lld"), Job->ContentSize));
+			JobObject->SetStringField(TEXT("ETag"), Job->ETag);
+			JobObject->SetStringField(TEXT("LastModified"), Job->LastModified);
+			JobObject->SetNumberField(TEXT("Attempts"), Job->Attempts);
+			JobObject->SetArrayField(TEXT("CompletedRanges"), RangeValues);
+			JobValues.Add(MakeShared<FJsonValueObject>(JobObject));
+		}
+
+		TSharedRef<FJsonObject> RootObject = MakeShared<FJsonObject>();
+		RootObject->SetArrayField(TEXT("Jobs"), JobValues);
+		const TSharedRef<TJsonWriter<>> JsonWriter = TJsonWriterFactory<>::Create(&JsonString);
+		FJsonSerializer::Serialize(RootObject, JsonWriter);
+	}
+
+	// The journal is written on the thread pool, and each save waits for the previous one so that the saves happen in order. Writing a temporary file first means a crash never leaves a truncated journal
+	JournalSaveFuture = Async(EAsyncExecution::ThreadPool, [JournalPath = GetJournalPath(), JsonString = MoveTemp(JsonString), PreviousSaveFuture = MoveTemp(JournalSaveFuture)]()
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeDownloadQueue::WriteJournal);
+
+		if (PreviousSaveFuture.IsValid())
+		{
+			PreviousSaveFuture.Wait();
+		}
+
+		if (JsonString.IsEmpty())
+		{
+			IFileManager::Get().Delete(*JournalPath, false, false, true);
+			return;
+		}
+
+		const FString TempJournalPath = JournalPath + TEXT(".tmp");
+		if (!FFileHelper::SaveStringToFile(JsonString, *TempJournalPath) || !IFileManager::Get().Move(*JournalPath, *TempJournalPath, true))
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to save the download queue journal '%s'"), *JournalPath);
+		}
+	});
+}
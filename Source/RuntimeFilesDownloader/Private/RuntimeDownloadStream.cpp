@@ -0,0 +1,484 @@
+// Georgy Treshchev 2024.
+
+#include "RuntimeDownloadStream.h"
+
+#include "FileToMemoryDownloader.h"
+#include "RuntimeFilesDownloaderDefines.h"
+#include "RuntimeFilesDownloaderProfiling.h"
+#include "Async/Async.h"
+#include "Dom/JsonObject.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+
+FRuntimeFileStreamConsumer::FRuntimeFileStreamConsumer(const FString& InFilePath)
+	: FilePath(InFilePath)
+{
+}
+
+FRuntimeFileStreamConsumer::~FRuntimeFileStreamConsumer()
+{
+	FileHandle.Reset();
+}
+
+bool FRuntimeFileStreamConsumer::Consume(const uint8* Data, int64 Size)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeFileStreamConsumer::Consume);
+
+	if (!FileHandle.IsValid())
+	{
+		IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+		const FString Directory = FPaths::GetPath(FilePath);
+		if (!Directory.IsEmpty() && !PlatformFile.DirectoryExists(*Directory) && !PlatformFile.CreateDirectoryTree(*Directory))
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to create the directory '%s' to stream the download into"), *Directory);
+			return false;
+		}
+
+		FileHandle.Reset(PlatformFile.OpenWrite(*FilePath));
+		if (!FileHandle.IsValid())
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to open the file '%s' to stream the download into"), *FilePath);
+			return false;
+		}
+	}
+
+	if (!FileHandle->Write(Data, Size))
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to write %lld bytes to the file '%s'"), Size, *FilePath);
+		return false;
+	}
+
+	return true;
+}
+
+bool FRuntimeFileStreamConsumer::Finalize(bool bSucceeded)
+{
+	// An empty download still produces an empty file
+	if (bSucceeded && !FileHandle.IsValid() && !Consume(nullptr, 0))
+	{
+		bSucceeded = false;
+	}
+
+	const bool bFlushed = !FileHandle.IsValid() || FileHandle->Flush();
+	FileHandle.Reset();
+
+	if (!bSucceeded || !bFlushed)
+	{
+		FPlatformFileManager::Get().GetPlatformFile().DeleteFile(*FilePath);
+		return false;
+	}
+
+	return true;
+}
+
+FRuntimeHashStreamConsumer::FRuntimeHashStreamConsumer(const FSHAHash& InExpectedHash)
+	: ExpectedHash(InExpectedHash)
+{
+}
+
+bool FRuntimeHashStreamConsumer::Consume(const uint8* Data, int64 Size)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeHashStreamConsumer::Consume);
+
+	// The hash state takes 32-bit sizes
+	while (Size > 0)
+	{
+		const uint32 UpdateSize = static_cast<uint32>(FMath::Min<int64>(Size, TNumericLimits<uint32>::Max()));
+		HashState.Update(Data, UpdateSize);
+		Data += UpdateSize;
+		Size -= UpdateSize;
+	}
+	return true;
+}
+
+bool FRuntimeHashStreamConsumer::Finalize(bool bSucceeded)
+{
+	HashState.Final();
+	HashState.GetHash(Hash.Hash);
+
+	if (bSucceeded && ExpectedHash.IsSet() && Hash != ExpectedHash.GetValue())
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Hash mismatch of the streamed download: expected %s, got %s"), *ExpectedHash.GetValue().ToString(), *Hash.ToString());
+		return false;
+	}
+
+	return bSucceeded;
+}
+
+FRuntimeDecompressStreamConsumer::FRuntimeDecompressStreamConsumer(const FRuntimeDownloadStreamConsumerRef& InNext, bool bRawDeflate)
+	: Next(InNext)
+	, Decompressor(bRawDeflate)
+{
+}
+
+bool FRuntimeDecompressStreamConsumer::Consume(const uint8* Data, int64 Size)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeDecompressStreamConsumer::Consume);
+
+	DecompressedData.Reset();
+	if (!Decompressor.Decompress(Data, Size, DecompressedData))
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to decompress the streamed download"));
+		return false;
+	}
+
+	return DecompressedData.Num() == 0 || Next->Consume(DecompressedData.GetData(), DecompressedData.Num());
+}
+
+bool FRuntimeDecompressStreamConsumer::Finalize(bool bSucceeded)
+{
+	if (bSucceeded && !Decompressor.IsFinished())
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("The streamed download ended before the end of the compressed stream"));
+		bSucceeded = false;
+	}
+
+	return Next->Finalize(bSucceeded) && bSucceeded;
+}
+
+bool FRuntimeDecompressStreamConsumer::IsReadyForData() const
+{
+	return Next->IsReadyForData();
+}
+
+void FRuntimeDecompressStreamConsumer::SetOnReadyForData(const TFunction<void()>& InOnReadyForData)
+{
+	Next->SetOnReadyForData(InOnReadyForData);
+}
+
+FRuntimeLineStreamConsumer::FRuntimeLineStreamConsumer(const FOnLine& InOnLine)
+	: OnLine(InOnLine)
+{
+}
+
+bool FRuntimeLineStreamConsumer::Consume(const uint8* Data, int64 Size)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeLineStreamConsumer::Consume);
+
+	int64 LineStart = 0;
+	for (int64 Index = 0; Index < Size; ++Index)
+	{
+		if (Data[Index] != '\n')
+		{
+			continue;
+		}
+
+		bool bEmitted;
+		if (PartialLine.Num() > 0)
+		{
+			// The line started in one of the previous slices
+			PartialLine.Append(Data + LineStart, Index - LineStart);
+			bEmitted = EmitLine(PartialLine.GetData(), PartialLine.Num());
+			PartialLine.Reset();
+		}
+		else
+		{
+			bEmitted = EmitLine(Data + LineStart, Index - LineStart);
+		}
+
+		if (!bEmitted)
+		{
+			return false;
+		}
+		LineStart = Index + 1;
+	}
+
+	PartialLine.Append(Data + LineStart, Size - LineStart);
+	return true;
+}
+
+bool FRuntimeLineStreamConsumer::Finalize(bool bSucceeded)
+{
+	// The last line may not be terminated
+	if (bSucceeded && PartialLine.Num() > 0)
+	{
+		bSucceeded = EmitLine(PartialLine.GetData(), PartialLine.Num());
+	}
+	PartialLine.Empty();
+	return bSucceeded;
+}
+
+bool FRuntimeLineStreamConsumer::EmitLine(const uint8* Data, int64 Size)
+{
+	if (Size > 0 && Data[Size - 1] == '\r')
+	{
+		--Size;
+	}
+
+	if (Size > TNumericLimits<int32>::Max())
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("The line of %lld bytes in the streamed download is too long"), Size);
+		return false;
+	}
+
+	const FUTF8ToTCHAR LineConverter(reinterpret_cast<const ANSICHAR*>(Data), static_cast<int32>(Size));
+	return OnLine(FString(LineConverter.Length(), LineConverter.Get()));
+}
+
+FRuntimeJsonRecordStreamConsumer::FRuntimeJsonRecordStreamConsumer(const FOnRecord& InOnRecord)
+	: FRuntimeLineStreamConsumer([InOnRecord](const FString& Line)
+	{
+		TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeJsonRecordStreamConsumer::ParseRecord);
+
+		// Blank lines are allowed between the records
+		bool bBlank = true;
+		for (const TCHAR Character : Line)
+		{
+			if (!FChar::IsWhitespace(Character))
+			{
+				bBlank = false;
+				break;
+			}
+		}
+		if (bBlank)
+		{
+			return true;
+		}
+
+		TSharedPtr<FJsonObject> Record;
+		const TSharedRef<TJsonReader<>> JsonReader = TJsonReaderFactory<>::Create(Line);
+		if (!FJsonSerializer::Deserialize(JsonReader, Record) || !Record.IsValid())
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to parse the JSON record of the streamed download: %s"), *JsonReader->GetErrorMessage());
+			return false;
+		}
+
+		return InOnRecord(Record.ToSharedRef());
+	})
+{
+}
+
+FRuntimeTeeStreamConsumer::FRuntimeTeeStreamConsumer(const TArray<FRuntimeDownloadStreamConsumerRef>& InConsumers)
+	: Consumers(InConsumers)
+{
+}
+
+bool FRuntimeTeeStreamConsumer::Consume(const uint8* Data, int64 Size)
+{
+	for (const FRuntimeDownloadStreamConsumerRef& Consumer : Consumers)
+	{
+		if (!Consumer->Consume(Data, Size))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool FRuntimeTeeStreamConsumer::Finalize(bool bSucceeded)
+{
+	// Every consumer is finalized, even if one of them fails, so that all of them can release their resources
+	bool bAllFinalized = true;
+	for (const FRuntimeDownloadStreamConsumerRef& Consumer : Consumers)
+	{
+		bAllFinalized &= Consumer->Finalize(bSucceeded);
+	}
+	return bAllFinalized;
+}
+
+bool FRuntimeTeeStreamConsumer::IsReadyForData() const
+{
+	for (const FRuntimeDownloadStreamConsumerRef& Consumer : Consumers)
+	{
+		if (!Consumer->IsReadyForData())
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void FRuntimeTeeStreamConsumer::SetOnReadyForData(const TFunction<void()>& InOnReadyForData)
+{
+	for (const FRuntimeDownloadStreamConsumerRef& Consumer : Consumers)
+	{
+		Consumer->SetOnReadyForData(InOnReadyForData);
+	}
+}
+
+FRuntimeStreamDownloader::FRuntimeStreamDownloader()
+	: PendingBytes(0)
+	, MaxPendingBytes(0)
+	, bStreaming(false)
+	, bConsuming(false)
+	, bPausedForBackpressure(false)
+	, bConsumerFailed(false)
+{
+}
+
+TFuture<EDownloadToMemoryResult> FRuntimeStreamDownloader::DownloadFileToStream(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, int64 InMaxPendingBytes, const FRuntimeDownloadStreamConsumerRef& Consumer, const FOnProgress& OnProgress)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeStreamDownloader::DownloadFileToStream);
+
+	{
+		FScopeLock Lock(&StreamLock);
+		// The previous consumer may still be consuming the last slices or finalizing after the download is over, so the shared state is only reset once its result has been reported
+		if (bStreaming)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to stream the download from %s: another download is being streamed by this downloader"), *URL);
+			return MakeFulfilledPromise<EDownloadToMemoryResult>(EDownloadToMemoryResult::DownloadFailed).GetFuture();
+		}
+
+		bStreaming = true;
+		ConsumerPtr = Consumer;
+		StreamPromisePtr = MakeShared<TPromise<EDownloadToMemoryResult>>();
+		PendingSlices.Empty();
+		PendingBytes = 0;
+		MaxPendingBytes = FMath::Max<int64>(InMaxPendingBytes, MaxChunkSize);
+		bConsuming = false;
+		bPausedForBackpressure = false;
+		DownloadResult.Reset();
+		bConsumerFailed = false;
+	}
+
+	TWeakPtr<FRuntimeStreamDownloader> WeakThisPtr = StaticCastSharedRef<FRuntimeStreamDownloader>(AsShared());
+	Consumer->SetOnReadyForData([WeakThisPtr]()
+	{
+		if (TSharedPtr<FRuntimeStreamDownloader> SharedThis = WeakThisPtr.Pin())
+		{
+			SharedThis->StartConsuming();
+		}
+	});
+
+	TFuture<EDownloadToMemoryResult> Future = StreamPromisePtr->GetFuture();
+	DownloadFilePerChunk(URL, Timeout, ContentType, MaxChunkSize, FInt64Vector2(), OnProgress, [WeakThisPtr](TArray64<uint8>&& Chunk)
+	{
+		TSharedPtr<FRuntimeStreamDownloader> SharedThis = WeakThisPtr.Pin();
+		if (!SharedThis.IsValid())
+		{
+			return;
+		}
+
+		bool bPauseForBackpressure = false;
+		{
+			FScopeLock Lock(&SharedThis->StreamLock);
+			SharedThis->PendingBytes += Chunk.Num();
+			SharedThis->PendingSlices.Enqueue(MoveTemp(Chunk));
+
+			// The consumer has fallen behind, so the download waits for it instead of buffering without limit
+			if (SharedThis->PendingBytes > SharedThis->MaxPendingBytes && !SharedThis->bPausedForBackpressure && !SharedThis->IsPaused())
+			{
+				SharedThis->bPausedForBackpressure = true;
+				bPauseForBackpressure = true;
+			}
+		}
+
+		if (bPauseForBackpressure)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Pausing the streamed download until the consumer catches up"));
+			SharedThis->PauseDownload();
+		}
+		SharedThis->StartConsuming();
+	}).Next([WeakThisPtr](EDownloadToMemoryResult Result)
+	{
+		TSharedPtr<FRuntimeStreamDownloader> SharedThis = WeakThisPtr.Pin();
+		if (!SharedThis.IsValid())
+		{
+			return;
+		}
+
+		{
+			FScopeLock Lock(&SharedThis->StreamLock);
+			SharedThis->DownloadResult = Result;
+		}
+		SharedThis->StartConsuming();
+	});
+
+	return Future;
+}
+
+void FRuntimeStreamDownloader::StartConsuming()
+{
+	FScopeLock Lock(&StreamLock);
+	if (bConsuming)
+	{
+		return;
+	}
+	bConsuming = true;
+
+	// The downloader is kept alive until the slices are consumed and the consumer is finalized
+	TSharedRef<FRuntimeStreamDownloader> SharedThis = StaticCastSharedRef<FRuntimeStreamDownloader>(AsShared());
+	Async(EAsyncExecution::ThreadPool, [SharedThis]()
+	{
+		SharedThis->ConsumePendingSlices();
+	});
+}
+
+void FRuntimeStreamDownloader::ConsumePendingSlices()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeStreamDownloader::ConsumePendingSlices);
+	RUNTIMEFILESDOWNLOADER_LLM_SCOPE;
+
+	TSharedRef<FRuntimeStreamDownloader> SharedThis = StaticCastSharedRef<FRuntimeStreamDownloader>(AsShared());
+	while (true)
+	{
+		TArray64<uint8> Slice;
+		{
+			FScopeLock Lock(&StreamLock);
+			if (PendingSlices.IsEmpty() || (!bConsumerFailed && !ConsumerPtr->IsReadyForData()))
+			{
+				// Wait for more data, or for the consumer to notify it is ready for data
+				if (!PendingSlices.IsEmpty() || !DownloadResult.IsSet())
+				{
+					bConsuming = false;
+					return;
+				}
+				break;
+			}
+
+			PendingSlices.Dequeue(Slice);
+			PendingBytes -= Slice.Num();
+
+			if (bPausedForBackpressure && PendingBytes <= MaxPendingBytes / 2)
+			{
+				bPausedForBackpressure = false;
+				AsyncTask(ENamedThreads::GameThread, [SharedThis]()
+				{
+					UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Resuming the streamed download as the consumer has caught up"));
+					SharedThis->ResumeDownload();
+				});
+			}
+		}
+
+		// Slices arriving after the consumer has failed are dropped while the download is being canceled
+		if (!bConsumerFailed && !ConsumerPtr->Consume(Slice.GetData(), Slice.Num()))
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("The stream consumer failed to process the downloaded data, canceling the download"));
+			{
+				FScopeLock Lock(&StreamLock);
+				bConsumerFailed = true;
+			}
+			AsyncTask(ENamedThreads::GameThread, [SharedThis]()
+			{
+				SharedThis->CancelDownload();
+			});
+		}
+	}
+
+	// The download is over and every slice has been consumed. bConsuming stays set, so the consumer is finalized only once
+	const EDownloadToMemoryResult Result = DownloadResult.GetValue();
+	const bool bDownloadSucceeded = Result == EDownloadToMemoryResult::Success || Result == EDownloadToMemoryResult::SucceededByPayload;
+	const bool bFinalized = ConsumerPtr->Finalize(bDownloadSucceeded && !bConsumerFailed);
+
+	EDownloadToMemoryResult StreamResult = Result;
+	if (bConsumerFailed || (bDownloadSucceeded && !bFinalized))
+	{
+		StreamResult = EDownloadToMemoryResult::DownloadFailed;
+	}
+
+	AsyncTask(ENamedThreads::GameThread, [SharedThis, StreamResult]()
+	{
+		TSharedPtr<TPromise<EDownloadToMemoryResult>> PromisePtr;
+		{
+			FScopeLock Lock(&SharedThis->StreamLock);
+			PromisePtr = MoveTemp(SharedThis->StreamPromisePtr);
+			SharedThis->ConsumerPtr.Reset();
+			SharedThis->bStreaming = false;
+		}
+
+		// Fulfilled after the state is released, so that the continuation can stream another download
+		PromisePtr->SetValue(StreamResult);
+	});
+}
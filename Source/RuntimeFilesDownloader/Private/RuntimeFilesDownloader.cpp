@@ -1,20 +1,59 @@
 // Georgy Treshchev 2024.
 
 #include "RuntimeFilesDownloader.h"
+#include "RuntimeChunkDownloader.h"
 #include "RuntimeFilesDownloaderDefines.h"
+#include "RuntimeFilesDownloaderProfiling.h"
+#include "RuntimeFilesDownloaderSettings.h"
+#include "RuntimeDownloadQueue.h"
+#include "RuntimePrefetchManager.h"
+#include "RuntimeTextureCache.h"
+#include "Engine/World.h"
+#include "Misc/CoreDelegates.h"
 
 #define LOCTEXT_NAMESPACE "FRuntimeFilesDownloaderModule"
 
 void FRuntimeFilesDownloaderModule::StartupModule()
 {
+	// A single registration for the downloads of all the downloader objects, instead of one per object
+	WorldCleanupHandle = FWorldDelegates::OnWorldCleanup.AddLambda([](UWorld* World, bool bSessionEnded, bool bCleanupResources)
+	{
+		if (bSessionEnded)
+		{
+			FRuntimeChunkDownloader::CancelSessionDownloads();
+		}
+	});
+
+	// The downloads left unfinished by the previous run are resumed once HTTP and the settings are available
+	PostEngineInitHandle = FCoreDelegates::OnPostEngineInit.AddLambda([]()
+	{
+		if (!GIsEditor && GetDefault<URuntimeFilesDownloaderSettings>()->bResumeDownloadQueueOnStartup)
+		{
+			FRuntimeDownloadQueue::Get().ResumeJournaledJobs();
+		}
+	});
 }
 
 void FRuntimeFilesDownloaderModule::ShutdownModule()
 {
+	FWorldDelegates::OnWorldCleanup.Remove(WorldCleanupHandle);
+	FCoreDelegates::OnPostEngineInit.Remove(PostEngineInitHandle);
+	FRuntimeDownloadQueue::Shutdown();
+	FRuntimePrefetchManager::Shutdown();
+	FRuntimeTextureCache::Shutdown();
 }
 
 #undef LOCTEXT_NAMESPACE
 	
 IMPLEMENT_MODULE(FRuntimeFilesDownloaderModule, RuntimeFilesDownloader)
 
-DEFINE_LOG_CATEGORY(LogRuntimeFilesDownloader);
\ No newline at end of file
+DEFINE_LOG_CATEGORY(LogRuntimeFilesDownloader);
+
+DEFINE_STAT(STAT_RuntimeFilesDownloader_ActiveDownloads);
+DEFINE_STAT(STAT_RuntimeFilesDownloader_InFlightRequests);
+DEFINE_STAT(STAT_RuntimeFilesDownloader_InFlightBytes);
+DEFINE_STAT(STAT_RuntimeFilesDownloader_QueuedRequests);
+
+#if !UE_VERSION_OLDER_THAN(5, 1, 0)
+LLM_DEFINE_TAG(RuntimeFilesDownloader);
+#endif
\ No newline at end of file
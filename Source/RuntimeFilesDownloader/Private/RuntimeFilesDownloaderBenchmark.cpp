@@ -0,0 +1,615 @@
+// Georgy Treshchev 2024.
+
+#include "CoreMinimal.h"
+
+#if !UE_BUILD_SHIPPING
+#include "FileToMemoryDownloader.h"
+#include "FileToStorageDownloader.h"
+#include "RuntimeChunkDownloader.h"
+#include "RuntimeFilesDownloaderDefines.h"
+#include "RuntimeFilesDownloaderProfiling.h"
+#include "RuntimeFilesDownloaderTestServer.h"
+#include "Containers/Ticker.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "HAL/PlatformMemory.h"
+#include "HAL/PlatformMisc.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/EngineVersionComparison.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Parse.h"
+#include "Misc/Paths.h"
+
+namespace RuntimeFilesDownloaderBenchmark
+{
+	/** Chunk sizes used when none are specified in the command arguments */
+	static const TArray<int64> DefaultChunkSizes = {1024 * 1024, 8 * 1024 * 1024};
+
+	/** Sizes of the files served by the test server when none are specified in the command arguments, from 1 KB to 8 GB */
+	static const TArray<int64> DefaultFileSizes = {1024, 64 * 1024, 1024 * 1024, 16 * 1024 * 1024, 64 * 1024 * 1024, 256 * 1024 * 1024, 1024 * 1024 * 1024, 4 * 1024LL * 1024 * 1024, 8 * 1024LL * 1024 * 1024};
+
+	/** The largest file size served by the test server when none is specified in the command arguments */
+	constexpr int64 DefaultMaxFileSize = 8 * 1024LL * 1024 * 1024;
+
+	/**
+	 * The measured result of a single benchmark case
+	 */
+	struct FCaseResult
+	{
+		/** The name of the case, including the URL and the chunk size */
+		FString Name;
+
+		/** The result reported by the download */
+		FString Result;
+
+		/** Whether the download succeeded and, if the expected content is known, delivered it intact */
+		bool bSucceeded = false;
+
+		/** Whether the case was skipped without downloading, e.g. for lack of memory or disk space */
+		bool bSkipped = false;
+
+		/** Statistics gathered by the downloader */
+		FRuntimeFilesDownloaderStats Stats;
+
+		/** Time from starting the download until its completion, in seconds */
+		double WallTime = 0;
+
+		/** Time spent by the plugin on the game thread during the download, in seconds */
+		double GameThreadTime = 0;
+
+		/** Peak increase of the physical memory used by the process during the download, in bytes */
+		int64 PeakMemoryIncrease = 0;
+	};
+
+	/**
+	 * Log the result of a single benchmark case
+	 */
+	static void LogCaseResult(const FCaseResult& CaseResult)
+	{
+		const FRuntimeFilesDownloaderStats& Stats = CaseResult.Stats;
+		UE_LOG(LogRuntimeFilesDownloader, Display, TEXT("Benchmark '%s': %s%s, received %lld bytes in %.3f s, throughput %.2f MB/s, game thread %.2f ms, peak memory increase %.2f MB, time-to-first-byte %.3f s, content size request %.3f s, chunks %d, buffer memory %.2f MB, retries %d, wasted %lld bytes"),
+		       *CaseResult.Name, *CaseResult.Result, CaseResult.bSucceeded ? TEXT("") : TEXT(" (failed)"), Stats.BytesReceived, CaseResult.WallTime, Stats.Throughput / (1024.0f * 1024.0f),
+		       CaseResult.GameThreadTime * 1000.0, static_cast<double>(CaseResult.PeakMemoryIncrease) / (1024.0 * 1024.0), Stats.TimeToFirstByte, Stats.ContentSizeRequestLatency,
+		       Stats.ChunkCount, static_cast<float>(Stats.PeakBufferMemory) / (1024.0f * 1024.0f), Stats.RetryCount, Stats.BytesWasted);
+	}
+
+	/**
+	 * Check whether the downloaded data matches the file generated by the test server, sampling it so that large files are checked quickly
+	 */
+	static bool IsTestServerContent(const TArray64<uint8>& Data, int64 ExpectedSize)
+	{
+		if (Data.Num() != ExpectedSize)
+		{
+			return false;
+		}
+
+		for (int64 Offset = 0; Offset < Data.Num(); Offset += 4093)
+		{
+			if (Data[Offset] != FRuntimeFilesDownloaderTestServer::GetFileByte(Offset))
+			{
+				return false;
+			}
+		}
+		return ExpectedSize == 0 || Data.Last() == FRuntimeFilesDownloaderTestServer::GetFileByte(ExpectedSize - 1);
+	}
+
+	/**
+	 * Runs the download paths one after another against each file and measures the wall time, the game thread time and the memory of each download
+	 * The files are either served by the test server on the loopback interface, sweeping over their sizes, or downloaded from the specified URL
+	 */
+	class FBenchmark : public TSharedFromThis<FBenchmark>
+	{
+	public:
+		/**
+		 * @param InServer The test server serving the files, if any. Kept alive until the benchmark finishes
+		 * @param Files The URLs of the files to download, along with their expected size if they are served by the test server, or zero if unknown
+		 * @param ChunkSizes The chunk sizes to download the files with
+		 */
+		FBenchmark(TSharedPtr<FRuntimeFilesDownloaderTestServer> InServer, const TArray<TPair<FString, int64>>& Files, const TArray<int64>& ChunkSizes)
+			: Server(MoveTemp(InServer))
+			, CurrentCaseIndex(INDEX_NONE)
+			, CaseStartTime(0)
+			, CaseStartGameThreadTime(0)
+			, CaseStartMemory(0)
+			, CasePeakMemory(0)
+			, bFinished(false)
+		{
+			for (const TPair<FString, int64>& File : Files)
+			{
+				AddFileCases(File.Key, File.Value, ChunkSizes);
+			}
+		}
+
+		/**
+		 * Start running the benchmark cases
+		 */
+		void Run()
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Display, TEXT("Starting downloads benchmark (%d cases)"), Cases.Num());
+
+			TWeakPtr<FBenchmark> WeakThisPtr = AsShared();
+			auto SampleMemory = [WeakThisPtr](float DeltaTime)
+			{
+				TSharedPtr<FBenchmark> SharedThis = WeakThisPtr.Pin();
+				if (SharedThis.IsValid())
+				{
+					SharedThis->SampleMemory();
+				}
+				return SharedThis.IsValid() && !SharedThis->bFinished;
+			};
+
+#if UE_VERSION_OLDER_THAN(5, 0, 0)
+			FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda(SampleMemory));
+#else
+			FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda(SampleMemory));
+#endif
+			RunCase(0);
+		}
+
+		/**
+		 * Check whether all the cases have been run
+		 */
+		bool IsFinished() const
+		{
+			return bFinished;
+		}
+
+		/**
+		 * Get the results of the cases that have been run
+		 */
+		const TArray<FCaseResult>& GetResults() const
+		{
+			return Results;
+		}
+
+	private:
+		using FOnCaseComplete = TFunction<void(const FString& Result, bool bSucceeded, const FRuntimeFilesDownloaderStats& Stats)>;
+		using FCaseFunction = TFunction<void(const FOnCaseComplete&)>;
+
+		/**
+		 * A benchmark case along with the resources it needs
+		 */
+		struct FCase
+		{
+			FString Name;
+			FCaseFunction Function;
+			int64 RequiredMemory = 0;
+			int64 RequiredDiskSpace = 0;
+			FString UnsupportedReason;
+		};
+
+		void AddFileCases(const FString& URL, int64 ExpectedSize, const TArray<int64>& ChunkSizes)
+		{
+			const FString FileName = FPaths::GetCleanFilename(URL);
+			auto IsSuccess = [](EDownloadToMemoryResult Result)
+			{
+				return Result == EDownloadToMemoryResult::Success || Result == EDownloadToMemoryResult::SucceededByPayload;
+			};
+
+			for (int64 ChunkSize : ChunkSizes)
+			{
+				AddCase(FString::Printf(TEXT("%s: DownloadFile, chunk size %lld"), *FileName, ChunkSize), ExpectedSize + ChunkSize, 0, FString(), [URL, ExpectedSize, ChunkSize, IsSuccess](const FOnCaseComplete& OnCaseComplete)
+				{
+					TSharedRef<FRuntimeChunkDownloader> Downloader = MakeShared<FRuntimeChunkDownloader>();
+					Downloader->DownloadFile(URL, 0, FString(), ChunkSize, [](int64, int64) {}).Next([Downloader, ExpectedSize, OnCaseComplete, IsSuccess](FRuntimeChunkDownloaderResult&& Result)
+					{
+						const bool bSucceeded = IsSuccess(Result.Result) && (ExpectedSize <= 0 || IsTestServerContent(Result.Data, ExpectedSize));
+						OnCaseComplete(UEnum::GetValueAsString(Result.Result), bSucceeded, Downloader->GetStats());
+					});
+				});
+			}
+
+			for (int64 ChunkSize : ChunkSizes)
+			{
+				AddCase(FString::Printf(TEXT("%s: DownloadFilePerChunk, chunk size %lld"), *FileName, ChunkSize), ExpectedSize > 0 ? 2 * FMath::Min(ChunkSize, ExpectedSize) : 0, 0, FString(), [URL, ExpectedSize, ChunkSize, IsSuccess](const FOnCaseComplete& OnCaseComplete)
+				{
+					TSharedRef<FRuntimeChunkDownloader> Downloader = MakeShared<FRuntimeChunkDownloader>();
+					TSharedRef<int64> DeliveredSize = MakeShared<int64>(0);
+					Downloader->DownloadFilePerChunk(URL, 0, FString(), ChunkSize, FInt64Vector2(), [](int64, int64) {}, [DeliveredSize](TArray64<uint8>&& ChunkData)
+					{
+						*DeliveredSize += ChunkData.Num();
+					}).Next([Downloader, ExpectedSize, DeliveredSize, OnCaseComplete, IsSuccess](EDownloadToMemoryResult Result)
+					{
+						const bool bSucceeded = IsSuccess(Result) && (ExpectedSize <= 0 || *DeliveredSize == ExpectedSize);
+						OnCaseComplete(UEnum::GetValueAsString(Result), bSucceeded, Downloader->GetStats());
+					});
+				});
+			}
+
+#if UE_VERSION_OLDER_THAN(5, 4, 0)
+			const FString PayloadUnsupportedReason = ExpectedSize > MAX_int32 ? TEXT("payload downloads are limited to 2 GB before UE 5.4") : FString();
+#else
+			const FString PayloadUnsupportedReason;
+#endif
+			// The response content and the result are both held in memory at the end of a payload download
+			AddCase(FString::Printf(TEXT("%s: DownloadFileByPayload"), *FileName), 2 * ExpectedSize, 0, PayloadUnsupportedReason, [URL, ExpectedSize, IsSuccess](const FOnCaseComplete& OnCaseComplete)
+			{
+				TSharedRef<FRuntimeChunkDownloader> Downloader = MakeShared<FRuntimeChunkDownloader>();
+				Downloader->DownloadFileByPayload(URL, 0, FString(), [](int64, int64) {}).Next([Downloader, ExpectedSize, OnCaseComplete, IsSuccess](FRuntimeChunkDownloaderResult&& Result)
+				{
+					const bool bSucceeded = IsSuccess(Result.Result) && (ExpectedSize <= 0 || IsTestServerContent(Result.Data, ExpectedSize));
+					OnCaseComplete(UEnum::GetValueAsString(Result.Result), bSucceeded, Downloader->GetStats());
+				});
+			});
+
+			AddCase(FString::Printf(TEXT("%s: DownloadFileToStorage"), *FileName), ExpectedSize, ExpectedSize, FString(), [URL, ExpectedSize](const FOnCaseComplete& OnCaseComplete)
+			{
+				const FString SavePath = FPaths::ConvertRelativePathToFull(FPaths::ProjectSavedDir() / TEXT("RuntimeFilesDownloaderBenchmark") / FPaths::GetCleanFilename(URL));
+				UFileToStorageDownloader::DownloadFileToStorage(URL, SavePath, 0, FString(), false, FOnDownloadProgressNative(), FOnFileToStorageDownloadCompleteNative::CreateLambda([ExpectedSize, OnCaseComplete](EDownloadToStorageResult Result, const FString& SavedPath, UFileToStorageDownloader* Downloader)
+				{
+					IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+					const bool bSucceeded = (Result == EDownloadToStorageResult::Success || Result == EDownloadToStorageResult::SucceededByPayload) && (ExpectedSize <= 0 || PlatformFile.FileSize(*SavedPath) == ExpectedSize);
+					OnCaseComplete(UEnum::GetValueAsString(Result), bSucceeded, Downloader ? Downloader->GetDownloadStats() : FRuntimeFilesDownloaderStats());
+					PlatformFile.DeleteFile(*SavedPath);
+				}));
+			});
+		}
+
+		/**
+		 * Add a case to run
+		 *
+		 * @param CaseName The name of the case
+		 * @param RequiredMemory The physical memory the case needs, in bytes, or zero if unknown
+		 * @param RequiredDiskSpace The disk space the case needs, in bytes, or zero if unknown
+		 * @param UnsupportedReason The reason the case cannot be run in this build, or an empty string if it can
+		 * @param CaseFunction The function running the case
+		 */
+		void AddCase(const FString& CaseName, int64 RequiredMemory, int64 RequiredDiskSpace, const FString& UnsupportedReason, FCaseFunction&& CaseFunction)
+		{
+			FCase& Case = Cases.AddDefaulted_GetRef();
+			Case.Name = CaseName;
+			Case.RequiredMemory = RequiredMemory;
+			Case.RequiredDiskSpace = RequiredDiskSpace;
+			Case.UnsupportedReason = UnsupportedReason;
+			Case.Function = MoveTemp(CaseFunction);
+		}
+
+		/**
+		 * Get the reason the case cannot be run right now, checked just before running it since the previous cases free their memory and files
+		 *
+		 * @return The reason, or an empty string if the case can be run
+		 */
+		static FString GetSkipReason(const FCase& Case)
+		{
+			if (!Case.UnsupportedReason.IsEmpty())
+			{
+				return Case.UnsupportedReason;
+			}
+
+			const int64 AvailableMemory = static_cast<int64>(FPlatformMemory::GetStats().AvailablePhysical);
+			if (Case.RequiredMemory > AvailableMemory)
+			{
+				return FString::Printf(TEXT("not enough memory, %.2f MB needed and %.2f MB available"), Case.RequiredMemory / (1024.0 * 1024.0), AvailableMemory / (1024.0 * 1024.0));
+			}
+
+			if (Case.RequiredDiskSpace > 0)
+			{
+				uint64 TotalDiskSpace = 0, FreeDiskSpace = 0;
+				if (FPlatformMisc::GetDiskTotalAndFreeSpace(FPaths::ConvertRelativePathToFull(FPaths::ProjectSavedDir()), TotalDiskSpace, FreeDiskSpace) && Case.RequiredDiskSpace > static_cast<int64>(FreeDiskSpace))
+				{
+					return FString::Printf(TEXT("not enough disk space, %.2f MB needed and %.2f MB free"), Case.RequiredDiskSpace / (1024.0 * 1024.0), FreeDiskSpace / (1024.0 * 1024.0));
+				}
+			}
+			return FString();
+		}
+
+		void RunCase(int32 CaseIndex)
+		{
+			if (!Cases.IsValidIndex(CaseIndex))
+			{
+				Finish();
+				return;
+			}
+
+			const FString SkipReason = GetSkipReason(Cases[CaseIndex]);
+			if (!SkipReason.IsEmpty())
+			{
+				FCaseResult CaseResult;
+				CaseResult.Name = Cases[CaseIndex].Name;
+				CaseResult.Result = FString::Printf(TEXT("Skipped: %s"), *SkipReason);
+				CaseResult.bSkipped = true;
+				UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Benchmark '%s' skipped: %s"), *CaseResult.Name, *SkipReason);
+				Results.Add(MoveTemp(CaseResult));
+				RunCase(CaseIndex + 1);
+				return;
+			}
+
+			CurrentCaseIndex = CaseIndex;
+			CaseStartMemory = static_cast<int64>(FPlatformMemory::GetStats().UsedPhysical);
+			CasePeakMemory = CaseStartMemory;
+			CaseStartGameThreadTime = FRuntimeFilesDownloaderGameThreadScope::GetSeconds();
+			CaseStartTime = FPlatformTime::Seconds();
+
+			TSharedRef<FBenchmark> SharedThis = AsShared();
+			const FString CaseName = Cases[CaseIndex].Name;
+
+			// Starting the download is part of the game thread time spent by the plugin
+			RUNTIMEFILESDOWNLOADER_GAME_THREAD_SCOPE;
+			Cases[CaseIndex].Function([SharedThis, CaseName, CaseIndex](const FString& Result, bool bSucceeded, const FRuntimeFilesDownloaderStats& Stats)
+			{
+				SharedThis->SampleMemory();
+
+				FCaseResult CaseResult;
+				CaseResult.Name = CaseName;
+				CaseResult.Result = Result;
+				CaseResult.bSucceeded = bSucceeded;
+				CaseResult.Stats = Stats;
+				CaseResult.WallTime = FPlatformTime::Seconds() - SharedThis->CaseStartTime;
+				CaseResult.GameThreadTime = FRuntimeFilesDownloaderGameThreadScope::GetSeconds() - SharedThis->CaseStartGameThreadTime;
+				CaseResult.PeakMemoryIncrease = SharedThis->CasePeakMemory - SharedThis->CaseStartMemory;
+				LogCaseResult(CaseResult);
+				SharedThis->Results.Add(MoveTemp(CaseResult));
+
+				// The next case is started on the next tick, so that the completion of this one is fully unwound and not measured as part of the next
+				AsyncTask(ENamedThreads::GameThread, [SharedThis, CaseIndex]()
+				{
+					SharedThis->RunCase(CaseIndex + 1);
+				});
+			});
+		}
+
+		void SampleMemory()
+		{
+			if (CurrentCaseIndex != INDEX_NONE)
+			{
+				CasePeakMemory = FMath::Max(CasePeakMemory, static_cast<int64>(FPlatformMemory::GetStats().UsedPhysical));
+			}
+		}
+
+		void Finish()
+		{
+			CurrentCaseIndex = INDEX_NONE;
+			bFinished = true;
+
+			// The results are also written as CSV, so that they can be collected and compared by CI
+			int32 SkippedCount = 0;
+			FString CSV = TEXT("Case,Result,Succeeded,BytesReceived,WallTimeSeconds,ThroughputMBps,GameThreadMs,PeakMemoryIncreaseMB,TimeToFirstByteSeconds,Chunks,Retries,BytesWasted\n");
+			for (const FCaseResult& CaseResult : Results)
+			{
+				if (CaseResult.bSkipped)
+				{
+					++SkippedCount;
+					UE_LOG(LogRuntimeFilesDownloader, Display, TEXT("Benchmark '%s' was skipped: %s"), *CaseResult.Name, *CaseResult.Result);
+				}
+				CSV += FString::Printf(TEXT("\"%s\",\"%s\",%d,%lld,%.4f,%.3f,%.3f,%.3f,%.4f,%d,%d,%lld\n"), *CaseResult.Name, *CaseResult.Result, CaseResult.bSucceeded, CaseResult.Stats.BytesReceived, CaseResult.WallTime,
+				                       CaseResult.Stats.Throughput / (1024.0f * 1024.0f), CaseResult.GameThreadTime * 1000.0, static_cast<double>(CaseResult.PeakMemoryIncrease) / (1024.0 * 1024.0),
+				                       CaseResult.Stats.TimeToFirstByte, CaseResult.Stats.ChunkCount, CaseResult.Stats.RetryCount, CaseResult.Stats.BytesWasted);
+			}
+
+			const FString ResultsPath = FPaths::ConvertRelativePathToFull(FPaths::ProjectSavedDir() / TEXT("RuntimeFilesDownloaderBenchmark") / TEXT("Results.csv"));
+			FFileHelper::SaveStringToFile(CSV, *ResultsPath);
+
+			UE_LOG(LogRuntimeFilesDownloader, Display, TEXT("Downloads benchmark has finished with %d of %d cases skipped, the results are written to %s"), SkippedCount, Results.Num(), *ResultsPath);
+			Server.Reset();
+		}
+
+		/** The test server serving the files, if any */
+		TSharedPtr<FRuntimeFilesDownloaderTestServer> Server;
+
+		/** The benchmark cases */
+		TArray<FCase> Cases;
+
+		/** The results of the cases that have been run */
+		TArray<FCaseResult> Results;
+
+		/** The index of the running case, or INDEX_NONE if none is running */
+		int32 CurrentCaseIndex;
+
+		/** The time the running case was started at, in seconds */
+		double CaseStartTime;
+
+		/** The game thread time spent by the plugin when the running case was started, in seconds */
+		double CaseStartGameThreadTime;
+
+		/** The physical memory used by the process when the running case was started, in bytes */
+		int64 CaseStartMemory;
+
+		/** The peak physical memory used by the process during the running case, in bytes */
+		int64 CasePeakMemory;
+
+		/** Whether all the cases have been run */
+		bool bFinished;
+	};
+
+	/**
+	 * Start the test server with the specified conditions, serving a generated file of each size
+	 *
+	 * @param Conditions The network conditions to simulate
+	 * @param FileSizes The sizes of the files to serve
+	 * @param OutFiles The URLs of the served files along with their sizes
+	 * @return The started server, or nullptr if it could not be started
+	 */
+	static TSharedPtr<FRuntimeFilesDownloaderTestServer> StartTestServer(const FRuntimeFilesDownloaderTestServerConditions& Conditions, const TArray<int64>& FileSizes, TArray<TPair<FString, int64>>& OutFiles)
+	{
+		TSharedPtr<FRuntimeFilesDownloaderTestServer> Server = MakeShared<FRuntimeFilesDownloaderTestServer>(Conditions);
+		if (!Server->Start())
+		{
+			return nullptr;
+		}
+
+		for (int64 FileSize : FileSizes)
+		{
+			const FString Path = FString::Printf(TEXT("/%lld.bin"), FileSize);
+			Server->AddFile(Path, FileSize);
+			OutFiles.Add(TPair<FString, int64>(Server->GetURL(Path), FileSize));
+		}
+		return Server;
+	}
+
+	/**
+	 * Parse a comma-separated list of sizes from the command line
+	 */
+	static TArray<int64> ParseSizes(const FString& CommandLine, const TCHAR* Name, const TArray<int64>& DefaultSizes)
+	{
+		FString SizesString;
+		if (!FParse::Value(*CommandLine, Name, SizesString, false))
+		{
+			return DefaultSizes;
+		}
+
+		TArray<FString> SizeStrings;
+		SizesString.ParseIntoArray(SizeStrings, TEXT(","));
+
+		TArray<int64> Sizes;
+		for (const FString& SizeString : SizeStrings)
+		{
+			const int64 Size = FCString::Atoi64(*SizeString);
+			if (Size > 0)
+			{
+				Sizes.Add(Size);
+			}
+		}
+		return Sizes.Num() > 0 ? Sizes : DefaultSizes;
+	}
+
+	static FAutoConsoleCommand BenchmarkCommand(
+		TEXT("RuntimeFilesDownloader.Benchmark"),
+		TEXT("Download files using every download path and log the throughput, latency, game thread time and memory for each. Without a URL, the files are served by a test server on the loopback interface.\n")
+		TEXT("The files range from 1 KB to 8 GB by default. Cases that do not fit in the available memory or disk space are skipped and reported.\n")
+		TEXT("Usage: RuntimeFilesDownloader.Benchmark [URL] [-ChunkSizes=1048576,8388608] [-FileSizes=65536,1048576] [-MaxFileSize=8589934592] [-LatencyMs=50] [-BandwidthKBps=1024] [-FaultRate=0.1] [-Chunked] [-IgnoreRange]"),
+		FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+		{
+			const FString CommandLine = TEXT(" ") + FString::Join(Args, TEXT(" "));
+			const TArray<int64> ChunkSizes = ParseSizes(CommandLine, TEXT("ChunkSizes="), DefaultChunkSizes);
+
+			TSharedPtr<FRuntimeFilesDownloaderTestServer> Server;
+			TArray<TPair<FString, int64>> Files;
+			if (Args.Num() > 0 && !Args[0].StartsWith(TEXT("-")))
+			{
+				Files.Add(TPair<FString, int64>(Args[0], 0));
+			}
+			else
+			{
+				FRuntimeFilesDownloaderTestServerConditions Conditions;
+				int32 LatencyMs = 0, BandwidthKBps = 0;
+				FParse::Value(*CommandLine, TEXT("LatencyMs="), LatencyMs);
+				FParse::Value(*CommandLine, TEXT("BandwidthKBps="), BandwidthKBps);
+				FParse::Value(*CommandLine, TEXT("FaultRate="), Conditions.FaultRate);
+				Conditions.Latency = LatencyMs / 1000.0f;
+				Conditions.BytesPerSecond = static_cast<int64>(BandwidthKBps) * 1024;
+				Conditions.bChunkedEncoding = FParse::Param(*CommandLine, TEXT("Chunked"));
+				Conditions.bIgnoreRange = FParse::Param(*CommandLine, TEXT("IgnoreRange"));
+
+				int64 MaxFileSize = DefaultMaxFileSize;
+				FParse::Value(*CommandLine, TEXT("MaxFileSize="), MaxFileSize);
+
+				TArray<int64> FileSizes = ParseSizes(CommandLine, TEXT("FileSizes="), DefaultFileSizes);
+				for (int64 FileSize : FileSizes)
+				{
+					if (FileSize > MaxFileSize)
+					{
+						UE_LOG(LogRuntimeFilesDownloader, Display, TEXT("Benchmark file size %lld skipped: above the maximum file size %lld"), FileSize, MaxFileSize);
+					}
+				}
+				FileSizes.RemoveAll([MaxFileSize](int64 FileSize)
+				{
+					return FileSize > MaxFileSize;
+				});
+
+				Server = StartTestServer(Conditions, FileSizes, Files);
+				if (!Server.IsValid())
+				{
+					return;
+				}
+			}
+
+			MakeShared<FBenchmark>(Server, Files, ChunkSizes)->Run();
+		}));
+}
+
+#if WITH_DEV_AUTOMATION_TESTS
+/**
+ * Waits until all the cases of the benchmark have been run, and fails the test if any of them failed and failures are not expected
+ */
+class FWaitForRuntimeFilesDownloaderBenchmark : public IAutomationLatentCommand
+{
+public:
+	FWaitForRuntimeFilesDownloaderBenchmark(FAutomationTestBase* InTest, TSharedRef<RuntimeFilesDownloaderBenchmark::FBenchmark> InBenchmark, bool bInFailuresExpected)
+		: Test(InTest)
+		, Benchmark(MoveTemp(InBenchmark))
+		, bFailuresExpected(bInFailuresExpected)
+	{
+	}
+
+	virtual bool Update() override
+	{
+		if (!Benchmark->IsFinished())
+		{
+			return false;
+		}
+
+		for (const RuntimeFilesDownloaderBenchmark::FCaseResult& CaseResult : Benchmark->GetResults())
+		{
+			if (!CaseResult.bSucceeded && !CaseResult.bSkipped && !bFailuresExpected)
+			{
+				Test->AddError(FString::Printf(TEXT("Benchmark case '%s' failed: %s"), *CaseResult.Name, *CaseResult.Result));
+			}
+		}
+		return true;
+	}
+
+private:
+	FAutomationTestBase* Test;
+	TSharedRef<RuntimeFilesDownloaderBenchmark::FBenchmark> Benchmark;
+	bool bFailuresExpected;
+};
+
+#if UE_VERSION_OLDER_THAN(5, 5, 0)
+IMPLEMENT_COMPLEX_AUTOMATION_TEST(FRuntimeFilesDownloaderBenchmarkTest, "RuntimeFilesDownloader.Benchmark", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+#else
+IMPLEMENT_COMPLEX_AUTOMATION_TEST(FRuntimeFilesDownloaderBenchmarkTest, "RuntimeFilesDownloader.Benchmark", EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+#endif
+
+void FRuntimeFilesDownloaderBenchmarkTest::GetTests(TArray<FString>& OutBeautifiedNames, TArray<FString>& OutTestCommands) const
+{
+	OutBeautifiedNames.Add(TEXT("Loopback"));
+	OutTestCommands.Add(TEXT("Loopback"));
+	OutBeautifiedNames.Add(TEXT("Latency and bandwidth"));
+	OutTestCommands.Add(TEXT("Shaped"));
+	OutBeautifiedNames.Add(TEXT("Chunked encoding"));
+	OutTestCommands.Add(TEXT("Chunked"));
+	OutBeautifiedNames.Add(TEXT("Range ignored"));
+	OutTestCommands.Add(TEXT("IgnoreRange"));
+	OutBeautifiedNames.Add(TEXT("Dropped connections"));
+	OutTestCommands.Add(TEXT("Faults"));
+}
+
+bool FRuntimeFilesDownloaderBenchmarkTest::RunTest(const FString& Parameters)
+{
+	FRuntimeFilesDownloaderTestServerConditions Conditions;
+	if (Parameters == TEXT("Shaped"))
+	{
+		Conditions.Latency = 0.05f;
+		Conditions.BytesPerSecond = 16 * 1024 * 1024;
+	}
+	else if (Parameters == TEXT("Chunked"))
+	{
+		Conditions.bChunkedEncoding = true;
+	}
+	else if (Parameters == TEXT("IgnoreRange"))
+	{
+		Conditions.bIgnoreRange = true;
+	}
+	else if (Parameters == TEXT("Faults"))
+	{
+		Conditions.FaultRate = 0.2f;
+	}
+
+	// Smaller files than the console command sweeps over, so that the test is quick enough for CI
+	TArray<TPair<FString, int64>> Files;
+	TSharedPtr<FRuntimeFilesDownloaderTestServer> Server = RuntimeFilesDownloaderBenchmark::StartTestServer(Conditions, {16 * 1024, 1024 * 1024, 8 * 1024 * 1024}, Files);
+	if (!Server.IsValid())
+	{
+		AddError(TEXT("Failed to start the test server"));
+		return false;
+	}
+
+	TSharedRef<RuntimeFilesDownloaderBenchmark::FBenchmark> Benchmark = MakeShared<RuntimeFilesDownloaderBenchmark::FBenchmark>(Server, Files, TArray<int64>{256 * 1024, 4 * 1024 * 1024});
+	Benchmark->Run();
+
+	// Dropped connections may legitimately fail a download, they are run to measure the cost of the retries
+	ADD_LATENT_AUTOMATION_COMMAND(FWaitForRuntimeFilesDownloaderBenchmark(this, Benchmark, Parameters == TEXT("Faults")));
+	return true;
+}
+#endif
+#endif
@@ -0,0 +1,135 @@
+// Georgy Treshchev 2024.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Misc/EngineVersionComparison.h"
+#include "Stats/Stats.h"
+#include "HAL/LowLevelMemTracker.h"
+#include "HAL/PlatformTime.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "Templates/Atomic.h"
+
+DECLARE_STATS_GROUP(TEXT("RuntimeFilesDownloader"), STATGROUP_RuntimeFilesDownloader, STATCAT_Advanced);
+
+/** Number of downloaders that currently exist */
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Active Downloads"), STAT_RuntimeFilesDownloader_ActiveDownloads, STATGROUP_RuntimeFilesDownloader, );
+
+/** Number of HTTP requests that have been issued and not yet completed */
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("In-Flight Requests"), STAT_RuntimeFilesDownloader_InFlightRequests, STATGROUP_RuntimeFilesDownloader, );
+
+/** Number of bytes requested by the in-flight chunk requests. A 64-bit stat, since more than 4 GB can be in flight at once */
+DECLARE_QWORD_ACCUMULATOR_STAT_EXTERN(TEXT("In-Flight Bytes"), STAT_RuntimeFilesDownloader_InFlightBytes, STATGROUP_RuntimeFilesDownloader, );
+
+/** Number of requests waiting to be issued, e.g. outstanding chunks of paused downloads */
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Queued Requests"), STAT_RuntimeFilesDownloader_QueuedRequests, STATGROUP_RuntimeFilesDownloader, );
+
+/**
+ * Keeps the in-flight request statistics up to date for the lifetime of the request it is bound to
+ */
+struct FRuntimeFilesDownloaderInFlightRequestStat
+{
+	explicit FRuntimeFilesDownloaderInFlightRequestStat(int64 InRequestedBytes, bool bInForeground)
+		: RequestedBytes(InRequestedBytes)
+		, bForeground(bInForeground)
+	{
+		INC_DWORD_STAT(STAT_RuntimeFilesDownloader_InFlightRequests);
+		INC_QWORD_STAT_BY(STAT_RuntimeFilesDownloader_InFlightBytes, RequestedBytes);
+		if (bForeground)
+		{
+			++GetForegroundRequestCounter();
+		}
+	}
+
+	~FRuntimeFilesDownloaderInFlightRequestStat()
+	{
+		DEC_DWORD_STAT(STAT_RuntimeFilesDownloader_InFlightRequests);
+		DEC_QWORD_STAT_BY(STAT_RuntimeFilesDownloader_InFlightBytes, RequestedBytes);
+		if (bForeground)
+		{
+			--GetForegroundRequestCounter();
+		}
+	}
+
+	/**
+	 * Get the number of in-flight requests made by foreground downloads, i.e. not by prefetching
+	 */
+	static TAtomic<int32>& GetForegroundRequestCounter()
+	{
+		static TAtomic<int32> ForegroundRequests(0);
+		return ForegroundRequests;
+	}
+
+private:
+	/** Number of bytes requested, zero if unknown */
+	int64 RequestedBytes;
+
+	/** Whether the request was made by a foreground download */
+	bool bForeground;
+};
+
+/**
+ * Measures the time spent by the plugin on the game thread, e.g. for the benchmark. Nested scopes are only counted once
+ */
+struct FRuntimeFilesDownloaderGameThreadScope
+{
+	FRuntimeFilesDownloaderGameThreadScope()
+		: bCounted(IsInGameThread() && GetDepth()++ == 0)
+		, StartCycles(bCounted ? FPlatformTime::Cycles64() : 0)
+	{
+	}
+
+	~FRuntimeFilesDownloaderGameThreadScope()
+	{
+		if (IsInGameThread())
+		{
+			--GetDepth();
+		}
+		if (bCounted)
+		{
+			GetCycles() += FPlatformTime::Cycles64() - StartCycles;
+		}
+	}
+
+	/**
+	 * Get the total time spent by the plugin on the game thread so far, in seconds
+	 */
+	static double GetSeconds()
+	{
+		return FPlatformTime::ToSeconds64(GetCycles());
+	}
+
+private:
+	/** Number of scopes currently open on the game thread */
+	static int32& GetDepth()
+	{
+		static int32 Depth = 0;
+		return Depth;
+	}
+
+	/** Cycles spent within the outermost scopes, only modified on the game thread */
+	static uint64& GetCycles()
+	{
+		static uint64 Cycles = 0;
+		return Cycles;
+	}
+
+	/** Whether this is the outermost scope on the game thread */
+	bool bCounted;
+
+	/** Cycle counter value at the start of the scope */
+	uint64 StartCycles;
+};
+
+/** Count the time spent within the scope towards the game thread time of the plugin */
+#define RUNTIMEFILESDOWNLOADER_GAME_THREAD_SCOPE FRuntimeFilesDownloaderGameThreadScope ANONYMOUS_VARIABLE(RuntimeFilesDownloaderGameThreadScope)
+
+#if !UE_VERSION_OLDER_THAN(5, 1, 0)
+LLM_DECLARE_TAG(RuntimeFilesDownloader);
+
+/** Tag the memory allocated within the scope as download buffers */
+#define RUNTIMEFILESDOWNLOADER_LLM_SCOPE LLM_SCOPE_BYTAG(RuntimeFilesDownloader)
+#else
+/** Tag the memory allocated within the scope as download buffers. Custom tags are not supported by older engine versions, so the networking tag is used */
+#define RUNTIMEFILESDOWNLOADER_LLM_SCOPE LLM_SCOPE(ELLMTag::Networking)
+#endif
@@ -0,0 +1,166 @@
+// Georgy Treshchev 2024.
+
+#include "CoreMinimal.h"
+
+#if !UE_BUILD_SHIPPING && WITH_DEV_AUTOMATION_TESTS
+#include "RuntimeChunkDownloader.h"
+#include "RuntimeFilesDownloaderTestServer.h"
+#include "RuntimePrefetchManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/EngineVersionComparison.h"
+
+namespace RuntimeFilesDownloaderSessionTest
+{
+	/** Size of the served files, large enough for the downloads to still be in progress when the session ends */
+	constexpr int64 FileSize = 4 * 1024 * 1024;
+
+	/** Time the downloads are given to start before the session ends, in seconds */
+	constexpr double TravelDelay = 0.5;
+
+	/** Time the downloads are given to finish after the session has ended, in seconds */
+	constexpr double Timeout = 30;
+
+	/**
+	 * State of the test shared with its latent command
+	 */
+	struct FState
+	{
+		/** The server the files are downloaded from */
+		TSharedPtr<FRuntimeFilesDownloaderTestServer> Server;
+
+		/** The URL of the prefetched file */
+		FString PrefetchURL;
+
+		/** The result of the download tied to the session, once complete */
+		TOptional<EDownloadToMemoryResult> SessionResult;
+
+		/** Time the downloads were started at, in seconds */
+		double StartTime = 0;
+
+		/** Time the session ended at, in seconds. Zero until then */
+		double TravelTime = 0;
+	};
+}
+
+/**
+ * Ends the session once the downloads are in progress, as a travel to another map does, then waits until the download tied to the session is canceled and the prefetch is complete
+ */
+class FWaitForRuntimeFilesDownloaderSessionEnd : public IAutomationLatentCommand
+{
+public:
+	FWaitForRuntimeFilesDownloaderSessionEnd(FAutomationTestBase* InTest, TSharedRef<RuntimeFilesDownloaderSessionTest::FState> InState)
+		: Test(InTest)
+		, State(MoveTemp(InState))
+	{
+	}
+
+	virtual bool Update() override
+	{
+		using namespace RuntimeFilesDownloaderSessionTest;
+
+		FRuntimePrefetchManager& PrefetchManager = FRuntimePrefetchManager::Get();
+		const double Now = FPlatformTime::Seconds();
+
+		if (State->TravelTime <= 0)
+		{
+			if (Now - State->StartTime < TravelDelay)
+			{
+				return false;
+			}
+
+			if (State->SessionResult.IsSet() || PrefetchManager.IsPrefetchComplete(State->PrefetchURL))
+			{
+				Test->AddError(TEXT("The downloads completed before the session ended, the served files are too small for the test"));
+				PrefetchManager.CancelPrefetch(State->PrefetchURL);
+				return true;
+			}
+
+			// The same cancellation the module performs when a world is cleaned up at the end of the session
+			FRuntimeChunkDownloader::CancelSessionDownloads();
+			State->TravelTime = Now;
+			return false;
+		}
+
+		const bool bPrefetchComplete = PrefetchManager.IsPrefetchComplete(State->PrefetchURL);
+		if (!State->SessionResult.IsSet() || !bPrefetchComplete)
+		{
+			if (Now - State->TravelTime > Timeout)
+			{
+				Test->AddError(FString::Printf(TEXT("The downloads did not finish within %.0f seconds after the session ended"), Timeout));
+				PrefetchManager.CancelPrefetch(State->PrefetchURL);
+				return true;
+			}
+			return false;
+		}
+
+		Test->TestEqual(TEXT("Result of the download tied to the session"), UEnum::GetValueAsString(State->SessionResult.GetValue()), UEnum::GetValueAsString(EDownloadToMemoryResult::Cancelled));
+
+		// The complete prefetch is claimed right away, without downloading the file again
+		TFuture<FRuntimeChunkDownloaderResult> PrefetchFuture = PrefetchManager.Request(State->PrefetchURL, 0, FString(), [](int64, int64) {});
+		if (!PrefetchFuture.IsReady())
+		{
+			Test->AddError(TEXT("The prefetch survived the end of the session but its data was not reused"));
+			return true;
+		}
+
+		const FRuntimeChunkDownloaderResult PrefetchResult = PrefetchFuture.Get();
+		Test->TestEqual(TEXT("Result of the prefetch"), UEnum::GetValueAsString(PrefetchResult.Result), UEnum::GetValueAsString(EDownloadToMemoryResult::Success));
+		Test->TestEqual(TEXT("Size of the prefetched data"), PrefetchResult.Data.Num(), FileSize);
+		if (PrefetchResult.Data.Num() == FileSize)
+		{
+			Test->TestEqual(TEXT("Last byte of the prefetched data"), static_cast<int32>(PrefetchResult.Data.Last()), static_cast<int32>(FRuntimeFilesDownloaderTestServer::GetFileByte(FileSize - 1)));
+		}
+		return true;
+	}
+
+private:
+	FAutomationTestBase* Test;
+	TSharedRef<RuntimeFilesDownloaderSessionTest::FState> State;
+};
+
+#if UE_VERSION_OLDER_THAN(5, 5, 0)
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FRuntimeFilesDownloaderSessionEndTest, "RuntimeFilesDownloader.SessionEnd", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+#else
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FRuntimeFilesDownloaderSessionEndTest, "RuntimeFilesDownloader.SessionEnd", EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+#endif
+
+bool FRuntimeFilesDownloaderSessionEndTest::RunTest(const FString& Parameters)
+{
+	using namespace RuntimeFilesDownloaderSessionTest;
+
+	// The bandwidth is limited so that both downloads are still in progress when the session ends
+	FRuntimeFilesDownloaderTestServerConditions Conditions;
+	Conditions.BytesPerSecond = 1024 * 1024;
+
+	TSharedRef<FState> State = MakeShared<FState>();
+	State->Server = MakeShared<FRuntimeFilesDownloaderTestServer>(Conditions);
+	if (!State->Server->Start())
+	{
+		AddError(TEXT("Failed to start the test server"));
+		return false;
+	}
+	State->Server->AddFile(TEXT("/Prefetch.bin"), FileSize);
+	State->Server->AddFile(TEXT("/Session.bin"), FileSize);
+	State->PrefetchURL = State->Server->GetURL(TEXT("/Prefetch.bin"));
+
+	FRuntimePrefetchManager::Get().Prefetch(State->PrefetchURL);
+
+	// A background download tied to the session, as the downloader objects do, which does not hold the prefetch back
+	TSharedRef<FRuntimeChunkDownloader> SessionDownloader = MakeShared<FRuntimeChunkDownloader>();
+	SessionDownloader->SetBackground(true);
+	SessionDownloader->SetCancelOnSessionEnd(true);
+	TWeakPtr<FState> WeakState = State;
+	SessionDownloader->DownloadFile(State->Server->GetURL(TEXT("/Session.bin")), 0, FString(), 256 * 1024, [](int64, int64) {}).Next([SessionDownloader, WeakState](FRuntimeChunkDownloaderResult&& Result)
+	{
+		if (TSharedPtr<FState> PinnedState = WeakState.Pin())
+		{
+			PinnedState->SessionResult = Result.Result;
+		}
+	});
+
+	State->StartTime = FPlatformTime::Seconds();
+	ADD_LATENT_AUTOMATION_COMMAND(FWaitForRuntimeFilesDownloaderSessionEnd(this, State));
+	return true;
+}
+#endif
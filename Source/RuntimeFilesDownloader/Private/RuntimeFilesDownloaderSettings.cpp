@@ -0,0 +1,24 @@
+// Georgy Treshchev 2024.
+
+#include "RuntimeFilesDownloaderSettings.h"
+
+URuntimeFilesDownloaderSettings::URuntimeFilesDownloaderSettings()
+	: bAcceptCompressedContent(false)
+	, bDecompressCompressedFiles(false)
+	, TextureCacheBudgetMB(64)
+	, bProcessDownloadsOnWorkerThreads(true)
+	, ProgressCallbackInterval(0.0f)
+	, bPausePrefetchDuringNetworkedPlay(true)
+	, MaxPrefetchedMB(256)
+	, bCheckDiskSpaceBeforeDownload(true)
+	, MinFreeDiskSpaceMB(64)
+	, bFastStartDownloads(false)
+	, bResumeDownloadQueueOnStartup(true)
+	, DownloadQueueMaxAttempts(3)
+{
+}
+
+FName URuntimeFilesDownloaderSettings::GetCategoryName() const
+{
+	return TEXT("Plugins");
+}
@@ -0,0 +1,380 @@
+// Georgy Treshchev 2024.
+
+#include "RuntimeFilesDownloaderTestServer.h"
+
+#if !UE_BUILD_SHIPPING
+#include "RuntimeFilesDownloaderDefines.h"
+#include "Async/Async.h"
+#include "Common/TcpListener.h"
+#include "Common/TcpSocketBuilder.h"
+#include "HAL/PlatformProcess.h"
+#include "HAL/PlatformTime.h"
+#include "Interfaces/IPv4/IPv4Endpoint.h"
+#include "Math/RandomStream.h"
+#include "Sockets.h"
+#include "SocketSubsystem.h"
+
+namespace
+{
+	/** The number of body bytes sent at once, which is also the granularity of the bandwidth limit */
+	constexpr int64 BodySliceSize = 64 * 1024;
+
+	/** The time an idle connection is kept open for, in seconds */
+	constexpr double ConnectionIdleTimeout = 30;
+
+	/** The maximum size of the request headers */
+	constexpr int32 MaxRequestHeadSize = 64 * 1024;
+}
+
+FRuntimeFilesDownloaderTestServer::FRuntimeFilesDownloaderTestServer(const FRuntimeFilesDownloaderTestServerConditions& InConditions)
+	: Conditions(InConditions)
+	, Port(0)
+	, bStopping(false)
+{
+}
+
+FRuntimeFilesDownloaderTestServer::~FRuntimeFilesDownloaderTestServer()
+{
+	bStopping = true;
+
+	// Stop accepting first, so that no connection is added while waiting for the others
+	Listener.Reset();
+
+	TArray<TFuture<void>> ConnectionsToWait;
+	{
+		FScopeLock ScopeLock(&Lock);
+		ConnectionsToWait = MoveTemp(Connections);
+	}
+
+	for (TFuture<void>& Connection : ConnectionsToWait)
+	{
+		Connection.Wait();
+	}
+}
+
+bool FRuntimeFilesDownloaderTestServer::Start()
+{
+	FSocket* ListenSocket = FTcpSocketBuilder(TEXT("RuntimeFilesDownloaderTestServer"))
+		.AsReusable()
+		.BoundToEndpoint(FIPv4Endpoint(FIPv4Address(127, 0, 0, 1), 0))
+		.Listening(16)
+		.Build();
+
+	if (!ListenSocket)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to start the test server: unable to listen on the loopback interface"));
+		return false;
+	}
+
+	Port = ListenSocket->GetPortNo();
+	Listener = MakeUnique<FTcpListener>(*ListenSocket, FTimespan::FromMilliseconds(10));
+	Listener->OnConnectionAccepted().BindRaw(this, &FRuntimeFilesDownloaderTestServer::HandleConnectionAccepted);
+
+	UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Test server is listening on port %d (latency %.3f s, %lld bytes per second, fault rate %.2f, ignore range %d, chunked encoding %d)"),
+	       Port, Conditions.Latency, Conditions.BytesPerSecond, Conditions.FaultRate, Conditions.bIgnoreRange, Conditions.bChunkedEncoding);
+	return true;
+}
+
+void FRuntimeFilesDownloaderTestServer::AddFile(const FString& Path, int64 Size)
+{
+	FScopeLock ScopeLock(&Lock);
+	Files.Add(Path, Size);
+}
+
+FString FRuntimeFilesDownloaderTestServer::GetURL(const FString& Path) const
+{
+	return FString::Printf(TEXT("http://127.0.0.1:%d%s"), Port, *Path);
+}
+
+uint8 FRuntimeFilesDownloaderTestServer::GetFileByte(int64 Offset)
+{
+	// Varies with the offset in every byte, so that shifted or spliced data does not go unnoticed, and is not trivially compressible
+	return static_cast<uint8>((Offset ^ (Offset >> 8) ^ (Offset >> 16) ^ (Offset >> 24)) * 167 + 13);
+}
+
+bool FRuntimeFilesDownloaderTestServer::HandleConnectionAccepted(FSocket* Socket, const FIPv4Endpoint& Endpoint)
+{
+	if (bStopping)
+	{
+		return false;
+	}
+
+	FScopeLock ScopeLock(&Lock);
+	Connections.RemoveAll([](const TFuture<void>& Connection)
+	{
+		return Connection.IsReady();
+	});
+
+	// Each connection gets its own thread, since the simulated latency and bandwidth keep it waiting
+	Connections.Add(Async(EAsyncExecution::Thread, [this, Socket]()
+	{
+		ServeConnection(Socket);
+	}));
+	return true;
+}
+
+void FRuntimeFilesDownloaderTestServer::ServeConnection(FSocket* Socket)
+{
+	FRandomStream RandomStream(static_cast<int32>(FPlatformTime::Cycles()));
+	TArray<uint8> Buffer;
+	FRequest Request;
+	while (!bStopping && ReceiveRequest(Socket, Buffer, Request))
+	{
+		if (!SendResponse(Socket, Request, RandomStream))
+		{
+			break;
+		}
+	}
+
+	Socket->Close();
+	ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(Socket);
+}
+
+bool FRuntimeFilesDownloaderTestServer::ReceiveRequest(FSocket* Socket, TArray<uint8>& Buffer, FRequest& OutRequest) const
+{
+	static const uint8 HeadEnd[] = {'\r', '\n', '\r', '\n'};
+	auto FindHeadEnd = [&Buffer]() -> int32
+	{
+		for (int32 Index = 0; Index + UE_ARRAY_COUNT(HeadEnd) <= Buffer.Num(); ++Index)
+		{
+			if (FMemory::Memcmp(Buffer.GetData() + Index, HeadEnd, UE_ARRAY_COUNT(HeadEnd)) == 0)
+			{
+				return Index;
+			}
+		}
+		return INDEX_NONE;
+	};
+
+	const double IdleStartTime = FPlatformTime::Seconds();
+	int32 HeadEndIndex = FindHeadEnd();
+	while (HeadEndIndex == INDEX_NONE)
+	{
+		if (bStopping || Buffer.Num() > MaxRequestHeadSize || FPlatformTime::Seconds() - IdleStartTime > ConnectionIdleTimeout)
+		{
+			return false;
+		}
+
+		if (!Socket->Wait(ESocketWaitConditions::WaitForRead, FTimespan::FromMilliseconds(100)))
+		{
+			continue;
+		}
+
+		uint8 ReceiveBuffer[4096];
+		int32 BytesRead = 0;
+		if (!Socket->Recv(ReceiveBuffer, sizeof(ReceiveBuffer), BytesRead) || BytesRead <= 0)
+		{
+			// The client closed the connection
+			return false;
+		}
+
+		Buffer.Append(ReceiveBuffer, BytesRead);
+		HeadEndIndex = FindHeadEnd();
+	}
+
+	const FUTF8ToTCHAR HeadConverter(reinterpret_cast<const ANSICHAR*>(Buffer.GetData()), HeadEndIndex);
+	const FString Head(HeadConverter.Length(), HeadConverter.Get());
+	Buffer.RemoveAt(0, HeadEndIndex + UE_ARRAY_COUNT(HeadEnd));
+
+	TArray<FString> Lines;
+	Head.ParseIntoArrayLines(Lines);
+	if (Lines.Num() == 0)
+	{
+		return false;
+	}
+
+	TArray<FString> RequestLineParts;
+	Lines[0].ParseIntoArrayWS(RequestLineParts);
+	if (RequestLineParts.Num() < 2)
+	{
+		return false;
+	}
+
+	OutRequest.Method = RequestLineParts[0];
+	OutRequest.Path = RequestLineParts[1];
+	OutRequest.Headers.Reset();
+
+	int32 QueryIndex;
+	if (OutRequest.Path.FindChar(TEXT('?'), QueryIndex))
+	{
+		OutRequest.Path.LeftInline(QueryIndex);
+	}
+
+	for (int32 LineIndex = 1; LineIndex < Lines.Num(); ++LineIndex)
+	{
+		FString Name, Value;
+		if (Lines[LineIndex].Split(TEXT(":"), &Name, &Value))
+		{
+			OutRequest.Headers.Add(Name.TrimStartAndEnd().ToLower(), Value.TrimStartAndEnd());
+		}
+	}
+	return true;
+}
+
+bool FRuntimeFilesDownloaderTestServer::SendResponse(FSocket* Socket, const FRequest& Request, FRandomStream& RandomStream) const
+{
+	auto SendHead = [Socket](const FString& HeadString)
+	{
+		const FTCHARToUTF8 HeadUTF8(*HeadString);
+		return SendAll(Socket, reinterpret_cast<const uint8*>(HeadUTF8.Get()), HeadUTF8.Length());
+	};
+
+	const bool bKeepAlive = !Request.Headers.FindRef(TEXT("connection")).Equals(TEXT("close"), ESearchCase::IgnoreCase);
+	const bool bHead = Request.Method == TEXT("HEAD");
+	if (!bHead && Request.Method != TEXT("GET"))
+	{
+		return SendHead(TEXT("HTTP/1.1 405 Method Not Allowed\r\nContent-Length: 0\r\n\r\n")) && bKeepAlive;
+	}
+
+	int64 FileSize;
+	{
+		FScopeLock ScopeLock(&Lock);
+		const int64* FoundFileSize = Files.Find(Request.Path);
+		if (!FoundFileSize)
+		{
+			return SendHead(TEXT("HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n")) && bKeepAlive;
+		}
+		FileSize = *FoundFileSize;
+	}
+
+	// Only a single byte range is supported, a request for several ranges is answered with the whole file as the specification allows
+	int64 BodyStart = 0, BodyEnd = FileSize - 1;
+	bool bPartial = false;
+	const FString* RangeHeader = Request.Headers.Find(TEXT("range"));
+	if (RangeHeader && !Conditions.bIgnoreRange && !bHead && RangeHeader->StartsWith(TEXT("bytes=")) && !RangeHeader->Contains(TEXT(",")))
+	{
+		FString StartString, EndString;
+		RangeHeader->RightChop(6).Split(TEXT("-"), &StartString, &EndString);
+		StartString.TrimStartAndEndInline();
+		EndString.TrimStartAndEndInline();
+
+		if (StartString.IsEmpty())
+		{
+			// A suffix range requests the last bytes of the file
+			BodyStart = FMath::Max<int64>(FileSize - FCString::Atoi64(*EndString), 0);
+		}
+		else
+		{
+			BodyStart = FCString::Atoi64(*StartString);
+			if (!EndString.IsEmpty())
+			{
+				BodyEnd = FMath::Min(FCString::Atoi64(*EndString), FileSize - 1);
+			}
+		}
+
+		if (BodyStart >= FileSize || BodyStart > BodyEnd)
+		{
+			return SendHead(FString::Printf(TEXT("HTTP/1.1 416 Range Not Satisfiable\r\nContent-Range: bytes */%lld\r\nContent-Length: 0\r\n\r\n"), FileSize)) && bKeepAlive;
+		}
+		bPartial = true;
+	}
+
+	if (Conditions.Latency > 0)
+	{
+		FPlatformProcess::Sleep(Conditions.Latency);
+	}
+
+	const int64 BodySize = BodyEnd - BodyStart + 1;
+	FString Head = bPartial ? TEXT("HTTP/1.1 206 Partial Content\r\n") : TEXT("HTTP/1.1 200 OK\r\n");
+	Head += TEXT("Content-Type: application/octet-stream\r\n");
+	Head += FString::Printf(TEXT("Accept-Ranges: %s\r\n"), Conditions.bIgnoreRange ? TEXT("none") : TEXT("bytes"));
+	Head += FString::Printf(TEXT("ETag: \"%lld\"\r\n"), FileSize);
+	if (bPartial)
+	{
+		Head += FString::Printf(TEXT("Content-Range: bytes %lld-%lld/%lld\r\n"), BodyStart, BodyEnd, FileSize);
+	}
+
+	const bool bChunked = Conditions.bChunkedEncoding && !bHead;
+	Head += bChunked ? TEXT("Transfer-Encoding: chunked\r\n") : FString::Printf(TEXT("Content-Length: %lld\r\n"), BodySize);
+	Head += bKeepAlive ? TEXT("\r\n") : TEXT("Connection: close\r\n\r\n");
+
+	if (!SendHead(Head))
+	{
+		return false;
+	}
+
+	if (bHead)
+	{
+		return bKeepAlive;
+	}
+
+	// A faulty response is cut off halfway, which the client sees as a dropped connection
+	const bool bFault = Conditions.FaultRate > 0 && RandomStream.FRand() < Conditions.FaultRate;
+	const int64 SentBodySize = bFault ? BodySize / 2 : BodySize;
+
+	TArray<uint8> Slice;
+	const double SendStartTime = FPlatformTime::Seconds();
+	for (int64 SliceStart = 0; SliceStart < SentBodySize && !bStopping; SliceStart += BodySliceSize)
+	{
+		const int64 SliceSize = FMath::Min(BodySliceSize, SentBodySize - SliceStart);
+		Slice.Reset();
+		if (bChunked)
+		{
+			const FTCHARToUTF8 ChunkSizeUTF8(*FString::Printf(TEXT("%llx\r\n"), SliceSize));
+			Slice.Append(reinterpret_cast<const uint8*>(ChunkSizeUTF8.Get()), ChunkSizeUTF8.Length());
+		}
+
+		const int32 DataIndex = Slice.Num();
+		Slice.AddUninitialized(static_cast<int32>(SliceSize));
+		for (int64 Offset = 0; Offset < SliceSize; ++Offset)
+		{
+			Slice[DataIndex + Offset] = GetFileByte(BodyStart + SliceStart + Offset);
+		}
+
+		if (bChunked)
+		{
+			Slice.Append(reinterpret_cast<const uint8*>("\r\n"), 2);
+		}
+
+		if (!SendAll(Socket, Slice.GetData(), Slice.Num()))
+		{
+			return false;
+		}
+
+		if (Conditions.BytesPerSecond > 0)
+		{
+			const double ExpectedTime = static_cast<double>(SliceStart + SliceSize) / Conditions.BytesPerSecond;
+			const double ElapsedTime = FPlatformTime::Seconds() - SendStartTime;
+			if (ExpectedTime > ElapsedTime)
+			{
+				FPlatformProcess::Sleep(static_cast<float>(ExpectedTime - ElapsedTime));
+			}
+		}
+	}
+
+	if (bFault || bStopping)
+	{
+		return false;
+	}
+
+	if (bChunked && !SendHead(TEXT("0\r\n\r\n")))
+	{
+		return false;
+	}
+	return bKeepAlive;
+}
+
+bool FRuntimeFilesDownloaderTestServer::SendAll(FSocket* Socket, const uint8* Data, int64 Size)
+{
+	while (Size > 0)
+	{
+		int32 BytesSent = 0;
+		if (!Socket->Send(Data, static_cast<int32>(FMath::Min<int64>(Size, TNumericLimits<int32>::Max())), BytesSent))
+		{
+			return false;
+		}
+
+		if (BytesSent <= 0)
+		{
+			if (!Socket->Wait(ESocketWaitConditions::WaitForWrite, FTimespan::FromSeconds(ConnectionIdleTimeout)))
+			{
+				return false;
+			}
+			continue;
+		}
+
+		Data += BytesSent;
+		Size -= BytesSent;
+	}
+	return true;
+}
+#endif
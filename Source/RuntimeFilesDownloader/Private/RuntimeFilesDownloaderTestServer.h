@@ -0,0 +1,146 @@
+// Georgy Treshchev 2024.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#if !UE_BUILD_SHIPPING
+#include "Async/Future.h"
+#include "Templates/Atomic.h"
+
+class FSocket;
+class FTcpListener;
+struct FIPv4Endpoint;
+
+/**
+ * Network conditions simulated by the test server
+ */
+struct FRuntimeFilesDownloaderTestServerConditions
+{
+	/** Delay before each response is sent, in seconds */
+	float Latency = 0;
+
+	/** Maximum rate the response bodies are sent at, in bytes per second. Zero for unlimited */
+	int64 BytesPerSecond = 0;
+
+	/** Probability of a response body being cut off halfway by closing the connection, from 0 to 1 */
+	float FaultRate = 0;
+
+	/** Whether to ignore the Range header and always send the whole file, as some servers do */
+	bool bIgnoreRange = false;
+
+	/** Whether to send the response bodies with chunked transfer encoding instead of the Content-Length header */
+	bool bChunkedEncoding = false;
+};
+
+/**
+ * HTTP server on the loopback interface serving generated files, so that the downloads can be benchmarked and tested without a remote server
+ * Supports HEAD requests, single byte ranges and chunked transfer encoding, and simulates latency, limited bandwidth and dropped connections
+ */
+class FRuntimeFilesDownloaderTestServer
+{
+public:
+	explicit FRuntimeFilesDownloaderTestServer(const FRuntimeFilesDownloaderTestServerConditions& InConditions);
+	~FRuntimeFilesDownloaderTestServer();
+
+	/**
+	 * Start listening on a free port of the loopback interface
+	 *
+	 * @return True if the server is listening, false otherwise
+	 */
+	bool Start();
+
+	/**
+	 * Serve a generated file of the specified size
+	 *
+	 * @param Path The path of the file on the server, starting with a slash
+	 * @param Size The size of the file in bytes
+	 */
+	void AddFile(const FString& Path, int64 Size);
+
+	/**
+	 * Get the URL of a file served by the server
+	 *
+	 * @param Path The path of the file on the server, starting with a slash
+	 * @return The URL of the file
+	 */
+	FString GetURL(const FString& Path) const;
+
+	/**
+	 * Get the byte at the specified offset of every generated file, used to check the downloaded data
+	 *
+	 * @param Offset The offset in the file
+	 * @return The byte at the offset
+	 */
+	static uint8 GetFileByte(int64 Offset);
+
+private:
+	/** A request received from a client */
+	struct FRequest
+	{
+		FString Method;
+		FString Path;
+
+		/** The headers of the request, with lowercase names */
+		TMap<FString, FString> Headers;
+	};
+
+	/**
+	 * Take over an accepted connection and serve it on its own thread
+	 */
+	bool HandleConnectionAccepted(FSocket* Socket, const FIPv4Endpoint& Endpoint);
+
+	/**
+	 * Serve the requests received on the connection until it is closed
+	 */
+	void ServeConnection(FSocket* Socket);
+
+	/**
+	 * Receive the next request on the connection
+	 *
+	 * @param Socket The socket of the connection
+	 * @param Buffer The bytes received but not processed yet
+	 * @param OutRequest The received request
+	 * @return True if a request was received, false if the connection was closed or has been idle for too long
+	 */
+	bool ReceiveRequest(FSocket* Socket, TArray<uint8>& Buffer, FRequest& OutRequest) const;
+
+	/**
+	 * Send the response to the request
+	 *
+	 * @param Socket The socket of the connection
+	 * @param Request The request to respond to
+	 * @param RandomStream The random stream the faults are simulated with
+	 * @return True if the connection can be kept alive, false otherwise
+	 */
+	bool SendResponse(FSocket* Socket, const FRequest& Request, FRandomStream& RandomStream) const;
+
+	/**
+	 * Send all the bytes, waiting for the socket as needed
+	 *
+	 * @return True if all the bytes were sent, false otherwise
+	 */
+	static bool SendAll(FSocket* Socket, const uint8* Data, int64 Size);
+
+	/** The simulated network conditions */
+	const FRuntimeFilesDownloaderTestServerConditions Conditions;
+
+	/** The listener accepting the connections, which owns the listening socket */
+	TUniquePtr<FTcpListener> Listener;
+
+	/** The port the server listens on */
+	int32 Port;
+
+	/** Guards the files and the connections */
+	mutable FCriticalSection Lock;
+
+	/** The sizes of the served files by path */
+	TMap<FString, int64> Files;
+
+	/** The connections being served */
+	TArray<TFuture<void>> Connections;
+
+	/** Whether the server is shutting down, so that the connections are closed */
+	TAtomic<bool> bStopping;
+};
+#endif
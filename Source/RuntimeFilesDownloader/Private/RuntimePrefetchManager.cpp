@@ -0,0 +1,369 @@
+// Georgy Treshchev 2024.
+
+#include "RuntimePrefetchManager.h"
+
+#include "FileToMemoryDownloader.h"
+#include "RuntimeFilesDownloaderDefines.h"
+#include "RuntimeFilesDownloaderProfiling.h"
+#include "RuntimeFilesDownloaderSettings.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+
+namespace
+{
+	/** The shared prefetch manager, created on first use */
+	TUniquePtr<FRuntimePrefetchManager> SharedPrefetchManager;
+
+	/** The size of the chunks prefetches are downloaded by, so that a prefetch can be paused soon after foreground activity starts */
+	constexpr int64 PrefetchChunkSize = 1024 * 1024;
+
+	/** The interval between checks of the foreground activity, in seconds */
+	constexpr float PrefetchTickInterval = 0.1f;
+
+	/**
+	 * Check whether any world is part of a networked game
+	 */
+	bool IsNetworkedPlayActive()
+	{
+		if (!GEngine)
+		{
+			return false;
+		}
+
+		for (const FWorldContext& WorldContext : GEngine->GetWorldContexts())
+		{
+			const UWorld* World = WorldContext.World();
+			if (World && World->GetNetMode() != NM_Standalone)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+}
+
+FRuntimePrefetchManager::FRuntimePrefetchManager()
+	: ForegroundActivityCount(0)
+	, PrefetchedBytes(0)
+	, MaxPrefetchedBytes(static_cast<int64>(GetDefault<URuntimeFilesDownloaderSettings>()->MaxPrefetchedMB) * 1024 * 1024)
+{
+#if UE_VERSION_OLDER_THAN(5, 0, 0)
+	TickerHandle = FTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FRuntimePrefetchManager::Tick), PrefetchTickInterval);
+#else
+	TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FRuntimePrefetchManager::Tick), PrefetchTickInterval);
+#endif
+}
+
+FRuntimePrefetchManager::~FRuntimePrefetchManager()
+{
+#if UE_VERSION_OLDER_THAN(5, 0, 0)
+	FTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+#else
+	FTSTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+#endif
+	CancelAllPrefetches();
+}
+
+FRuntimePrefetchManager& FRuntimePrefetchManager::Get()
+{
+	check(IsInGameThread());
+	if (!SharedPrefetchManager.IsValid())
+	{
+		SharedPrefetchManager = MakeUnique<FRuntimePrefetchManager>();
+	}
+	return *SharedPrefetchManager;
+}
+
+bool FRuntimePrefetchManager::IsAvailable()
+{
+	return SharedPrefetchManager.IsValid();
+}
+
+void FRuntimePrefetchManager::Shutdown()
+{
+	SharedPrefetchManager.Reset();
+}
+
+void FRuntimePrefetchManager::Prefetch(const FString& URL, float Timeout, const FString& ContentType)
+{
+	if (URL.IsEmpty())
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("You have not provided an URL to prefetch the file"));
+		return;
+	}
+
+	if (Entries.Contains(URL))
+	{
+		return;
+	}
+
+	TSharedRef<FPrefetchEntry> Entry = MakeShared<FPrefetchEntry>();
+	Entry->URL = URL;
+	Entry->Timeout = FMath::Max(Timeout, 0.0f);
+	Entry->ContentType = ContentType;
+	Entries.Add(URL, Entry);
+	Queue.Add(URL);
+
+	UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Queued prefetch of %s"), *URL);
+}
+
+void FRuntimePrefetchManager::CancelPrefetch(const FString& URL)
+{
+	TSharedRef<FPrefetchEntry>* EntryPtr = Entries.Find(URL);
+	if (!EntryPtr)
+	{
+		return;
+	}
+
+	TSharedRef<FPrefetchEntry> Entry = *EntryPtr;
+	Entries.Remove(URL);
+	Queue.Remove(URL);
+	CompletedOrder.Remove(URL);
+
+	if (Entry->bComplete)
+	{
+		PrefetchedBytes -= Entry->Data.Num();
+	}
+	else if (Entry->Downloader.IsValid())
+	{
+		Entry->Downloader->CancelDownload();
+	}
+
+	if (ActiveEntry == Entry)
+	{
+		ActiveEntry.Reset();
+	}
+}
+
+void FRuntimePrefetchManager::CancelAllPrefetches()
+{
+	TArray<FString> URLs;
+	Entries.GetKeys(URLs);
+	for (const FString& URL : URLs)
+	{
+		CancelPrefetch(URL);
+	}
+}
+
+bool FRuntimePrefetchManager::IsPrefetched(const FString& URL) const
+{
+	return Entries.Contains(URL);
+}
+
+bool FRuntimePrefetchManager::IsPrefetchComplete(const FString& URL) const
+{
+	const TSharedRef<FPrefetchEntry>* EntryPtr = Entries.Find(URL);
+	return EntryPtr && (*EntryPtr)->bComplete;
+}
+
+TFuture<FRuntimeChunkDownloaderResult> FRuntimePrefetchManager::Request(const FString& URL, float Timeout, const FString& ContentType, const FRuntimeChunkDownloader::FOnProgress& OnProgress)
+{
+	TSharedPtr<FRuntimeChunkDownloader> Downloader;
+	TFuture<FRuntimeChunkDownloaderResult> Future;
+	if (Claim(URL, OnProgress, Downloader, Future))
+	{
+		return Future;
+	}
+
+	// The continuation keeps the downloader alive until the download is complete
+	TSharedRef<FRuntimeChunkDownloader> NewDownloader = MakeShared<FRuntimeChunkDownloader>();
+	return NewDownloader->DownloadFile(URL, FMath::Max(Timeout, 0.0f), ContentType, TNumericLimits<TArray<uint8>::SizeType>::Max(), OnProgress).Next([NewDownloader](FRuntimeChunkDownloaderResult&& Result)
+	{
+		return MoveTemp(Result);
+	});
+}
+
+bool FRuntimePrefetchManager::Claim(const FString& URL, const FRuntimeChunkDownloader::FOnProgress& OnProgress, TSharedPtr<FRuntimeChunkDownloader>& OutDownloader, TFuture<FRuntimeChunkDownloaderResult>& OutFuture)
+{
+	check(IsInGameThread());
+
+	TSharedRef<FPrefetchEntry>* EntryPtr = Entries.Find(URL);
+	if (!EntryPtr)
+	{
+		return false;
+	}
+
+	TSharedRef<FPrefetchEntry> Entry = *EntryPtr;
+	Entries.Remove(URL);
+
+	// A prefetch that has not started yet has nothing to reuse
+	if (!Entry->Downloader.IsValid())
+	{
+		Queue.Remove(URL);
+		return false;
+	}
+
+	OutDownloader = Entry->Downloader;
+
+	if (Entry->bComplete)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Reusing %lld prefetched bytes of %s"), Entry->Data.Num(), *URL);
+		CompletedOrder.Remove(URL);
+		PrefetchedBytes -= Entry->Data.Num();
+		if (OnProgress)
+		{
+			OnProgress(Entry->Data.Num(), Entry->Data.Num());
+		}
+		OutFuture = MakeFulfilledPromise<FRuntimeChunkDownloaderResult>(FRuntimeChunkDownloaderResult{EDownloadToMemoryResult::Success, MoveTemp(Entry->Data)}).GetFuture();
+		return true;
+	}
+
+	// The prefetch continues as a foreground download from where it is, so the chunks downloaded so far are kept
+	UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Promoting prefetch of %s to a foreground download"), *URL);
+	Entry->PromotedPromise = MakeShared<TPromise<FRuntimeChunkDownloaderResult>>();
+	Entry->PromotedOnProgress = OnProgress;
+	Entry->Downloader->SetBackground(false);
+	if (Entry->Downloader->IsPaused())
+	{
+		Entry->Downloader->ResumeDownload();
+	}
+
+	if (ActiveEntry == Entry)
+	{
+		ActiveEntry.Reset();
+	}
+
+	OutFuture = Entry->PromotedPromise->GetFuture();
+	return true;
+}
+
+void FRuntimePrefetchManager::BeginForegroundActivity()
+{
+	++ForegroundActivityCount;
+}
+
+void FRuntimePrefetchManager::EndForegroundActivity()
+{
+	if (ForegroundActivityCount <= 0)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("EndForegroundActivity was called without a matching BeginForegroundActivity"));
+		return;
+	}
+	--ForegroundActivityCount;
+}
+
+bool FRuntimePrefetchManager::IsForegroundActive() const
+{
+	if (ForegroundActivityCount > 0 || FRuntimeChunkDownloader::GetForegroundRequestCount() > 0)
+	{
+		return true;
+	}
+	return GetDefault<URuntimeFilesDownloaderSettings>()->bPausePrefetchDuringNetworkedPlay && IsNetworkedPlayActive();
+}
+
+void FRuntimePrefetchManager::SetMaxPrefetchedBytes(int64 InMaxPrefetchedBytes)
+{
+	MaxPrefetchedBytes = FMath::Max<int64>(InMaxPrefetchedBytes, 0);
+	EvictOverLimit();
+}
+
+bool FRuntimePrefetchManager::Tick(float DeltaTime)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimePrefetchManager::Tick);
+
+	const bool bForegroundActive = IsForegroundActive();
+	if (ActiveEntry.IsValid())
+	{
+		FRuntimeChunkDownloader& Downloader = *ActiveEntry->Downloader;
+		if (bForegroundActive && !Downloader.IsPaused())
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Pausing prefetch of %s while foreground activity is in progress"), *ActiveEntry->URL);
+			Downloader.PauseDownload();
+		}
+		else if (!bForegroundActive && Downloader.IsPaused())
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Resuming prefetch of %s"), *ActiveEntry->URL);
+			Downloader.ResumeDownload();
+		}
+		return true;
+	}
+
+	if (!bForegroundActive && Queue.Num() > 0)
+	{
+		const FString URL = Queue[0];
+		Queue.RemoveAt(0);
+		if (TSharedRef<FPrefetchEntry>* EntryPtr = Entries.Find(URL))
+		{
+			StartPrefetch(*EntryPtr);
+		}
+	}
+	return true;
+}
+
+void FRuntimePrefetchManager::StartPrefetch(const TSharedRef<FPrefetchEntry>& Entry)
+{
+	UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Starting prefetch of %s"), *Entry->URL);
+
+	// Prefetches are meant for what comes next, such as the next level, so they are not canceled when the session ends on travel
+	Entry->Downloader = MakeShared<FRuntimeChunkDownloader>();
+	Entry->Downloader->SetBackground(true);
+	Entry->Downloader->SetCancelOnSessionEnd(false);
+	ActiveEntry = Entry;
+
+	// The entry is only weakly referenced by the progress, as the downloader it owns keeps the progress function alive
+	TWeakPtr<FPrefetchEntry> WeakEntry = Entry;
+	Entry->Downloader->DownloadFile(Entry->URL, Entry->Timeout, Entry->ContentType, PrefetchChunkSize, [WeakEntry](int64 BytesReceived, int64 ContentSize)
+	{
+		TSharedPtr<FPrefetchEntry> PinnedEntry = WeakEntry.Pin();
+		if (PinnedEntry.IsValid() && PinnedEntry->PromotedOnProgress)
+		{
+			PinnedEntry->PromotedOnProgress(BytesReceived, ContentSize);
+		}
+	}).Next([Entry](FRuntimeChunkDownloaderResult&& Result)
+	{
+		if (IsAvailable())
+		{
+			Get().OnPrefetchComplete(Entry, MoveTemp(Result));
+		}
+		else if (Entry->PromotedPromise.IsValid())
+		{
+			Entry->PromotedPromise->SetValue(MoveTemp(Result));
+		}
+	});
+}
+
+void FRuntimePrefetchManager::OnPrefetchComplete(const TSharedRef<FPrefetchEntry>& Entry, FRuntimeChunkDownloaderResult&& Result)
+{
+	if (ActiveEntry == Entry)
+	{
+		ActiveEntry.Reset();
+	}
+
+	// The prefetch has been promoted, so the result goes to the foreground download
+	if (Entry->PromotedPromise.IsValid())
+	{
+		Entry->PromotedPromise->SetValue(MoveTemp(Result));
+		return;
+	}
+
+	// The prefetch has been canceled or replaced in the meantime
+	const TSharedRef<FPrefetchEntry>* EntryPtr = Entries.Find(Entry->URL);
+	if (!EntryPtr || *EntryPtr != Entry)
+	{
+		return;
+	}
+
+	if (Result.Result != EDownloadToMemoryResult::Success && Result.Result != EDownloadToMemoryResult::SucceededByPayload)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Failed to prefetch %s: %s"), *Entry->URL, *UEnum::GetValueAsString(Result.Result));
+		Entries.Remove(Entry->URL);
+		return;
+	}
+
+	UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Prefetched %lld bytes of %s"), Result.Data.Num(), *Entry->URL);
+	Entry->Data = MoveTemp(Result.Data);
+	Entry->bComplete = true;
+	PrefetchedBytes += Entry->Data.Num();
+	CompletedOrder.Add(Entry->URL);
+	EvictOverLimit();
+}
+
+void FRuntimePrefetchManager::EvictOverLimit()
+{
+	while (PrefetchedBytes > MaxPrefetchedBytes && CompletedOrder.Num() > 0)
+	{
+		const FString URL = CompletedOrder[0];
+		UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Freeing prefetched data of %s to stay within the prefetch limit"), *URL);
+		CancelPrefetch(URL);
+	}
+}
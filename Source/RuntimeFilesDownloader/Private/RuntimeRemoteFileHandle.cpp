@@ -0,0 +1,226 @@
+// Georgy Treshchev 2024.
+
+#include "RuntimeRemoteFileHandle.h"
+
+#include "FileToMemoryDownloader.h"
+#include "RuntimeFilesDownloaderDefines.h"
+#include "RuntimeFilesDownloaderProfiling.h"
+#include "Async/Async.h"
+#include "Misc/ScopeLock.h"
+
+TUniquePtr<FRuntimeRemoteFileHandle> FRuntimeRemoteFileHandle::Open(const FString& URL, float Timeout, int64 BlockSize, int32 MaxCachedBlocks)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeRemoteFileHandle::Open);
+
+	if (IsInGameThread())
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to open the remote file %s: the remote file handle cannot be used on the game thread, since it waits for the requests processed there"), *URL);
+		return nullptr;
+	}
+
+	TSharedRef<TPromise<int64>> ContentSizePromise = MakeShared<TPromise<int64>>();
+	TFuture<int64> ContentSizeFuture = ContentSizePromise->GetFuture();
+	AsyncTask(ENamedThreads::GameThread, [URL, Timeout, ContentSizePromise]()
+	{
+		TSharedRef<FRuntimeChunkDownloader> Downloader = MakeShared<FRuntimeChunkDownloader>();
+		Downloader->GetContentSize(URL, Timeout).Next([Downloader, ContentSizePromise](int64 ContentSize)
+		{
+			ContentSizePromise->SetValue(ContentSize);
+		});
+	});
+
+	const int64 FileSize = ContentSizeFuture.Get();
+	if (FileSize <= 0)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to open the remote file %s: failed to get the file size"), *URL);
+		return nullptr;
+	}
+
+	return MakeUnique<FRuntimeRemoteFileHandle>(URL, Timeout, FileSize, BlockSize, MaxCachedBlocks);
+}
+
+FRuntimeRemoteFileHandle::FRuntimeRemoteFileHandle(const FString& InURL, float InTimeout, int64 InFileSize, int64 InBlockSize, int32 InMaxCachedBlocks)
+	: URL(InURL)
+	, Timeout(InTimeout)
+	, FileSize(InFileSize)
+	, BlockSize(FMath::Max<int64>(InBlockSize, 1))
+	, MaxCachedBlocks(FMath::Max(InMaxCachedBlocks, 2))
+	, Position(0)
+	, ChunkDownloader(MakeShared<FRuntimeChunkDownloader>())
+{
+}
+
+int64 FRuntimeRemoteFileHandle::Tell()
+{
+	return Position;
+}
+
+bool FRuntimeRemoteFileHandle::Seek(int64 NewPosition)
+{
+	if (NewPosition < 0 || NewPosition > FileSize)
+	{
+		return false;
+	}
+	Position = NewPosition;
+	return true;
+}
+
+bool FRuntimeRemoteFileHandle::SeekFromEnd(int64 NewPositionRelativeToEnd)
+{
+	return Seek(FileSize + NewPositionRelativeToEnd);
+}
+
+bool FRuntimeRemoteFileHandle::Read(uint8* Destination, int64 BytesToRead)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeRemoteFileHandle::Read);
+
+	if (BytesToRead < 0 || Position + BytesToRead > FileSize)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to read %lld bytes at %lld from the remote file %s of %lld bytes"), BytesToRead, Position, *URL, FileSize);
+		return false;
+	}
+
+	if (BytesToRead == 0)
+	{
+		return true;
+	}
+
+	if (IsInGameThread())
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to read from the remote file %s: the remote file handle cannot be used on the game thread, since it waits for the requests processed there"), *URL);
+		return false;
+	}
+
+	// Reads larger than the cache are requested directly, bypassing the cache
+	if (BytesToRead >= BlockSize * MaxCachedBlocks)
+	{
+		TArray64<uint8> Data;
+		if (!FetchRange(FInt64Vector2(Position, Position + BytesToRead - 1), Data))
+		{
+			return false;
+		}
+		FMemory::Memcpy(Destination, Data.GetData(), BytesToRead);
+		Position += BytesToRead;
+		return true;
+	}
+
+	FScopeLock ScopeLock(&CacheCriticalSection);
+
+	const int64 LastNeededBlockIndex = (Position + BytesToRead - 1) / BlockSize;
+	while (BytesToRead > 0)
+	{
+		const int64 BlockIndex = Position / BlockSize;
+		const TArray64<uint8>* Block = FindOrFetchBlock(BlockIndex, LastNeededBlockIndex);
+		if (!Block)
+		{
+			return false;
+		}
+
+		const int64 OffsetInBlock = Position - BlockIndex * BlockSize;
+		const int64 BytesFromBlock = FMath::Min(BytesToRead, Block->Num() - OffsetInBlock);
+		FMemory::Memcpy(Destination, Block->GetData() + OffsetInBlock, BytesFromBlock);
+
+		Destination += BytesFromBlock;
+		Position += BytesFromBlock;
+		BytesToRead -= BytesFromBlock;
+	}
+
+	return true;
+}
+
+bool FRuntimeRemoteFileHandle::Write(const uint8* Source, int64 BytesToWrite)
+{
+	UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to write to the remote file %s: the remote file handle is read-only"), *URL);
+	return false;
+}
+
+bool FRuntimeRemoteFileHandle::Flush(const bool bFullFlush)
+{
+	return false;
+}
+
+bool FRuntimeRemoteFileHandle::Truncate(int64 NewSize)
+{
+	return false;
+}
+
+int64 FRuntimeRemoteFileHandle::Size()
+{
+	return FileSize;
+}
+
+bool FRuntimeRemoteFileHandle::FetchRange(FInt64Vector2 Range, TArray64<uint8>& OutData) const
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeRemoteFileHandle::FetchRange);
+
+	// The chunk downloader is not thread-safe, so the request is made on the game thread while this thread waits for it
+	TSharedRef<TArray64<uint8>> DataRef = MakeShared<TArray64<uint8>>();
+	TSharedRef<TPromise<EDownloadToMemoryResult>> ResultPromise = MakeShared<TPromise<EDownloadToMemoryResult>>();
+	TFuture<EDownloadToMemoryResult> ResultFuture = ResultPromise->GetFuture();
+	AsyncTask(ENamedThreads::GameThread, [ChunkDownloader = ChunkDownloader, URL = URL, Timeout = Timeout, FileSize = FileSize, Range, DataRef, ResultPromise]()
+	{
+		ChunkDownloader->DownloadFileByChunk(URL, Timeout, FString(), FileSize, Range, [](int64, int64) {}).Next([DataRef, ResultPromise](FRuntimeChunkDownloaderResult&& Result)
+		{
+			*DataRef = MoveTemp(Result.Data);
+			ResultPromise->SetValue(Result.Result);
+		});
+	});
+
+	if (ResultFuture.Get() != EDownloadToMemoryResult::Success || DataRef->Num() != Range.Y - Range.X + 1)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to read the range {%lld; %lld} of the remote file %s"), Range.X, Range.Y, *URL);
+		return false;
+	}
+
+	OutData = MoveTemp(*DataRef);
+	return true;
+}
+
+const TArray64<uint8>* FRuntimeRemoteFileHandle::FindOrFetchBlock(int64 BlockIndex, int64 LastNeededBlockIndex)
+{
+	if (const TArray64<uint8>* CachedBlock = CachedBlocks.Find(BlockIndex))
+	{
+		CachedBlocksUsage.Remove(BlockIndex);
+		CachedBlocksUsage.Add(BlockIndex);
+		return CachedBlock;
+	}
+
+	// Fetch the consecutive missing blocks needed by the read, plus one block ahead, in a single request
+	const int64 LastBlockIndex = (FileSize - 1) / BlockSize;
+	int64 LastFetchedBlockIndex = BlockIndex;
+	while (LastFetchedBlockIndex < FMath::Min(LastNeededBlockIndex + 1, LastBlockIndex)
+		&& LastFetchedBlockIndex - BlockIndex + 1 < MaxCachedBlocks
+		&& !CachedBlocks.Contains(LastFetchedBlockIndex + 1))
+	{
+		++LastFetchedBlockIndex;
+	}
+
+	const int64 RangeStart = BlockIndex * BlockSize;
+	const int64 RangeEnd = FMath::Min((LastFetchedBlockIndex + 1) * BlockSize, FileSize) - 1;
+	TArray64<uint8> Data;
+	if (!FetchRange(FInt64Vector2(RangeStart, RangeEnd), Data))
+	{
+		return nullptr;
+	}
+
+	for (int64 FetchedBlockIndex = BlockIndex; FetchedBlockIndex <= LastFetchedBlockIndex; ++FetchedBlockIndex)
+	{
+		const int64 OffsetInData = (FetchedBlockIndex - BlockIndex) * BlockSize;
+		const int64 FetchedBlockSize = FMath::Min(BlockSize, Data.Num() - OffsetInData);
+
+		// Evict the least recently used blocks
+		while (CachedBlocksUsage.Num() >= MaxCachedBlocks)
+		{
+			CachedBlocks.Remove(CachedBlocksUsage[0]);
+			CachedBlocksUsage.RemoveAt(0);
+		}
+
+		CachedBlocks.Add(FetchedBlockIndex, TArray64<uint8>(Data.GetData() + OffsetInData, FetchedBlockSize));
+		CachedBlocksUsage.Add(FetchedBlockIndex);
+	}
+
+	// The requested block was added first and the number of fetched blocks never exceeds the cache capacity, so it is still cached
+	CachedBlocksUsage.Remove(BlockIndex);
+	CachedBlocksUsage.Add(BlockIndex);
+	return CachedBlocks.Find(BlockIndex);
+}
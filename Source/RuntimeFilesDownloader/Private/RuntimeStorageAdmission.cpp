@@ -0,0 +1,279 @@
+// Georgy Treshchev 2024.
+
+#include "RuntimeStorageAdmission.h"
+
+#include "RuntimeFilesDownloaderDefines.h"
+#include "RuntimeFilesDownloaderProfiling.h"
+#include "RuntimeFilesDownloaderSettings.h"
+#include "Async/Async.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformMisc.h"
+#include "Misc/Paths.h"
+
+namespace
+{
+	/**
+	 * Normalize the directory so that it can be compared with the other directories
+	 */
+	FString NormalizeDirectory(const FString& Directory)
+	{
+		FString NormalizedDirectory = FPaths::ConvertRelativePathToFull(Directory);
+		FPaths::NormalizeDirectoryName(NormalizedDirectory);
+		return NormalizedDirectory;
+	}
+
+	/**
+	 * Get the closest existing directory of the path, as the free space can only be queried for an existing directory
+	 */
+	FString GetExistingDirectory(const FString& Path)
+	{
+		FString Directory = FPaths::GetPath(Path);
+		while (!Directory.IsEmpty() && !IFileManager::Get().DirectoryExists(*Directory))
+		{
+			const FString ParentDirectory = FPaths::GetPath(Directory);
+			if (ParentDirectory == Directory)
+			{
+				break;
+			}
+			Directory = ParentDirectory;
+		}
+		return Directory;
+	}
+}
+
+FRuntimeStorageReservation::FRuntimeStorageReservation(uint64 InReservationId, int64 InSize)
+	: ReservationId(InReservationId)
+	, Size(InSize)
+{
+}
+
+FRuntimeStorageReservation::~FRuntimeStorageReservation()
+{
+	FRuntimeStorageAdmission::Get().Release(ReservationId);
+}
+
+FRuntimeStorageAdmission& FRuntimeStorageAdmission::Get()
+{
+	static FRuntimeStorageAdmission Admission;
+	return Admission;
+}
+
+ERuntimeStorageAdmissionResult FRuntimeStorageAdmission::Reserve(const FString& SavePath, int64 Size, FRuntimeStorageReservationPtr& OutReservation)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeStorageAdmission::Reserve);
+
+	const FString FullSavePath = FPaths::ConvertRelativePathToFull(SavePath);
+
+	// The existing file is replaced, so its space becomes available
+	const int64 ExistingFileSize = FMath::Max<int64>(IFileManager::Get().FileSize(*FullSavePath), 0);
+	const int64 RequiredBytes = FMath::Max<int64>(Size - ExistingFileSize, 0);
+
+	// Eviction comes first, without holding the lock, as the eviction function may delete files and make other reservations
+	TArray<TPair<FString, FQuota>> ExceededQuotas;
+	{
+		FScopeLock ScopeLock(&Lock);
+		for (const TPair<FString, FQuota>& Quota : Quotas)
+		{
+			if (Quota.Value.OnQuotaExceeded && FPaths::IsUnderDirectory(FullSavePath, Quota.Key) && GetExceedingBytes(Quota.Key, Quota.Value, RequiredBytes) > 0)
+			{
+				ExceededQuotas.Add(Quota);
+			}
+		}
+	}
+
+	for (const TPair<FString, FQuota>& Quota : ExceededQuotas)
+	{
+		// An earlier eviction may have freed enough space under a nested quota
+		int64 ExceedingBytes = 0;
+		{
+			FScopeLock ScopeLock(&Lock);
+			if (const FQuota* CurrentQuota = Quotas.Find(Quota.Key))
+			{
+				ExceedingBytes = GetExceedingBytes(Quota.Key, *CurrentQuota, RequiredBytes);
+			}
+		}
+		if (ExceedingBytes <= 0)
+		{
+			continue;
+		}
+
+		UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Saving '%s' would exceed the quota of '%s' by %lld bytes, evicting files"), *FullSavePath, *Quota.Key, ExceedingBytes);
+		const int64 FreedBytes = Quota.Value.OnQuotaExceeded(Quota.Key, ExceedingBytes);
+
+		FScopeLock ScopeLock(&Lock);
+		if (FQuota* CurrentQuota = Quotas.Find(Quota.Key))
+		{
+			CurrentQuota->UsedBytes = FMath::Max<int64>(CurrentQuota->UsedBytes - FMath::Max<int64>(FreedBytes, 0), 0);
+			ScheduleUsageScan(Quota.Key, *CurrentQuota);
+		}
+	}
+
+	const FString ExistingDirectory = GetExistingDirectory(FullSavePath);
+
+	// The quotas and the free space are checked and the space is reserved under a single lock, so that concurrent downloads cannot be admitted to the same space
+	FScopeLock ScopeLock(&Lock);
+
+	for (const TPair<FString, FQuota>& Quota : Quotas)
+	{
+		if (!FPaths::IsUnderDirectory(FullSavePath, Quota.Key))
+		{
+			continue;
+		}
+
+		const int64 ExceedingBytes = GetExceedingBytes(Quota.Key, Quota.Value, RequiredBytes);
+		if (ExceedingBytes > 0)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to save '%s': the quota of '%s' (%lld bytes) would be exceeded by %lld bytes"), *FullSavePath, *Quota.Key, Quota.Value.MaxBytes, ExceedingBytes);
+			return ERuntimeStorageAdmissionResult::QuotaExceeded;
+		}
+	}
+
+	uint64 TotalBytes = 0;
+	uint64 FreeBytes = 0;
+	if (FPlatformMisc::GetDiskTotalAndFreeSpace(ExistingDirectory, TotalBytes, FreeBytes))
+	{
+		// Reservations are not tracked per volume, so all of them are subtracted to stay on the safe side
+		const int64 MinFreeBytes = static_cast<int64>(GetDefault<URuntimeFilesDownloaderSettings>()->MinFreeDiskSpaceMB) * 1024 * 1024;
+		int64 ReservedBytes = 0;
+		for (const TPair<uint64, FReservation>& Reservation : Reservations)
+		{
+			ReservedBytes += Reservation.Value.Size;
+		}
+
+		const int64 AvailableBytes = static_cast<int64>(FreeBytes) - ReservedBytes - MinFreeBytes;
+		if (AvailableBytes < RequiredBytes)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to save '%s': %lld bytes are required, but only %lld bytes are available (%llu free, %lld reserved by other downloads, %lld kept free)"),
+			       *FullSavePath, RequiredBytes, FMath::Max<int64>(AvailableBytes, 0), FreeBytes, ReservedBytes, MinFreeBytes);
+			return ERuntimeStorageAdmissionResult::NotEnoughSpace;
+		}
+	}
+	else
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Warning, TEXT("Unable to query the free disk space for '%s', admitting the download without checking it"), *ExistingDirectory);
+	}
+
+	const uint64 ReservationId = NextReservationId++;
+	Reservations.Add(ReservationId, FReservation{FullSavePath, RequiredBytes});
+	OutReservation = MakeShared<FRuntimeStorageReservation, ESPMode::ThreadSafe>(ReservationId, RequiredBytes);
+	return ERuntimeStorageAdmissionResult::Admitted;
+}
+
+void FRuntimeStorageAdmission::SetDirectoryQuota(const FString& Directory, int64 MaxBytes, const FOnQuotaExceeded& OnQuotaExceeded)
+{
+	const FString NormalizedDirectory = NormalizeDirectory(Directory);
+
+	FQuota Quota;
+	Quota.MaxBytes = FMath::Max<int64>(MaxBytes, 0);
+	Quota.OnQuotaExceeded = OnQuotaExceeded;
+	Quota.UsedBytes = GetDirectorySize(NormalizedDirectory);
+
+	FScopeLock ScopeLock(&Lock);
+	Quotas.Add(NormalizedDirectory, MoveTemp(Quota));
+}
+
+void FRuntimeStorageAdmission::RemoveDirectoryQuota(const FString& Directory)
+{
+	FScopeLock ScopeLock(&Lock);
+	Quotas.Remove(NormalizeDirectory(Directory));
+}
+
+int64 FRuntimeStorageAdmission::GetReservedBytes() const
+{
+	FScopeLock ScopeLock(&Lock);
+	int64 ReservedBytes = 0;
+	for (const TPair<uint64, FReservation>& Reservation : Reservations)
+	{
+		ReservedBytes += Reservation.Value.Size;
+	}
+	return ReservedBytes;
+}
+
+int64 FRuntimeStorageAdmission::GetDirectorySize(const FString& Directory)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeStorageAdmission::GetDirectorySize);
+
+	int64 DirectorySize = 0;
+	IFileManager::Get().IterateDirectoryStatRecursively(*Directory, [&DirectorySize](const TCHAR* Path, const FFileStatData& StatData)
+	{
+		if (!StatData.bIsDirectory && StatData.FileSize > 0)
+		{
+			DirectorySize += StatData.FileSize;
+		}
+		return true;
+	});
+	return DirectorySize;
+}
+
+void FRuntimeStorageAdmission::Release(uint64 ReservationId)
+{
+	FScopeLock ScopeLock(&Lock);
+	const FReservation* Reservation = Reservations.Find(ReservationId);
+	if (!Reservation)
+	{
+		return;
+	}
+
+	// The file is assumed to have been saved with the reserved size until the directory is measured again
+	for (TPair<FString, FQuota>& Quota : Quotas)
+	{
+		if (FPaths::IsUnderDirectory(Reservation->SavePath, Quota.Key))
+		{
+			Quota.Value.UsedBytes += Reservation->Size;
+			ScheduleUsageScan(Quota.Key, Quota.Value);
+		}
+	}
+
+	Reservations.Remove(ReservationId);
+}
+
+int64 FRuntimeStorageAdmission::GetReservedBytesUnder(const FString& Directory) const
+{
+	int64 ReservedBytes = 0;
+	for (const TPair<uint64, FReservation>& Reservation : Reservations)
+	{
+		if (FPaths::IsUnderDirectory(Reservation.Value.SavePath, Directory))
+		{
+			ReservedBytes += Reservation.Value.Size;
+		}
+	}
+	return ReservedBytes;
+}
+
+int64 FRuntimeStorageAdmission::GetExceedingBytes(const FString& Directory, const FQuota& Quota, int64 RequiredBytes) const
+{
+	return Quota.UsedBytes + GetReservedBytesUnder(Directory) + RequiredBytes - Quota.MaxBytes;
+}
+
+void FRuntimeStorageAdmission::ScheduleUsageScan(const FString& Directory, FQuota& Quota)
+{
+	// The measurement in progress may have missed the latest change, so it is repeated once finished
+	if (Quota.bScanInProgress)
+	{
+		Quota.bScanOutdated = true;
+		return;
+	}
+
+	Quota.bScanInProgress = true;
+	Quota.bScanOutdated = false;
+	Async(EAsyncExecution::ThreadPool, [Directory]()
+	{
+		const int64 DirectorySize = GetDirectorySize(Directory);
+
+		FRuntimeStorageAdmission& Admission = Get();
+		FScopeLock ScopeLock(&Admission.Lock);
+		FQuota* CurrentQuota = Admission.Quotas.Find(Directory);
+		if (!CurrentQuota)
+		{
+			return;
+		}
+
+		CurrentQuota->bScanInProgress = false;
+		if (CurrentQuota->bScanOutdated)
+		{
+			Admission.ScheduleUsageScan(Directory, *CurrentQuota);
+			return;
+		}
+		CurrentQuota->UsedBytes = DirectorySize;
+	});
+}
@@ -0,0 +1,144 @@
+// Georgy Treshchev 2024.
+
+#include "RuntimeStreamDecompressor.h"
+#include "RuntimeFilesDownloaderDefines.h"
+
+THIRD_PARTY_INCLUDES_START
+#include "zlib.h"
+THIRD_PARTY_INCLUDES_END
+
+namespace
+{
+	/** Size of the intermediate buffer the data is decompressed into */
+	constexpr int32 OutputBufferSize = 256 * 1024;
+
+	/** Window bits value that makes zlib automatically detect gzip and zlib headers */
+	constexpr int32 AutoDetectWindowBits = 15 + 32;
+
+	/** Window bits value for raw deflate data without a header */
+	constexpr int32 RawDeflateWindowBits = -15;
+}
+
+FRuntimeStreamDecompressor::FRuntimeStreamDecompressor(bool bRawDeflate)
+	: Stream(MakeUnique<z_stream_s>())
+	, bInitialized(false)
+	, bFinished(false)
+{
+	FMemory::Memzero(Stream.Get(), sizeof(z_stream_s));
+	const int32 Result = inflateInit2(Stream.Get(), bRawDeflate ? RawDeflateWindowBits : AutoDetectWindowBits);
+	if (Result != Z_OK)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to initialize the decompression stream: %d"), Result);
+		return;
+	}
+	bInitialized = true;
+	OutputBuffer.SetNumUninitialized(OutputBufferSize);
+}
+
+FRuntimeStreamDecompressor::~FRuntimeStreamDecompressor()
+{
+	if (bInitialized)
+	{
+		inflateEnd(Stream.Get());
+	}
+}
+
+bool FRuntimeStreamDecompressor::Decompress(const uint8* CompressedData, int64 CompressedSize, TArray64<uint8>& OutDecompressedData)
+{
+	if (!bInitialized)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to decompress data: the decompression stream is not initialized"));
+		return false;
+	}
+
+	int64 InputOffset = 0;
+	while (InputOffset < CompressedSize)
+	{
+		const uInt InputSize = static_cast<uInt>(FMath::Min<int64>(CompressedSize - InputOffset, MAX_uint32));
+		Stream->next_in = const_cast<Bytef*>(CompressedData + InputOffset);
+		Stream->avail_in = InputSize;
+		InputOffset += InputSize;
+
+		bool bHasPendingOutput = true;
+		while (Stream->avail_in > 0 || bHasPendingOutput)
+		{
+			if (bFinished)
+			{
+				if (Stream->avail_in == 0)
+				{
+					break;
+				}
+
+				// The data contains several concatenated gzip members
+				inflateReset(Stream.Get());
+				bFinished = false;
+			}
+
+			Stream->next_out = OutputBuffer.GetData();
+			Stream->avail_out = OutputBuffer.Num();
+
+			const int32 Result = inflate(Stream.Get(), Z_NO_FLUSH);
+			OutDecompressedData.Append(OutputBuffer.GetData(), OutputBuffer.Num() - Stream->avail_out);
+			bHasPendingOutput = Stream->avail_out == 0;
+
+			if (Result == Z_STREAM_END)
+			{
+				bFinished = true;
+			}
+			else if (Result == Z_BUF_ERROR)
+			{
+				// No progress is possible until more input is provided
+				break;
+			}
+			else if (Result != Z_OK)
+			{
+				UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to decompress data: %d (%s)"), Result, Stream->msg ? UTF8_TO_TCHAR(Stream->msg) : TEXT("unknown error"));
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+bool FRuntimeStreamDecompressor::IsFinished() const
+{
+	return bFinished;
+}
+
+bool FRuntimeStreamDecompressor::IsCompressed(const uint8* Data, int64 Size)
+{
+	if (!Data || Size < 2)
+	{
+		return false;
+	}
+
+	const bool bGzip = Data[0] == 0x1F && Data[1] == 0x8B;
+	const bool bZlib = (Data[0] & 0x0F) == Z_DEFLATED && ((static_cast<uint32>(Data[0]) << 8) | Data[1]) % 31 == 0;
+	return bGzip || bZlib;
+}
+
+bool FRuntimeStreamDecompressor::DecompressBuffer(const TArray64<uint8>& CompressedData, TArray64<uint8>& OutDecompressedData)
+{
+	// The gzip trailer contains the decompressed size modulo 2^32, which is a good reservation hint
+	if (CompressedData.Num() > 4 && CompressedData[0] == 0x1F && CompressedData[1] == 0x8B)
+	{
+		const uint8* SizeTrailer = CompressedData.GetData() + CompressedData.Num() - 4;
+		const uint32 DecompressedSizeHint = SizeTrailer[0] | (SizeTrailer[1] << 8) | (SizeTrailer[2] << 16) | (static_cast<uint32>(SizeTrailer[3]) << 24);
+		OutDecompressedData.Reserve(FMath::Max<int64>(DecompressedSizeHint, CompressedData.Num()));
+	}
+
+	FRuntimeStreamDecompressor Decompressor;
+	if (!Decompressor.Decompress(CompressedData.GetData(), CompressedData.Num(), OutDecompressedData))
+	{
+		return false;
+	}
+
+	if (!Decompressor.IsFinished())
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Failed to decompress data: the compressed stream is truncated"));
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,172 @@
+// Georgy Treshchev 2024.
+
+#include "RuntimeTextureCache.h"
+
+#include "RuntimeFilesDownloaderDefines.h"
+#include "RuntimeFilesDownloaderSettings.h"
+#include "Engine/Texture2D.h"
+
+namespace
+{
+	/** The shared texture cache, created on first use */
+	TUniquePtr<FRuntimeTextureCache> SharedTextureCache;
+}
+
+FRuntimeTextureCache::FRuntimeTextureCache()
+	: BudgetBytes(static_cast<int64>(GetDefault<URuntimeFilesDownloaderSettings>()->TextureCacheBudgetMB) * 1024 * 1024)
+	, UsedBytes(0)
+	, UseCounter(0)
+{
+}
+
+FRuntimeTextureCache& FRuntimeTextureCache::Get()
+{
+	check(IsInGameThread());
+	if (!SharedTextureCache.IsValid())
+	{
+		SharedTextureCache = MakeUnique<FRuntimeTextureCache>();
+	}
+	return *SharedTextureCache;
+}
+
+void FRuntimeTextureCache::Shutdown()
+{
+	SharedTextureCache.Reset();
+}
+
+FString FRuntimeTextureCache::MakeKey(const FString& URL, const FIntPoint& MaxSize, bool bGenerateMips)
+{
+	return FString::Printf(TEXT("%s|%dx%d|%s"), *URL, FMath::Max(MaxSize.X, 0), FMath::Max(MaxSize.Y, 0), bGenerateMips ? TEXT("Mips") : TEXT("NoMips"));
+}
+
+UTexture2D* FRuntimeTextureCache::Find(const FString& Key)
+{
+	check(IsInGameThread());
+
+	FEntry* Entry = Entries.Find(Key);
+	if (!Entry)
+	{
+		return nullptr;
+	}
+
+	UTexture2D* Texture = Entry->WeakTexture.Get();
+	if (!Texture)
+	{
+		Entries.Remove(Key);
+		return nullptr;
+	}
+
+	Entry->LastUsed = ++UseCounter;
+
+	// A texture evicted over the budget but still alive is kept alive by the cache again
+	if (!Entry->StrongTexture)
+	{
+		Entry->StrongTexture = Texture;
+		UsedBytes += Entry->Size;
+		EvictOverBudget();
+	}
+
+	return Texture;
+}
+
+void FRuntimeTextureCache::Add(const FString& Key, UTexture2D* Texture)
+{
+	check(IsInGameThread());
+
+	if (!Texture)
+	{
+		return;
+	}
+
+	Remove(Key);
+	RemoveStaleEntries();
+
+	FEntry& Entry = Entries.Add(Key);
+	Entry.WeakTexture = Texture;
+	Entry.StrongTexture = Texture;
+	Entry.Size = Texture->CalcTextureMemorySizeEnum(TMC_AllMips);
+	Entry.LastUsed = ++UseCounter;
+	UsedBytes += Entry.Size;
+
+	EvictOverBudget();
+}
+
+void FRuntimeTextureCache::Remove(const FString& Key)
+{
+	check(IsInGameThread());
+
+	FEntry Entry;
+	if (Entries.RemoveAndCopyValue(Key, Entry) && Entry.StrongTexture)
+	{
+		UsedBytes -= Entry.Size;
+	}
+}
+
+void FRuntimeTextureCache::Empty()
+{
+	check(IsInGameThread());
+
+	Entries.Empty();
+	UsedBytes = 0;
+}
+
+void FRuntimeTextureCache::SetBudget(int64 InBudgetBytes)
+{
+	check(IsInGameThread());
+
+	BudgetBytes = FMath::Max<int64>(InBudgetBytes, 0);
+	EvictOverBudget();
+}
+
+void FRuntimeTextureCache::AddReferencedObjects(FReferenceCollector& Collector)
+{
+	for (TPair<FString, FEntry>& EntryPair : Entries)
+	{
+		if (EntryPair.Value.StrongTexture)
+		{
+			Collector.AddReferencedObject(EntryPair.Value.StrongTexture);
+		}
+	}
+}
+
+FString FRuntimeTextureCache::GetReferencerName() const
+{
+	return TEXT("FRuntimeTextureCache");
+}
+
+void FRuntimeTextureCache::EvictOverBudget()
+{
+	while (UsedBytes > BudgetBytes)
+	{
+		FEntry* LeastRecentlyUsed = nullptr;
+		for (TPair<FString, FEntry>& EntryPair : Entries)
+		{
+			if (EntryPair.Value.StrongTexture && (!LeastRecentlyUsed || EntryPair.Value.LastUsed < LeastRecentlyUsed->LastUsed))
+			{
+				LeastRecentlyUsed = &EntryPair.Value;
+			}
+		}
+
+		if (!LeastRecentlyUsed)
+		{
+			break;
+		}
+
+		UE_LOG(LogRuntimeFilesDownloader, Verbose, TEXT("Texture cache is over the budget (%lld of %lld bytes), releasing the least recently used texture of %lld bytes"), UsedBytes, BudgetBytes, LeastRecentlyUsed->Size);
+
+		// Only the strong reference is dropped, so the texture can still be reused while something else keeps it alive
+		LeastRecentlyUsed->StrongTexture = nullptr;
+		UsedBytes -= LeastRecentlyUsed->Size;
+	}
+}
+
+void FRuntimeTextureCache::RemoveStaleEntries()
+{
+	for (auto EntryIt = Entries.CreateIterator(); EntryIt; ++EntryIt)
+	{
+		if (!EntryIt->Value.WeakTexture.IsValid())
+		{
+			EntryIt.RemoveCurrent();
+		}
+	}
+}
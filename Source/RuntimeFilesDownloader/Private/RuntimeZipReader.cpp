@@ -0,0 +1,300 @@
+// Georgy Treshchev 2024.
+
+#include "RuntimeZipReader.h"
+
+#include "RuntimeFilesDownloaderDefines.h"
+#include "RuntimeFilesDownloaderProfiling.h"
+#include "RuntimeStreamDecompressor.h"
+
+THIRD_PARTY_INCLUDES_START
+#include "zlib.h"
+THIRD_PARTY_INCLUDES_END
+
+namespace
+{
+	constexpr uint32 EndOfCentralDirectorySignature = 0x06054B50;
+	constexpr uint32 Zip64EndOfCentralDirectoryLocatorSignature = 0x07064B50;
+	constexpr uint32 Zip64EndOfCentralDirectorySignature = 0x06064B50;
+	constexpr uint32 CentralDirectoryHeaderSignature = 0x02014B50;
+	constexpr uint32 LocalFileHeaderSignature = 0x04034B50;
+
+	constexpr int64 EndOfCentralDirectorySize = 22;
+	constexpr int64 Zip64EndOfCentralDirectoryLocatorSize = 20;
+	constexpr int64 Zip64EndOfCentralDirectorySize = 56;
+	constexpr int64 CentralDirectoryHeaderSize = 46;
+	constexpr int64 LocalFileHeaderSize = 30;
+	constexpr int64 MaxCommentSize = 0xFFFF;
+
+	/** The highest compression ratio deflate can achieve, which bounds the uncompressed size of an entry */
+	constexpr int64 MaxDeflateRatio = 1032;
+
+	constexpr uint16 Zip64ExtraFieldId = 0x0001;
+	constexpr uint16 StoredCompressionMethod = 0;
+	constexpr uint16 DeflateCompressionMethod = 8;
+	constexpr uint16 EncryptedFlag = 1 << 0;
+
+	uint16 ReadUInt16(const uint8* Data)
+	{
+		return static_cast<uint16>(Data[0] | (Data[1] << 8));
+	}
+
+	uint32 ReadUInt32(const uint8* Data)
+	{
+		return static_cast<uint32>(Data[0]) | (static_cast<uint32>(Data[1]) << 8) | (static_cast<uint32>(Data[2]) << 16) | (static_cast<uint32>(Data[3]) << 24);
+	}
+
+	uint64 ReadUInt64(const uint8* Data)
+	{
+		return static_cast<uint64>(ReadUInt32(Data)) | (static_cast<uint64>(ReadUInt32(Data + 4)) << 32);
+	}
+}
+
+FRuntimeZipReader::FRuntimeZipReader(TUniquePtr<IFileHandle> InFileHandle)
+	: FileHandle(MoveTemp(InFileHandle))
+{
+}
+
+bool FRuntimeZipReader::ReadCentralDirectory()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeZipReader::ReadCentralDirectory);
+
+	if (!FileHandle)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to read the zip archive: the file handle is invalid"));
+		return false;
+	}
+
+	// The end of central directory record is at the end of the archive, followed by a comment of up to 64 KB
+	const int64 ArchiveSize = FileHandle->Size();
+	const int64 TailSize = FMath::Min(ArchiveSize, EndOfCentralDirectorySize + MaxCommentSize + Zip64EndOfCentralDirectoryLocatorSize);
+	TArray64<uint8> Tail;
+	if (TailSize < EndOfCentralDirectorySize || !ReadAt(ArchiveSize - TailSize, TailSize, Tail))
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to read the zip archive: the archive is too small or cannot be read"));
+		return false;
+	}
+
+	int64 RecordOffset = INDEX_NONE;
+	for (int64 Offset = TailSize - EndOfCentralDirectorySize; Offset >= 0; --Offset)
+	{
+		if (ReadUInt32(Tail.GetData() + Offset) == EndOfCentralDirectorySignature)
+		{
+			RecordOffset = Offset;
+			break;
+		}
+	}
+
+	if (RecordOffset == INDEX_NONE)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to read the zip archive: the end of central directory record is not found"));
+		return false;
+	}
+
+	const uint8* Record = Tail.GetData() + RecordOffset;
+	int64 EntryCount = ReadUInt16(Record + 10);
+	int64 CentralDirectorySize = ReadUInt32(Record + 12);
+	int64 CentralDirectoryOffset = ReadUInt32(Record + 16);
+
+	// Archives larger than 4 GB or with more than 65535 entries store the values in the zip64 record
+	if (RecordOffset >= Zip64EndOfCentralDirectoryLocatorSize && ReadUInt32(Record - Zip64EndOfCentralDirectoryLocatorSize) == Zip64EndOfCentralDirectoryLocatorSignature)
+	{
+		const int64 Zip64RecordOffset = static_cast<int64>(ReadUInt64(Record - Zip64EndOfCentralDirectoryLocatorSize + 8));
+		TArray64<uint8> Zip64Record;
+		if (!ReadAt(Zip64RecordOffset, Zip64EndOfCentralDirectorySize, Zip64Record) || ReadUInt32(Zip64Record.GetData()) != Zip64EndOfCentralDirectorySignature)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to read the zip archive: the zip64 end of central directory record is invalid"));
+			return false;
+		}
+
+		EntryCount = static_cast<int64>(ReadUInt64(Zip64Record.GetData() + 32));
+		CentralDirectorySize = static_cast<int64>(ReadUInt64(Zip64Record.GetData() + 40));
+		CentralDirectoryOffset = static_cast<int64>(ReadUInt64(Zip64Record.GetData() + 48));
+	}
+
+	TArray64<uint8> CentralDirectory;
+	if (CentralDirectoryOffset < 0 || CentralDirectorySize < 0 || CentralDirectoryOffset + CentralDirectorySize > ArchiveSize || !ReadAt(CentralDirectoryOffset, CentralDirectorySize, CentralDirectory))
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to read the zip archive: the central directory (offset %lld, size %lld) cannot be read"), CentralDirectoryOffset, CentralDirectorySize);
+		return false;
+	}
+
+	return ParseCentralDirectory(CentralDirectory, EntryCount);
+}
+
+const FRuntimeZipEntry* FRuntimeZipReader::FindEntry(const FString& Name) const
+{
+	const int32* EntryIndex = EntryIndices.Find(Name);
+	return EntryIndex ? &Entries[*EntryIndex] : nullptr;
+}
+
+bool FRuntimeZipReader::ReadEntry(const FRuntimeZipEntry& Entry, TArray64<uint8>& OutData)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(FRuntimeZipReader::ReadEntry);
+	RUNTIMEFILESDOWNLOADER_LLM_SCOPE;
+
+	// The local header may have a different extra field than the central directory, so its size is read to locate the data
+	TArray64<uint8> LocalHeader;
+	if (!ReadAt(Entry.LocalHeaderOffset, LocalFileHeaderSize, LocalHeader) || ReadUInt32(LocalHeader.GetData()) != LocalFileHeaderSignature)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to read the zip entry '%s': the local file header is invalid"), *Entry.Name);
+		return false;
+	}
+
+	const int64 DataOffset = Entry.LocalHeaderOffset + LocalFileHeaderSize + ReadUInt16(LocalHeader.GetData() + 26) + ReadUInt16(LocalHeader.GetData() + 28);
+	TArray64<uint8> CompressedData;
+	if (!ReadAt(DataOffset, Entry.CompressedSize, CompressedData))
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to read the data of the zip entry '%s'"), *Entry.Name);
+		return false;
+	}
+
+	if (Entry.CompressionMethod == StoredCompressionMethod)
+	{
+		OutData = MoveTemp(CompressedData);
+	}
+	else if (Entry.CompressionMethod == DeflateCompressionMethod)
+	{
+		OutData.Reset(Entry.UncompressedSize);
+		FRuntimeStreamDecompressor Decompressor(true);
+		if (!Decompressor.Decompress(CompressedData.GetData(), CompressedData.Num(), OutData) || !Decompressor.IsFinished())
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to decompress the zip entry '%s'"), *Entry.Name);
+			return false;
+		}
+	}
+	else
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to read the zip entry '%s': compression method %d is not supported"), *Entry.Name, Entry.CompressionMethod);
+		return false;
+	}
+
+	uLong Crc = crc32(0L, Z_NULL, 0);
+	for (int64 Offset = 0; Offset < OutData.Num(); Offset += MAX_uint32)
+	{
+		Crc = crc32(Crc, OutData.GetData() + Offset, static_cast<uInt>(FMath::Min<int64>(OutData.Num() - Offset, MAX_uint32)));
+	}
+
+	if (OutData.Num() != Entry.UncompressedSize || static_cast<uint32>(Crc) != Entry.Crc32)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("The data of the zip entry '%s' is corrupted"), *Entry.Name);
+		return false;
+	}
+
+	return true;
+}
+
+bool FRuntimeZipReader::ReadEntry(const FString& Name, TArray64<uint8>& OutData)
+{
+	const FRuntimeZipEntry* Entry = FindEntry(Name);
+	if (!Entry)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("The zip archive does not contain the entry '%s'"), *Name);
+		return false;
+	}
+	return ReadEntry(*Entry, OutData);
+}
+
+bool FRuntimeZipReader::ReadAt(int64 Offset, int64 Size, TArray64<uint8>& OutData)
+{
+	// The offsets and sizes are read from the archive itself, so they are checked against its size before allocating
+	if (Offset < 0 || Size < 0 || Size > FileHandle->Size() - Offset)
+	{
+		return false;
+	}
+
+	OutData.SetNumUninitialized(Size);
+	return FileHandle->Seek(Offset) && FileHandle->Read(OutData.GetData(), Size);
+}
+
+bool FRuntimeZipReader::ParseCentralDirectory(const TArray64<uint8>& CentralDirectory, int64 EntryCount)
+{
+	Entries.Reset();
+	EntryIndices.Reset();
+
+	// Each entry takes at least a header in the central directory, so a larger count cannot be valid and is not reserved for
+	if (EntryCount < 0 || EntryCount > CentralDirectory.Num() / CentralDirectoryHeaderSize)
+	{
+		UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to read the zip archive: %lld entries do not fit into the central directory of %lld bytes"), EntryCount, CentralDirectory.Num());
+		return false;
+	}
+	Entries.Reserve(EntryCount);
+
+	const int64 ArchiveSize = FileHandle->Size();
+
+	int64 Offset = 0;
+	for (int64 EntryIndex = 0; EntryIndex < EntryCount; ++EntryIndex)
+	{
+		if (Offset + CentralDirectoryHeaderSize > CentralDirectory.Num() || ReadUInt32(CentralDirectory.GetData() + Offset) != CentralDirectoryHeaderSignature)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to read the zip archive: the central directory header of entry %lld is invalid"), EntryIndex);
+			return false;
+		}
+
+		const uint8* Header = CentralDirectory.GetData() + Offset;
+		const uint16 Flags = ReadUInt16(Header + 8);
+		const int64 NameSize = ReadUInt16(Header + 28);
+		const int64 ExtraFieldSize = ReadUInt16(Header + 30);
+		const int64 CommentSize = ReadUInt16(Header + 32);
+		if (Offset + CentralDirectoryHeaderSize + NameSize + ExtraFieldSize + CommentSize > CentralDirectory.Num())
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to read the zip archive: the central directory is truncated"));
+			return false;
+		}
+
+		FRuntimeZipEntry Entry;
+		const FUTF8ToTCHAR NameConverter(reinterpret_cast<const ANSICHAR*>(Header + CentralDirectoryHeaderSize), NameSize);
+		Entry.Name = FString(NameConverter.Length(), NameConverter.Get());
+		Entry.CompressionMethod = ReadUInt16(Header + 10);
+		Entry.Crc32 = ReadUInt32(Header + 16);
+		Entry.CompressedSize = ReadUInt32(Header + 20);
+		Entry.UncompressedSize = ReadUInt32(Header + 24);
+		Entry.LocalHeaderOffset = ReadUInt32(Header + 42);
+
+		// Values that do not fit into 32 bits are stored in the zip64 extra field, in this order
+		const uint8* ExtraField = Header + CentralDirectoryHeaderSize + NameSize;
+		for (int64 ExtraOffset = 0; ExtraOffset + 4 <= ExtraFieldSize;)
+		{
+			const uint16 FieldId = ReadUInt16(ExtraField + ExtraOffset);
+			const int64 FieldSize = ReadUInt16(ExtraField + ExtraOffset + 2);
+			if (FieldId == Zip64ExtraFieldId)
+			{
+				const uint8* Field = ExtraField + ExtraOffset + 4;
+				int64 FieldOffset = 0;
+				auto ReadZip64Value = [Field, FieldSize, &FieldOffset](int64& Value)
+				{
+					if (Value == MAX_uint32 && FieldOffset + 8 <= FieldSize)
+					{
+						Value = static_cast<int64>(ReadUInt64(Field + FieldOffset));
+						FieldOffset += 8;
+					}
+				};
+				ReadZip64Value(Entry.UncompressedSize);
+				ReadZip64Value(Entry.CompressedSize);
+				ReadZip64Value(Entry.LocalHeaderOffset);
+			}
+			ExtraOffset += 4 + FieldSize;
+		}
+
+		Offset += CentralDirectoryHeaderSize + NameSize + ExtraFieldSize + CommentSize;
+
+		// The data must be within the archive, and cannot decompress to more than deflate allows
+		const bool bDataInArchive = Entry.LocalHeaderOffset >= 0 && Entry.CompressedSize >= 0 && Entry.CompressedSize <= ArchiveSize - LocalFileHeaderSize - Entry.LocalHeaderOffset;
+		if (!bDataInArchive || Entry.UncompressedSize < 0 || Entry.UncompressedSize > FMath::Max<int64>(Entry.CompressedSize, 1) * MaxDeflateRatio)
+		{
+			UE_LOG(LogRuntimeFilesDownloader, Error, TEXT("Unable to read the zip archive: the entry '%s' has invalid sizes (offset %lld, compressed %lld, uncompressed %lld)"), *Entry.Name, Entry.LocalHeaderOffset, Entry.CompressedSize, Entry.UncompressedSize);
+			return false;
+		}
+
+		// Encrypted entries cannot be read, and directories have no data
+		if ((Flags & EncryptedFlag) != 0 || Entry.Name.EndsWith(TEXT("/")))
+		{
+			continue;
+		}
+
+		EntryIndices.Add(Entry.Name, Entries.Num());
+		Entries.Add(MoveTemp(Entry));
+	}
+
+	UE_LOG(LogRuntimeFilesDownloader, Log, TEXT("Read the central directory of the zip archive with %d entries"), Entries.Num());
+	return true;
+}
@@ -5,6 +5,7 @@
 #include "Http.h"
 #include "Templates/SharedPointer.h"
 #include "Misc/EngineVersionComparison.h"
+#include "RuntimeFilesDownloaderStats.h"
 #include "BaseFilesDownloader.generated.h"
 
 /** Dynamic delegate to track download progress */
@@ -34,8 +35,6 @@ protected:
 	FOnDownloadProgressNative OnDownloadProgress;
 
 public:
-	UBaseFilesDownloader();
-
 	/**
 	 * Canceling the current download
 	 *
@@ -44,6 +43,38 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Runtime Files Downloader|Main")
 	virtual bool CancelDownload();
 
+	/**
+	 * Pausing the current download. Already downloaded chunks are kept, so that resuming continues with only the outstanding data
+	 *
+	 * @return Whether the pausing was successful or not
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Runtime Files Downloader|Main")
+	virtual bool PauseDownload();
+
+	/**
+	 * Resuming the paused download
+	 *
+	 * @return Whether the resuming was successful or not
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Runtime Files Downloader|Main")
+	virtual bool ResumeDownload();
+
+	/**
+	 * Check whether the current download is paused
+	 *
+	 * @return True if the download is paused, false otherwise
+	 */
+	UFUNCTION(BlueprintPure, Category = "Runtime Files Downloader|Main")
+	bool IsDownloadPaused() const;
+
+	/**
+	 * Get the statistics gathered during the current download, such as time-to-first-byte, per-chunk timings and throughput
+	 *
+	 * @return The download statistics
+	 */
+	UFUNCTION(BlueprintPure, Category = "Runtime Files Downloader|Main")
+	FRuntimeFilesDownloaderStats GetDownloadStats() const;
+
 	/**
 	 * Get the content length of the file to be downloaded
 	 *
@@ -64,7 +95,7 @@ public:
 	static void GetContentSize(const FString& URL, float Timeout, const FOnGetDownloadContentLengthNative& OnComplete);
 
 	/**
-	 * Convert bytes to string
+	 * Convert bytes to string, decoding them as UTF-8. UTF-16 text is detected by its byte order mark
 	 *
 	 * @param Bytes Byte array to convert to string
 	 * @return Converted string, empty on failure
@@ -72,6 +103,23 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Runtime Files Downloader|Utilities")
 	static FString BytesToString(const TArray<uint8>& Bytes);
 
+	/**
+	 * Convert bytes to string, decoding them as UTF-8. UTF-16 text is detected by its byte order mark. Suitable for use in C++
+	 *
+	 * @param Bytes Byte array to convert to string
+	 * @return Converted string, empty on failure
+	 */
+	static FString BytesToString(const TArray64<uint8>& Bytes);
+
+	/**
+	 * Convert bytes to string, decoding them as UTF-8. UTF-16 text is detected by its byte order mark. Suitable for use in C++
+	 *
+	 * @param Bytes The bytes to convert to string
+	 * @param Size The number of bytes
+	 * @return Converted string, empty on failure
+	 */
+	static FString BytesToString(const uint8* Bytes, int64 Size);
+
 	/**
 	 * Convert bytes to texture. This is fully engine-based functionality and may not be well optimized
 	 *
@@ -138,6 +186,11 @@ protected:
 	 */
 	void BroadcastProgress(int64 BytesReceived, int64 ContentLength, float ProgressRatio) const;
 
+	/**
+	 * Get the execution policy of the downloads made by the object. The data is processed as set in the plugin settings, while the delegates are always broadcast on the game thread
+	 */
+	static struct FRuntimeDownloadExecutionPolicy GetExecutionPolicy();
+
 	/** Internal downloader */
 	TSharedPtr<class FRuntimeChunkDownloader> RuntimeChunkDownloaderPtr;
 };
@@ -3,6 +3,7 @@
 #pragma once
 
 #include "BaseFilesDownloader.h"
+#include "RuntimeChunkDownloader.h"
 #include "FileToMemoryDownloader.generated.h"
 
 class UFileToMemoryDownloader;
@@ -24,12 +25,18 @@ enum class EDownloadToMemoryResult : uint8
 /** Static delegate to track download completion */
 DECLARE_DELEGATE_ThreeParams(FOnFileToMemoryDownloadCompleteNative, const TArray64<uint8>&, EDownloadToMemoryResult, UFileToMemoryDownloader*);
 
+/** Static delegate to track download completion, providing the downloaded data as a shared buffer that can be kept without copying */
+DECLARE_DELEGATE_ThreeParams(FOnFileToMemoryDownloadCompleteSharedNative, const FRuntimeSharedBuffer&, EDownloadToMemoryResult, UFileToMemoryDownloader*);
+
 /** Dynamic delegate to track download completion */
 DECLARE_DYNAMIC_DELEGATE_ThreeParams(FOnFileToMemoryDownloadComplete, const TArray<uint8>&, DownloadedContent, EDownloadToMemoryResult, Result, UFileToMemoryDownloader*, Downloader);
 
 /** Static delegate to track chunk download completion */
 DECLARE_DELEGATE_TwoParams(FOnFileToMemoryChunkDownloadCompleteNative, const TArray64<uint8>&, UFileToMemoryDownloader*);
 
+/** Static delegate to track chunk download completion, providing the chunk data as a shared buffer that can be kept without copying */
+DECLARE_DELEGATE_TwoParams(FOnFileToMemoryChunkDownloadCompleteSharedNative, const FRuntimeSharedBuffer&, UFileToMemoryDownloader*);
+
 /** Dynamic delegate to track chunk download completion */
 DECLARE_DYNAMIC_DELEGATE_TwoParams(FOnFileToMemoryChunkDownloadComplete, const TArray<uint8>&, DownloadedContent, UFileToMemoryDownloader*, Downloader);
 
@@ -54,6 +61,12 @@ protected:
 	/** Static delegate for monitoring the completion of the chunk download */
 	FOnFileToMemoryChunkDownloadCompleteNative OnChunkDownloadComplete;
 
+	/** Static delegate for monitoring the completion of the download with the data as a shared buffer */
+	FOnFileToMemoryDownloadCompleteSharedNative OnDownloadCompleteShared;
+
+	/** Static delegate for monitoring the completion of the chunk download with the data as a shared buffer */
+	FOnFileToMemoryChunkDownloadCompleteSharedNative OnChunkDownloadCompleteShared;
+
 	/** Static delegate for monitoring the full completion of the chunks download */
 	FOnFileToMemoryAllChunksDownloadCompleteNative OnAllChunksDownloadComplete;
 
@@ -83,6 +96,18 @@ public:
 	 */
 	static UFileToMemoryDownloader* DownloadFileToMemory(const FString& URL, float Timeout, const FString& ContentType, bool bForceByPayload, const FOnDownloadProgressNative& OnProgress, const FOnFileToMemoryDownloadCompleteNative& OnComplete);
 
+	/**
+	 * Download the file into temporary memory (RAM) as a shared buffer, which can be kept and passed to several consumers without copying. Suitable for use in C++
+	 *
+	 * @param URL The URL of the file to be downloaded
+	 * @param Timeout The maximum time to wait for the download to complete, in seconds. Works only for engine versions >= 4.26
+	 * @param ContentType A string to set in the Content-Type header field. Use a MIME type to specify the file type
+	 * @param bForceByPayload If true, download the file regardless of the Content-Length header's presence (useful for servers without support for this header)
+	 * @param OnProgress Delegate for download progress updates
+	 * @param OnComplete Delegate for broadcasting the completion of the download
+	 */
+	static UFileToMemoryDownloader* DownloadFileToMemory(const FString& URL, float Timeout, const FString& ContentType, bool bForceByPayload, const FOnDownloadProgressNative& OnProgress, const FOnFileToMemoryDownloadCompleteSharedNative& OnComplete);
+
 	/**
 	 * Download the file and save it as a byte array in temporary memory (RAM). Continuously broadcasts the download result per chunk
 	 *
@@ -110,6 +135,19 @@ public:
 	 */
 	static UFileToMemoryDownloader* DownloadFileToMemoryPerChunk(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, const FOnDownloadProgressNative& OnProgress, const FOnFileToMemoryChunkDownloadCompleteNative& OnChunkDownloadComplete, const FOnFileToMemoryAllChunksDownloadCompleteNative& OnAllChunksDownloadComplete);
 
+	/**
+	 * Download the file into temporary memory (RAM), broadcasting each chunk as a shared buffer, which can be kept and passed to several consumers without copying. Suitable for use in C++
+	 *
+	 * @param URL The URL of the file to be downloaded
+	 * @param Timeout The maximum time to wait for the download to complete, in seconds. Works only for engine versions >= 4.26
+	 * @param ContentType A string to set in the Content-Type header field. Use a MIME type to specify the file type
+	 * @param MaxChunkSize The maximum size of each chunk to download in bytes
+	 * @param OnProgress Delegate for download progress updates
+	 * @param OnChunkDownloadComplete Delegate for broadcasting the completion of the download. Will be called for each chunk
+	 * @param OnAllChunksDownloadComplete Delegate for broadcasting the completion of the download of all chunks
+	 */
+	static UFileToMemoryDownloader* DownloadFileToMemoryPerChunk(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, const FOnDownloadProgressNative& OnProgress, const FOnFileToMemoryChunkDownloadCompleteSharedNative& OnChunkDownloadComplete, const FOnFileToMemoryAllChunksDownloadCompleteNative& OnAllChunksDownloadComplete);
+
 	//~ Begin UBaseFilesDownloader Interface
 	virtual bool CancelDownload() override;
 	//~ End UBaseFilesDownloader Interface
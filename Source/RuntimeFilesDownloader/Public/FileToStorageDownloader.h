@@ -19,7 +19,11 @@ enum class EDownloadToStorageResult : uint8
 	SaveFailed,
 	DirectoryCreationFailed,
 	InvalidURL,
-	InvalidSavePath
+	InvalidSavePath,
+	/** There was not enough free space on storage for the file, checked before downloading */
+	NotEnoughSpace,
+	/** Saving the file would exceed the quota of its directory, checked before downloading */
+	QuotaExceeded
 };
 
 
@@ -71,6 +75,35 @@ public:
 	 */
 	static UFileToStorageDownloader* DownloadFileToStorage(const FString& URL, const FString& SavePath, float Timeout, const FString& ContentType, bool bForceByPayload, const FOnDownloadProgressNative& OnProgress, const FOnFileToStorageDownloadCompleteNative& OnComplete);
 
+	/**
+	 * Update the file in storage to its new version, downloading only the blocks that differ from the existing file
+	 * The block signature of the new version can be generated using FRuntimeBlockSignature::Generate and FRuntimeBlockSignature::ToBytes
+	 * If the existing file or the signature is unavailable, the whole file is downloaded
+	 *
+	 * @param URL The URL of the new version of the file
+	 * @param SignatureURL The URL of the block signature of the new version of the file
+	 * @param SavePath The absolute path and file name of the existing file, which will be replaced with the new version
+	 * @param Timeout The maximum time to wait for the download to complete, in seconds. Works only for engine versions >= 4.26
+	 * @param ContentType A string to set in the Content-Type header field. Use a MIME type to specify the file type
+	 * @param OnProgress Delegate for download progress updates. Bytes reused from the existing file count as received
+	 * @param OnComplete Delegate for broadcasting the completion of the download
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Runtime Files Downloader|Storage")
+	static UFileToStorageDownloader* DownloadFileToStorageDelta(const FString& URL, const FString& SignatureURL, const FString& SavePath, float Timeout, const FString& ContentType, const FOnDownloadProgress& OnProgress, const FOnFileToStorageDownloadComplete& OnComplete);
+
+	/**
+	 * Update the file in storage to its new version, downloading only the blocks that differ from the existing file. Suitable for use in C++
+	 *
+	 * @param URL The URL of the new version of the file
+	 * @param SignatureURL The URL of the block signature of the new version of the file
+	 * @param SavePath The absolute path and file name of the existing file, which will be replaced with the new version
+	 * @param Timeout The maximum time to wait for the download to complete, in seconds. Works only for engine versions >= 4.26
+	 * @param ContentType A string to set in the Content-Type header field. Use a MIME type to specify the file type
+	 * @param OnProgress Delegate for download progress updates. Bytes reused from the existing file count as received
+	 * @param OnComplete Delegate for broadcasting the completion of the download
+	 */
+	static UFileToStorageDownloader* DownloadFileToStorageDelta(const FString& URL, const FString& SignatureURL, const FString& SavePath, float Timeout, const FString& ContentType, const FOnDownloadProgressNative& OnProgress, const FOnFileToStorageDownloadCompleteNative& OnComplete);
+
 	//~ Begin UBaseFilesDownloader Interface
 	virtual bool CancelDownload() override;
 	//~ End UBaseFilesDownloader Interface
@@ -87,6 +120,24 @@ protected:
 	 */
 	void DownloadFileToStorage(const FString& URL, const FString& SavePath, float Timeout, const FString& ContentType, bool bForceByPayload);
 
+	/**
+	 * Update the file on the device disk, downloading only the blocks that differ from the existing file
+	 *
+	 * @param URL The URL of the new version of the file
+	 * @param SignatureURL The URL of the block signature of the new version of the file
+	 * @param SavePath The absolute path and file name of the existing file
+	 * @param Timeout The maximum time to wait for the download to complete, in seconds. Works only for engine versions >= 4.26
+	 * @param ContentType A string to set in the Content-Type header field. Use a MIME type to specify the file type
+	 */
+	void DownloadFileToStorageDelta(const FString& URL, const FString& SignatureURL, const FString& SavePath, float Timeout, const FString& ContentType);
+
+	/**
+	 * Validate the common download parameters, broadcasting the failure if they are invalid
+	 *
+	 * @return Whether the parameters are valid or not
+	 */
+	bool ValidateDownloadParameters(const FString& URL, const FString& SavePath, float& Timeout);
+
 	/**
 	 * Internal callback for when file downloading has finished
 	 */
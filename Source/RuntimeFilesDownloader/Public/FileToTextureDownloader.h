@@ -0,0 +1,151 @@
+// Georgy Treshchev 2024.
+
+#pragma once
+
+#include "BaseFilesDownloader.h"
+#include "FileToTextureDownloader.generated.h"
+
+class UFileToTextureDownloader;
+class UTexture2D;
+
+/** Possible results from a download request */
+UENUM(BlueprintType, Category = "File To Texture Downloader")
+enum class EDownloadToTextureResult : uint8
+{
+	Success,
+	Cancelled,
+	DownloadFailed,
+	/** Downloaded successfully, but the data is not an image in a supported format (PNG, JPEG, BMP, etc.) */
+	DecodeFailed,
+	InvalidURL
+};
+
+/** Static delegate broadcast after the download is complete */
+DECLARE_DELEGATE_ThreeParams(FOnFileToTextureDownloadCompleteNative, UTexture2D*, EDownloadToTextureResult, UFileToTextureDownloader*);
+
+/** Dynamic delegate broadcast after the download is complete */
+DECLARE_DYNAMIC_DELEGATE_ThreeParams(FOnFileToTextureDownloadComplete, UTexture2D*, Texture, EDownloadToTextureResult, Result, UFileToTextureDownloader*, Downloader);
+
+/**
+ * Downloads an image and creates a texture from it, decoding the image and generating the mips on a worker thread
+ */
+UCLASS(BlueprintType, Category = "Runtime Files Downloader|Texture")
+class RUNTIMEFILESDOWNLOADER_API UFileToTextureDownloader : public UBaseFilesDownloader
+{
+	GENERATED_BODY()
+
+protected:
+	/** Static delegate for monitoring the completion of the download */
+	FOnFileToTextureDownloadCompleteNative OnDownloadComplete;
+
+	/** Whether the download was canceled, checked after decoding the image */
+	bool bCanceled = false;
+
+	/** The cache key of the texture being downloaded, if other requests for the same texture may be waiting for it */
+	FString PendingCacheKey;
+
+public:
+	/**
+	 * Download the image and create a texture from it without blocking the game thread while decoding
+	 *
+	 * @param URL The URL of the image to be downloaded
+	 * @param Timeout The maximum time to wait for the download to complete, in seconds. Works only for engine versions >= 4.26
+	 * @param bGenerateMips Whether to generate the full mip chain for the texture
+	 * @param OnProgress Delegate for download progress updates
+	 * @param OnComplete Delegate for broadcasting the completion of the download
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Runtime Files Downloader|Texture")
+	static UFileToTextureDownloader* DownloadFileToTexture(const FString& URL, float Timeout, bool bGenerateMips, const FOnDownloadProgress& OnProgress, const FOnFileToTextureDownloadComplete& OnComplete);
+
+	/**
+	 * Download the image and create a texture from it without blocking the game thread while decoding. Suitable for use in C++
+	 *
+	 * @param URL The URL of the image to be downloaded
+	 * @param Timeout The maximum time to wait for the download to complete, in seconds. Works only for engine versions >= 4.26
+	 * @param bGenerateMips Whether to generate the full mip chain for the texture
+	 * @param OnProgress Delegate for download progress updates
+	 * @param OnComplete Delegate for broadcasting the completion of the download
+	 */
+	static UFileToTextureDownloader* DownloadFileToTexture(const FString& URL, float Timeout, bool bGenerateMips, const FOnDownloadProgressNative& OnProgress, const FOnFileToTextureDownloadCompleteNative& OnComplete);
+
+	/**
+	 * Get the texture from the texture cache, or download the image and create a texture from it, adding it to the cache
+	 * The image is downscaled on decode to fit the maximum size, preserving the aspect ratio
+	 *
+	 * @param URL The URL of the image to be downloaded
+	 * @param Timeout The maximum time to wait for the download to complete, in seconds. Works only for engine versions >= 4.26
+	 * @param bGenerateMips Whether to generate the full mip chain for the texture
+	 * @param MaxWidth The maximum width of the texture, 0 for no limit
+	 * @param MaxHeight The maximum height of the texture, 0 for no limit
+	 * @param OnProgress Delegate for download progress updates
+	 * @param OnComplete Delegate for broadcasting the completion of the download
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Runtime Files Downloader|Texture")
+	static UFileToTextureDownloader* DownloadFileToTextureCached(const FString& URL, float Timeout, bool bGenerateMips, int32 MaxWidth, int32 MaxHeight, const FOnDownloadProgress& OnProgress, const FOnFileToTextureDownloadComplete& OnComplete);
+
+	/**
+	 * Get the texture from the texture cache, or download the image and create a texture from it, adding it to the cache. Suitable for use in C++
+	 * The image is downscaled on decode to fit the maximum size, preserving the aspect ratio
+	 *
+	 * @param URL The URL of the image to be downloaded
+	 * @param Timeout The maximum time to wait for the download to complete, in seconds. Works only for engine versions >= 4.26
+	 * @param bGenerateMips Whether to generate the full mip chain for the texture
+	 * @param MaxSize The maximum size of the texture, zero components meaning no limit
+	 * @param OnProgress Delegate for download progress updates
+	 * @param OnComplete Delegate for broadcasting the completion of the download
+	 */
+	static UFileToTextureDownloader* DownloadFileToTextureCached(const FString& URL, float Timeout, bool bGenerateMips, const FIntPoint& MaxSize, const FOnDownloadProgressNative& OnProgress, const FOnFileToTextureDownloadCompleteNative& OnComplete);
+
+	/**
+	 * Decode the image and generate its mips, returning the BGRA8 data of each mip. Thread-safe, intended to be called on a worker thread
+	 *
+	 * @param ImageData The compressed image data
+	 * @param bGenerateMips Whether to generate the full mip chain
+	 * @param MaxSize The maximum size the image is downscaled to, preserving the aspect ratio. Zero components mean no limit
+	 * @param OutMips The BGRA8 data of each mip, starting from the full-size image
+	 * @param OutWidth The width of the decoded image
+	 * @param OutHeight The height of the decoded image
+	 * @return Whether the image was decoded successfully or not
+	 */
+	static bool DecodeImage(const TArray64<uint8>& ImageData, bool bGenerateMips, const FIntPoint& MaxSize, TArray<TArray64<uint8>>& OutMips, int32& OutWidth, int32& OutHeight);
+
+	/**
+	 * Create a transient texture from the decoded mips. Must be called on the game thread
+	 *
+	 * @param Mips The BGRA8 data of each mip, starting from the full-size image
+	 * @param Width The width of the image
+	 * @param Height The height of the image
+	 * @return The created texture, or nullptr on failure
+	 */
+	static UTexture2D* CreateTextureFromMips(TArray<TArray64<uint8>>&& Mips, int32 Width, int32 Height);
+
+	//~ Begin UBaseFilesDownloader Interface
+	virtual bool CancelDownload() override;
+	//~ End UBaseFilesDownloader Interface
+
+protected:
+	/**
+	 * Download the image and create a texture from it
+	 *
+	 * @param URL The URL of the image to be downloaded
+	 * @param Timeout The maximum time to wait for the download to complete, in seconds. Works only for engine versions >= 4.26
+	 * @param bGenerateMips Whether to generate the full mip chain for the texture
+	 * @param MaxSize The maximum size of the texture, zero components meaning no limit
+	 * @param bUseCache Whether to look up the texture in the texture cache and add it there once created
+	 */
+	void DownloadFileToTexture(const FString& URL, float Timeout, bool bGenerateMips, const FIntPoint& MaxSize, bool bUseCache);
+
+	/**
+	 * Internal callback for when the texture creation has finished
+	 */
+	void OnComplete_Internal(UTexture2D* Texture, EDownloadToTextureResult Result);
+
+	/**
+	 * Complete the requests that have been waiting for the texture downloaded by another request
+	 *
+	 * @param CacheKey The cache key of the texture
+	 * @param Texture The downloaded texture, or nullptr on failure
+	 * @param Result The result of the download
+	 */
+	static void CompletePendingTextureRequests(const FString& CacheKey, UTexture2D* Texture, EDownloadToTextureResult Result);
+};
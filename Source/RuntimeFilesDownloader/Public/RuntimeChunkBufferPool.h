@@ -0,0 +1,62 @@
+// Georgy Treshchev 2024.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Thread-safe pool of byte buffers reused for downloaded chunks, so that parallel downloads do not allocate and free a new buffer per chunk
+ */
+class RUNTIMEFILESDOWNLOADER_API FRuntimeChunkBufferPool
+{
+public:
+	/**
+	 * Get the buffer pool shared by the downloaders
+	 */
+	static FRuntimeChunkBufferPool& Get();
+
+	/**
+	 * Take an empty buffer with at least the specified capacity from the pool, or allocate a new one if none fits
+	 * Pooled buffers larger than twice the specified capacity are not taken
+	 *
+	 * @param MinCapacity The minimum capacity of the buffer in bytes
+	 * @return The empty buffer
+	 */
+	TArray64<uint8> Acquire(int64 MinCapacity);
+
+	/**
+	 * Return the buffer to the pool. The buffer is freed instead if the pool is full
+	 *
+	 * @param Buffer The buffer to return
+	 */
+	void Release(TArray64<uint8>&& Buffer);
+
+	/**
+	 * Free all the pooled buffers
+	 */
+	void Trim();
+
+	/**
+	 * Set the limits of the pool
+	 *
+	 * @param InMaxBuffers The maximum number of pooled buffers
+	 * @param InMaxBytes The maximum total capacity of the pooled buffers in bytes
+	 */
+	void SetLimits(int32 InMaxBuffers, int64 InMaxBytes);
+
+private:
+	/** Guards the pooled buffers */
+	FCriticalSection Lock;
+
+	/** The pooled empty buffers */
+	TArray<TArray64<uint8>> Buffers;
+
+	/** The total capacity of the pooled buffers in bytes */
+	int64 PooledBytes = 0;
+
+	/** The maximum number of pooled buffers */
+	int32 MaxBuffers = 16;
+
+	/** The maximum total capacity of the pooled buffers in bytes */
+	int64 MaxBytes = 256 * 1024 * 1024;
+};
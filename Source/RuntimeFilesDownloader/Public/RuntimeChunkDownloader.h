@@ -5,19 +5,72 @@
 #include "CoreMinimal.h"
 #include "Http.h"
 #include "Templates/SharedPointer.h"
+#include "Templates/Atomic.h"
 #include "Async/Future.h"
 #include "Misc/EngineVersionComparison.h"
+#include "RuntimeFilesDownloaderStats.h"
+#include "RuntimeDownloadExecutionPolicy.h"
 #if UE_VERSION_OLDER_THAN(5, 1, 0)
 #include <type_traits>
 #endif
 
 enum class EDownloadToMemoryResult : uint8;
+class FRuntimePayloadSegmentDecoder;
 
 /**
  * A struct that contains the result of downloading a file
  */
 using FRuntimeChunkDownloaderResult = struct{ EDownloadToMemoryResult Result; TArray64<uint8> Data; };
 
+/**
+ * A struct that contains the result of downloading a file into a caller-provided buffer
+ */
+using FRuntimeChunkDownloaderBufferResult = struct{ EDownloadToMemoryResult Result; uint8* Data; int64 Size; };
+
+/**
+ * Immutable, reference-counted downloaded data that can be shared between several consumers without copying
+ */
+using FRuntimeSharedBuffer = TSharedRef<const TArray64<uint8>, ESPMode::ThreadSafe>;
+
+/**
+ * Wrap the data into a shared buffer without copying it
+ *
+ * @param Data The data to wrap
+ * @return The shared buffer owning the data
+ */
+inline FRuntimeSharedBuffer MakeRuntimeSharedBuffer(TArray64<uint8>&& Data)
+{
+	return MakeShared<TArray64<uint8>, ESPMode::ThreadSafe>(MoveTemp(Data));
+}
+
+/**
+ * Information about a file on the server, received without downloading its content
+ */
+struct FRuntimeContentInfo
+{
+	/** Size of the file in bytes, or a value <= 0 if unknown */
+	int64 Size = 0;
+
+	/** The ETag header of the file, if any */
+	FString ETag;
+
+	/** The Last-Modified header of the file, if any */
+	FString LastModified;
+
+	/** Whether the server accepts range requests for the file. False if it answered with "Accept-Ranges: none" or ignored a range request */
+	bool bAcceptsRanges = true;
+
+	/**
+	 * Get the validator that can be sent with the If-Range header, since weak ETags cannot be used for ranges
+	 *
+	 * @return The strong ETag if there is one, the Last-Modified date otherwise
+	 */
+	FString GetRangeValidator() const
+	{
+		return !ETag.IsEmpty() && !ETag.StartsWith(TEXT("W/")) ? ETag : LastModified;
+	}
+};
+
 #if UE_VERSION_OLDER_THAN(5, 1, 0)
 template <typename InIntType>
 struct TIntVector2
@@ -72,6 +125,10 @@ public:
 
 	using FOnProgress = TFunction<void(int64, int64)>;
 	using FOnChunkDownloaded = TFunction<void(TArray64<uint8>&&)>;
+	using FOnRangeDownloaded = TFunction<void(FInt64Vector2, TArray64<uint8>&&)>;
+
+	/** Function returning a destination of at least the specified number of bytes, or nullptr to fail the download */
+	using FOnAllocateBuffer = TFunction<uint8*(int64)>;
 
 	/**
 	 * Download a file from the specified URL
@@ -85,6 +142,34 @@ public:
 	 */
 	virtual TFuture<FRuntimeChunkDownloaderResult> DownloadFile(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, const FOnProgress& OnProgress);
 
+	/**
+	 * Download a file into a destination provided by the caller, e.g. an arena or a mapped upload buffer, instead of a buffer allocated by the downloader
+	 * Each chunk is copied straight into the destination. Compressed transfer is not requested, since the data is written as received
+	 *
+	 * @param URL The URL of the file to download
+	 * @param Timeout The timeout value in seconds
+	 * @param ContentType The content type of the file
+	 * @param MaxChunkSize The maximum size of each chunk to download in bytes
+	 * @param AllocateBuffer A function called once the content size is known, returning the destination of at least that many bytes
+	 * @param OnProgress A function that is called with the progress as BytesReceived and ContentSize
+	 * @return A future that resolves to the destination and the number of bytes written to it
+	 */
+	virtual TFuture<FRuntimeChunkDownloaderBufferResult> DownloadFileToBuffer(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, const FOnAllocateBuffer& AllocateBuffer, const FOnProgress& OnProgress);
+
+	/**
+	 * Download a file into a fixed destination provided by the caller. Fails if the file does not fit
+	 *
+	 * @param URL The URL of the file to download
+	 * @param Timeout The timeout value in seconds
+	 * @param ContentType The content type of the file
+	 * @param MaxChunkSize The maximum size of each chunk to download in bytes
+	 * @param Buffer The destination, which must stay valid until the download is complete
+	 * @param BufferSize The size of the destination in bytes
+	 * @param OnProgress A function that is called with the progress as BytesReceived and ContentSize
+	 * @return A future that resolves to the destination and the number of bytes written to it
+	 */
+	TFuture<FRuntimeChunkDownloaderBufferResult> DownloadFileToBuffer(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, uint8* Buffer, int64 BufferSize, const FOnProgress& OnProgress);
+
 	/**
 	 * Download a file by dividing it into chunks and downloading each chunk separately
 	 *
@@ -109,9 +194,25 @@ public:
 	 * @param ChunkRange The range of the chunk to download
 	 * @param OnProgress A function that is called with the progress as BytesReceived and ContentSize
 	 * @return A future that resolves to the downloaded data as a TArray64<uint8>
+	 * @note If the server ignores the range and sends the whole file, the chunk is taken from it
 	 */
 	virtual TFuture<FRuntimeChunkDownloaderResult> DownloadFileByChunk(const FString& URL, float Timeout, const FString& ContentType, int64 ContentSize, FInt64Vector2 ChunkRange, const FOnProgress& OnProgress);
 
+	/**
+	 * Download several ranges of a file using as few requests as possible by requesting multiple ranges at once (multipart/byteranges)
+	 * Ranges that overlap or are separated by a gap smaller than the threshold are merged into a single range
+	 *
+	 * @param URL The URL of the file to download
+	 * @param Timeout The timeout value in seconds
+	 * @param ContentType The content type of the file
+	 * @param Ranges The inclusive byte ranges to download
+	 * @param MergeGapThreshold The maximum gap in bytes between two ranges for them to be requested as one
+	 * @param OnProgress A function that is called with the progress as BytesReceived and the total number of requested bytes
+	 * @param OnRangeDownloaded A function that is called with each of the specified ranges and its data once downloaded
+	 * @return A future that resolves to the result of downloading all ranges
+	 */
+	virtual TFuture<EDownloadToMemoryResult> DownloadFileByRanges(const FString& URL, float Timeout, const FString& ContentType, const TArray<FInt64Vector2>& Ranges, int64 MergeGapThreshold, const FOnProgress& OnProgress, const FOnRangeDownloaded& OnRangeDownloaded);
+
 	/**
 	 * Download a file using payload-based approach. This approach is used when the server does not return the Content-Length header
 	 *
@@ -120,12 +221,26 @@ public:
 	 * @param ContentType The content type of the file
 	 * @param OnProgress A function that is called with the progress as BytesReceived and ContentSize
 	 * @return A future that resolves to the downloaded data as a TArray64<uint8>
-	 * @note This approach cannot be used to download files that are larger than 2 GB
+	 * @note Before UE 5.4, this approach cannot be used to download files that are larger than 2 GB
 	 */
 	virtual TFuture<FRuntimeChunkDownloaderResult> DownloadFileByPayload(const FString& URL, float Timeout, const FString& ContentType, const FOnProgress& OnProgress);
+
+	/**
+	 * Download a file using payload-based approach, delivering the response body in segments as it arrives instead of keeping it in memory as a whole
+	 * Suitable for files of unknown size, e.g. sent with chunked transfer encoding, and for files larger than 2 GB
+	 *
+	 * @param URL The URL of the file to download
+	 * @param Timeout The timeout value in seconds
+	 * @param ContentType The content type of the file
+	 * @param OnProgress A function that is called with the progress as BytesReceived and ContentSize
+	 * @param OnSegmentDownloaded A function that is called with each segment of the file, in order. A response encoded for the transfer is decoded as it arrives, while a compressed file is delivered as stored
+	 * @return A future that resolves to the result of the download
+	 * @note Streaming the response body is only supported since UE 5.4. On earlier versions, the file is downloaded by payload and delivered as a single segment
+	 */
+	virtual TFuture<EDownloadToMemoryResult> DownloadFileByPayloadPerSegment(const FString& URL, float Timeout, const FString& ContentType, const FOnProgress& OnProgress, const FOnChunkDownloaded& OnSegmentDownloaded);
 	
 	/**
-	 * Get the content size of the file to be downloaded
+	 * Get the content size of the file to be downloaded. The size is remembered per URL until the download it was requested for is over
 	 *
 	 * @param URL The URL of the file to be downloaded
 	 * @param Timeout The timeout value in seconds
@@ -133,12 +248,322 @@ public:
 	 */
 	TFuture<int64> GetContentSize(const FString& URL, float Timeout);
 
+	/**
+	 * Get the content size and the validators of the file to be downloaded. The information is remembered per URL until the download it was requested for is over
+	 *
+	 * @param URL The URL of the file to be downloaded
+	 * @param Timeout The timeout value in seconds
+	 * @return A future that resolves to the information about the file, with a size <= 0 if the request failed
+	 */
+	TFuture<FRuntimeContentInfo> GetContentInfo(const FString& URL, float Timeout);
+
 	/**
 	 * Cancel the download
 	 */
 	virtual void CancelDownload();
 
+	/**
+	 * Pause the download. Chunks that have already been downloaded are kept, and the chunk or the content size being requested at the moment of pausing is requested again once resumed
+	 */
+	virtual void PauseDownload();
+
+	/**
+	 * Resume the paused download, continuing with only the outstanding ranges
+	 */
+	virtual void ResumeDownload();
+
+	/**
+	 * Set whether the download is canceled when the game session ends, e.g. on travel to another map
+	 * Set by the downloader objects for their downloads. Other downloads, such as the ones started through download handles, are not tied to the session by default
+	 *
+	 * @param bCancel Whether to cancel the download when the session ends
+	 */
+	void SetCancelOnSessionEnd(bool bCancel);
+
+	/**
+	 * Cancel the downloads that are still alive and have been set to be canceled when the session ends. Called by the module when the game session ends
+	 */
+	static void CancelSessionDownloads();
+
+	/**
+	 * Check whether the download is paused
+	 *
+	 * @return True if the download is paused, false otherwise
+	 */
+	bool IsPaused() const;
+
+	/**
+	 * Get the statistics gathered during the download
+	 *
+	 * @return The download statistics
+	 */
+	const FRuntimeFilesDownloaderStats& GetStats() const;
+
+	/**
+	 * Set whether to request compressed (gzip or deflate) transfer from the server. Only requests for the whole file ask for it, since ranges of compressed data cannot be joined
+	 * Compressed responses are decompressed on a worker thread once downloaded. Defaults to the value from the plugin settings
+	 *
+	 * @param bAccept Whether to accept compressed content
+	 */
+	void SetAcceptCompressedContent(bool bAccept);
+
+	/**
+	 * Set whether to decompress downloaded files that are themselves gzip or zlib compressed, recognized by the .gz or .zz extension of their URL
+	 * Files that fail to decompress are delivered as received. Defaults to the value from the plugin settings
+	 *
+	 * @param bDecompress Whether to decompress compressed files
+	 */
+	void SetDecompressCompressedFiles(bool bDecompress);
+
+	/**
+	 * Set where the downloaded data is processed. Defaults to the values from the plugin settings
+	 *
+	 * @param InExecutionPolicy The execution policy of the downloads
+	 */
+	void SetExecutionPolicy(const FRuntimeDownloadExecutionPolicy& InExecutionPolicy);
+
+	/**
+	 * Get where the downloaded data is processed
+	 */
+	const FRuntimeDownloadExecutionPolicy& GetExecutionPolicy() const;
+
+	/**
+	 * Set whether the downloader runs in the background, e.g. prefetching. Requests of background downloaders do not hold back prefetching
+	 *
+	 * @param bInBackground Whether the downloader runs in the background
+	 */
+	void SetBackground(bool bInBackground);
+
+	/**
+	 * Check whether the downloader runs in the background
+	 */
+	bool IsBackground() const;
+
+	/**
+	 * Get the number of in-flight requests made by downloaders that do not run in the background
+	 */
+	static int32 GetForegroundRequestCount();
+
+	/**
+	 * Set the validator sent with the If-Range header of the range requests, e.g. from FRuntimeContentInfo::GetRangeValidator
+	 * A range of a file that has changed since the validator was received fails instead of being mixed with the ranges downloaded before
+	 *
+	 * @param InIfRangeValidator The ETag or Last-Modified date of the file, or an empty string to not send the header
+	 */
+	void SetIfRangeValidator(const FString& InIfRangeValidator);
+
+	/**
+	 * Set whether DownloadFile and DownloadFilePerChunk request the first chunk right away and learn the content size from its Content-Range header, instead of waiting for a content size request first
+	 * Halves the number of requests for files that fit in a single chunk. Defaults to the value from the plugin settings
+	 *
+	 * @param bInFastStart Whether to start downloads without a content size request
+	 */
+	void SetFastStart(bool bInFastStart);
+
 protected:
+	/**
+	 * The content size of a file, along with the beginning of the file if it was received while determining the size
+	 */
+	struct FContentProbe
+	{
+		/** Size of the file in bytes, or a value <= 0 if unknown */
+		int64 ContentSize = 0;
+
+		/** The first chunk of the file, or the whole file if the server ignored the range. Empty if the size was requested separately */
+		TArray64<uint8> FirstChunk;
+
+		/** Whether the first chunk is the whole file, already decompressed if needed */
+		bool bWholeFile = false;
+
+		/** Whether the server accepts range requests for the file */
+		bool bAcceptsRanges = true;
+	};
+
+	/**
+	 * Determine the content size of the file. With fast start, the first chunk is requested right away and the size is taken from its Content-Range header
+	 * Falls back to a content size request if the size is already known, fast start is disabled, or the server does not answer the range as expected
+	 *
+	 * @param URL The URL of the file to download
+	 * @param Timeout The timeout value in seconds
+	 * @param ContentType The content type of the file
+	 * @param MaxChunkSize The size of the first chunk to request in bytes, or a value <= 0 to only request the content size
+	 * @param OnProgress A function that is called with the progress of the first chunk as BytesReceived and ContentSize
+	 * @return A future that resolves to the content size and the first chunk, if received
+	 */
+	TFuture<FContentProbe> ProbeContent(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, const FOnProgress& OnProgress);
+
+	/**
+	 * Download a single chunk of a file, validating the Content-Range of the response
+	 *
+	 * @param URL The URL of the file to download
+	 * @param Timeout The timeout value in seconds
+	 * @param ContentType The content type of the file
+	 * @param ContentSize The size of the file in bytes
+	 * @param ChunkRange The range of the chunk to download
+	 * @param OnProgress A function that is called with the progress as BytesReceived and ContentSize
+	 * @param bAcceptRestOfFile Whether the result may extend to the end of the file if the server ignores the range and sends the whole file, so that it is not downloaded again. Otherwise the request fails
+	 * @return A future that resolves to the downloaded data, starting at the beginning of the chunk
+	 */
+	TFuture<FRuntimeChunkDownloaderResult> RequestChunk(const FString& URL, float Timeout, const FString& ContentType, int64 ContentSize, FInt64Vector2 ChunkRange, const FOnProgress& OnProgress, bool bAcceptRestOfFile);
+
+#if !UE_VERSION_OLDER_THAN(5, 4, 0)
+	/**
+	 * Download the response body of the file as a stream of segments, decoding them on worker threads as they arrive
+	 *
+	 * @param URL The URL of the file to download
+	 * @param Timeout The timeout value in seconds
+	 * @param ContentType The content type of the file
+	 * @param OnProgress A function that is called with the progress as BytesReceived and ContentSize
+	 * @param OnSegmentDownloaded A function that is called with each decoded segment of the file, in order
+	 * @param bDecompressFile Whether the file itself is decompressed if it starts with a compression header
+	 * @return A future that resolves to the result of the download once all segments have been delivered
+	 */
+	TFuture<EDownloadToMemoryResult> DownloadPayloadSegments(const FString& URL, float Timeout, const FString& ContentType, const FOnProgress& OnProgress, const FOnChunkDownloaded& OnSegmentDownloaded, bool bDecompressFile);
+
+	/**
+	 * Request the response body of the file as a stream of segments. A request interrupted by pausing continues from the last delivered segment once resumed
+	 *
+	 * @param PromisePtr The promise resolved with the result of the download
+	 * @param URL The URL of the file to download
+	 * @param Timeout The timeout value in seconds
+	 * @param ContentType The content type of the file
+	 * @param OnProgress A function that is called with the progress as BytesReceived and ContentSize
+	 * @param DecoderRef The decoder the segments of the file are passed to, in order
+	 * @param ResumeOffset The number of bytes of the file already delivered by the interrupted request
+	 * @param ResumeValidator The ETag or Last-Modified header of the file the delivered bytes were downloaded from, if any
+	 */
+	void RequestPayloadSegments(const TSharedPtr<TPromise<EDownloadToMemoryResult>>& PromisePtr, const FString& URL, float Timeout, const FString& ContentType, const FOnProgress& OnProgress, const TSharedRef<FRuntimePayloadSegmentDecoder, ESPMode::ThreadSafe>& DecoderRef, int64 ResumeOffset, const FString& ResumeValidator);
+#endif
+
+	/**
+	 * Decompress the downloaded data on a worker thread if the response declared a content encoding, or if it is a .gz or .zz file and decompression of compressed files is enabled
+	 * Used for data that is received as a whole anyway, while streamed payloads are decompressed segment by segment as they arrive
+	 *
+	 * @param Result The result of the download
+	 * @param URL The URL the data was downloaded from
+	 * @param ResponseContentEncoding The Content-Encoding header of the response the data was received with, empty if the data was requested without compression
+	 * @return A future that resolves to the result with decompressed data on the game thread, or the unchanged result if no decompression is needed or it fails. A content encoding other than gzip or deflate fails the download
+	 */
+	TFuture<FRuntimeChunkDownloaderResult> DecompressIfNeeded(FRuntimeChunkDownloaderResult&& Result, const FString& URL, const FString& ResponseContentEncoding) const;
+
+	/**
+	 * Check whether the URL refers to a compressed file by its extension
+	 */
+	static bool IsCompressedFileURL(const FString& URL);
+
+	/**
+	 * Set the request headers shared by all requests made by the downloader
+	 *
+	 * @param HttpRequestRef The request to set the headers for
+	 * @param bWholeBody Whether the request is for the whole body of the file, so that it may be transferred compressed
+	 */
+#if UE_VERSION_NEWER_THAN(4, 26, 0)
+	void SetCommonHeaders(const TSharedRef<IHttpRequest, ESPMode::ThreadSafe>& HttpRequestRef, bool bWholeBody) const;
+#else
+	void SetCommonHeaders(const TSharedRef<IHttpRequest>& HttpRequestRef, bool bWholeBody) const;
+#endif
+
+	/**
+	 * A single multi-range request of DownloadFileByRanges
+	 */
+	struct FRangeRequest
+	{
+		/** The merged ranges requested at once */
+		TArray<FInt64Vector2> MergedRanges;
+
+		/** The ranges specified by the caller that are covered by the merged ranges */
+		TArray<FInt64Vector2> Ranges;
+	};
+
+	/**
+	 * Make the multi-range requests one after another
+	 *
+	 * @param URL The URL of the file to download
+	 * @param Timeout The timeout value in seconds
+	 * @param ContentType The content type of the file
+	 * @param Requests The requests to make
+	 * @param RequestIndex The index of the request to make
+	 * @param CompletedBytes The number of bytes downloaded by the previous requests
+	 * @param TotalBytes The number of bytes requested in total
+	 * @param OnProgress A function that is called with the progress as BytesReceived and TotalBytes
+	 * @param OnRangeDownloaded A function that is called with each of the specified ranges and its data once downloaded
+	 * @return A future that resolves to the result of the remaining requests
+	 */
+	TFuture<EDownloadToMemoryResult> DownloadRangeRequests(const FString& URL, float Timeout, const FString& ContentType, const TSharedPtr<TArray<FRangeRequest>>& Requests, int32 RequestIndex, int64 CompletedBytes, int64 TotalBytes, const FOnProgress& OnProgress, const FOnRangeDownloaded& OnRangeDownloaded);
+
+	/**
+	 * Parse the value of the Content-Range header, e.g. "bytes 0-499/1234"
+	 *
+	 * @param ContentRangeHeader The value of the header
+	 * @param OutRange The inclusive range of the content
+	 * @param OutTotalSize The total size of the file, or -1 if unknown
+	 * @return Whether the header was parsed successfully or not
+	 */
+	static bool ParseContentRange(const FString& ContentRangeHeader, FInt64Vector2& OutRange, int64& OutTotalSize);
+
+	/**
+	 * Split the body of a multipart/byteranges response into its parts
+	 *
+	 * @param Content The body of the response
+	 * @param ContentTypeHeader The value of the Content-Type header containing the boundary
+	 * @param OutParts The range of each part, paired with the offset of its data in the body
+	 * @return Whether the body was parsed successfully or not
+	 */
+	static bool ParseMultipartByteRanges(const TArray<uint8>& Content, const FString& ContentTypeHeader, TArray<TPair<FInt64Vector2, int64>>& OutParts);
+
+	/**
+	 * Mark the start of the download for the statistics, if it has not been marked yet
+	 */
+	void MarkDownloadStarted();
+
+	/**
+	 * Record the body bytes received by a finished request, refresh the derived statistics and report them to the profilers
+	 *
+	 * @param Bytes The number of received body bytes
+	 */
+	void RecordReceivedBytes(int64 Bytes);
+
+	/**
+	 * Record the amount of memory temporarily held by a request in addition to the download buffer
+	 *
+	 * @param TransientBytes The number of bytes held by the request
+	 */
+	void RecordBufferMemory(int64 TransientBytes);
+
+	/**
+	 * Record the statistics of a finished chunk request, dropping the oldest ones once the limit is reached
+	 *
+	 * @param ChunkStats The statistics of the chunk request
+	 */
+	void AddChunkStats(const FRuntimeChunkDownloadStats& ChunkStats);
+
+	/**
+	 * Run the function once the download is resumed, or right away if the download is not paused (anymore)
+	 *
+	 * @param Function The function continuing the outstanding download
+	 */
+	void RunWhenResumed(TFunction<void()>&& Function);
+
+	/**
+	 * Check whether the request was canceled by pausing the download, so that it is made again once resumed instead of failing
+	 * This does not depend on whether the download is still paused, since it may have been resumed before the completion of the request arrived
+	 *
+	 * @param Request The completed request
+	 * @return True if the request was interrupted by pausing, false otherwise
+	 */
+	bool WasInterruptedByPause(const FHttpRequestPtr& Request);
+
+	/**
+	 * Defer downloading the file by payload until the download is resumed
+	 *
+	 * @param PromisePtr The promise to fulfill with the result of the deferred download
+	 * @param URL The URL of the file to download
+	 * @param Timeout The timeout value in seconds
+	 * @param ContentType The content type of the file
+	 * @param OnProgress A function that is called with the progress as BytesReceived and ContentSize
+	 */
+	void DeferPayloadDownloadUntilResumed(const TSharedPtr<TPromise<FRuntimeChunkDownloaderResult>>& PromisePtr, const FString& URL, float Timeout, const FString& ContentType, const FOnProgress& OnProgress);
+
 	/**
 	 * Check and request permissions required for downloading files
 	 *
@@ -155,4 +580,59 @@ protected:
 
 	/** A flag indicating whether the download has been canceled */
 	bool bCanceled;
+
+	/** Guards the pause state, since the download can be paused and resumed from any thread */
+	mutable FCriticalSection PauseLock;
+
+	/** A flag indicating whether the download has been paused */
+	bool bPaused;
+
+	/** Functions continuing the outstanding downloads once the download is resumed */
+	TArray<TFunction<void()>> PendingResumeFunctions;
+
+	/** The request canceled by pausing the download, whose completion is therefore not a failure */
+#if UE_VERSION_NEWER_THAN(4, 26, 0)
+	TWeakPtr<IHttpRequest, ESPMode::ThreadSafe> InterruptedHttpRequestPtr;
+#else
+	TWeakPtr<IHttpRequest> InterruptedHttpRequestPtr;
+#endif
+
+	/** Statistics gathered during the download */
+	FRuntimeFilesDownloaderStats Stats;
+
+	/** Time the download was started at, in seconds. Zero if not started yet */
+	double DownloadStartTime;
+
+	/** The number of bytes allocated for the buffer the whole file is downloaded into */
+	int64 AllocatedBufferMemory;
+
+	/** Whether to request compressed transfer from the server */
+	bool bAcceptCompressedContent;
+
+	/** Whether to decompress downloaded files that are themselves compressed */
+	bool bDecompressCompressedFiles;
+
+	/** Whether to request the first chunk without a content size request */
+	bool bFastStart;
+
+	/** Where the downloaded data is processed */
+	FRuntimeDownloadExecutionPolicy ExecutionPolicy;
+
+	/** Whether the downloader runs in the background */
+	bool bBackground;
+
+	/** Content information already received from the server by URL, so that it is not requested again within a download. Forgotten once the download is over */
+	TMap<FString, FRuntimeContentInfo> KnownContentInfos;
+
+	/** The validator sent with the If-Range header of the range requests */
+	FString IfRangeValidator;
+
+	/**
+	 * Function copying the data of a received chunk straight into the destination of the download, called with the offset of the chunk in the file on the thread the response is processed on
+	 * Returns whether the chunk was copied. A copied chunk is passed on as an empty buffer, and its end is recorded in ChunkSinkEndPtr instead. Only set while DownloadFile downloads by chunks
+	 */
+	TFunction<bool(int64, const uint8*, int64)> ChunkSink;
+
+	/** The end of the data last copied by the chunk sink in the file, set along with the chunk sink */
+	TSharedPtr<TAtomic<int64>> ChunkSinkEndPtr;
 };
@@ -0,0 +1,253 @@
+// Georgy Treshchev 2024.
+
+#pragma once
+
+#include "RuntimeChunkDownloader.h"
+#include "Misc/SecureHash.h"
+
+enum class EDownloadToStorageResult : uint8;
+
+/**
+ * A content-defined chunk of a file listed in the chunk manifest
+ */
+struct RUNTIMEFILESDOWNLOADER_API FRuntimeChunkManifestChunk
+{
+	/** Hash of the chunk content, used as the chunk identifier in the chunk store */
+	FSHAHash Hash;
+
+	/** Offset of the chunk in the file, in bytes */
+	int64 Offset = 0;
+
+	/** Size of the chunk, in bytes */
+	int64 Size = 0;
+};
+
+/**
+ * A file listed in the chunk manifest as a sequence of content-hashed chunks
+ */
+struct RUNTIMEFILESDOWNLOADER_API FRuntimeChunkManifestFile
+{
+	/** Path of the file relative to the install directory */
+	FString Path;
+
+	/** The URL of the file, from which missing chunks are requested using the HTTP Range header */
+	FString URL;
+
+	/** Size of the file, in bytes */
+	int64 Size = 0;
+
+	/** Chunks of the file, in the order of their offsets */
+	TArray<FRuntimeChunkManifestChunk> Chunks;
+};
+
+/**
+ * Manifest listing files as sequences of content-hashed chunks, which allows identical regions to be shared across files and versions
+ */
+struct RUNTIMEFILESDOWNLOADER_API FRuntimeChunkManifest
+{
+	/** Files listed in the manifest */
+	TArray<FRuntimeChunkManifestFile> Files;
+
+	/**
+	 * Parse the manifest from JSON
+	 *
+	 * @param JsonString The JSON representation of the manifest
+	 * @param OutManifest The parsed manifest
+	 * @return Whether the manifest was parsed successfully or not
+	 */
+	static bool FromJson(const FString& JsonString, FRuntimeChunkManifest& OutManifest);
+
+	/**
+	 * Convert the manifest to JSON
+	 *
+	 * @return The JSON representation of the manifest
+	 */
+	FString ToJson() const;
+
+	/**
+	 * Split the file data into content-defined chunks, so that an insertion or removal only affects the chunks around it
+	 *
+	 * @param Path Path of the file relative to the install directory
+	 * @param URL The URL the file will be available at
+	 * @param Data The file data
+	 * @param Size The size of the data in bytes
+	 * @param MinChunkSize The minimum size of a chunk in bytes, except for the last chunk of the file
+	 * @param AverageChunkSize The desired average size of a chunk in bytes, rounded down to a power of two
+	 * @param MaxChunkSize The maximum size of a chunk in bytes
+	 * @return The manifest entry describing the file
+	 */
+	static FRuntimeChunkManifestFile GenerateFile(const FString& Path, const FString& URL, const uint8* Data, int64 Size, int64 MinChunkSize = 16 * 1024, int64 AverageChunkSize = 64 * 1024, int64 MaxChunkSize = 256 * 1024);
+};
+
+/**
+ * A chunk downloader that installs the files listed in a chunk manifest from a local chunk store
+ * Only chunks missing from the store are downloaded, each of them once even if it is shared by several files, and the files are then reassembled from the store
+ */
+class RUNTIMEFILESDOWNLOADER_API FRuntimeChunkStoreDownloader : public FRuntimeChunkDownloader
+{
+public:
+	/**
+	 * @param InStoreDirectory The directory where the downloaded chunks are stored and shared between installs
+	 */
+	explicit FRuntimeChunkStoreDownloader(const FString& InStoreDirectory);
+
+	/**
+	 * Download the chunks of the manifest that are missing from the chunk store and reassemble the files in the install directory
+	 * Chunks already in the store are verified against their hashes, and the corrupted ones are downloaded again
+	 *
+	 * @param Manifest The manifest listing the files to install
+	 * @param InstallDirectory The directory where the files are reassembled
+	 * @param Timeout The timeout value in seconds
+	 * @param ContentType The content type of the files
+	 * @param MaxConcurrentDownloads The maximum number of range requests made at once
+	 * @param OnProgress A function that is called with the progress as BytesReceived and the total size of the missing chunks
+	 * @return A future that resolves to the result of installing the files
+	 */
+	virtual TFuture<EDownloadToStorageResult> DownloadManifestFiles(const FRuntimeChunkManifest& Manifest, const FString& InstallDirectory, float Timeout, const FString& ContentType, int32 MaxConcurrentDownloads, const FOnProgress& OnProgress);
+
+	//~ Begin FRuntimeChunkDownloader Interface
+	virtual void CancelDownload() override;
+	virtual void PauseDownload() override;
+	virtual void ResumeDownload() override;
+	//~ End FRuntimeChunkDownloader Interface
+
+	/**
+	 * Check whether the chunk is present in the chunk store and matches its hash. Should be called outside of the game thread
+	 *
+	 * @param Chunk The chunk to check
+	 */
+	bool HasChunk(const FRuntimeChunkManifestChunk& Chunk) const;
+
+	/**
+	 * Get the path of the chunk in the chunk store
+	 *
+	 * @param Hash The hash of the chunk
+	 */
+	FString GetChunkPath(const FSHAHash& Hash) const;
+
+	/**
+	 * Delete the chunks from the chunk store that are not referenced by any of the manifests
+	 *
+	 * @param Manifests The manifests of the installs that are still in use
+	 * @return The number of bytes freed
+	 */
+	int64 RemoveUnreferencedChunks(const TArray<FRuntimeChunkManifest>& Manifests) const;
+
+protected:
+	/**
+	 * A single range request covering one or more adjacent missing chunks of a file
+	 */
+	struct FChunkFetch
+	{
+		/** The URL of the file the chunks belong to */
+		FString URL;
+
+		/** Size of the file the chunks belong to, in bytes */
+		int64 FileSize = 0;
+
+		/** The range of the file to request */
+		FInt64Vector2 Range;
+
+		/** The chunks covered by the range */
+		TArray<FRuntimeChunkManifestChunk> Chunks;
+	};
+
+	/**
+	 * The progress of downloading the missing chunks of the manifest
+	 */
+	struct FChunkFetchState
+	{
+		/** The manifest being installed */
+		FRuntimeChunkManifest Manifest;
+
+		/** The directory where the files are reassembled */
+		FString InstallDirectory;
+
+		/** The range requests to make */
+		TArray<FChunkFetch> Fetches;
+
+		/** The number of bytes to download in total */
+		int64 TotalBytes = 0;
+
+		/** The timeout value in seconds */
+		float Timeout = 0;
+
+		/** The content type of the files */
+		FString ContentType;
+
+		/** The maximum number of range requests made at once */
+		int32 MaxConcurrentDownloads = 1;
+
+		/** The function called with the progress */
+		FOnProgress OnProgress;
+
+		/** The index of the next range request to start */
+		int32 NextFetchIndex = 0;
+
+		/** The number of range requests being downloaded or stored */
+		int32 ActiveDownloads = 0;
+
+		/** The bytes received by the completed range requests */
+		int64 CompletedBytes = 0;
+
+		/** The bytes received by the range requests being downloaded, by the index of the range request */
+		TMap<int32, int64> ActiveBytes;
+
+		/** The result of the failed range request, if any */
+		TOptional<EDownloadToStorageResult> FailureResult;
+
+		/** The promise of the install */
+		TSharedPtr<TPromise<EDownloadToStorageResult>> PromisePtr;
+	};
+
+	/**
+	 * Find the chunks of the manifest that are missing from the chunk store or corrupted, merging adjacent ones of the same file into range requests. Should be called outside of the game thread
+	 *
+	 * @param State The progress of the install, which receives the range requests and the number of bytes to download
+	 */
+	void CreateChunkFetches(FChunkFetchState& State) const;
+
+	/**
+	 * Start the next range requests, up to the maximum number of concurrent downloads, or reassemble the files once all chunks are stored
+	 */
+	void StartNextChunkFetches(const TSharedRef<FChunkFetchState>& State);
+
+	/**
+	 * Handle the completion of a range request and continue with the next ones
+	 *
+	 * @param WeakThisPtr The chunk store downloader, which may have been destroyed in the meantime
+	 * @param State The progress of the install
+	 * @param FetchIndex The index of the range request that was completed
+	 * @param FailureResult The result of the failed download or store, if it failed
+	 */
+	static void OnChunkFetchComplete(const TWeakPtr<FRuntimeChunkStoreDownloader>& WeakThisPtr, const TSharedRef<FChunkFetchState>& State, int32 FetchIndex, TOptional<EDownloadToStorageResult> FailureResult);
+
+	/**
+	 * Reassemble the files on a worker thread and complete the install
+	 */
+	static void FinishInstall(const TWeakPtr<FRuntimeChunkStoreDownloader>& WeakThisPtr, const TSharedRef<FChunkFetchState>& State);
+
+	/**
+	 * Load the chunk from the chunk store and verify it against its size and hash. Should be called outside of the game thread
+	 *
+	 * @param Chunk The chunk to load
+	 * @param OutData The chunk data
+	 * @return Whether the chunk was loaded and matches its hash or not
+	 */
+	bool LoadChunk(const FRuntimeChunkManifestChunk& Chunk, TArray64<uint8>& OutData) const;
+
+	/**
+	 * Reassemble the files of the manifest from the chunk store. Should be called outside of the game thread
+	 *
+	 * @param Manifest The manifest listing the files to reassemble
+	 * @param InstallDirectory The directory where the files are reassembled
+	 * @return The result of reassembling the files
+	 */
+	EDownloadToStorageResult AssembleFiles(const FRuntimeChunkManifest& Manifest, const FString& InstallDirectory) const;
+
+	/** The directory where the downloaded chunks are stored */
+	FString StoreDirectory;
+
+	/** Downloaders of the range requests being made */
+	TArray<TSharedPtr<FRuntimeChunkDownloader>> FetchDownloaders;
+};
@@ -0,0 +1,144 @@
+// Georgy Treshchev 2024.
+
+#pragma once
+
+#include "RuntimeChunkDownloader.h"
+#include "Misc/SecureHash.h"
+
+class IFileHandle;
+
+/**
+ * Block signature of a file, used to find blocks that can be reused from an older local copy of the file (rsync/zsync-style)
+ * Each block is described by a rolling weak checksum and a strong SHA-1 hash. The signature is stored in a binary format, which can be produced with ToBytes
+ */
+struct RUNTIMEFILESDOWNLOADER_API FRuntimeBlockSignature
+{
+	/** The size of the file the signature describes, in bytes */
+	int64 FileSize = 0;
+
+	/** The size of each block, in bytes. The last block may be shorter */
+	int32 BlockSize = 0;
+
+	/** Rolling weak checksums of the blocks */
+	TArray<uint32> WeakHashes;
+
+	/** Strong hashes of the blocks */
+	TArray<FSHAHash> StrongHashes;
+
+	/** Hash of the whole file, used to verify the reassembled file */
+	FSHAHash FileHash;
+
+	/**
+	 * Generate the signature of the data
+	 *
+	 * @param Data The file data
+	 * @param Size The size of the data in bytes
+	 * @param BlockSize The size of each block in bytes
+	 * @return The generated signature
+	 */
+	static FRuntimeBlockSignature Generate(const uint8* Data, int64 Size, int32 BlockSize);
+
+	/**
+	 * Parse the signature from its binary representation
+	 *
+	 * @param Bytes The binary representation of the signature
+	 * @param OutSignature The parsed signature
+	 * @return Whether the signature was parsed successfully or not
+	 */
+	static bool FromBytes(const TArray64<uint8>& Bytes, FRuntimeBlockSignature& OutSignature);
+
+	/**
+	 * Convert the signature to its binary representation
+	 *
+	 * @return The binary representation of the signature
+	 */
+	TArray64<uint8> ToBytes() const;
+
+	/**
+	 * Compute the rolling weak checksum of a block
+	 *
+	 * @param Data The block data
+	 * @param Size The size of the block in bytes
+	 * @return The weak checksum
+	 */
+	static uint32 ComputeWeakHash(const uint8* Data, int64 Size);
+
+	/**
+	 * Find the blocks of the signature that are present anywhere in the local data
+	 *
+	 * @param LocalData The data of the local copy of the file
+	 * @param LocalSize The size of the local data in bytes
+	 * @return Offsets in the local data for each block of the signature, INDEX_NONE for blocks that were not found
+	 */
+	TArray<int64> FindMatchingBlocks(const uint8* LocalData, int64 LocalSize) const;
+
+	/**
+	 * Find the blocks of the signature that are present anywhere in the local file, reading it in slices instead of loading it as a whole
+	 *
+	 * @param LocalFile The handle of the local copy of the file
+	 * @return Offsets in the local file for each block of the signature, INDEX_NONE for blocks that were not found or could not be read
+	 */
+	TArray<int64> FindMatchingBlocks(IFileHandle& LocalFile) const;
+
+	/**
+	 * Get the number of blocks in the signature
+	 */
+	int32 GetBlockCount() const
+	{
+		return WeakHashes.Num();
+	}
+};
+
+/**
+ * A chunk downloader that updates an existing local copy of a file by reusing its unchanged blocks and requesting only the changed ones using the HTTP Range header
+ */
+class RUNTIMEFILESDOWNLOADER_API FRuntimeDeltaDownloader : public FRuntimeChunkDownloader
+{
+public:
+	/**
+	 * Download a file by reusing the blocks of its local copy that match the block signature, and requesting only the changed blocks
+	 * Falls back to downloading the whole file if the local copy does not exist, or the signature cannot be downloaded or does not match the file, or the size of the file on the server is unknown
+	 *
+	 * @param URL The URL of the file to download
+	 * @param SignatureURL The URL of the block signature of the file
+	 * @param LocalFilePath The path to the local copy of the file
+	 * @param Timeout The timeout value in seconds
+	 * @param ContentType The content type of the file
+	 * @param OnProgress A function that is called with the progress as BytesReceived and ContentSize. Reused bytes count as received
+	 * @return A future that resolves to the full data of the new version of the file
+	 */
+	virtual TFuture<FRuntimeChunkDownloaderResult> DownloadFileDelta(const FString& URL, const FString& SignatureURL, const FString& LocalFilePath, float Timeout, const FString& ContentType, const FOnProgress& OnProgress);
+
+protected:
+	/**
+	 * Reuse the blocks of the local copy that match the signature, download the rest and verify the reassembled file
+	 *
+	 * @param PromisePtr The promise resolved with the result of the download
+	 * @param URL The URL of the file to download
+	 * @param LocalFilePath The path to the local copy of the file
+	 * @param Timeout The timeout value in seconds
+	 * @param ContentType The content type of the file
+	 * @param OnProgress A function that is called with the progress as BytesReceived and ContentSize
+	 * @param SignaturePtr The block signature of the file
+	 */
+	void ReuseLocalBlocks(const TSharedPtr<TPromise<FRuntimeChunkDownloaderResult>>& PromisePtr, const FString& URL, const FString& LocalFilePath, float Timeout, const FString& ContentType, const FOnProgress& OnProgress, const TSharedPtr<FRuntimeBlockSignature>& SignaturePtr);
+
+	/**
+	 * Download the whole file as a fallback, resolving the promise with the result
+	 */
+	void DownloadWholeFile(const TSharedPtr<TPromise<FRuntimeChunkDownloaderResult>>& PromisePtr, const FString& URL, float Timeout, const FString& ContentType, const FOnProgress& OnProgress);
+
+	/**
+	 * Download the missing ranges of the file into the data buffer using multi-range requests
+	 *
+	 * @param URL The URL of the file to download
+	 * @param Timeout The timeout value in seconds
+	 * @param ContentType The content type of the file
+	 * @param DataPtr The buffer of the whole file the ranges are downloaded into
+	 * @param MissingRanges The ranges of the file that need to be downloaded
+	 * @param ReusedBytes The number of bytes reused from the local copy, used for the progress
+	 * @param OnProgress A function that is called with the progress as BytesReceived and ContentSize
+	 * @return A future that resolves to the result of downloading the ranges
+	 */
+	TFuture<EDownloadToMemoryResult> DownloadMissingRanges(const FString& URL, float Timeout, const FString& ContentType, const TSharedPtr<TArray64<uint8>>& DataPtr, const TSharedPtr<TArray<FInt64Vector2>>& MissingRanges, int64 ReusedBytes, const FOnProgress& OnProgress);
+};
@@ -0,0 +1,243 @@
+// Georgy Treshchev 2024.
+
+#pragma once
+
+#include "RuntimeChunkDownloader.h"
+#include "RuntimeStorageAdmission.h"
+#include "Misc/SecureHash.h"
+
+enum class EDownloadToStorageResult : uint8;
+
+/**
+ * A file listed in the sync manifest
+ */
+struct RUNTIMEFILESDOWNLOADER_API FRuntimeSyncManifestFile
+{
+	/** Path of the file relative to the synced directory, using forward slashes */
+	FString Path;
+
+	/** The URL of the file */
+	FString URL;
+
+	/** Size of the file, in bytes */
+	int64 Size = 0;
+
+	/** SHA-1 hash of the file content */
+	FSHAHash Hash;
+};
+
+/**
+ * Manifest listing the files a local directory is kept in sync with
+ */
+struct RUNTIMEFILESDOWNLOADER_API FRuntimeSyncManifest
+{
+	/** Files listed in the manifest */
+	TArray<FRuntimeSyncManifestFile> Files;
+
+	/**
+	 * Parse the manifest from JSON in the format {"Files": [{"Path": ..., "URL": ..., "Size": ..., "Hash": ...}]}
+	 *
+	 * @param JsonString The JSON representation of the manifest
+	 * @param BaseURL The URL the paths of the files without a URL are resolved against, e.g. the directory of the manifest
+	 * @param OutManifest The parsed manifest
+	 * @return Whether the manifest was parsed successfully or not
+	 */
+	static bool FromJson(const FString& JsonString, const FString& BaseURL, FRuntimeSyncManifest& OutManifest);
+
+	/**
+	 * Convert the manifest to JSON
+	 *
+	 * @return The JSON representation of the manifest
+	 */
+	FString ToJson() const;
+};
+
+/**
+ * A downloader that mirrors a sync manifest into a local directory
+ * The local directory is compared with the manifest using cached size, modification time and hash of each file, so unchanged files are not hashed again
+ * Only new or changed files are downloaded, in parallel, into a staging directory. Once all of them are downloaded and verified, they are moved into place and stale files are deleted
+ * The commit is journaled, so an interrupted commit is completed by the next sync, and a failed or canceled sync leaves the directory unchanged
+ */
+class RUNTIMEFILESDOWNLOADER_API FRuntimeDirectorySyncDownloader : public FRuntimeChunkDownloader
+{
+public:
+	/**
+	 * Sync the local directory with the manifest
+	 *
+	 * @param Manifest The manifest listing the files the directory should contain
+	 * @param LocalDirectory The directory to sync. Files not listed in the manifest are deleted from it
+	 * @param Timeout The timeout value in seconds
+	 * @param ContentType The content type of the files
+	 * @param MaxConcurrentDownloads The maximum number of files downloaded at once
+	 * @param OnProgress A function that is called with the progress as BytesReceived and the total size of the files to download
+	 * @return A future that resolves to the result of the sync
+	 */
+	virtual TFuture<EDownloadToStorageResult> SyncDirectory(const FRuntimeSyncManifest& Manifest, const FString& LocalDirectory, float Timeout, const FString& ContentType, int32 MaxConcurrentDownloads, const FOnProgress& OnProgress);
+
+	/**
+	 * Download the sync manifest and sync the local directory with it
+	 *
+	 * @param ManifestURL The URL of the sync manifest. Files without a URL are downloaded relative to the directory of the manifest
+	 * @param LocalDirectory The directory to sync. Files not listed in the manifest are deleted from it
+	 * @param Timeout The timeout value in seconds
+	 * @param ContentType The content type of the files
+	 * @param MaxConcurrentDownloads The maximum number of files downloaded at once
+	 * @param OnProgress A function that is called with the progress as BytesReceived and the total size of the files to download
+	 * @return A future that resolves to the result of the sync
+	 */
+	virtual TFuture<EDownloadToStorageResult> SyncDirectoryFromURL(const FString& ManifestURL, const FString& LocalDirectory, float Timeout, const FString& ContentType, int32 MaxConcurrentDownloads, const FOnProgress& OnProgress);
+
+	//~ Begin FRuntimeChunkDownloader Interface
+	virtual void CancelDownload() override;
+	virtual void PauseDownload() override;
+	virtual void ResumeDownload() override;
+	//~ End FRuntimeChunkDownloader Interface
+
+protected:
+	/**
+	 * Cached metadata of a local file, used to detect changes without hashing the file
+	 */
+	struct FLocalFileState
+	{
+		/** Size of the file, in bytes */
+		int64 Size = 0;
+
+		/** The modification time of the file */
+		FDateTime ModificationTime;
+
+		/** SHA-1 hash of the file content */
+		FSHAHash Hash;
+	};
+
+	/**
+	 * The changes needed to bring the local directory in sync with the manifest
+	 */
+	struct FSyncPlan
+	{
+		/** Indices of the manifest files to download */
+		TArray<int32> FilesToDownload;
+
+		/** Paths of the local files not listed in the manifest, relative to the synced directory */
+		TArray<FString> StaleFiles;
+
+		/** The cached metadata of the local files that are up to date, by relative path */
+		TMap<FString, FLocalFileState> FileStates;
+
+		/** The total size of the files to download, in bytes */
+		int64 TotalBytes = 0;
+
+		/** Whether the cached metadata differs from the saved one, e.g. because files were hashed again */
+		bool bFileStatesChanged = false;
+	};
+
+	/**
+	 * The progress of downloading the files of the sync plan
+	 */
+	struct FSyncDownloadState
+	{
+		/** The manifest being synced */
+		FRuntimeSyncManifest Manifest;
+
+		/** The changes being made */
+		FSyncPlan Plan;
+
+		/** The directory being synced */
+		FString LocalDirectory;
+
+		/** The timeout value in seconds */
+		float Timeout = 0;
+
+		/** The content type of the files */
+		FString ContentType;
+
+		/** The maximum number of files downloaded at once */
+		int32 MaxConcurrentDownloads = 1;
+
+		/** The function called with the progress */
+		FOnProgress OnProgress;
+
+		/** The index in the files to download of the next file to start */
+		int32 NextFileIndex = 0;
+
+		/** The number of files being downloaded or saved */
+		int32 ActiveDownloads = 0;
+
+		/** The bytes received by the completed files */
+		int64 CompletedBytes = 0;
+
+		/** The bytes received by the files being downloaded, by the index of the manifest file */
+		TMap<int32, int64> ActiveBytes;
+
+		/** The result of the failed download, if any */
+		TOptional<EDownloadToStorageResult> FailureResult;
+
+		/** Whether the sync is being finished */
+		bool bFinished = false;
+
+		/** The storage space reserved for the files to download */
+		FRuntimeStorageReservationPtr Reservation;
+
+		/** The promise of the sync */
+		TSharedPtr<TPromise<EDownloadToStorageResult>> PromisePtr;
+	};
+
+	/**
+	 * Compare the local directory with the manifest. Should be called outside of the game thread
+	 *
+	 * @param Manifest The manifest listing the files the directory should contain
+	 * @param LocalDirectory The directory to sync
+	 * @return The changes needed to sync the directory
+	 */
+	static FSyncPlan CreateSyncPlan(const FRuntimeSyncManifest& Manifest, const FString& LocalDirectory);
+
+	/**
+	 * Start downloading the next files of the plan, up to the maximum number of concurrent downloads, or finish the sync once all are downloaded
+	 */
+	void StartNextDownloads(const TSharedRef<FSyncDownloadState>& State);
+
+	/**
+	 * Finish the sync by committing the downloaded files, or discarding them if a download failed
+	 */
+	static void FinishSync(const TSharedRef<FSyncDownloadState>& State);
+
+	/**
+	 * Handle the completion of a file download and continue with the next files
+	 *
+	 * @param WeakThisPtr The sync downloader, which may have been destroyed in the meantime
+	 * @param State The progress of the sync
+	 * @param FileIndex The index of the manifest file that was downloaded
+	 * @param FailureResult The result of the failed download or save, if it failed
+	 */
+	static void OnFileComplete(const TWeakPtr<FRuntimeDirectorySyncDownloader>& WeakThisPtr, const TSharedRef<FSyncDownloadState>& State, int32 FileIndex, TOptional<EDownloadToStorageResult> FailureResult);
+
+	/**
+	 * Move the staged files into place and delete the stale files as listed in the commit journal, then remove the journal. Should be called outside of the game thread
+	 *
+	 * @param LocalDirectory The directory being synced
+	 * @return Whether the commit was completed or not
+	 */
+	static bool ApplyCommitJournal(const FString& LocalDirectory);
+
+	/**
+	 * Get the directory the sync keeps its metadata, staged files and commit journal in
+	 */
+	static FString GetSyncMetadataDirectory(const FString& LocalDirectory);
+
+	/**
+	 * Load the cached metadata of the local files
+	 */
+	static TMap<FString, FLocalFileState> LoadFileStates(const FString& LocalDirectory);
+
+	/**
+	 * Save the cached metadata of the local files
+	 */
+	static bool SaveFileStates(const FString& LocalDirectory, const TMap<FString, FLocalFileState>& FileStates);
+
+	/**
+	 * Compute the SHA-1 hash of the file without loading it into memory at once
+	 */
+	static bool HashFile(const FString& FilePath, FSHAHash& OutHash);
+
+	/** Downloaders of the files being downloaded */
+	TArray<TSharedPtr<FRuntimeChunkDownloader>> FileDownloaders;
+};
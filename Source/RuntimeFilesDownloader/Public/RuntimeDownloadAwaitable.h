@@ -0,0 +1,340 @@
+// Georgy Treshchev 2024.
+
+#pragma once
+
+#include "RuntimeChunkDownloader.h"
+#include "RuntimeDownloadExecutionPolicy.h"
+#include "HAL/CriticalSection.h"
+#include "Templates/Atomic.h"
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <coroutine>
+#define RUNTIMEFILESDOWNLOADER_WITH_COROUTINES 1
+#else
+#define RUNTIMEFILESDOWNLOADER_WITH_COROUTINES 0
+#endif
+
+/**
+ * Token canceling all the downloaders registered with it at once, e.g. every download of a screen or of a parallel batch
+ * Copies of the token share the same state
+ */
+class RUNTIMEFILESDOWNLOADER_API FRuntimeDownloadCancellationToken
+{
+public:
+	FRuntimeDownloadCancellationToken();
+
+	/**
+	 * Cancel all the registered downloaders, and the downloaders registered from now on. Should be called on the game thread
+	 */
+	void Cancel() const;
+
+	/**
+	 * Check whether the token has been canceled
+	 */
+	bool IsCanceled() const;
+
+	/**
+	 * Register the downloader to be canceled with the token. The downloader is canceled right away if the token is already canceled
+	 *
+	 * @param Downloader The downloader to register
+	 */
+	void Register(const TSharedRef<FRuntimeChunkDownloader>& Downloader) const;
+
+	/**
+	 * Create a chunk downloader registered with the token
+	 */
+	TSharedRef<FRuntimeChunkDownloader> MakeDownloader() const;
+
+private:
+	struct FState
+	{
+		/** Guards the registered downloaders */
+		FCriticalSection Lock;
+
+		/** The registered downloaders */
+		TArray<TWeakPtr<FRuntimeChunkDownloader>> Downloaders;
+
+		/** Whether the token has been canceled */
+		TAtomic<bool> bCanceled{false};
+	};
+
+	/** The state shared by the copies of the token */
+	TSharedRef<FState, ESPMode::ThreadSafe> State;
+};
+
+/**
+ * Combine the futures into a future that resolves once all of them have resolved, with their values in the same order
+ *
+ * @param Futures The futures to combine
+ * @return The future resolving to the values of all the futures
+ */
+template <typename ResultType>
+TFuture<TArray<ResultType>> WhenAll(TArray<TFuture<ResultType>>&& Futures)
+{
+	if (Futures.Num() == 0)
+	{
+		return MakeFulfilledPromise<TArray<ResultType>>(TArray<ResultType>()).GetFuture();
+	}
+
+	struct FState
+	{
+		FCriticalSection Lock;
+		TArray<TOptional<ResultType>> Results;
+		int32 RemainingCount = 0;
+		TPromise<TArray<ResultType>> Promise;
+	};
+
+	TSharedRef<FState, ESPMode::ThreadSafe> State = MakeShared<FState, ESPMode::ThreadSafe>();
+	State->Results.SetNum(Futures.Num());
+	State->RemainingCount = Futures.Num();
+	TFuture<TArray<ResultType>> CombinedFuture = State->Promise.GetFuture();
+
+	for (int32 FutureIndex = 0; FutureIndex < Futures.Num(); ++FutureIndex)
+	{
+		Futures[FutureIndex].Next([State, FutureIndex](ResultType Result)
+		{
+			bool bLast;
+			{
+				FScopeLock Lock(&State->Lock);
+				State->Results[FutureIndex].Emplace(MoveTemp(Result));
+				bLast = --State->RemainingCount == 0;
+			}
+
+			if (bLast)
+			{
+				TArray<ResultType> Results;
+				Results.Reserve(State->Results.Num());
+				for (TOptional<ResultType>& OptionalResult : State->Results)
+				{
+					Results.Add(MoveTemp(OptionalResult.GetValue()));
+				}
+				State->Promise.SetValue(MoveTemp(Results));
+			}
+		});
+	}
+
+	return CombinedFuture;
+}
+
+/**
+ * Combine the futures into a future that resolves as soon as the first of them resolves. The other futures keep running, and can be stopped with a cancellation token
+ *
+ * @param Futures The futures to combine. Must not be empty
+ * @return The future resolving to the index of the first resolved future paired with its value
+ */
+template <typename ResultType>
+TFuture<TPair<int32, ResultType>> WhenAny(TArray<TFuture<ResultType>>&& Futures)
+{
+	check(Futures.Num() > 0);
+
+	struct FState
+	{
+		TAtomic<bool> bResolved{false};
+		TPromise<TPair<int32, ResultType>> Promise;
+	};
+
+	TSharedRef<FState, ESPMode::ThreadSafe> State = MakeShared<FState, ESPMode::ThreadSafe>();
+	TFuture<TPair<int32, ResultType>> CombinedFuture = State->Promise.GetFuture();
+
+	for (int32 FutureIndex = 0; FutureIndex < Futures.Num(); ++FutureIndex)
+	{
+		Futures[FutureIndex].Next([State, FutureIndex](ResultType Result)
+		{
+			if (!State->bResolved.Exchange(true))
+			{
+				State->Promise.SetValue(TPair<int32, ResultType>(FutureIndex, MoveTemp(Result)));
+			}
+		});
+	}
+
+	return CombinedFuture;
+}
+
+#if RUNTIMEFILESDOWNLOADER_WITH_COROUTINES
+/**
+ * Awaitable of a future, resuming the awaiting coroutine on the chosen executor once the future resolves
+ * Usage: FRuntimeChunkDownloaderResult Result = co_await RuntimeAwait(Downloader->DownloadFile(...));
+ */
+template <typename ResultType>
+class TRuntimeDownloadAwaitable
+{
+public:
+	TRuntimeDownloadAwaitable(TFuture<ResultType>&& InFuture, ERuntimeDownloadExecutor InExecutor)
+		: Future(MoveTemp(InFuture))
+		, Executor(InExecutor)
+	{
+	}
+
+	bool await_ready() const
+	{
+		return false;
+	}
+
+	void await_suspend(std::coroutine_handle<> Handle)
+	{
+		// The future is moved out, since the coroutine may be resumed and the awaitable destroyed before Next returns
+		TFuture<ResultType> AwaitedFuture = MoveTemp(Future);
+
+		// The awaitable lives in the suspended coroutine frame until it is resumed, so it can receive the result directly
+		const ERuntimeDownloadExecutor ResumeExecutor = Executor;
+		AwaitedFuture.Next([this, Handle, ResumeExecutor](ResultType InResult)
+		{
+			Result.Emplace(MoveTemp(InResult));
+			RuntimeDownloadExecutor::Execute(ResumeExecutor, [Handle]()
+			{
+				Handle.resume();
+			});
+		});
+	}
+
+	ResultType await_resume()
+	{
+		return MoveTemp(Result.GetValue());
+	}
+
+private:
+	/** The awaited future */
+	TFuture<ResultType> Future;
+
+	/** The executor the coroutine is resumed on */
+	ERuntimeDownloadExecutor Executor;
+
+	/** The value of the future, set right before the coroutine is resumed */
+	TOptional<ResultType> Result;
+};
+
+template <>
+class TRuntimeDownloadAwaitable<void>
+{
+public:
+	TRuntimeDownloadAwaitable(TFuture<void>&& InFuture, ERuntimeDownloadExecutor InExecutor)
+		: Future(MoveTemp(InFuture))
+		, Executor(InExecutor)
+	{
+	}
+
+	bool await_ready() const
+	{
+		return false;
+	}
+
+	void await_suspend(std::coroutine_handle<> Handle)
+	{
+		TFuture<void> AwaitedFuture = MoveTemp(Future);
+		const ERuntimeDownloadExecutor ResumeExecutor = Executor;
+		AwaitedFuture.Then([Handle, ResumeExecutor](TFuture<void>)
+		{
+			RuntimeDownloadExecutor::Execute(ResumeExecutor, [Handle]()
+			{
+				Handle.resume();
+			});
+		});
+	}
+
+	void await_resume()
+	{
+	}
+
+private:
+	/** The awaited future */
+	TFuture<void> Future;
+
+	/** The executor the coroutine is resumed on */
+	ERuntimeDownloadExecutor Executor;
+};
+
+/**
+ * Make the future awaitable in a coroutine
+ *
+ * @param Future The future to await, e.g. returned by one of the FRuntimeChunkDownloader functions
+ * @param Executor The executor to resume the coroutine on
+ * @return The awaitable
+ */
+template <typename ResultType>
+TRuntimeDownloadAwaitable<ResultType> RuntimeAwait(TFuture<ResultType>&& Future, ERuntimeDownloadExecutor Executor = ERuntimeDownloadExecutor::GameThread)
+{
+	return TRuntimeDownloadAwaitable<ResultType>(MoveTemp(Future), Executor);
+}
+
+template <typename ResultType>
+struct TRuntimeDownloadTaskPromiseBase
+{
+	/** The promise resolved with the value the coroutine returns */
+	TPromise<ResultType> Promise;
+
+	template <typename ValueType>
+	void return_value(ValueType&& Value)
+	{
+		Promise.SetValue(Forward<ValueType>(Value));
+	}
+};
+
+template <>
+struct TRuntimeDownloadTaskPromiseBase<void>
+{
+	/** The promise resolved once the coroutine returns */
+	TPromise<void> Promise;
+
+	void return_void()
+	{
+		Promise.SetValue();
+	}
+};
+
+/**
+ * Return type of the coroutines orchestrating downloads. The coroutine starts right away and its frame is freed once it returns
+ * The task can be awaited from another coroutine, or converted to a future to be used with the rest of the API
+ */
+template <typename ResultType>
+class TRuntimeDownloadTask
+{
+public:
+	struct promise_type : TRuntimeDownloadTaskPromiseBase<ResultType>
+	{
+		TRuntimeDownloadTask get_return_object()
+		{
+			return TRuntimeDownloadTask(this->Promise.GetFuture());
+		}
+
+		std::suspend_never initial_suspend() noexcept
+		{
+			return {};
+		}
+
+		std::suspend_never final_suspend() noexcept
+		{
+			return {};
+		}
+
+		void unhandled_exception()
+		{
+			checkNoEntry();
+		}
+	};
+
+	explicit TRuntimeDownloadTask(TFuture<ResultType>&& InFuture)
+		: Future(MoveTemp(InFuture))
+	{
+	}
+
+	/**
+	 * Get the future resolving to the value the coroutine returns. Can only be called once
+	 */
+	TFuture<ResultType> GetFuture()
+	{
+		return MoveTemp(Future);
+	}
+
+	/**
+	 * Await the task from another coroutine, resuming it on the thread the task finished on
+	 */
+	TRuntimeDownloadAwaitable<ResultType> operator co_await()
+	{
+		return TRuntimeDownloadAwaitable<ResultType>(MoveTemp(Future), ERuntimeDownloadExecutor::Inline);
+	}
+
+private:
+	/** The future resolving to the value the coroutine returns */
+	TFuture<ResultType> Future;
+};
+#endif
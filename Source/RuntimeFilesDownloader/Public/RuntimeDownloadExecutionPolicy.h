@@ -0,0 +1,84 @@
+// Georgy Treshchev 2024.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/Async.h"
+
+/**
+ * Where a continuation of a download is run
+ */
+enum class ERuntimeDownloadExecutor : uint8
+{
+	/** On the thread that completed the download, usually the game thread */
+	Inline,
+	/** On the game thread, without a thread hop if already there */
+	GameThread,
+	/** On a task graph background thread */
+	TaskGraph,
+	/** On the thread pool */
+	Background
+};
+
+namespace RuntimeDownloadExecutor
+{
+	/**
+	 * Run the function on the executor
+	 *
+	 * @param Executor The executor to run the function on
+	 * @param Function The function to run
+	 */
+	inline void Execute(ERuntimeDownloadExecutor Executor, TUniqueFunction<void()>&& Function)
+	{
+		switch (Executor)
+		{
+		case ERuntimeDownloadExecutor::GameThread:
+			if (IsInGameThread())
+			{
+				Function();
+			}
+			else
+			{
+				AsyncTask(ENamedThreads::GameThread, MoveTemp(Function));
+			}
+			break;
+		case ERuntimeDownloadExecutor::TaskGraph:
+			AsyncTask(ENamedThreads::AnyBackgroundThreadNormalTask, MoveTemp(Function));
+			break;
+		case ERuntimeDownloadExecutor::Background:
+			Async(EAsyncExecution::ThreadPool, MoveTemp(Function));
+			break;
+		default:
+			Function();
+			break;
+		}
+	}
+}
+
+/**
+ * Where the work of a download and its callbacks are run
+ */
+struct RUNTIMEFILESDOWNLOADER_API FRuntimeDownloadExecutionPolicy
+{
+	/** Whether to copy the downloaded data and write files on worker threads, instead of the game thread where the HTTP module completes the requests */
+	bool bProcessOnWorkerThreads = true;
+
+	/** The executor the progress and completion callbacks are run on */
+	ERuntimeDownloadExecutor CallbackExecutor = ERuntimeDownloadExecutor::GameThread;
+
+	/** The minimum interval between two progress callbacks in seconds, so that progress updates are delivered in batches. 0 to deliver every update */
+	float ProgressInterval = 0.0f;
+
+	/**
+	 * Get the policy with the defaults from the plugin settings
+	 */
+	static FRuntimeDownloadExecutionPolicy FromSettings();
+
+	/**
+	 * Wrap the progress function so that it is run on the callback executor, at most once per progress interval. The final progress update is always delivered
+	 *
+	 * @param OnProgress The progress function to wrap, called with BytesReceived and ContentSize
+	 * @return The wrapped progress function
+	 */
+	TFunction<void(int64, int64)> WrapProgress(const TFunction<void(int64, int64)>& OnProgress) const;
+};
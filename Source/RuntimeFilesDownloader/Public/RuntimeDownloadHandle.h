@@ -0,0 +1,136 @@
+// Georgy Treshchev 2024.
+
+#pragma once
+
+#include "RuntimeChunkDownloader.h"
+#include "Templates/Atomic.h"
+
+enum class EDownloadToStorageResult : uint8;
+
+/**
+ * Lightweight handle of a download started from C++ without creating a UObject
+ * The download keeps itself alive until complete, so the handle only needs to be kept to control the download
+ * Callbacks are called on the callback executor of the execution policy, the game thread by default
+ * The download outlives the game session unless SetCancelOnSessionEnd is called on its downloader
+ */
+class RUNTIMEFILESDOWNLOADER_API FRuntimeDownloadHandle : public TSharedFromThis<FRuntimeDownloadHandle>
+{
+public:
+	using FOnMemoryDownloadComplete = TFunction<void(EDownloadToMemoryResult, const FRuntimeSharedBuffer&)>;
+	using FOnStorageDownloadComplete = TFunction<void(EDownloadToStorageResult, const FString&)>;
+	using FOnContentSize = TFunction<void(int64)>;
+
+	explicit FRuntimeDownloadHandle(const TSharedRef<FRuntimeChunkDownloader>& InDownloader);
+
+	/**
+	 * Download the file into memory
+	 *
+	 * @param URL The URL of the file to download
+	 * @param Timeout The timeout value in seconds
+	 * @param ContentType The content type of the file
+	 * @param bForceByPayload Whether to download the file by payload, without requesting the content size first
+	 * @param OnProgress A function that is called with the progress as BytesReceived and ContentSize
+	 * @param OnComplete A function that is called with the result and the downloaded data
+	 * @param ExecutionPolicy Where the downloaded data is processed and the callbacks are called
+	 * @return The handle of the download
+	 */
+	static TSharedRef<FRuntimeDownloadHandle> DownloadToMemory(const FString& URL, float Timeout, const FString& ContentType, bool bForceByPayload, const FRuntimeChunkDownloader::FOnProgress& OnProgress, const FOnMemoryDownloadComplete& OnComplete, const FRuntimeDownloadExecutionPolicy& ExecutionPolicy = FRuntimeDownloadExecutionPolicy::FromSettings());
+
+	/**
+	 * Download the file and save it to storage
+	 *
+	 * @param URL The URL of the file to download
+	 * @param SavePath The absolute path to save the file to
+	 * @param Timeout The timeout value in seconds
+	 * @param ContentType The content type of the file
+	 * @param bForceByPayload Whether to download the file by payload, without requesting the content size first
+	 * @param OnProgress A function that is called with the progress as BytesReceived and ContentSize
+	 * @param OnComplete A function that is called with the result and the path the file was saved to
+	 * @param ExecutionPolicy Where the downloaded data is processed, the file is written and the callbacks are called
+	 * @return The handle of the download
+	 */
+	static TSharedRef<FRuntimeDownloadHandle> DownloadToStorage(const FString& URL, const FString& SavePath, float Timeout, const FString& ContentType, bool bForceByPayload, const FRuntimeChunkDownloader::FOnProgress& OnProgress, const FOnStorageDownloadComplete& OnComplete, const FRuntimeDownloadExecutionPolicy& ExecutionPolicy = FRuntimeDownloadExecutionPolicy::FromSettings());
+
+	/**
+	 * Get the content size of the file
+	 *
+	 * @param URL The URL of the file
+	 * @param Timeout The timeout value in seconds
+	 * @param OnComplete A function that is called with the content size in bytes, or a value <= 0 if it is unknown
+	 * @param ExecutionPolicy Where the callback is called
+	 * @return The handle of the request
+	 */
+	static TSharedRef<FRuntimeDownloadHandle> GetContentSize(const FString& URL, float Timeout, const FOnContentSize& OnComplete, const FRuntimeDownloadExecutionPolicy& ExecutionPolicy = FRuntimeDownloadExecutionPolicy::FromSettings());
+
+	/**
+	 * Save the downloaded data to the file, replacing the existing file. Shared by the handle and UFileToStorageDownloader
+	 * Writes the file on the calling thread, which should be a worker thread when the execution policy allows it
+	 *
+	 * @param Result The result of downloading the data
+	 * @param Data The downloaded data
+	 * @param SavePath The absolute path to save the file to
+	 * @return The result of saving the download
+	 */
+	static EDownloadToStorageResult SaveDownloadedData(EDownloadToMemoryResult Result, const TArray64<uint8>& Data, const FString& SavePath);
+
+	/**
+	 * Cancel the download
+	 */
+	void Cancel();
+
+	/**
+	 * Pause the download
+	 */
+	void Pause();
+
+	/**
+	 * Resume the paused download
+	 */
+	void Resume();
+
+	/**
+	 * Check whether the download is paused
+	 */
+	bool IsPaused() const;
+
+	/**
+	 * Check whether the download is complete and its callback has been called
+	 */
+	bool IsComplete() const
+	{
+		return bComplete;
+	}
+
+	/**
+	 * Get the statistics gathered during the download
+	 */
+	const FRuntimeFilesDownloaderStats& GetStats() const;
+
+	/**
+	 * Get the chunk downloader performing the download
+	 */
+	const TSharedRef<FRuntimeChunkDownloader>& GetDownloader() const
+	{
+		return Downloader;
+	}
+
+private:
+	/**
+	 * Start downloading the file into memory, without marshalling the result to the callback executor
+	 *
+	 * @param Handle The handle of the download
+	 * @param URL The URL of the file to download
+	 * @param Timeout The timeout value in seconds
+	 * @param ContentType The content type of the file
+	 * @param bForceByPayload Whether to download the file by payload, without requesting the content size first
+	 * @param OnProgress A function that is called with the progress as BytesReceived and ContentSize
+	 * @param OnResult A function that is called on the game thread with the result of the download
+	 */
+	static void StartDownloadToMemory(const TSharedRef<FRuntimeDownloadHandle>& Handle, const FString& URL, float Timeout, const FString& ContentType, bool bForceByPayload, const FRuntimeChunkDownloader::FOnProgress& OnProgress, TFunction<void(FRuntimeChunkDownloaderResult&&)>&& OnResult);
+
+	/** The chunk downloader performing the download */
+	TSharedRef<FRuntimeChunkDownloader> Downloader;
+
+	/** Whether the download is complete */
+	TAtomic<bool> bComplete;
+};
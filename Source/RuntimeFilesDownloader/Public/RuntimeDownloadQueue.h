@@ -0,0 +1,246 @@
+// Georgy Treshchev 2024.
+
+#pragma once
+
+#include "RuntimeChunkDownloader.h"
+#include "RuntimeStorageAdmission.h"
+#include "Misc/Guid.h"
+#include "Delegates/Delegate.h"
+#include "GenericPlatform/GenericPlatformFile.h"
+#include "Templates/Atomic.h"
+
+enum class EDownloadToStorageResult : uint8;
+
+/** Delegate broadcast when a job of the download queue completes, including the jobs resumed from a previous run. Called with the job identifier, the result and the save path */
+DECLARE_MULTICAST_DELEGATE_ThreeParams(FOnRuntimeDownloadQueueJobComplete, const FGuid&, EDownloadToStorageResult, const FString&);
+
+/**
+ * A queue of downloads to storage that survives restarts of the application
+ * Each job is recorded in a journal along with the validators of the file and the ranges already written to a partial file next to the save path
+ * Jobs left unfinished, e.g. when the application was killed by the OS, continue from the recorded ranges once resumed, unless the file has changed on the server
+ * Jobs are downloaded one at a time. Should only be used from the game thread
+ */
+class RUNTIMEFILESDOWNLOADER_API FRuntimeDownloadQueue
+{
+public:
+	using FOnJobComplete = TFunction<void(EDownloadToStorageResult, const FString&)>;
+
+	FRuntimeDownloadQueue();
+	~FRuntimeDownloadQueue();
+
+	/**
+	 * Get the download queue shared by the downloaders. Loads the jobs recorded in the journal on first use, without starting them
+	 */
+	static FRuntimeDownloadQueue& Get();
+
+	/**
+	 * Check whether the download queue has been created
+	 */
+	static bool IsAvailable();
+
+	/**
+	 * Save the journal, stop the active job and destroy the download queue. Called by the module on shutdown
+	 */
+	static void Shutdown();
+
+	/**
+	 * Get the path of the journal the jobs are recorded in
+	 */
+	static FString GetJournalPath();
+
+	/**
+	 * Queue the file to be downloaded and saved to storage
+	 *
+	 * @param URL The URL of the file to download
+	 * @param SavePath The absolute path to save the file to
+	 * @param Timeout The timeout value in seconds
+	 * @param ContentType The content type of the file
+	 * @param OnProgress A function that is called with the progress as BytesReceived and ContentSize
+	 * @param OnComplete A function that is called with the result and the path the file was saved to
+	 * @return The identifier of the job
+	 */
+	FGuid Enqueue(const FString& URL, const FString& SavePath, float Timeout = 0, const FString& ContentType = FString(), const FRuntimeChunkDownloader::FOnProgress& OnProgress = nullptr, const FOnJobComplete& OnComplete = nullptr);
+
+	/**
+	 * Cancel the job, delete its partial file and remove it from the journal
+	 *
+	 * @param JobId The identifier of the job
+	 */
+	void Cancel(const FGuid& JobId);
+
+	/**
+	 * Start the jobs recorded in the journal by a previous run, as well as the jobs held back after failing in this run
+	 *
+	 * @return The number of jobs waiting to be downloaded
+	 */
+	int32 ResumeJournaledJobs();
+
+	/**
+	 * Check whether the job is in the queue
+	 *
+	 * @param JobId The identifier of the job
+	 */
+	bool IsQueued(const FGuid& JobId) const;
+
+	/**
+	 * Get the progress of the job
+	 *
+	 * @param JobId The identifier of the job
+	 * @param OutBytesDownloaded The number of bytes downloaded so far, including the previous runs
+	 * @param OutContentSize The size of the file in bytes, or a value <= 0 if not known yet
+	 * @return Whether the job is in the queue or not
+	 */
+	bool GetJobProgress(const FGuid& JobId, int64& OutBytesDownloaded, int64& OutContentSize) const;
+
+	/**
+	 * Get the delegate broadcast when a job completes
+	 */
+	FOnRuntimeDownloadQueueJobComplete& OnJobComplete()
+	{
+		return JobCompleteDelegate;
+	}
+
+protected:
+	/**
+	 * A download recorded in the journal
+	 */
+	struct FJob
+	{
+		/** The identifier of the job */
+		FGuid Id;
+
+		/** The URL of the file */
+		FString URL;
+
+		/** The absolute path to save the file to */
+		FString SavePath;
+
+		/** The timeout value in seconds */
+		float Timeout = 0;
+
+		/** The content type of the file */
+		FString ContentType;
+
+		/** Size of the file in bytes, or a value <= 0 if not known yet */
+		int64 ContentSize = 0;
+
+		/** The ETag header of the file the ranges were downloaded from */
+		FString ETag;
+
+		/** The Last-Modified header of the file the ranges were downloaded from */
+		FString LastModified;
+
+		/** The inclusive ranges of the file written to the partial file, sorted and merged */
+		TArray<FInt64Vector2> CompletedRanges;
+
+		/** The number of runs the job has failed in */
+		int32 Attempts = 0;
+
+		/** Whether the job is held back until the queue is resumed, e.g. because it was loaded from the journal or failed in this run */
+		bool bHeldBack = false;
+
+		/** The number of bytes downloaded so far */
+		int64 BytesDownloaded = 0;
+
+		/** The offset the next downloaded chunk is written at */
+		int64 WriteOffset = 0;
+
+		/** The downloader of the job, valid while active */
+		TSharedPtr<FRuntimeChunkDownloader> Downloader;
+
+		/** The partial file being written, valid while active */
+		TSharedPtr<IFileHandle, ESPMode::ThreadSafe> PartialFile;
+
+		/** The write of the previous chunk to the partial file, or the close of the partial file once the job is restarted. Writes are chained so that they happen in order */
+		TFuture<void> WriteFuture;
+
+		/** Whether writing to the partial file has failed */
+		TSharedPtr<TAtomic<bool>, ESPMode::ThreadSafe> bWriteFailed;
+
+		/** The storage space reserved for the rest of the file */
+		FRuntimeStorageReservationPtr Reservation;
+
+		/** The function called with the progress */
+		FRuntimeChunkDownloader::FOnProgress OnProgress;
+
+		/** The function called once the job completes */
+		FOnJobComplete OnComplete;
+	};
+
+	/**
+	 * Start the first job that is not held back, if no job is active
+	 */
+	void StartNextJob();
+
+	/**
+	 * Start downloading the job, continuing from the ranges recorded in the journal if the file has not changed on the server
+	 */
+	void StartJob(const TSharedRef<FJob>& Job);
+
+	/**
+	 * Download the rest of the file into the opened partial file
+	 */
+	void DownloadRemainingChunks(const TSharedRef<FJob>& Job);
+
+	/**
+	 * Record the chunk written to the partial file
+	 */
+	void OnChunkWritten(const TSharedRef<FJob>& Job, FInt64Vector2 Range);
+
+	/**
+	 * Complete the job, removing it from the journal unless it failed and has attempts left. A job canceled from outside of the queue is restarted instead
+	 */
+	void CompleteJob(const TSharedRef<FJob>& Job, EDownloadToStorageResult Result);
+
+	/**
+	 * Check whether the job is the one being downloaded
+	 */
+	bool IsActiveJob(const TSharedRef<FJob>& Job) const;
+
+	/**
+	 * Make the function tracking the progress of the job and forwarding it to the function of the job, if any
+	 */
+	static FRuntimeChunkDownloader::FOnProgress MakeProgressFunction(const TSharedRef<FJob>& Job);
+
+	/**
+	 * Get the path of the partial file of the job
+	 */
+	static FString GetPartialFilePath(const FJob& Job);
+
+	/**
+	 * Get the number of bytes at the start of the file covered by the ranges without a gap
+	 */
+	static int64 GetContiguousBytes(const TArray<FInt64Vector2>& Ranges);
+
+	/**
+	 * Add the range to the sorted ranges, merging it with the adjacent ones
+	 */
+	static void AddRange(TArray<FInt64Vector2>& Ranges, FInt64Vector2 Range);
+
+	/**
+	 * Load the jobs recorded in the journal
+	 */
+	void LoadJournal();
+
+	/**
+	 * Save the jobs to the journal on the thread pool. Progress is saved at most once per interval, unless forced
+	 *
+	 * @param bForce Whether to save regardless of the time since the last save, e.g. when a job is added or removed
+	 */
+	void SaveJournal(bool bForce);
+
+	/** The jobs, in the order they were queued */
+	TArray<TSharedRef<FJob>> Jobs;
+
+	/** The job being downloaded */
+	TSharedPtr<FJob> ActiveJob;
+
+	/** Time the journal was last saved at, in seconds */
+	double LastJournalSaveTime;
+
+	/** The last save of the journal. Saves are chained so that they happen in order */
+	TFuture<void> JournalSaveFuture;
+
+	/** The delegate broadcast when a job completes */
+	FOnRuntimeDownloadQueueJobComplete JobCompleteDelegate;
+};
@@ -0,0 +1,305 @@
+// Georgy Treshchev 2024.
+
+#pragma once
+
+#include "RuntimeChunkDownloader.h"
+#include "RuntimeStreamDecompressor.h"
+#include "Containers/Queue.h"
+#include "Misc/SecureHash.h"
+
+class FJsonObject;
+class IFileHandle;
+
+/**
+ * Consumer of a download stream that processes the downloaded data slice by slice, in order, as it arrives
+ * The slices are consumed on a worker thread, one at a time. While the consumer is not ready for data, the slices are queued, and the download is paused once the queue grows too large
+ */
+class RUNTIMEFILESDOWNLOADER_API IRuntimeDownloadStreamConsumer : public TSharedFromThis<IRuntimeDownloadStreamConsumer, ESPMode::ThreadSafe>
+{
+public:
+	virtual ~IRuntimeDownloadStreamConsumer() = default;
+
+	/**
+	 * Process the next slice of the downloaded data
+	 *
+	 * @param Data The slice data
+	 * @param Size The size of the slice in bytes
+	 * @return Whether the slice was processed successfully or not. Returning false fails and cancels the download
+	 */
+	virtual bool Consume(const uint8* Data, int64 Size) = 0;
+
+	/**
+	 * Finish processing once the download is over. Called exactly once, after the last slice has been consumed
+	 *
+	 * @param bSucceeded Whether the whole data has been downloaded and consumed successfully
+	 * @return Whether the consumer has finished successfully or not
+	 */
+	virtual bool Finalize(bool bSucceeded) = 0;
+
+	/**
+	 * Check whether the consumer can accept more data. Consumers returning false must call NotifyReadyForData once they become ready again
+	 */
+	virtual bool IsReadyForData() const
+	{
+		return true;
+	}
+
+	/**
+	 * Set the function called when the consumer becomes ready for data again. Set by the stream downloader
+	 *
+	 * @param InOnReadyForData The function to call. Can be called on any thread
+	 */
+	virtual void SetOnReadyForData(const TFunction<void()>& InOnReadyForData)
+	{
+		OnReadyForData = InOnReadyForData;
+	}
+
+protected:
+	/**
+	 * Notify the stream downloader that the consumer is ready for data again
+	 */
+	void NotifyReadyForData() const
+	{
+		if (OnReadyForData)
+		{
+			OnReadyForData();
+		}
+	}
+
+private:
+	/** The function called when the consumer becomes ready for data again */
+	TFunction<void()> OnReadyForData;
+};
+
+using FRuntimeDownloadStreamConsumerRef = TSharedRef<IRuntimeDownloadStreamConsumer, ESPMode::ThreadSafe>;
+
+/**
+ * Stream consumer writing the data to a file. The partially written file is deleted if the download fails
+ */
+class RUNTIMEFILESDOWNLOADER_API FRuntimeFileStreamConsumer : public IRuntimeDownloadStreamConsumer
+{
+public:
+	/**
+	 * @param InFilePath The path of the file to write
+	 */
+	explicit FRuntimeFileStreamConsumer(const FString& InFilePath);
+	virtual ~FRuntimeFileStreamConsumer() override;
+
+	//~ Begin IRuntimeDownloadStreamConsumer Interface
+	virtual bool Consume(const uint8* Data, int64 Size) override;
+	virtual bool Finalize(bool bSucceeded) override;
+	//~ End IRuntimeDownloadStreamConsumer Interface
+
+protected:
+	/** The path of the file to write */
+	FString FilePath;
+
+	/** The handle of the file being written, opened on the first slice */
+	TUniquePtr<IFileHandle> FileHandle;
+};
+
+/**
+ * Stream consumer computing the SHA-1 hash of the data, optionally verifying it against the expected hash
+ */
+class RUNTIMEFILESDOWNLOADER_API FRuntimeHashStreamConsumer : public IRuntimeDownloadStreamConsumer
+{
+public:
+	FRuntimeHashStreamConsumer() = default;
+
+	/**
+	 * @param InExpectedHash The hash the data must match for the consumer to finish successfully
+	 */
+	explicit FRuntimeHashStreamConsumer(const FSHAHash& InExpectedHash);
+
+	//~ Begin IRuntimeDownloadStreamConsumer Interface
+	virtual bool Consume(const uint8* Data, int64 Size) override;
+	virtual bool Finalize(bool bSucceeded) override;
+	//~ End IRuntimeDownloadStreamConsumer Interface
+
+	/**
+	 * Get the hash of the data. Valid once finalized
+	 */
+	const FSHAHash& GetHash() const
+	{
+		return Hash;
+	}
+
+protected:
+	/** The hash state */
+	FSHA1 HashState;
+
+	/** The hash of the data, computed when finalized */
+	FSHAHash Hash;
+
+	/** The hash the data must match, if verification is requested */
+	TOptional<FSHAHash> ExpectedHash;
+};
+
+/**
+ * Stream consumer decompressing gzip, zlib or raw deflate data and passing the decompressed data to the next consumer
+ */
+class RUNTIMEFILESDOWNLOADER_API FRuntimeDecompressStreamConsumer : public IRuntimeDownloadStreamConsumer
+{
+public:
+	/**
+	 * @param InNext The consumer receiving the decompressed data
+	 * @param bRawDeflate Whether the data is raw deflate without a gzip or zlib header
+	 */
+	explicit FRuntimeDecompressStreamConsumer(const FRuntimeDownloadStreamConsumerRef& InNext, bool bRawDeflate = false);
+
+	//~ Begin IRuntimeDownloadStreamConsumer Interface
+	virtual bool Consume(const uint8* Data, int64 Size) override;
+	virtual bool Finalize(bool bSucceeded) override;
+	virtual bool IsReadyForData() const override;
+	virtual void SetOnReadyForData(const TFunction<void()>& InOnReadyForData) override;
+	//~ End IRuntimeDownloadStreamConsumer Interface
+
+protected:
+	/** The consumer receiving the decompressed data */
+	FRuntimeDownloadStreamConsumerRef Next;
+
+	/** The decompressor state */
+	FRuntimeStreamDecompressor Decompressor;
+
+	/** Buffer the slices are decompressed into, reused between the slices */
+	TArray64<uint8> DecompressedData;
+};
+
+/**
+ * Stream consumer splitting UTF-8 text into lines, with either LF or CRLF line endings
+ */
+class RUNTIMEFILESDOWNLOADER_API FRuntimeLineStreamConsumer : public IRuntimeDownloadStreamConsumer
+{
+public:
+	/** Function called with each line, without the line ending. Returning false fails the download */
+	using FOnLine = TFunction<bool(const FString&)>;
+
+	/**
+	 * @param InOnLine The function called with each line on the worker thread
+	 */
+	explicit FRuntimeLineStreamConsumer(const FOnLine& InOnLine);
+
+	//~ Begin IRuntimeDownloadStreamConsumer Interface
+	virtual bool Consume(const uint8* Data, int64 Size) override;
+	virtual bool Finalize(bool bSucceeded) override;
+	//~ End IRuntimeDownloadStreamConsumer Interface
+
+protected:
+	/**
+	 * Convert the UTF-8 line to a string and pass it to the line function
+	 */
+	bool EmitLine(const uint8* Data, int64 Size);
+
+	/** The function called with each line */
+	FOnLine OnLine;
+
+	/** The incomplete last line of the previous slices */
+	TArray64<uint8> PartialLine;
+};
+
+/**
+ * Stream consumer parsing newline-delimited JSON (NDJSON, JSON Lines) records one at a time. Empty lines are skipped
+ */
+class RUNTIMEFILESDOWNLOADER_API FRuntimeJsonRecordStreamConsumer : public FRuntimeLineStreamConsumer
+{
+public:
+	/** Function called with each parsed record. Returning false fails the download */
+	using FOnRecord = TFunction<bool(const TSharedRef<FJsonObject>&)>;
+
+	/**
+	 * @param InOnRecord The function called with each record on the worker thread
+	 */
+	explicit FRuntimeJsonRecordStreamConsumer(const FOnRecord& InOnRecord);
+};
+
+/**
+ * Stream consumer passing the data to several consumers, e.g. writing a file and hashing it at the same time
+ */
+class RUNTIMEFILESDOWNLOADER_API FRuntimeTeeStreamConsumer : public IRuntimeDownloadStreamConsumer
+{
+public:
+	/**
+	 * @param InConsumers The consumers receiving the data
+	 */
+	explicit FRuntimeTeeStreamConsumer(const TArray<FRuntimeDownloadStreamConsumerRef>& InConsumers);
+
+	//~ Begin IRuntimeDownloadStreamConsumer Interface
+	virtual bool Consume(const uint8* Data, int64 Size) override;
+	virtual bool Finalize(bool bSucceeded) override;
+	virtual bool IsReadyForData() const override;
+	virtual void SetOnReadyForData(const TFunction<void()>& InOnReadyForData) override;
+	//~ End IRuntimeDownloadStreamConsumer Interface
+
+protected:
+	/** The consumers receiving the data */
+	TArray<FRuntimeDownloadStreamConsumerRef> Consumers;
+};
+
+/**
+ * A chunk downloader that passes the downloaded chunks to a stream consumer as they arrive, so large downloads can be processed progressively instead of after the whole payload
+ */
+class RUNTIMEFILESDOWNLOADER_API FRuntimeStreamDownloader : public FRuntimeChunkDownloader
+{
+public:
+	FRuntimeStreamDownloader();
+
+	/**
+	 * Download the file by chunks, passing each chunk to the consumer on a worker thread as soon as it is downloaded
+	 * The download is paused while more than MaxPendingBytes are waiting to be consumed, and resumed once the consumer catches up
+	 * Only one download can be streamed at a time. A new one is rejected until the returned future of the previous one is fulfilled
+	 *
+	 * @param URL The URL of the file to download
+	 * @param Timeout The timeout value in seconds
+	 * @param ContentType The content type of the file
+	 * @param MaxChunkSize The maximum size of each chunk to download in bytes
+	 * @param MaxPendingBytes The maximum number of downloaded bytes waiting to be consumed before the download is paused
+	 * @param Consumer The consumer processing the downloaded data
+	 * @param OnProgress A function that is called with the progress as BytesReceived and ContentSize
+	 * @return A future that resolves to the result of downloading and consuming the file
+	 */
+	virtual TFuture<EDownloadToMemoryResult> DownloadFileToStream(const FString& URL, float Timeout, const FString& ContentType, int64 MaxChunkSize, int64 MaxPendingBytes, const FRuntimeDownloadStreamConsumerRef& Consumer, const FOnProgress& OnProgress);
+
+protected:
+	/**
+	 * Start consuming the pending slices on a worker thread, unless already consuming
+	 */
+	void StartConsuming();
+
+	/**
+	 * Consume the pending slices until none are left or the consumer is not ready, finalizing the consumer once the download is over. Called on a worker thread
+	 */
+	void ConsumePendingSlices();
+
+	/** The consumer of the current download */
+	TSharedPtr<IRuntimeDownloadStreamConsumer, ESPMode::ThreadSafe> ConsumerPtr;
+
+	/** The promise fulfilled once the consumer has been finalized */
+	TSharedPtr<TPromise<EDownloadToMemoryResult>> StreamPromisePtr;
+
+	/** Guards the state shared with the worker thread */
+	FCriticalSection StreamLock;
+
+	/** Downloaded slices waiting to be consumed */
+	TQueue<TArray64<uint8>> PendingSlices;
+
+	/** The number of bytes waiting to be consumed */
+	int64 PendingBytes;
+
+	/** The maximum number of bytes waiting to be consumed before the download is paused */
+	int64 MaxPendingBytes;
+
+	/** Whether a download is being streamed, from its start until the consumer has been finalized and the result reported */
+	bool bStreaming;
+
+	/** Whether the slices are being consumed on a worker thread */
+	bool bConsuming;
+
+	/** Whether the download was paused because the consumer fell behind */
+	bool bPausedForBackpressure;
+
+	/** The result of the download, set once it is over */
+	TOptional<EDownloadToMemoryResult> DownloadResult;
+
+	/** Whether the consumer failed to process a slice */
+	bool bConsumerFailed;
+};
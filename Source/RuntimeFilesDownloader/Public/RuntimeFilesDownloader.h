@@ -9,4 +9,11 @@ class FRuntimeFilesDownloaderModule : public IModuleInterface
 public:
 	virtual void StartupModule() override;
 	virtual void ShutdownModule() override;
+
+private:
+	/** Handle of the delegate canceling all the downloads when the game session ends */
+	FDelegateHandle WorldCleanupHandle;
+
+	/** Handle of the delegate resuming the download queue once the engine is initialized */
+	FDelegateHandle PostEngineInitHandle;
 };
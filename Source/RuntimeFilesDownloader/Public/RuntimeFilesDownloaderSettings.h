@@ -0,0 +1,71 @@
+// Georgy Treshchev 2024.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DeveloperSettings.h"
+#include "RuntimeFilesDownloaderSettings.generated.h"
+
+/**
+ * Project-wide defaults used by the downloaders. Can be changed in the Project Settings under Plugins > Runtime Files Downloader
+ */
+UCLASS(Config = Game, DefaultConfig, meta = (DisplayName = "Runtime Files Downloader"))
+class RUNTIMEFILESDOWNLOADER_API URuntimeFilesDownloaderSettings : public UDeveloperSettings
+{
+	GENERATED_BODY()
+
+public:
+	URuntimeFilesDownloaderSettings();
+
+	//~ Begin UDeveloperSettings Interface
+	virtual FName GetCategoryName() const override;
+	//~ End UDeveloperSettings Interface
+
+	/** Whether to request compressed (gzip or deflate) transfer from the server using the Accept-Encoding header. Only the requests for the whole file ask for it, not the ones for its chunks. Since UE 5.4, a compressed response is decompressed on worker threads while it is received, and once downloaded on earlier versions. Other encodings, such as br or zstd, are not requested and fail the download if sent anyway */
+	UPROPERTY(Config, EditAnywhere, Category = "Compression")
+	bool bAcceptCompressedContent;
+
+	/** Whether to decompress downloaded files that are themselves gzip or zlib compressed, recognized by the .gz or .zz extension of their URL. Since UE 5.4, a file downloaded by payload is decompressed on worker threads while it is received */
+	UPROPERTY(Config, EditAnywhere, Category = "Compression")
+	bool bDecompressCompressedFiles;
+
+	/** The amount of texture memory, in megabytes, the texture cache keeps alive. Textures beyond the budget are only weakly referenced and are freed once nothing else uses them */
+	UPROPERTY(Config, EditAnywhere, Category = "Texture Cache", meta = (ClampMin = "0", UIMin = "0"))
+	int32 TextureCacheBudgetMB;
+
+	/** Whether to copy the downloaded data and write the downloaded files on worker threads, keeping multi-megabyte copies and disk writes off the game thread */
+	UPROPERTY(Config, EditAnywhere, Category = "Threading")
+	bool bProcessDownloadsOnWorkerThreads;
+
+	/** The minimum interval between two progress callbacks in seconds, so that progress updates are delivered in batches. 0 to deliver every update */
+	UPROPERTY(Config, EditAnywhere, Category = "Threading", meta = (ClampMin = "0", UIMin = "0", Units = "s"))
+	float ProgressCallbackInterval;
+
+	/** Whether to pause prefetching while any world is part of a networked game, so that prefetches do not compete with gameplay traffic */
+	UPROPERTY(Config, EditAnywhere, Category = "Prefetch")
+	bool bPausePrefetchDuringNetworkedPlay;
+
+	/** The amount of prefetched data, in megabytes, kept in memory until requested. The oldest prefetched files are freed beyond the limit */
+	UPROPERTY(Config, EditAnywhere, Category = "Prefetch", meta = (ClampMin = "0", UIMin = "0"))
+	int32 MaxPrefetchedMB;
+
+	/** Whether to check the free disk space and the directory quotas against the content size before downloading a file to storage, and reserve the space until the file is saved */
+	UPROPERTY(Config, EditAnywhere, Category = "Storage")
+	bool bCheckDiskSpaceBeforeDownload;
+
+	/** The amount of disk space, in megabytes, that downloads to storage must leave free */
+	UPROPERTY(Config, EditAnywhere, Category = "Storage", meta = (ClampMin = "0", UIMin = "0", EditCondition = "bCheckDiskSpaceBeforeDownload"))
+	int32 MinFreeDiskSpaceMB;
+
+	/** Whether to request the first chunk of a download right away and learn the file size from the Content-Range header, instead of sending a HEAD request first. Servers ignoring the range are handled by keeping the full response */
+	UPROPERTY(Config, EditAnywhere, Category = "Latency")
+	bool bFastStartDownloads;
+
+	/** Whether to resume the downloads of the persistent download queue left unfinished by the previous run once the engine is initialized. Not done in the editor */
+	UPROPERTY(Config, EditAnywhere, Category = "Download Queue")
+	bool bResumeDownloadQueueOnStartup;
+
+	/** The number of times a download of the persistent download queue is attempted, across runs, before it is dropped from the queue */
+	UPROPERTY(Config, EditAnywhere, Category = "Download Queue", meta = (ClampMin = "1", UIMin = "1"))
+	int32 DownloadQueueMaxAttempts;
+};
@@ -0,0 +1,80 @@
+// Georgy Treshchev 2024.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RuntimeFilesDownloaderStats.generated.h"
+
+/**
+ * Statistics of a single chunk request
+ */
+USTRUCT(BlueprintType, Category = "Runtime Files Downloader")
+struct RUNTIMEFILESDOWNLOADER_API FRuntimeChunkDownloadStats
+{
+	GENERATED_BODY()
+
+	/** Offset of the chunk in the file, in bytes */
+	UPROPERTY(BlueprintReadOnly, Category = "Runtime Files Downloader")
+	int64 Offset = 0;
+
+	/** Number of body bytes received for the chunk */
+	UPROPERTY(BlueprintReadOnly, Category = "Runtime Files Downloader")
+	int64 Size = 0;
+
+	/** Time from issuing the chunk request until its completion, in seconds */
+	UPROPERTY(BlueprintReadOnly, Category = "Runtime Files Downloader")
+	float Duration = 0;
+
+	/** Whether the chunk was downloaded successfully */
+	UPROPERTY(BlueprintReadOnly, Category = "Runtime Files Downloader")
+	bool bSucceeded = false;
+};
+
+/**
+ * Statistics gathered during a download, used to tune chunk sizes, concurrency and mirrors
+ */
+USTRUCT(BlueprintType, Category = "Runtime Files Downloader")
+struct RUNTIMEFILESDOWNLOADER_API FRuntimeFilesDownloaderStats
+{
+	GENERATED_BODY()
+
+	/** Latency of the last content size (HEAD) request, in seconds. Negative if no such request was made */
+	UPROPERTY(BlueprintReadOnly, Category = "Runtime Files Downloader")
+	float ContentSizeRequestLatency = -1;
+
+	/** Time from the start of the download until the first body byte was received, in seconds. Negative if nothing has been received yet */
+	UPROPERTY(BlueprintReadOnly, Category = "Runtime Files Downloader")
+	float TimeToFirstByte = -1;
+
+	/** Time from the start of the download until the last finished request, in seconds */
+	UPROPERTY(BlueprintReadOnly, Category = "Runtime Files Downloader")
+	float Duration = 0;
+
+	/** Number of body bytes received, including the bytes that were discarded later */
+	UPROPERTY(BlueprintReadOnly, Category = "Runtime Files Downloader")
+	int64 BytesReceived = 0;
+
+	/** Number of received bytes that were discarded, e.g. chunks thrown away when falling back to downloading by payload */
+	UPROPERTY(BlueprintReadOnly, Category = "Runtime Files Downloader")
+	int64 BytesWasted = 0;
+
+	/** Achieved throughput over the whole download, in bytes per second */
+	UPROPERTY(BlueprintReadOnly, Category = "Runtime Files Downloader")
+	float Throughput = 0;
+
+	/** Number of requests that had to be made again, e.g. chunks interrupted by pausing or fallbacks to downloading by payload */
+	UPROPERTY(BlueprintReadOnly, Category = "Runtime Files Downloader")
+	int32 RetryCount = 0;
+
+	/** Peak amount of memory held in download buffers, in bytes */
+	UPROPERTY(BlueprintReadOnly, Category = "Runtime Files Downloader")
+	int64 PeakBufferMemory = 0;
+
+	/** Number of chunk requests that have completed, including those no longer kept in Chunks */
+	UPROPERTY(BlueprintReadOnly, Category = "Runtime Files Downloader")
+	int32 ChunkCount = 0;
+
+	/** Statistics of the most recent chunk requests, in the order of completion. Only the last few hundred are kept, so that long-lived downloaders do not grow without limit */
+	UPROPERTY(BlueprintReadOnly, Category = "Runtime Files Downloader")
+	TArray<FRuntimeChunkDownloadStats> Chunks;
+};
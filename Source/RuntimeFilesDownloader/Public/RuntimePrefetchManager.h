@@ -0,0 +1,193 @@
+// Georgy Treshchev 2024.
+
+#pragma once
+
+#include "RuntimeChunkDownloader.h"
+#include "Misc/EngineVersionComparison.h"
+#include "Containers/Ticker.h"
+
+/**
+ * Prefetches files that are likely to be needed soon, such as the assets of the next level, using only spare bandwidth
+ * Prefetches are downloaded one at a time and paused while foreground downloads or gameplay networking are active
+ * Asking for a prefetched URL promotes the prefetch to a foreground download, and reuses the bytes downloaded so far
+ * Should only be used from the game thread
+ */
+class RUNTIMEFILESDOWNLOADER_API FRuntimePrefetchManager
+{
+public:
+	FRuntimePrefetchManager();
+	~FRuntimePrefetchManager();
+
+	/**
+	 * Get the prefetch manager shared by the downloaders
+	 */
+	static FRuntimePrefetchManager& Get();
+
+	/**
+	 * Check whether the prefetch manager has been created
+	 */
+	static bool IsAvailable();
+
+	/**
+	 * Cancel all the prefetches and destroy the prefetch manager. Called by the module on shutdown
+	 */
+	static void Shutdown();
+
+	/**
+	 * Queue the file for prefetching. Does nothing if the file is already prefetched or queued
+	 *
+	 * @param URL The URL of the file to prefetch
+	 * @param Timeout The timeout value in seconds
+	 * @param ContentType The content type of the file
+	 */
+	void Prefetch(const FString& URL, float Timeout = 0, const FString& ContentType = FString());
+
+	/**
+	 * Cancel prefetching the file and free its prefetched data
+	 *
+	 * @param URL The URL of the prefetched file
+	 */
+	void CancelPrefetch(const FString& URL);
+
+	/**
+	 * Cancel all the prefetches and free the prefetched data
+	 */
+	void CancelAllPrefetches();
+
+	/**
+	 * Check whether the file is queued, being prefetched or has been prefetched
+	 *
+	 * @param URL The URL of the file
+	 */
+	bool IsPrefetched(const FString& URL) const;
+
+	/**
+	 * Check whether the file has been fully prefetched
+	 *
+	 * @param URL The URL of the file
+	 */
+	bool IsPrefetchComplete(const FString& URL) const;
+
+	/**
+	 * Download the file in the foreground, promoting its prefetch if there is one, or starting a new download otherwise
+	 *
+	 * @param URL The URL of the file to download
+	 * @param Timeout The timeout value in seconds
+	 * @param ContentType The content type of the file
+	 * @param OnProgress A function that is called with the progress as BytesReceived and ContentSize
+	 * @return A future that resolves to the downloaded data
+	 */
+	TFuture<FRuntimeChunkDownloaderResult> Request(const FString& URL, float Timeout, const FString& ContentType, const FRuntimeChunkDownloader::FOnProgress& OnProgress);
+
+	/**
+	 * Take over the prefetch of the file as a foreground download. The prefetch is removed from the manager
+	 *
+	 * @param URL The URL of the file
+	 * @param OnProgress A function that is called with the progress of the remaining download as BytesReceived and ContentSize
+	 * @param OutDownloader The downloader of the prefetch, which can be used to control the download
+	 * @param OutFuture A future that resolves to the downloaded data
+	 * @return True if the file was being prefetched or had been prefetched, false if it has to be downloaded from scratch
+	 */
+	bool Claim(const FString& URL, const FRuntimeChunkDownloader::FOnProgress& OnProgress, TSharedPtr<FRuntimeChunkDownloader>& OutDownloader, TFuture<FRuntimeChunkDownloaderResult>& OutFuture);
+
+	/**
+	 * Mark the start of gameplay activity that prefetching must not compete with, e.g. a latency-sensitive network session. Prefetching stays paused until the matching EndForegroundActivity
+	 */
+	void BeginForegroundActivity();
+
+	/**
+	 * Mark the end of the gameplay activity started with BeginForegroundActivity
+	 */
+	void EndForegroundActivity();
+
+	/**
+	 * Check whether prefetching is held back by foreground downloads or gameplay activity
+	 */
+	bool IsForegroundActive() const;
+
+	/**
+	 * Set the maximum amount of prefetched data kept in memory. The oldest prefetched files are freed beyond the limit
+	 *
+	 * @param InMaxPrefetchedBytes The maximum size of the prefetched data in bytes
+	 */
+	void SetMaxPrefetchedBytes(int64 InMaxPrefetchedBytes);
+
+protected:
+	/**
+	 * A file queued, being prefetched or prefetched
+	 */
+	struct FPrefetchEntry
+	{
+		/** The URL of the file */
+		FString URL;
+
+		/** The timeout value in seconds */
+		float Timeout = 0;
+
+		/** The content type of the file */
+		FString ContentType;
+
+		/** The downloader of the prefetch, valid once started */
+		TSharedPtr<FRuntimeChunkDownloader> Downloader;
+
+		/** The prefetched data, once complete */
+		TArray64<uint8> Data;
+
+		/** Whether the prefetch is complete */
+		bool bComplete = false;
+
+		/** The promise of the foreground download the prefetch was promoted to */
+		TSharedPtr<TPromise<FRuntimeChunkDownloaderResult>> PromotedPromise;
+
+		/** The progress function of the foreground download the prefetch was promoted to */
+		FRuntimeChunkDownloader::FOnProgress PromotedOnProgress;
+	};
+
+	/**
+	 * Pause or resume the active prefetch and start the next queued one, depending on the foreground activity
+	 */
+	bool Tick(float DeltaTime);
+
+	/**
+	 * Start prefetching the file
+	 */
+	void StartPrefetch(const TSharedRef<FPrefetchEntry>& Entry);
+
+	/**
+	 * Handle the completion of the prefetch
+	 */
+	void OnPrefetchComplete(const TSharedRef<FPrefetchEntry>& Entry, FRuntimeChunkDownloaderResult&& Result);
+
+	/**
+	 * Free the oldest prefetched data beyond the limit
+	 */
+	void EvictOverLimit();
+
+	/** The queued, active and complete prefetches by URL */
+	TMap<FString, TSharedRef<FPrefetchEntry>> Entries;
+
+	/** URLs of the queued prefetches, in the order they were requested */
+	TArray<FString> Queue;
+
+	/** URLs of the complete prefetches, from the oldest to the newest */
+	TArray<FString> CompletedOrder;
+
+	/** The prefetch being downloaded */
+	TSharedPtr<FPrefetchEntry> ActiveEntry;
+
+	/** The number of foreground activities in progress */
+	int32 ForegroundActivityCount;
+
+	/** The size of the prefetched data in bytes */
+	int64 PrefetchedBytes;
+
+	/** The maximum size of the prefetched data in bytes */
+	int64 MaxPrefetchedBytes;
+
+	/** Handle of the ticker driving the prefetches */
+#if UE_VERSION_OLDER_THAN(5, 0, 0)
+	FDelegateHandle TickerHandle;
+#else
+	FTSTicker::FDelegateHandle TickerHandle;
+#endif
+};
@@ -0,0 +1,105 @@
+// Georgy Treshchev 2024.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GenericPlatform/GenericPlatformFile.h"
+#include "HAL/CriticalSection.h"
+#include "RuntimeChunkDownloader.h"
+
+/**
+ * Read-only file handle for a remote file, reading the requested parts of the file using the HTTP Range header
+ * Reads are blocking, so the handle must only be used outside of the game thread, which processes the HTTP requests
+ * Recently read blocks are kept in a small cache, and cache misses also fetch the following block to serve sequential reads with fewer requests
+ */
+class RUNTIMEFILESDOWNLOADER_API FRuntimeRemoteFileHandle : public IFileHandle
+{
+public:
+	/**
+	 * Open the remote file, requesting its size. Must not be called from the game thread
+	 *
+	 * @param URL The URL of the file
+	 * @param Timeout The timeout value of each request in seconds
+	 * @param BlockSize The size of the blocks the file is read and cached by, in bytes
+	 * @param MaxCachedBlocks The maximum number of blocks kept in the cache
+	 * @return The file handle, or nullptr if the file size could not be retrieved
+	 */
+	static TUniquePtr<FRuntimeRemoteFileHandle> Open(const FString& URL, float Timeout, int64 BlockSize = 256 * 1024, int32 MaxCachedBlocks = 16);
+
+	/**
+	 * @param InURL The URL of the file
+	 * @param InTimeout The timeout value of each request in seconds
+	 * @param InFileSize The size of the file in bytes
+	 * @param InBlockSize The size of the blocks the file is read and cached by, in bytes
+	 * @param InMaxCachedBlocks The maximum number of blocks kept in the cache
+	 */
+	FRuntimeRemoteFileHandle(const FString& InURL, float InTimeout, int64 InFileSize, int64 InBlockSize, int32 InMaxCachedBlocks);
+
+	//~ Begin IFileHandle Interface
+	virtual int64 Tell() override;
+	virtual bool Seek(int64 NewPosition) override;
+	virtual bool SeekFromEnd(int64 NewPositionRelativeToEnd = 0) override;
+	virtual bool Read(uint8* Destination, int64 BytesToRead) override;
+	virtual bool Write(const uint8* Source, int64 BytesToWrite) override;
+	virtual bool Flush(const bool bFullFlush = false) override;
+	virtual bool Truncate(int64 NewSize) override;
+	virtual int64 Size() override;
+	//~ End IFileHandle Interface
+
+	/**
+	 * Get the URL of the file
+	 */
+	const FString& GetURL() const
+	{
+		return URL;
+	}
+
+protected:
+	/**
+	 * Download the range of the file on the game thread and wait for the result
+	 *
+	 * @param Range The inclusive range to download
+	 * @param OutData The downloaded data
+	 * @return Whether the range was downloaded successfully or not
+	 */
+	bool FetchRange(FInt64Vector2 Range, TArray64<uint8>& OutData) const;
+
+	/**
+	 * Find the block in the cache, downloading it together with the following blocks if it is missing
+	 *
+	 * @param BlockIndex The index of the block
+	 * @param LastNeededBlockIndex The index of the last block needed by the current read, used to fetch several blocks at once
+	 * @return The block data, or nullptr if the block could not be downloaded
+	 */
+	const TArray64<uint8>* FindOrFetchBlock(int64 BlockIndex, int64 LastNeededBlockIndex);
+
+	/** The URL of the file */
+	FString URL;
+
+	/** The timeout value of each request in seconds */
+	float Timeout;
+
+	/** The size of the file in bytes */
+	int64 FileSize;
+
+	/** The size of the blocks the file is read and cached by, in bytes */
+	int64 BlockSize;
+
+	/** The maximum number of blocks kept in the cache */
+	int32 MaxCachedBlocks;
+
+	/** The current read position */
+	int64 Position;
+
+	/** The cached blocks by their index */
+	TMap<int64, TArray64<uint8>> CachedBlocks;
+
+	/** Indices of the cached blocks, from the least to the most recently used */
+	TArray<int64> CachedBlocksUsage;
+
+	/** The downloader used to make the range requests */
+	TSharedRef<FRuntimeChunkDownloader> ChunkDownloader;
+
+	/** Guards the block cache */
+	FCriticalSection CacheCriticalSection;
+};
@@ -0,0 +1,170 @@
+// Georgy Treshchev 2024.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/CriticalSection.h"
+
+/** Possible results of admitting a download to storage */
+enum class ERuntimeStorageAdmissionResult : uint8
+{
+	Admitted,
+	/** The free disk space, minus the space reserved by other downloads, is not enough for the file */
+	NotEnoughSpace,
+	/** The file would exceed the quota of a directory it is saved under, even after eviction */
+	QuotaExceeded
+};
+
+/**
+ * Space reserved on storage for a download that has not been saved yet. The space is released when the reservation is destroyed
+ */
+class RUNTIMEFILESDOWNLOADER_API FRuntimeStorageReservation
+{
+public:
+	FRuntimeStorageReservation(uint64 InReservationId, int64 InSize);
+	~FRuntimeStorageReservation();
+
+	/**
+	 * Get the reserved size in bytes
+	 */
+	int64 GetSize() const
+	{
+		return Size;
+	}
+
+private:
+	/** The identifier of the reservation in the storage admission */
+	uint64 ReservationId;
+
+	/** The reserved size in bytes */
+	int64 Size;
+};
+
+using FRuntimeStorageReservationPtr = TSharedPtr<FRuntimeStorageReservation, ESPMode::ThreadSafe>;
+
+/**
+ * Thread-safe admission control for downloads to storage
+ * Checks the free disk space and the quotas of the directories before a download starts, and reserves space for the downloads in flight
+ */
+class RUNTIMEFILESDOWNLOADER_API FRuntimeStorageAdmission
+{
+public:
+	/**
+	 * Function called when saving a file would exceed the quota of a directory, to free space e.g. by deleting the least recently used files
+	 * Called with the quota directory and the number of bytes to free, returns the number of bytes freed
+	 */
+	using FOnQuotaExceeded = TFunction<int64(const FString&, int64)>;
+
+	/**
+	 * Get the storage admission shared by the downloaders
+	 */
+	static FRuntimeStorageAdmission& Get();
+
+	/**
+	 * Check whether the file fits on storage and reserve the space for it until it is saved
+	 *
+	 * @param SavePath The absolute path the file will be saved to. The size of an existing file at the path is taken into account, as it will be replaced
+	 * @param Size The size of the file in bytes
+	 * @param OutReservation The reservation of the space, if admitted
+	 * @return The result of the admission
+	 */
+	ERuntimeStorageAdmissionResult Reserve(const FString& SavePath, int64 Size, FRuntimeStorageReservationPtr& OutReservation);
+
+	/**
+	 * Set the maximum size of the files stored under the directory
+	 * The size of the files is measured when the quota is set. It is then tracked as downloads are saved and files are evicted, and measured again on a worker thread after each change
+	 *
+	 * @param Directory The directory to limit
+	 * @param MaxBytes The maximum size of the files under the directory in bytes, including the files of the reservations
+	 * @param OnQuotaExceeded A function that is called to free space when a file would exceed the quota
+	 */
+	void SetDirectoryQuota(const FString& Directory, int64 MaxBytes, const FOnQuotaExceeded& OnQuotaExceeded = nullptr);
+
+	/**
+	 * Remove the quota of the directory
+	 *
+	 * @param Directory The directory to stop limiting
+	 */
+	void RemoveDirectoryQuota(const FString& Directory);
+
+	/**
+	 * Get the number of bytes reserved by the downloads in flight
+	 */
+	int64 GetReservedBytes() const;
+
+	/**
+	 * Get the total size of the files under the directory
+	 *
+	 * @param Directory The directory to calculate the size of
+	 * @return The size of the files in bytes
+	 */
+	static int64 GetDirectorySize(const FString& Directory);
+
+private:
+	friend class FRuntimeStorageReservation;
+
+	/**
+	 * Release the space of the reservation
+	 */
+	void Release(uint64 ReservationId);
+
+	/**
+	 * Get the number of bytes reserved for files under the directory. The lock must be held
+	 */
+	int64 GetReservedBytesUnder(const FString& Directory) const;
+
+	/**
+	 * A reservation of a download in flight
+	 */
+	struct FReservation
+	{
+		/** The absolute path the file will be saved to */
+		FString SavePath;
+
+		/** The reserved size in bytes */
+		int64 Size = 0;
+	};
+
+	/**
+	 * A quota of a directory
+	 */
+	struct FQuota
+	{
+		/** The maximum size of the files under the directory in bytes */
+		int64 MaxBytes = 0;
+
+		/** The function called to free space when a file would exceed the quota */
+		FOnQuotaExceeded OnQuotaExceeded;
+
+		/** The size of the files under the directory in bytes, as last measured and adjusted since */
+		int64 UsedBytes = 0;
+
+		/** Whether the size of the files is being measured on a worker thread */
+		bool bScanInProgress = false;
+
+		/** Whether the files have changed since the measurement in progress started, so that it has to be repeated */
+		bool bScanOutdated = false;
+	};
+
+	/**
+	 * Get the number of bytes by which saving a file of the required size would exceed the quota. The lock must be held
+	 */
+	int64 GetExceedingBytes(const FString& Directory, const FQuota& Quota, int64 RequiredBytes) const;
+
+	/**
+	 * Measure the size of the files under the quota directory again on a worker thread. The lock must be held
+	 */
+	void ScheduleUsageScan(const FString& Directory, FQuota& Quota);
+
+	/** Guards the reservations and the quotas */
+	mutable FCriticalSection Lock;
+
+	/** The reservations of the downloads in flight by their identifiers */
+	TMap<uint64, FReservation> Reservations;
+
+	/** The quotas by their absolute directories */
+	TMap<FString, FQuota> Quotas;
+
+	/** The identifier of the next reservation */
+	uint64 NextReservationId = 1;
+};
@@ -0,0 +1,71 @@
+// Georgy Treshchev 2024.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct z_stream_s;
+
+/**
+ * Decompresses gzip or zlib (deflate) compressed data incrementally, slice by slice, without knowing the decompressed size in advance
+ */
+class RUNTIMEFILESDOWNLOADER_API FRuntimeStreamDecompressor
+{
+public:
+	/**
+	 * @param bRawDeflate Whether the data is raw deflate without a gzip or zlib header, as stored in zip archives
+	 */
+	explicit FRuntimeStreamDecompressor(bool bRawDeflate = false);
+	~FRuntimeStreamDecompressor();
+
+	FRuntimeStreamDecompressor(const FRuntimeStreamDecompressor&) = delete;
+	FRuntimeStreamDecompressor& operator=(const FRuntimeStreamDecompressor&) = delete;
+
+	/**
+	 * Decompress the next slice of the compressed stream
+	 *
+	 * @param CompressedData The next slice of compressed data
+	 * @param CompressedSize The size of the slice in bytes
+	 * @param OutDecompressedData The array to append the decompressed data to
+	 * @return Whether the slice was decompressed successfully or not
+	 */
+	bool Decompress(const uint8* CompressedData, int64 CompressedSize, TArray64<uint8>& OutDecompressedData);
+
+	/**
+	 * Check whether the end of the compressed stream has been reached
+	 *
+	 * @return True if the whole compressed stream has been decompressed, false otherwise
+	 */
+	bool IsFinished() const;
+
+	/**
+	 * Check whether the data starts with a gzip or zlib header
+	 *
+	 * @param Data The data to check
+	 * @param Size The size of the data in bytes
+	 * @return True if the data looks compressed, false otherwise
+	 */
+	static bool IsCompressed(const uint8* Data, int64 Size);
+
+	/**
+	 * Decompress the whole gzip or zlib compressed buffer
+	 *
+	 * @param CompressedData The compressed data
+	 * @param OutDecompressedData The decompressed data
+	 * @return Whether the decompression was successful or not
+	 */
+	static bool DecompressBuffer(const TArray64<uint8>& CompressedData, TArray64<uint8>& OutDecompressedData);
+
+private:
+	/** The zlib stream state */
+	TUniquePtr<z_stream_s> Stream;
+
+	/** Intermediate buffer the data is decompressed into before being appended to the output */
+	TArray<uint8> OutputBuffer;
+
+	/** Whether the zlib stream has been initialized successfully */
+	bool bInitialized;
+
+	/** Whether the end of the compressed stream has been reached */
+	bool bFinished;
+};
@@ -0,0 +1,137 @@
+// Georgy Treshchev 2024.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/GCObject.h"
+#include "UObject/WeakObjectPtrTemplates.h"
+
+class UTexture2D;
+
+/**
+ * Cache of textures created from downloaded images, keyed by the URL and the requested size
+ * The most recently used textures are kept alive up to the memory budget. Textures beyond the budget are only weakly referenced, so they are reused while something else still holds them and freed otherwise
+ * Must only be used on the game thread
+ */
+class RUNTIMEFILESDOWNLOADER_API FRuntimeTextureCache : public FGCObject
+{
+public:
+	FRuntimeTextureCache();
+
+	/**
+	 * Get the texture cache shared by the downloaders
+	 */
+	static FRuntimeTextureCache& Get();
+
+	/**
+	 * Destroy the shared texture cache, releasing all the textures it keeps alive
+	 */
+	static void Shutdown();
+
+	/**
+	 * Make the cache key for the image
+	 *
+	 * @param URL The URL of the image
+	 * @param MaxSize The maximum size the image is downscaled to, zero components meaning no limit
+	 * @param bGenerateMips Whether the texture has the full mip chain
+	 * @return The cache key
+	 */
+	static FString MakeKey(const FString& URL, const FIntPoint& MaxSize, bool bGenerateMips);
+
+	/**
+	 * Find the texture in the cache and mark it as the most recently used
+	 *
+	 * @param Key The cache key
+	 * @return The cached texture, or nullptr if it is not cached or was already freed
+	 */
+	UTexture2D* Find(const FString& Key);
+
+	/**
+	 * Add the texture to the cache as the most recently used, evicting the least recently used textures over the budget
+	 *
+	 * @param Key The cache key
+	 * @param Texture The texture to cache
+	 */
+	void Add(const FString& Key, UTexture2D* Texture);
+
+	/**
+	 * Remove the texture from the cache
+	 *
+	 * @param Key The cache key
+	 */
+	void Remove(const FString& Key);
+
+	/**
+	 * Remove all the textures from the cache
+	 */
+	void Empty();
+
+	/**
+	 * Set the amount of texture memory the cache keeps alive
+	 *
+	 * @param InBudgetBytes The budget in bytes
+	 */
+	void SetBudget(int64 InBudgetBytes);
+
+	/**
+	 * Get the amount of texture memory the cache keeps alive, in bytes
+	 */
+	int64 GetBudget() const
+	{
+		return BudgetBytes;
+	}
+
+	/**
+	 * Get the amount of texture memory currently kept alive by the cache, in bytes
+	 */
+	int64 GetUsedBytes() const
+	{
+		return UsedBytes;
+	}
+
+	//~ Begin FGCObject Interface
+	virtual void AddReferencedObjects(FReferenceCollector& Collector) override;
+	virtual FString GetReferencerName() const override;
+	//~ End FGCObject Interface
+
+protected:
+	/**
+	 * A cached texture
+	 */
+	struct FEntry
+	{
+		/** The texture, valid as long as something keeps it alive */
+		TWeakObjectPtr<UTexture2D> WeakTexture;
+
+		/** The texture kept alive by the cache, or nullptr once evicted over the budget */
+		UTexture2D* StrongTexture = nullptr;
+
+		/** The memory used by the texture, in bytes */
+		int64 Size = 0;
+
+		/** The value of the use counter when the texture was last used */
+		uint64 LastUsed = 0;
+	};
+
+	/**
+	 * Stop keeping alive the least recently used textures until the used memory fits the budget
+	 */
+	void EvictOverBudget();
+
+	/**
+	 * Remove the entries whose textures were freed
+	 */
+	void RemoveStaleEntries();
+
+	/** The cached textures by their keys */
+	TMap<FString, FEntry> Entries;
+
+	/** The amount of texture memory the cache keeps alive, in bytes */
+	int64 BudgetBytes;
+
+	/** The amount of texture memory currently kept alive, in bytes */
+	int64 UsedBytes;
+
+	/** Incremented on each use, used to find the least recently used textures */
+	uint64 UseCounter;
+};
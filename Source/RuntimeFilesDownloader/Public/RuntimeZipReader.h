@@ -0,0 +1,105 @@
+// Georgy Treshchev 2024.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GenericPlatform/GenericPlatformFile.h"
+
+/**
+ * An entry of a zip archive
+ */
+struct RUNTIMEFILESDOWNLOADER_API FRuntimeZipEntry
+{
+	/** Path of the entry within the archive */
+	FString Name;
+
+	/** Compression method of the entry. Stored (0) and deflate (8) are supported */
+	uint16 CompressionMethod = 0;
+
+	/** CRC-32 of the uncompressed data */
+	uint32 Crc32 = 0;
+
+	/** Size of the compressed data, in bytes */
+	int64 CompressedSize = 0;
+
+	/** Size of the uncompressed data, in bytes */
+	int64 UncompressedSize = 0;
+
+	/** Offset of the local file header of the entry in the archive */
+	int64 LocalHeaderOffset = 0;
+};
+
+/**
+ * Reads individual entries of a zip archive through a file handle, reading only the central directory and the requested entries
+ * Used with FRuntimeRemoteFileHandle, this allows extracting a few files from a large remote archive without downloading all of it
+ * Reads are blocking, so the reader must only be used outside of the game thread when reading a remote archive
+ */
+class RUNTIMEFILESDOWNLOADER_API FRuntimeZipReader
+{
+public:
+	/**
+	 * @param InFileHandle The handle of the archive to read
+	 */
+	explicit FRuntimeZipReader(TUniquePtr<IFileHandle> InFileHandle);
+
+	/**
+	 * Read the central directory of the archive. Must be called before reading the entries
+	 *
+	 * @return Whether the central directory was read successfully or not
+	 */
+	bool ReadCentralDirectory();
+
+	/**
+	 * Get the entries of the archive, available once the central directory has been read
+	 */
+	const TArray<FRuntimeZipEntry>& GetEntries() const
+	{
+		return Entries;
+	}
+
+	/**
+	 * Find the entry by its path within the archive
+	 *
+	 * @param Name The path of the entry
+	 * @return The entry, or nullptr if the archive does not contain it
+	 */
+	const FRuntimeZipEntry* FindEntry(const FString& Name) const;
+
+	/**
+	 * Read and decompress the entry
+	 *
+	 * @param Entry The entry to read
+	 * @param OutData The uncompressed data of the entry
+	 * @return Whether the entry was read successfully and its checksum matches or not
+	 */
+	bool ReadEntry(const FRuntimeZipEntry& Entry, TArray64<uint8>& OutData);
+
+	/**
+	 * Read and decompress the entry by its path within the archive
+	 *
+	 * @param Name The path of the entry
+	 * @param OutData The uncompressed data of the entry
+	 * @return Whether the entry was read successfully and its checksum matches or not
+	 */
+	bool ReadEntry(const FString& Name, TArray64<uint8>& OutData);
+
+protected:
+	/**
+	 * Read the bytes at the specified offset of the archive
+	 */
+	bool ReadAt(int64 Offset, int64 Size, TArray64<uint8>& OutData);
+
+	/**
+	 * Parse the entries of the central directory
+	 */
+	bool ParseCentralDirectory(const TArray64<uint8>& CentralDirectory, int64 EntryCount);
+
+	/** The handle of the archive */
+	TUniquePtr<IFileHandle> FileHandle;
+
+	/** The entries of the archive */
+	TArray<FRuntimeZipEntry> Entries;
+
+	/** Indices of the entries by their paths */
+	TMap<FString, int32> EntryIndices;
+};
@@ -18,6 +18,16 @@ public class RuntimeFilesDownloader : ModuleRules
 			}
 		);
 		
+		// Developer settings were moved out of the Engine module in 4.26
+		if (Target.Version.MajorVersion > 4 || Target.Version.MinorVersion >= 26)
+		{
+			PublicDependencyModuleNames.Add("DeveloperSettings");
+		}
+
+		PrivateDependencyModuleNames.AddRange(new string[] { "Json", "ImageWrapper", "Sockets", "Networking" });
+
+		AddEngineThirdPartyPrivateStaticDependencies(Target, "zlib");
+
 		if (Target.Platform == UnrealTargetPlatform.Android)
 		{
 			PrivateDependencyModuleNames.Add("AndroidPermission");